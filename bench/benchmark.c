@@ -0,0 +1,455 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      benchmark.c
+**
+**      Copyright (C) 1998-2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/**
+ * @file
+ * Runs micro-benchmarks of the library's internal routines and end-to-end
+ * encode and decode benchmarks over deterministic corpora, printing one line
+ * per benchmark in a fixed format so runs can be diffed.
+ */
+
+// local
+#include "pjl_config.h"
+#include "common.h"
+#include "corpus.h"
+#include "txt2pdbdoc.h"
+#include "util.h"
+
+// standard
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <time.h>
+#include <unistd.h>                     /* for getopt() */
+
+#if defined(__x86_64__) || defined(__i386__)
+# include <x86intrin.h>                 /* for __rdtsc() */
+# define BENCH_HAVE_RDTSC 1
+#else
+# define BENCH_HAVE_RDTSC 0
+#endif
+
+#define BENCH_MIN_SECS_DEFAULT  0.5     /* minimum time per benchmark */
+#define MEM_FIND_WINDOW         2047    /* mirrors compress.c's DISP_BITS */
+#define MEM_FIND_STEP           64      /* bytes between mem_find() calls */
+
+/**
+ * The data all benchmarks of a given corpus share.
+ */
+struct bench_ctx {
+  t2pd_t         *t;                    ///< Conversion handle.
+  uint8_t        *text;                 ///< The UTF-8 corpus...
+  size_t          text_len;             ///< ...and its length.
+  uint8_t        *palm;                 ///< The corpus in PalmOS characters...
+  size_t          palm_len;             ///< ...and its length.
+  uint8_t        *z;                    ///< Compressed records...
+  size_t         *z_lens;               ///< ...the length of each...
+  size_t          z_len;                ///< ...and their total length.
+  size_t          num_recs;             ///< Number of records.
+  void           *pdb;                  ///< The encoded Doc file...
+  size_t          pdb_len;              ///< ...and its length.
+  uint8_t         scratch[ T2PD_COMPRESS_BOUND( RECORD_SIZE_MAX ) ];
+};
+typedef struct bench_ctx bench_ctx_t;
+
+/**
+ * The signature for a benchmark function.
+ *
+ * @param ctx The bench_ctx.
+ * @return Returns the number of bytes processed.
+ */
+typedef size_t (*bench_fn)( bench_ctx_t *ctx );
+
+/**
+ * A benchmark.
+ */
+struct bench {
+  char const     *name;                 ///< The benchmark's name.
+  bench_fn        fn;                   ///< The function to run.
+};
+typedef struct bench bench_t;
+
+////////// extern variables ///////////////////////////////////////////////////
+
+char const  *me;
+
+////////// local variables ////////////////////////////////////////////////////
+
+static double   min_secs = BENCH_MIN_SECS_DEFAULT;
+static char const *only_benches;        // comma-separated benchmarks to run
+static char const *only_kinds;          // comma-separated corpora to run
+static uint64_t seed = 1;
+static volatile size_t sink;            // defeats dead-code elimination
+
+////////// local functions ////////////////////////////////////////////////////
+
+/**
+ * Checks whether a name is in a comma-separated list.
+ *
+ * @param list The list or NULL for all names.
+ * @param name The name to check.
+ * @return Returns `true` only if \a list is NULL or \a name is in it.
+ */
+NODISCARD
+static bool in_list( char const *list, char const *name ) {
+  if ( list == NULL )
+    return true;
+  size_t const name_len = strlen( name );
+  for ( char const *s = list; s != NULL; ) {
+    char const *const comma = strchr( s, ',' );
+    size_t const len = comma ? STATIC_CAST( size_t, comma - s ) : strlen( s );
+    if ( len == name_len && strncmp( s, name, len ) == 0 )
+      return true;
+    s = comma ? comma + 1 : NULL;
+  } // for
+  return false;
+}
+
+/**
+ * Gets the current monotonic time.
+ *
+ * @return Returns said time in seconds.
+ */
+NODISCARD
+static double now_secs( void ) {
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return STATIC_CAST( double, ts.tv_sec ) +
+         STATIC_CAST( double, ts.tv_nsec ) / 1e9;
+}
+
+/**
+ * Gets the current CPU cycle count, if available.
+ *
+ * @return Returns said count or 0 if unavailable.
+ */
+NODISCARD
+static uint64_t now_cycles( void ) {
+#if BENCH_HAVE_RDTSC
+  return __rdtsc();
+#else
+  return 0;
+#endif /* BENCH_HAVE_RDTSC */
+}
+
+/**
+ * Opens a memory buffer for reading as a `FILE`.
+ *
+ * @param buf The buffer.
+ * @param buf_len The length of \a buf.
+ * @return Returns said `FILE`.
+ */
+NODISCARD
+static FILE* open_mem( uint8_t *buf, size_t buf_len ) {
+  FILE *const f = fmemopen( buf, buf_len, "r" );
+  if ( f == NULL )
+    PERROR_EXIT( EX_OSERR );
+  return f;
+}
+
+////////// benchmarks /////////////////////////////////////////////////////////
+
+static size_t bench_compress( bench_ctx_t *ctx ) {
+  size_t z_len = 0;
+  for ( size_t i = 0; i < ctx->palm_len; i += RECORD_SIZE_MAX ) {
+    size_t const n = ctx->palm_len - i < RECORD_SIZE_MAX ?
+      ctx->palm_len - i : RECORD_SIZE_MAX;
+    size_t len;
+    PJL_DISCARD t2pd_compress( ctx->palm + i, n, ctx->scratch, &len );
+    z_len += len;
+  } // for
+  sink = z_len;
+  return ctx->palm_len;
+}
+
+static size_t bench_decode( bench_ctx_t *ctx ) {
+  void *out;
+  size_t out_len;
+  if ( t2pd_decode_mem( ctx->t, ctx->pdb, ctx->pdb_len, &out, &out_len ) !=
+       T2PD_OK ) {
+    PMESSAGE_EXIT( EX_SOFTWARE, "decode: %s\n", t2pd_errmsg( ctx->t ) );
+  }
+  free( out );
+  return out_len;
+}
+
+static size_t bench_encode( bench_ctx_t *ctx ) {
+  void *out;
+  size_t out_len;
+  if ( t2pd_encode_mem( ctx->t, "bench", ctx->text, ctx->text_len, &out,
+                        &out_len ) != T2PD_OK ) {
+    PMESSAGE_EXIT( EX_SOFTWARE, "encode: %s\n", t2pd_errmsg( ctx->t ) );
+  }
+  free( out );
+  return ctx->text_len;
+}
+
+static size_t bench_fill_buffer( bench_ctx_t *ctx ) {
+  FILE *const f = open_mem( ctx->text, ctx->text_len );
+  buffer_t buf = { ctx->scratch, 0 };
+  size_t total = 0;
+  do {
+    if ( t2pd_fill_buffer( ctx->t, f, &buf, RECORD_SIZE_MAX ) != T2PD_OK )
+      PMESSAGE_EXIT( EX_SOFTWARE, "fill_buffer: %s\n", t2pd_errmsg( ctx->t ) );
+    total += buf.len;
+  } while ( buf.len > 0 );
+  fclose( f );
+  sink = total;
+  return ctx->text_len;
+}
+
+static size_t bench_mem_find( bench_ctx_t *ctx ) {
+  size_t scanned = 0, found = 0;
+  for ( size_t i = MEM_FIND_WINDOW; i + 3 <= ctx->palm_len;
+        i += MEM_FIND_STEP ) {
+    uint8_t const *const window = ctx->palm + i - MEM_FIND_WINDOW;
+    found += STATIC_CAST( size_t,
+      mem_find( window, MEM_FIND_WINDOW + 3, ctx->palm + i, 3 ) - window
+    );
+    scanned += MEM_FIND_WINDOW;
+  } // for
+  sink = found;
+  return scanned;
+}
+
+static size_t bench_palm_to_utf8( bench_ctx_t *ctx ) {
+  char8_t utf8_char[ UTF8_CHAR_SIZE_MAX ];
+  size_t total = 0;
+  for ( size_t i = 0; i < ctx->palm_len; ++i )
+    total += t2pd_palm_to_utf8( ctx->t, ctx->palm[i], utf8_char );
+  sink = total;
+  return ctx->palm_len;
+}
+
+static size_t bench_uncompress( bench_ctx_t *ctx ) {
+  uint8_t const *z = ctx->z;
+  size_t total = 0;
+  for ( size_t r = 0; r < ctx->num_recs; z += ctx->z_lens[ r++ ] ) {
+    size_t len;
+    PJL_DISCARD t2pd_uncompress( z, ctx->z_lens[r], ctx->scratch,
+                                 sizeof ctx->scratch, &len );
+    total += len;
+  } // for
+  sink = total;
+  return ctx->palm_len;
+}
+
+static bench_t const BENCHES[] = {
+  { "fill_buffer",  &bench_fill_buffer  },
+  { "palm_to_utf8", &bench_palm_to_utf8 },
+  { "mem_find",     &bench_mem_find     },
+  { "compress",     &bench_compress     },
+  { "uncompress",   &bench_uncompress   },
+  { "encode",       &bench_encode       },
+  { "decode",       &bench_decode       },
+  { NULL,           NULL                }
+};
+
+////////// running ////////////////////////////////////////////////////////////
+
+/**
+ * Prepares the shared data for a corpus.
+ *
+ * @param ctx The bench_ctx to prepare.
+ * @param kind The kind of corpus.
+ * @param size The size of the corpus.
+ */
+static void ctx_init( bench_ctx_t *ctx, corpus_kind_t kind, size_t size ) {
+  t2pd_options_t opts;
+  t2pd_options_init( &opts );
+  opts.no_timestamp = true;
+  opts.no_warnings = true;
+  if ( (ctx->t = t2pd_new( &opts )) == NULL )
+    PERROR_EXIT( EX_OSERR );
+
+  ctx->text_len = size;
+  ctx->text = malloc( size + 1 );
+  ctx->palm = malloc( size + 1 );
+  ctx->num_recs = size / RECORD_SIZE_MAX + 1;
+  ctx->z = malloc( T2PD_COMPRESS_BOUND( size + 1 ) );
+  ctx->z_lens = malloc( ctx->num_recs * sizeof *ctx->z_lens );
+  if ( !ctx->text || !ctx->palm || !ctx->z || !ctx->z_lens )
+    PERROR_EXIT( EX_OSERR );
+  corpus_generate( kind, seed, ctx->text, size );
+
+  // transcode into PalmOS characters
+  FILE *const f = open_mem( ctx->text, ctx->text_len );
+  buffer_t buf = { ctx->palm, 0 };
+  ctx->palm_len = 0;
+  do {
+    buf.data = ctx->palm + ctx->palm_len;
+    if ( t2pd_fill_buffer( ctx->t, f, &buf, RECORD_SIZE_MAX ) != T2PD_OK )
+      PMESSAGE_EXIT( EX_SOFTWARE, "fill_buffer: %s\n", t2pd_errmsg( ctx->t ) );
+    ctx->palm_len += buf.len;
+  } while ( buf.len > 0 );
+  fclose( f );
+
+  // compress each record
+  ctx->num_recs = ctx->z_len = 0;
+  for ( size_t i = 0; i < ctx->palm_len; i += RECORD_SIZE_MAX ) {
+    size_t const n = ctx->palm_len - i < RECORD_SIZE_MAX ?
+      ctx->palm_len - i : RECORD_SIZE_MAX;
+    size_t len;
+    PJL_DISCARD t2pd_compress( ctx->palm + i, n, ctx->z + ctx->z_len, &len );
+    ctx->z_lens[ ctx->num_recs++ ] = len;
+    ctx->z_len += len;
+  } // for
+
+  if ( t2pd_encode_mem( ctx->t, "bench", ctx->text, ctx->text_len, &ctx->pdb,
+                        &ctx->pdb_len ) != T2PD_OK ) {
+    PMESSAGE_EXIT( EX_SOFTWARE, "encode: %s\n", t2pd_errmsg( ctx->t ) );
+  }
+}
+
+/**
+ * Frees the shared data for a corpus.
+ *
+ * @param ctx The bench_ctx to free.
+ */
+static void ctx_free( bench_ctx_t *ctx ) {
+  t2pd_free( ctx->t );
+  free( ctx->text );
+  free( ctx->palm );
+  free( ctx->z );
+  free( ctx->z_lens );
+  free( ctx->pdb );
+}
+
+/**
+ * Runs a benchmark repeatedly for at least \ref min_secs and prints its line.
+ *
+ * @param b The benchmark to run.
+ * @param ctx The bench_ctx to run it with.
+ * @param kind The kind of corpus.
+ */
+static void bench_run( bench_t const *b, bench_ctx_t *ctx,
+                       corpus_kind_t kind ) {
+  size_t bytes = 0;
+  double const start = now_secs();
+  uint64_t const start_cycles = now_cycles();
+  double elapsed;
+  do {
+    bytes += (*b->fn)( ctx );
+    elapsed = now_secs() - start;
+  } while ( elapsed < min_secs );
+  uint64_t const cycles = now_cycles() - start_cycles;
+
+  char cycles_buf[ 16 ] = "-";
+  if ( BENCH_HAVE_RDTSC && bytes > 0 ) {
+    snprintf( cycles_buf, sizeof cycles_buf, "%.2f",
+      STATIC_CAST( double, cycles ) / STATIC_CAST( double, bytes )
+    );
+  }
+
+  char ratio_buf[ 16 ] = "-";
+  if ( strcmp( b->name, "compress" ) == 0 && ctx->palm_len > 0 ) {
+    snprintf( ratio_buf, sizeof ratio_buf, "%.4f",
+      STATIC_CAST( double, ctx->z_len ) / STATIC_CAST( double, ctx->palm_len )
+    );
+  }
+  else if ( strcmp( b->name, "encode" ) == 0 && ctx->text_len > 0 ) {
+    snprintf( ratio_buf, sizeof ratio_buf, "%.4f",
+      STATIC_CAST( double, ctx->pdb_len ) / STATIC_CAST( double, ctx->text_len )
+    );
+  }
+
+  printf( "%-12s %-10s %12zu %10.2f %9s %8s\n",
+    b->name, corpus_name( kind ), ctx->text_len,
+    elapsed > 0 ? STATIC_CAST( double, bytes ) / elapsed / (1024 * 1024) : 0.0,
+    cycles_buf, ratio_buf
+  );
+  fflush( stdout );
+}
+
+/**
+ * Prints the usage message to standard error and exits.
+ */
+static void usage( void ) {
+  PRINT_ERR(
+"usage: %s [-b benches] [-k kinds] [-s seed] [-t seconds] [size...]\n"
+"\n"
+"options:\n"
+"  -b benches  Run only the comma-separated benchmarks [default: all].\n"
+"  -k kinds    Use only the comma-separated corpora [default: all].\n"
+"  -s seed     Set the corpus random number seed [default: 1].\n"
+"  -t seconds  Set minimum time per benchmark [default: %.1f].\n"
+"\n"
+"benches: fill_buffer, palm_to_utf8, mem_find, compress, uncompress, encode,\n"
+"         decode\n"
+"kinds:   ascii, latin1, symbol, repetitive, random\n"
+"size:    bytes, optionally followed by K, M, or G [default: 1M]\n"
+    , me, BENCH_MIN_SECS_DEFAULT
+  );
+  exit( EX_USAGE );
+}
+
+////////// main ///////////////////////////////////////////////////////////////
+
+int main( int argc, char *argv[] ) {
+  me = strrchr( argv[0], '/' );         // determine base name...
+  me = me ? me + 1 : argv[0];           // ...of executable
+
+  for ( int opt; (opt = getopt( argc, argv, "b:k:s:t:" )) != EOF; ) {
+    switch ( opt ) {
+      case 'b': only_benches = optarg;                  break;
+      case 'k': only_kinds = optarg;                    break;
+      case 's': seed = strtoull( optarg, NULL, 0 );     break;
+      case 't': min_secs = strtod( optarg, NULL );      break;
+      default : usage();
+    } // switch
+  } // for
+  argc -= optind;
+  argv += optind;
+
+  static char const *const DEFAULT_SIZES[] = { "1M" };
+  char const *const *const sizes =
+    argc > 0 ? STATIC_CAST( char const *const*, argv ) : DEFAULT_SIZES;
+  int const num_sizes = argc > 0 ? argc : 1;
+
+  printf( "# %-10s %-10s %12s %10s %9s %8s\n",
+    "benchmark", "corpus", "bytes", "MB/s", "cycles/B", "ratio"
+  );
+
+  for ( int i = 0; i < num_sizes; ++i ) {
+    size_t const size = corpus_parse_size( sizes[i] );
+    for ( unsigned k = 0; k < CORPUS_NUM_KINDS; ++k ) {
+      corpus_kind_t const kind = STATIC_CAST( corpus_kind_t, k );
+      if ( !in_list( only_kinds, corpus_name( kind ) ) )
+        continue;
+      bench_ctx_t *const ctx = calloc( 1, sizeof *ctx );
+      if ( ctx == NULL )
+        PERROR_EXIT( EX_OSERR );
+      ctx_init( ctx, kind, size );
+      for ( bench_t const *b = BENCHES; b->name != NULL; ++b )
+        if ( in_list( only_benches, b->name ) )
+          bench_run( b, ctx, kind );
+      ctx_free( ctx );
+      free( ctx );
+    } // for
+  } // for
+
+  exit( EXIT_SUCCESS );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* vim:set et sw=2 ts=2: */
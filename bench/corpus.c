@@ -0,0 +1,285 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      corpus.c
+**
+**      Copyright (C) 1998-2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+// local
+#include "pjl_config.h"
+#include "corpus.h"
+#include "util.h"
+
+// standard
+#include <assert.h>
+#include <ctype.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define LINE_WIDTH      72              /* wrap prose lines at this column */
+
+/**
+ * The state of generating a corpus.
+ */
+struct corpus_gen {
+  uint8_t  *buf;                        ///< The buffer to fill.
+  size_t    size;                       ///< The size of \a buf.
+  size_t    len;                        ///< Bytes generated so far.
+  size_t    col;                        ///< Current column of current line.
+  uint64_t  rng;                        ///< Random number generator state.
+};
+typedef struct corpus_gen corpus_gen_t;
+
+static char const *const CORPUS_NAMES[] = {
+  "ascii", "latin1", "symbol", "repetitive", "random"
+};
+
+static char const *const ASCII_WORDS[] = {
+  "the", "of", "and", "to", "in", "is", "was", "that", "for", "it", "with",
+  "as", "his", "on", "be", "at", "by", "had", "are", "but", "from", "or",
+  "have", "an", "they", "which", "one", "you", "were", "all", "her", "she",
+  "there", "would", "their", "we", "him", "been", "has", "when", "who",
+  "will", "no", "more", "if", "out", "so", "said", "what", "up", "its",
+  "about", "than", "into", "them", "can", "only", "other", "new", "some",
+  "could", "time", "these", "two", "may", "then", "do", "first", "any",
+  "now", "such", "like", "over", "even", "most", "made", "after", "also",
+  "many", "before", "must", "through", "back", "years", "where", "much",
+  "way", "well", "down", "should", "because", "each", "just", "those",
+  "people", "little", "state", "good", "very", "make", "world", "still",
+  "own", "work", "long", "here", "both", "between", "life", "being", "under",
+  "never", "day", "same", "another", "know", "while", "last", "might",
+  "great", "old", "year", "off", "come", "since", "against", "came", "right",
+  "used", "take", "three", "palm", "document", "record", "reader", "pilot"
+};
+
+static char const *const LATIN1_WORDS[] = {
+  "café", "naïve", "élève", "été", "où", "très", "garçon", "façade", "déjà",
+  "crème", "brûlée", "über", "schön", "Mädchen", "Größe", "Straße", "fünf",
+  "mañana", "niño", "señor", "corazón", "año", "São", "João", "ação",
+  "coração", "Ærø", "smørrebrød", "øl", "Ångström", "fjärd", "pâté", "rôle",
+  "señorita", "Zürich", "Köln", "Málaga", "Ísafjörður", "Þór", "ðe",
+  "le", "la", "et", "und", "der", "die", "el", "los", "de", "que", "em"
+};
+
+static char const *const SYMBOLS[] = {
+  "“", "”", "‘", "’", "—", "–", "…", "•", "€", "™", "©", "®", "°", "±", "×",
+  "÷", "§", "¶", "†", "‡", "‰", "«", "»", "¼", "½", "¾", "¢", "£", "¥"
+};
+
+static char const *const REPETITIVE_LINES[] = {
+  "The quick brown fox jumps over the lazy dog.\n",
+  "Pack my box with five dozen liquor jugs.\n",
+  "How vexingly quick daft zebras jump!\n",
+  "Sphinx of black quartz, judge my vow.\n"
+};
+
+////////// local functions ////////////////////////////////////////////////////
+
+/**
+ * Gets the next pseudo-random number via xorshift64*.
+ *
+ * @param g The corpus_gen to use.
+ * @param n The number of possible values.
+ * @return Returns a number in the range [0,n).
+ */
+NODISCARD
+static unsigned gen_rand( corpus_gen_t *g, unsigned n ) {
+  g->rng ^= g->rng >> 12;
+  g->rng ^= g->rng << 25;
+  g->rng ^= g->rng >> 27;
+  return STATIC_CAST( unsigned,
+    ((g->rng * 0x2545F4914F6CDD1DULL) >> 32) % n
+  );
+}
+
+/**
+ * Appends bytes to the corpus.  If they don't fit, pads the rest of the
+ * corpus with spaces so a UTF-8 sequence is never split.
+ *
+ * @param g The corpus_gen to use.
+ * @param s The bytes to append.
+ * @param s_len The number of bytes.
+ * @return Returns `true` only if there's room for more.
+ */
+NODISCARD
+static bool gen_put( corpus_gen_t *g, char const *s, size_t s_len ) {
+  if ( s_len > g->size - g->len ) {
+    memset( g->buf + g->len, ' ', g->size - g->len );
+    g->len = g->size;
+    return false;
+  }
+  memcpy( g->buf + g->len, s, s_len );
+  g->len += s_len;
+  char const *const nl = memchr( s, '\n', s_len );
+  g->col = nl != NULL ? STATIC_CAST( size_t, s + s_len - nl - 1 ) :
+                        g->col + s_len;
+  return g->len < g->size;
+}
+
+/**
+ * Appends a string to the corpus.
+ *
+ * @param g The corpus_gen to use.
+ * @param s The NULL-terminated string to append.
+ * @return Returns `true` only if there's room for more.
+ */
+NODISCARD
+static bool gen_puts( corpus_gen_t *g, char const *s ) {
+  return gen_put( g, s, strlen( s ) );
+}
+
+/**
+ * Appends a word to prose, preceded by either a space or, if it would pass
+ * #LINE_WIDTH, a newline.
+ *
+ * @param g The corpus_gen to use.
+ * @param word The NULL-terminated word to append.
+ * @param capitalize If `true`, capitalize the word's first letter (if ASCII).
+ * @return Returns `true` only if there's room for more.
+ */
+NODISCARD
+static bool gen_word( corpus_gen_t *g, char const *word, bool capitalize ) {
+  size_t const word_len = strlen( word );
+  if ( g->col > 0 && !gen_puts( g, g->col + word_len >= LINE_WIDTH ? "\n" : " " ) )
+    return false;
+  if ( capitalize && islower( (unsigned char)word[0] ) ) {
+    char const c = STATIC_CAST( char, toupper( (unsigned char)word[0] ) );
+    return gen_put( g, &c, 1 ) && gen_put( g, word + 1, word_len - 1 );
+  }
+  return gen_put( g, word, word_len );
+}
+
+/**
+ * Generates prose.
+ *
+ * @param g The corpus_gen to use.
+ * @param words The words to choose from.
+ * @param num_words The number of \a words.
+ * @param symbols If `true`, sprinkle symbols between words.
+ */
+static void gen_prose( corpus_gen_t *g, char const *const words[],
+                       size_t num_words, bool symbols ) {
+  char word_buf[ 64 ];
+  for (;;) {
+    unsigned const sentences = 3 + gen_rand( g, 5 );
+    for ( unsigned s = 0; s < sentences; ++s ) {
+      unsigned const sentence_words = 4 + gen_rand( g, 11 );
+      for ( unsigned w = 0; w < sentence_words; ++w ) {
+        char const *word = words[ gen_rand( g, STATIC_CAST( unsigned, num_words ) ) ];
+        if ( symbols && gen_rand( g, 3 ) == 0 ) {
+          char const *const sym =
+            SYMBOLS[ gen_rand( g, ARRAY_SIZE( SYMBOLS ) ) ];
+          if ( gen_rand( g, 2 ) )
+            snprintf( word_buf, sizeof word_buf, "%s%s", word, sym );
+          else
+            snprintf( word_buf, sizeof word_buf, "%s%s", sym, word );
+          word = word_buf;
+        }
+        if ( !gen_word( g, word, w == 0 ) )
+          return;
+        if ( w + 1 < sentence_words && gen_rand( g, 8 ) == 0 &&
+             !gen_puts( g, "," ) ) {
+          return;
+        }
+      } // for
+      if ( !gen_puts( g, "." ) )
+        return;
+    } // for
+    if ( !gen_puts( g, "\n\n" ) )
+      return;
+  } // for
+}
+
+////////// extern functions ///////////////////////////////////////////////////
+
+void corpus_generate( corpus_kind_t kind, uint64_t seed, uint8_t *buf,
+                      size_t size ) {
+  assert( buf != NULL );
+  if ( size == 0 )
+    return;
+
+  // splitmix64 so that similar seeds give dissimilar states
+  uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  corpus_gen_t g = {
+    .buf = buf, .size = size, .rng = (z ^ (z >> 31)) | 1
+  };
+
+  switch ( kind ) {
+    case CORPUS_ASCII:
+      gen_prose( &g, ASCII_WORDS, ARRAY_SIZE( ASCII_WORDS ), false );
+      break;
+    case CORPUS_LATIN1:
+      gen_prose( &g, LATIN1_WORDS, ARRAY_SIZE( LATIN1_WORDS ), false );
+      break;
+    case CORPUS_SYMBOL:
+      gen_prose( &g, ASCII_WORDS, ARRAY_SIZE( ASCII_WORDS ), true );
+      break;
+    case CORPUS_REPETITIVE:
+      for ( size_t i = 0;
+            gen_puts( &g, REPETITIVE_LINES[ i % ARRAY_SIZE( REPETITIVE_LINES ) ] );
+            ++i ) {
+        NO_OP;
+      } // for
+      break;
+    case CORPUS_RANDOM:
+      for ( size_t i = 0; i < size; ++i ) {
+        unsigned const r = gen_rand( &g, 96 );
+        buf[i] = STATIC_CAST( uint8_t, r == 95 ? '\n' : ' ' + r );
+      } // for
+      break;
+    case CORPUS_NUM_KINDS:
+      assert( false );
+  } // switch
+}
+
+char const* corpus_name( corpus_kind_t kind ) {
+  assert( kind < CORPUS_NUM_KINDS );
+  return CORPUS_NAMES[ kind ];
+}
+
+corpus_kind_t corpus_parse_kind( char const *s ) {
+  assert( s != NULL );
+  for ( unsigned k = 0; k < CORPUS_NUM_KINDS; ++k )
+    if ( strcmp( s, CORPUS_NAMES[k] ) == 0 )
+      return STATIC_CAST( corpus_kind_t, k );
+  return CORPUS_NUM_KINDS;
+}
+
+size_t corpus_parse_size( char const *s ) {
+  assert( s != NULL );
+  if ( isdigit( (unsigned char)s[0] ) ) {
+    char *end = NULL;
+    errno = 0;
+    unsigned long long n = strtoull( s, &end, 10 );
+    if ( errno == 0 ) {
+      switch ( toupper( (unsigned char)*end ) ) {
+        case 'G': n <<= 10; FALLTHROUGH;
+        case 'M': n <<= 10; FALLTHROUGH;
+        case 'K': n <<= 10; ++end;      FALLTHROUGH;
+        case '\0':
+          if ( *end == '\0' )
+            return STATIC_CAST( size_t, n );
+      } // switch
+    }
+  }
+  PMESSAGE_EXIT( EX_USAGE, "\"%s\": invalid size\n", s );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* vim:set et sw=2 ts=2: */
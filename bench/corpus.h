@@ -0,0 +1,99 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      corpus.h
+**
+**      Copyright (C) 1998-2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#ifndef txt2pdbdoc_corpus_H
+#define txt2pdbdoc_corpus_H
+
+/**
+ * @file
+ * Declares a deterministic generator of UTF-8 text corpora for benchmarks.
+ * The same kind, size, and seed always generate the same bytes on every
+ * platform.
+ */
+
+// local
+#include "pjl_config.h"
+
+// standard
+#include <stddef.h>                     /* for size_t */
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Kinds of corpora.
+ */
+enum corpus_kind {
+  CORPUS_ASCII,                         ///< English-like ASCII prose.
+  CORPUS_LATIN1,                        ///< Prose heavy in accented letters.
+  CORPUS_SYMBOL,                        ///< Prose heavy in punctuation symbols.
+  CORPUS_REPETITIVE,                    ///< A few lines repeated.
+  CORPUS_RANDOM,                        ///< Random printable ASCII.
+  CORPUS_NUM_KINDS
+};
+typedef enum corpus_kind corpus_kind_t;
+
+////////// extern functions ///////////////////////////////////////////////////
+
+/**
+ * Generates a corpus.
+ *
+ * @param kind The kind of corpus.
+ * @param seed The random number seed.
+ * @param buf The buffer to fill.  The text is always valid UTF-8 that maps
+ * entirely to the PalmOS character set.
+ * @param size The exact number of bytes to generate.
+ */
+void corpus_generate( corpus_kind_t kind, uint64_t seed, uint8_t *buf,
+                      size_t size );
+
+/**
+ * Gets the name of a kind of corpus.
+ *
+ * @param kind The kind of corpus.
+ * @return Returns said name.
+ */
+NODISCARD
+char const* corpus_name( corpus_kind_t kind );
+
+/**
+ * Parses the name of a kind of corpus.
+ *
+ * @param s The NULL-terminated name to parse.
+ * @return Returns the corresponding kind or #CORPUS_NUM_KINDS if none.
+ */
+NODISCARD
+corpus_kind_t corpus_parse_kind( char const *s );
+
+/**
+ * Parses a size with an optional `K`, `M`, or `G` (binary) suffix.
+ *
+ * @param s The NULL-terminated string to parse.
+ * @return Returns the size or prints an error message and exits if \a s is
+ * invalid.
+ */
+NODISCARD
+size_t corpus_parse_size( char const *s );
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif /* txt2pdbdoc_corpus_H */
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,95 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      gencorpus.c
+**
+**      Copyright (C) 1998-2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/**
+ * @file
+ * Writes a deterministic benchmark corpus to standard output.
+ */
+
+// local
+#include "pjl_config.h"
+#include "corpus.h"
+#include "util.h"
+
+// standard
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <unistd.h>                     /* for getopt() */
+
+////////// extern variables ///////////////////////////////////////////////////
+
+char const  *me;
+
+////////// local functions ////////////////////////////////////////////////////
+
+/**
+ * Prints the usage message to standard error and exits.
+ */
+static void usage( void ) {
+  PRINT_ERR(
+"usage: %s [-s seed] kind size\n"
+"\n"
+"kinds: ascii, latin1, symbol, repetitive, random\n"
+"size:  bytes, optionally followed by K, M, or G\n"
+    , me
+  );
+  exit( EX_USAGE );
+}
+
+////////// main ///////////////////////////////////////////////////////////////
+
+int main( int argc, char *argv[] ) {
+  uint64_t seed = 1;
+
+  me = strrchr( argv[0], '/' );         // determine base name...
+  me = me ? me + 1 : argv[0];           // ...of executable
+
+  for ( int opt; (opt = getopt( argc, argv, "s:" )) != EOF; ) {
+    switch ( opt ) {
+      case 's': seed = strtoull( optarg, NULL, 0 ); break;
+      default : usage();
+    } // switch
+  } // for
+  argc -= optind;
+  argv += optind;
+  if ( argc != 2 )
+    usage();
+
+  corpus_kind_t const kind = corpus_parse_kind( argv[0] );
+  if ( kind == CORPUS_NUM_KINDS )
+    usage();
+  size_t const size = corpus_parse_size( argv[1] );
+
+  uint8_t *const buf = malloc( size + 1 );
+  if ( buf == NULL )
+    PERROR_EXIT( EX_OSERR );
+  corpus_generate( kind, seed, buf, size );
+  FWRITE( buf, 1, size, stdout );
+  free( buf );
+  if ( fflush( stdout ) != 0 )
+    PERROR_EXIT( EX_IOERR );
+  exit( EXIT_SUCCESS );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* vim:set et sw=2 ts=2: */
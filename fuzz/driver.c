@@ -0,0 +1,308 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      driver.c
+**
+**      Copyright (C) 1998-2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/**
+ * @file
+ * Defines a standalone driver for the fuzzing harnesses for when libFuzzer
+ * isn't available.  It accepts a subset of libFuzzer's command line:
+ *
+ *      harness [-max_total_time=secs] [-runs=n] [-seed=n] [file|dir...]
+ *
+ * Without `-max_total_time` or `-runs`, it runs each given file once (which is
+ * also how AFL runs it via `@@`) to reproduce a crash.  Otherwise, it runs
+ * random inputs and random mutations of the given files (used only as seeds;
+ * directories are never written) until either limit is reached.
+ *
+ * Unlike libFuzzer, it is not coverage-guided.  If a harness crashes, the
+ * offending input is saved to `crash-`_harness_ first.
+ */
+
+// local
+#include "pjl_config.h"
+#include "fuzz.h"
+#include "util.h"
+
+// standard
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sysexits.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * A seed input.
+ */
+struct seed {
+  uint8_t  *data;                       ///< The input's bytes.
+  size_t    size;                       ///< The number of bytes of \a data.
+};
+typedef struct seed seed_t;
+
+////////// extern variables ///////////////////////////////////////////////////
+
+char const         *me;
+
+////////// local variables ////////////////////////////////////////////////////
+
+static char         crash_path[ 256 ];  // where to save a crashing input
+static uint8_t      input[ FUZZ_INPUT_MAX ];
+static size_t       input_size;
+static uint64_t     rng_state;
+static seed_t      *seeds;
+static size_t       num_seeds;
+
+////////// local functions ////////////////////////////////////////////////////
+
+/**
+ * Gets a pseudo-random number (xorshift64*).
+ *
+ * @return Returns said number.
+ */
+NODISCARD
+static uint64_t rng_next( void ) {
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return rng_state * 0x2545F4914F6CDD1Dull;
+}
+
+/**
+ * Gets a pseudo-random number in a range.
+ *
+ * @param n One past the largest number to get; must be &gt; 0.
+ * @return Returns a number in [0,\a n).
+ */
+NODISCARD
+static size_t rng_below( size_t n ) {
+  return STATIC_CAST( size_t, rng_next() % n );
+}
+
+/**
+ * Saves the current input to \ref crash_path when a harness crashes, then
+ * lets the signal take its default action.  Uses only async-signal-safe
+ * functions.
+ *
+ * @param sig The signal.
+ */
+static void on_crash( int sig ) {
+  int const fd = open( crash_path, O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+  if ( fd != -1 ) {
+    (void)!write( fd, input, input_size );
+    close( fd );
+  }
+  signal( sig, SIG_DFL );
+  raise( sig );
+}
+
+/**
+ * Runs the harness on the current input.
+ */
+static void run_input( void ) {
+  PJL_DISCARD LLVMFuzzerTestOneInput( input, input_size );
+}
+
+/**
+ * Adds a file as a seed.
+ *
+ * @param path The path of the file.
+ */
+static void add_seed_file( char const *path ) {
+  FILE *const f = fopen( path, "rb" );
+  if ( f == NULL )
+    PMESSAGE_EXIT( EX_NOINPUT, "\"%s\": %s\n", path, STRERROR );
+  seeds = realloc( seeds, (num_seeds + 1) * sizeof *seeds );
+  uint8_t *const data = malloc( FUZZ_INPUT_MAX );
+  if ( seeds == NULL || data == NULL )
+    PERROR_EXIT( EX_OSERR );
+  size_t const size = fread( data, 1, FUZZ_INPUT_MAX, f );
+  if ( ferror( f ) )
+    PMESSAGE_EXIT( EX_IOERR, "\"%s\": %s\n", path, STRERROR );
+  fclose( f );
+  seeds[ num_seeds++ ] = (seed_t){ data, size };
+}
+
+/**
+ * Adds a file or every regular file in a directory as seeds.
+ *
+ * @param path The path of the file or directory.
+ */
+static void add_seeds( char const *path ) {
+  struct stat st;
+  if ( stat( path, &st ) == -1 )
+    PMESSAGE_EXIT( EX_NOINPUT, "\"%s\": %s\n", path, STRERROR );
+  if ( !S_ISDIR( st.st_mode ) ) {
+    add_seed_file( path );
+    return;
+  }
+  DIR *const dir = opendir( path );
+  if ( dir == NULL )
+    PMESSAGE_EXIT( EX_NOINPUT, "\"%s\": %s\n", path, STRERROR );
+  for ( struct dirent const *de; (de = readdir( dir )) != NULL; ) {
+    char file_path[ 1024 ];
+    snprintf( file_path, sizeof file_path, "%s/%s", path, de->d_name );
+    if ( stat( file_path, &st ) == 0 && S_ISREG( st.st_mode ) )
+      add_seed_file( file_path );
+  } // for
+  closedir( dir );
+}
+
+/**
+ * Makes the next input: either random bytes or a random seed with a few
+ * random mutations.
+ */
+static void make_input( void ) {
+  if ( num_seeds == 0 || rng_below( 8 ) == 0 ) {
+    //
+    // Mostly short inputs, sometimes long ones, and often from a small
+    // alphabet so back-references and escapes are likely.
+    //
+    input_size = rng_below( rng_below( 4 ) == 0 ? FUZZ_INPUT_MAX : 256 );
+    unsigned const alphabet = rng_below( 2 ) ? 256 : 4;
+    uint8_t const base = STATIC_CAST( uint8_t, rng_next() );
+    for ( size_t i = 0; i < input_size; ++i )
+      input[i] = STATIC_CAST( uint8_t, base + rng_below( alphabet ) );
+    return;
+  }
+
+  seed_t const *const s = &seeds[ rng_below( num_seeds ) ];
+  memcpy( input, s->data, s->size );
+  input_size = s->size;
+
+  for ( unsigned n = 1 + STATIC_CAST( unsigned, rng_below( 8 ) ); n > 0; --n ) {
+    size_t const pos = input_size > 0 ? rng_below( input_size ) : 0;
+    switch ( rng_below( 5 ) ) {
+      case 0:                           // flip a bit
+        if ( input_size > 0 )
+          input[ pos ] ^= STATIC_CAST( uint8_t, 1u << rng_below( 8 ) );
+        break;
+      case 1:                           // set a byte
+        if ( input_size > 0 )
+          input[ pos ] = STATIC_CAST( uint8_t, rng_next() );
+        break;
+      case 2:                           // truncate
+        input_size = pos;
+        break;
+      case 3: {                         // insert a byte
+        if ( input_size == FUZZ_INPUT_MAX )
+          break;
+        memmove( input + pos + 1, input + pos, input_size - pos );
+        input[ pos ] = STATIC_CAST( uint8_t, rng_next() );
+        ++input_size;
+        break;
+      }
+      case 4: {                         // duplicate a chunk
+        size_t len = rng_below( 64 ) + 1;
+        if ( len > input_size - pos )
+          len = input_size - pos;
+        if ( input_size + len > FUZZ_INPUT_MAX )
+          break;
+        memmove( input + pos + len, input + pos, input_size - pos );
+        input_size += len;
+        break;
+      }
+    } // switch
+  } // for
+}
+
+/**
+ * Gets the current monotonic time.
+ *
+ * @return Returns said time in seconds.
+ */
+NODISCARD
+static double now_secs( void ) {
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return STATIC_CAST( double, ts.tv_sec ) +
+         STATIC_CAST( double, ts.tv_nsec ) / 1e9;
+}
+
+////////// main ///////////////////////////////////////////////////////////////
+
+int main( int argc, char *argv[] ) {
+  me = strrchr( argv[0], '/' );         // determine base name...
+  me = me ? me + 1 : argv[0];           // ...of executable
+
+  unsigned long max_secs = 0, max_runs = 0;
+  bool limited = false;
+  rng_state = STATIC_CAST( uint64_t, time( NULL ) );
+
+  for ( int i = 1; i < argc; ++i ) {
+    char const *const arg = argv[i];
+    if ( strncmp( arg, "-max_total_time=", 16 ) == 0 ) {
+      max_secs = strtoul( arg + 16, NULL, 10 );
+      limited = true;
+    } else if ( strncmp( arg, "-runs=", 6 ) == 0 ) {
+      max_runs = strtoul( arg + 6, NULL, 10 );
+      limited = true;
+    } else if ( strncmp( arg, "-seed=", 6 ) == 0 ) {
+      rng_state = strtoull( arg + 6, NULL, 10 );
+    } else if ( arg[0] == '-' ) {
+      PMESSAGE( "\"%s\": ignoring unsupported option\n", arg );
+    } else {
+      add_seeds( arg );
+    }
+  } // for
+  if ( rng_state == 0 )                 // xorshift gets stuck at 0
+    rng_state = 1;
+
+  snprintf( crash_path, sizeof crash_path, "crash-%s", me );
+  static int const CRASH_SIGNALS[] = {
+    SIGABRT, SIGBUS, SIGFPE, SIGILL, SIGSEGV
+  };
+  for ( size_t i = 0; i < sizeof CRASH_SIGNALS / sizeof CRASH_SIGNALS[0]; ++i )
+    signal( CRASH_SIGNALS[i], &on_crash );
+
+  if ( !limited ) {                     // reproduce mode
+    for ( size_t i = 0; i < num_seeds; ++i ) {
+      memcpy( input, seeds[i].data, seeds[i].size );
+      input_size = seeds[i].size;
+      run_input();
+    } // for
+    exit( EXIT_SUCCESS );
+  }
+
+  double const start = now_secs();
+  unsigned long runs = 0;
+  for ( ; max_runs == 0 || runs < max_runs; ++runs ) {
+    if ( max_secs > 0 && runs % 256 == 0 &&
+         now_secs() - start >= STATIC_CAST( double, max_secs ) ) {
+      break;
+    }
+    make_input();
+    run_input();
+  } // for
+
+  printf( "%s: %lu runs in %.1f seconds; no crashes\n",
+    me, runs, now_secs() - start
+  );
+  exit( EXIT_SUCCESS );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,75 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      fuzz.h
+**
+**      Copyright (C) 1998-2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#ifndef txt2pdbdoc_fuzz_H
+#define txt2pdbdoc_fuzz_H
+
+/**
+ * @file
+ * Declares what every fuzzing harness defines.  Each harness is a
+ * libFuzzer-style entry point so it can be linked with libFuzzer, an AFL
+ * driver, or the standalone driver in driver.c.
+ */
+
+// local
+#include "pjl_config.h"
+#include "txt2pdbdoc.h"
+#include "util.h"
+
+// standard
+#include <stddef.h>                     /* for size_t */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>                     /* for abort() */
+
+/**
+ * The maximum number of bytes of input worth giving to any harness: enough for
+ * a text record of the largest size.
+ */
+#define FUZZ_INPUT_MAX            T2PD_RECORD_SIZE_MAX
+
+/**
+ * Checks that \a EXPR is true; if not, prints it and aborts so the fuzzing
+ * engine records the input as a crash.  Unlike `assert`, it's never compiled
+ * out.
+ */
+#define FUZZ_ASSERT(EXPR) BLOCK(                                      \
+  if ( !(EXPR) ) {                                                    \
+    fprintf( stderr, "%s:%d: fuzz assertion failed: %s\n",            \
+             __FILE__, __LINE__, #EXPR );                             \
+    abort();                                                          \
+  } )
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Runs a harness on one input.
+ *
+ * @param data The input.
+ * @param size The number of bytes of \a data.
+ * @return Always returns 0.
+ */
+int LLVMFuzzerTestOneInput( uint8_t const *data, size_t size );
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif /* txt2pdbdoc_fuzz_H */
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,87 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      fuzz_decode.c
+**
+**      Copyright (C) 1998-2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/**
+ * @file
+ * Fuzzes the decoder with arbitrary bytes, both as compressed record data and
+ * as a whole Doc file, checking only that it never misbehaves (which needs a
+ * build with sanitizers to be thorough) and that whatever it accepts is
+ * consistent.
+ */
+
+// local
+#include "pjl_config.h"
+#include "common.h"
+#include "fuzz.h"
+#include "palm.h"
+#include "txt2pdbdoc.h"
+
+// standard
+#include <stdlib.h>
+#include <string.h>
+
+////////// local variables ////////////////////////////////////////////////////
+
+static t2pd_t *t;                       // reused across inputs
+
+////////// extern functions ///////////////////////////////////////////////////
+
+int LLVMFuzzerTestOneInput( uint8_t const *data, size_t size ) {
+  if ( size > FUZZ_INPUT_MAX )
+    return 0;
+
+  ////////// as compressed record data ////////////////////////////////////////
+
+  //
+  // The first byte picks the output buffer size so that running out of room
+  // is exercised at every length, not just the record size.
+  //
+  size_t const dst_size = size > 0 ? data[0] * 32u : BUFFER_SIZE;
+  uint8_t *const dst = malloc( dst_size + 1 );
+  FUZZ_ASSERT( dst != NULL );
+  size_t dst_len, mismatch;
+  if ( t2pd_uncompress( data, size, dst, dst_size, &dst_len ) == T2PD_OK ) {
+    FUZZ_ASSERT( dst_len <= dst_size );
+    FUZZ_ASSERT(
+      t2pd_compress_check( data, size, dst, dst_len, &mismatch )
+    );
+  }
+  free( dst );
+
+  ////////// as a Doc file ////////////////////////////////////////////////////
+
+  if ( t == NULL ) {
+    t2pd_options_t opts;
+    t2pd_options_init( &opts );
+    opts.no_warnings = true;
+    t = t2pd_new( &opts );
+    FUZZ_ASSERT( t != NULL );
+  }
+  void *text;
+  size_t text_len;
+  if ( t2pd_decode_mem( t, data, size, &text, &text_len ) == T2PD_OK )
+    free( text );
+
+  return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* vim:set et sw=2 ts=2: */
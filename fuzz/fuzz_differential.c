@@ -0,0 +1,113 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      fuzz_differential.c
+**
+**      Copyright (C) 1998-2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/**
+ * @file
+ * Fuzzes t2pd_compress() and t2pd_uncompress() against the reference
+ * implementations in reference.c: for every input, both must produce
+ * identical bytes and statuses.
+ */
+
+// local
+#include "pjl_config.h"
+#include "common.h"
+#include "fuzz.h"
+#include "palm.h"
+#include "reference.h"
+#include "txt2pdbdoc.h"
+
+// standard
+#include <stdlib.h>
+#include <string.h>
+
+////////// local functions ////////////////////////////////////////////////////
+
+/**
+ * Checks that both compressors produce identical bytes.
+ *
+ * @param data The bytes to compress.
+ * @param size The number of bytes of \a data.
+ */
+static void diff_compress( uint8_t const *data, size_t size ) {
+  if ( size > T2PD_RECORD_SIZE_MAX )
+    size = T2PD_RECORD_SIZE_MAX;
+  size_t const z_size = T2PD_COMPRESS_BOUND( size );
+  uint8_t *const z = malloc( z_size + 1 );
+  uint8_t *const ref_z = malloc( z_size + 1 );
+  FUZZ_ASSERT( z != NULL && ref_z != NULL );
+
+  size_t z_len, ref_z_len;
+  FUZZ_ASSERT( t2pd_compress( data, size, z, &z_len ) == T2PD_OK );
+  FUZZ_ASSERT( ref_compress( data, size, ref_z, &ref_z_len ) == T2PD_OK );
+  FUZZ_ASSERT( z_len == ref_z_len );
+  FUZZ_ASSERT( memcmp( z, ref_z, z_len ) == 0 );
+
+  free( z );
+  free( ref_z );
+}
+
+/**
+ * Checks that both decompressors produce identical statuses and, if
+ * successful, identical bytes.
+ *
+ * @param data The bytes to uncompress.
+ * @param size The number of bytes of \a data.
+ * @param dst_size The size of the output buffer.
+ */
+static void diff_uncompress( uint8_t const *data, size_t size,
+                             size_t dst_size ) {
+  uint8_t *const out = malloc( dst_size + 1 );
+  uint8_t *const ref_out = malloc( dst_size + 1 );
+  FUZZ_ASSERT( out != NULL && ref_out != NULL );
+
+  size_t out_len, ref_out_len;
+  t2pd_status_t const status =
+    t2pd_uncompress( data, size, out, dst_size, &out_len );
+  t2pd_status_t const ref_status =
+    ref_uncompress( data, size, ref_out, dst_size, &ref_out_len );
+  FUZZ_ASSERT( status == ref_status );
+  if ( status == T2PD_OK ) {
+    FUZZ_ASSERT( out_len == ref_out_len );
+    FUZZ_ASSERT( memcmp( out, ref_out, out_len ) == 0 );
+  }
+
+  free( out );
+  free( ref_out );
+}
+
+////////// extern functions ///////////////////////////////////////////////////
+
+int LLVMFuzzerTestOneInput( uint8_t const *data, size_t size ) {
+  if ( size > FUZZ_INPUT_MAX )
+    return 0;
+  diff_compress( data, size );
+  diff_uncompress( data, size, BUFFER_SIZE );
+  diff_uncompress( data, size, T2PD_RECORD_SIZE_MAX );
+  if ( size > 1 ) {                     // also exercise running out of room
+    diff_uncompress( data + 2, size - 2,
+      STATIC_CAST( size_t, data[0] ) << 8 | data[1]
+    );
+  }
+  return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,70 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      fuzz_roundtrip.c
+**
+**      Copyright (C) 1998-2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/**
+ * @file
+ * Fuzzes that every buffer of up to #T2PD_RECORD_SIZE_MAX bytes survives being
+ * compressed and uncompressed, that compression stays within
+ * #T2PD_COMPRESS_BOUND, and that the round-trip check agrees.
+ */
+
+// local
+#include "pjl_config.h"
+#include "common.h"
+#include "fuzz.h"
+#include "palm.h"
+#include "txt2pdbdoc.h"
+
+// standard
+#include <stdlib.h>
+#include <string.h>
+
+////////// extern functions ///////////////////////////////////////////////////
+
+int LLVMFuzzerTestOneInput( uint8_t const *data, size_t size ) {
+  if ( size > T2PD_RECORD_SIZE_MAX )
+    size = T2PD_RECORD_SIZE_MAX;
+
+  //
+  // Exactly-sized heap buffers so a sanitizer catches any overrun.
+  //
+  size_t const z_size = T2PD_COMPRESS_BOUND( size );
+  uint8_t *const z = malloc( z_size + 1 );
+  uint8_t *const out = malloc( size + 1 );
+  FUZZ_ASSERT( z != NULL && out != NULL );
+
+  size_t z_len, out_len, mismatch;
+  FUZZ_ASSERT( t2pd_compress( data, size, z, &z_len ) == T2PD_OK );
+  FUZZ_ASSERT( z_len <= z_size );
+  FUZZ_ASSERT( t2pd_compress_check( z, z_len, data, size, &mismatch ) );
+  FUZZ_ASSERT(
+    t2pd_uncompress( z, z_len, out, size, &out_len ) == T2PD_OK
+  );
+  FUZZ_ASSERT( out_len == size );
+  FUZZ_ASSERT( memcmp( out, data, size ) == 0 );
+
+  free( z );
+  free( out );
+  return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* vim:set et sw=2 ts=2: */
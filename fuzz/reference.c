@@ -0,0 +1,199 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      reference.c
+**
+**      Copyright (C) 1998-2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+// local
+#include "pjl_config.h"
+#include "reference.h"
+#include "txt2pdbdoc.h"
+#include "util.h"
+
+// standard
+#include <stdbool.h>
+#include <string.h>
+
+#define REF_COUNT_BITS  3               /* as in compress.c */
+#define REF_DISP_BITS   11              /* ditto */
+
+////////// local functions ////////////////////////////////////////////////////
+
+/**
+ * Finds the first occurrence of \a b within \a m the obvious way.
+ *
+ * @param m The bytes to search through.
+ * @param m_len The number of bytes of \a m.
+ * @param b The bytes to find.
+ * @param b_len The number of bytes of \a b.
+ * @return Returns a pointer to the first occurrence or NULL if none.
+ */
+NODISCARD
+static uint8_t const* ref_find( uint8_t const *m, size_t m_len,
+                                uint8_t const *b, size_t b_len ) {
+  for ( size_t i = 0; i + b_len <= m_len; ++i )
+    if ( memcmp( m + i, b, b_len ) == 0 )
+      return m + i;
+  return NULL;
+}
+
+/**
+ * Appends a literal byte, merging a pending space into it or escaping it as
+ * needed.
+ *
+ * @param dst The buffer to append to.
+ * @param j The index into \a dst to append at; updated.
+ * @param c The byte.
+ * @param space The pending-space flag; updated.
+ */
+static void ref_put_byte( uint8_t *dst, size_t *j, uint8_t c, bool *space ) {
+  if ( *space ) {
+    *space = false;
+    if ( c >= 0x40 && c <= 0x7F ) {
+      dst[ (*j)++ ] = c ^ 0x80;
+      return;
+    }
+    dst[ (*j)++ ] = ' ';
+  } else if ( c == ' ' ) {
+    *space = true;
+    return;
+  }
+  if ( (c >= 1 && c <= 8) || c >= 0x80 )
+    dst[ (*j)++ ] = 1;
+  dst[ (*j)++ ] = c;
+}
+
+////////// extern functions ///////////////////////////////////////////////////
+
+t2pd_status_t ref_compress( uint8_t const *src, size_t src_len,
+                            uint8_t *dst, size_t *dst_len ) {
+  size_t const window = (1u << REF_DISP_BITS) - 1;
+  size_t const run_max = (1u << REF_COUNT_BITS) + 2;
+  size_t head = 0, tail = 1, from = 0, j = 0;
+  bool space = false;
+
+  //
+  // Grow the string [head,tail) one byte at a time while it still occurs in
+  // the window before it; once it doesn't (or gets too long, or the input
+  // ends), emit either the first byte as a literal or all but the last byte
+  // as a back-reference to where it last matched.
+  //
+  while ( head < src_len ) {
+    if ( head - from > window )
+      from = head - window;
+
+    uint8_t const *const p =
+      ref_find( src + from, tail - from, src + head, tail - head );
+
+    if ( p == NULL || p == src + head || tail - head > run_max ||
+         tail == src_len ) {
+      if ( tail - head < 4 ) {
+        ref_put_byte( dst, &j, src[ head++ ], &space );
+      } else {
+        size_t const code =
+          ((head - from) << REF_COUNT_BITS) + (tail - head - 4);
+        if ( space ) {
+          dst[ j++ ] = ' ';
+          space = false;
+        }
+        dst[ j++ ] = STATIC_CAST( uint8_t, 0x80 + (code >> 8) );
+        dst[ j++ ] = STATIC_CAST( uint8_t, code & 0xFF );
+        head = tail - 1;
+      }
+      from = 0;
+    } else {
+      from = STATIC_CAST( size_t, p - src );
+    }
+
+    if ( tail != src_len )
+      ++tail;
+  } // while
+
+  if ( space )
+    dst[ j++ ] = ' ';
+
+  //
+  // Merge runs of single escaped bytes into one escape of up to 8 bytes.
+  //
+  size_t const len = j;
+  size_t i;
+  for ( i = j = 0; i < len; ++i, ++j ) {
+    dst[j] = dst[i];
+    if ( dst[j] >= 0x80 && dst[j] < 0xC0 ) {
+      dst[ ++j ] = dst[ ++i ];
+    } else if ( dst[j] == 1 ) {
+      dst[ j + 1 ] = dst[ i + 1 ];
+      while ( i + 2 < len && dst[ i + 2 ] == 1 && dst[j] < 8 ) {
+        ++dst[j];
+        dst[ j + dst[j] ] = dst[ i + 3 ];
+        i += 2;
+      } // while
+      j += dst[j];
+      ++i;
+    }
+  } // for
+
+  *dst_len = j;
+  return T2PD_OK;
+}
+
+t2pd_status_t ref_uncompress( uint8_t const *src, size_t src_len,
+                              uint8_t *dst, size_t dst_size,
+                              size_t *dst_len ) {
+  size_t i = 0, j = 0;
+
+  while ( i < src_len ) {
+    unsigned const c = src[ i++ ];
+
+    if ( c == 0 || (c >= 0x09 && c <= 0x7F) ) {
+      if ( j == dst_size )
+        return T2PD_ERR_CORRUPT;
+      dst[ j++ ] = STATIC_CAST( uint8_t, c );
+    }
+    else if ( c <= 0x08 ) {
+      for ( unsigned k = 0; k < c; ++k ) {
+        if ( i == src_len || j == dst_size )
+          return T2PD_ERR_CORRUPT;
+        dst[ j++ ] = src[ i++ ];
+      } // for
+    }
+    else if ( c >= 0xC0 ) {
+      if ( dst_size - j < 2 )
+        return T2PD_ERR_CORRUPT;
+      dst[ j++ ] = ' ';
+      dst[ j++ ] = STATIC_CAST( uint8_t, c ^ 0x80 );
+    }
+    else {
+      if ( i == src_len )
+        return T2PD_ERR_CORRUPT;
+      unsigned const code = ((c << 8) | src[ i++ ]) & 0x3FFF;
+      size_t const dist = code >> REF_COUNT_BITS;
+      size_t const n = (code & ((1u << REF_COUNT_BITS) - 1)) + 3;
+      if ( dist == 0 || dist > j || n > dst_size - j )
+        return T2PD_ERR_CORRUPT;
+      for ( size_t k = 0; k < n; ++k, ++j )
+        dst[j] = dst[ j - dist ];
+    }
+  } // while
+
+  *dst_len = j;
+  return T2PD_OK;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,78 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      reference.h
+**
+**      Copyright (C) 1998-2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#ifndef txt2pdbdoc_reference_H
+#define txt2pdbdoc_reference_H
+
+/**
+ * @file
+ * Declares reference implementations of Doc compression and decompression.
+ *
+ * These are deliberately simple, unoptimized, and frozen: any optimization of
+ * t2pd_compress() or t2pd_uncompress() must keep producing exactly what these
+ * produce, which the differential fuzzing harness checks.
+ */
+
+// local
+#include "pjl_config.h"
+#include "txt2pdbdoc.h"
+#include "util.h"
+
+// standard
+#include <stddef.h>                     /* for size_t */
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Compresses a buffer exactly as t2pd_compress() must.
+ *
+ * @param src The bytes to compress.
+ * @param src_len The number of bytes of \a src.
+ * @param dst The buffer to receive the compressed bytes.  It must be at least
+ * #T2PD_COMPRESS_BOUND(\a src_len) bytes.
+ * @param dst_len A pointer to receive the number of compressed bytes.
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+t2pd_status_t ref_compress( uint8_t const *src, size_t src_len,
+                            uint8_t *dst, size_t *dst_len );
+
+/**
+ * Uncompresses a buffer exactly as t2pd_uncompress() must.
+ *
+ * @param src The bytes to uncompress.
+ * @param src_len The number of bytes of \a src.
+ * @param dst The buffer to receive the uncompressed bytes.
+ * @param dst_size The size of \a dst.
+ * @param dst_len A pointer to receive the number of uncompressed bytes.
+ * @return Returns #T2PD_OK only if successful or #T2PD_ERR_CORRUPT if either
+ * \a src is malformed or its uncompressed bytes would exceed \a dst_size.
+ */
+NODISCARD
+t2pd_status_t ref_uncompress( uint8_t const *src, size_t src_len,
+                              uint8_t *dst, size_t dst_size,
+                              size_t *dst_len );
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif /* txt2pdbdoc_reference_H */
+/* vim:set et sw=2 ts=2: */
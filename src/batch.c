@@ -0,0 +1,988 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      batch.c
+**
+**      Copyright (C) 1998-2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+// local
+#include "pjl_config.h"
+#include "batch.h"
+#include "pool.h"
+#include "txt2pdbdoc.h"
+#include "util.h"
+
+// standard
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sysexits.h>
+#include <time.h>
+#include <unistd.h>                     /* for unlink() */
+#ifdef HAVE_SYS_INOTIFY_H
+#include <poll.h>
+#include <sys/inotify.h>
+#endif /* HAVE_SYS_INOTIFY_H */
+
+#define IO_BUF_SIZE   (64 * 1024)       /* per-worker stdio buffer size */
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * A single conversion.
+ */
+struct batch_job {
+  char           *doc_name;             ///< Document name (encoding only).
+  char           *in_path;              ///< Path of input file.
+  char           *out_path;             ///< Path of output file, if any.
+  t2pd_status_t   status;               ///< Result of the conversion.
+  char           *errmsg;               ///< Error message, if any.
+  off_t           in_bytes;             ///< Size of input file.
+  off_t           out_bytes;            ///< Size of output file.
+  double          event_secs;           ///< Time of first change, if watching.
+  double          done_secs;            ///< Time the conversion finished.
+};
+typedef struct batch_job batch_job_t;
+
+/**
+ * Per-worker state that's reused for every job the worker runs.
+ */
+struct batch_worker {
+  t2pd_t             *t;                ///< Conversion handle.
+  batch_job_t const  *job;              ///< Job currently being run.
+  char               *in_io_buf;        ///< stdio buffer for input.
+  char               *out_io_buf;       ///< stdio buffer for output.
+  char               *tmp_path;         ///< Temporary output path, if any.
+  unsigned            num_volumes;      ///< Volumes written of current job.
+};
+typedef struct batch_worker batch_worker_t;
+
+/**
+ * State shared by all workers.
+ */
+struct batch {
+  bool            atomic;               ///< Write output via rename(2)?
+  bool            decode;               ///< Decode rather than encode?
+  bool            html;                 ///< Encode from or decode to HTML?
+  bool            verify;               ///< Verify rather than convert?
+  batch_job_t    *jobs;                 ///< All jobs.
+  size_t          num_jobs;             ///< Number of jobs.
+  size_t          jobs_cap;             ///< Capacity of \a jobs.
+  batch_worker_t *workers;              ///< One per worker.
+  unsigned        num_workers;          ///< Number of workers.
+};
+typedef struct batch batch_t;
+
+////////// local functions ////////////////////////////////////////////////////
+
+/**
+ * Adds a job.
+ *
+ * @param b The batch to add to.
+ * @param doc_name The document name, if any.
+ * @param in_path The input path.
+ * @param out_path The output path.
+ */
+static void batch_add( batch_t *b, char const *doc_name, char const *in_path,
+                       char const *out_path ) {
+  if ( b->num_jobs == b->jobs_cap ) {
+    b->jobs_cap = b->jobs_cap ? b->jobs_cap * 2 : 64;
+    b->jobs = check_realloc( b->jobs, b->jobs_cap * sizeof *b->jobs );
+  }
+  batch_job_t *const job = &b->jobs[ b->num_jobs++ ];
+  *job = (batch_job_t){
+    .doc_name = doc_name != NULL ? check_strdup( doc_name ) : NULL,
+    .in_path = check_strdup( in_path ),
+    .out_path = out_path != NULL ? check_strdup( out_path ) : NULL
+  };
+}
+
+/**
+ * Prints a diagnostic message from the library prefixed by the path of the
+ * input file being converted.
+ *
+ * @param data The batch_worker.
+ * @param kind The kind of message.
+ * @param msg The message.
+ */
+static void batch_diag( void *data, t2pd_diag_t kind, char const *msg ) {
+  batch_worker_t const *const w = data;
+  if ( kind != T2PD_DIAG_PROGRESS )
+    PMESSAGE( "%s: %s", w->job->in_path, msg );
+}
+
+/**
+ * Opens the output file for a volume after the first of a Doc file too large
+ * for one.
+ *
+ * @param data The batch_worker.
+ * @param volume The volume number (&gt; 1).
+ * @return Returns the file opened for writing or NULL upon error.
+ */
+NODISCARD
+static FILE* batch_volume( void *data, unsigned volume ) {
+  batch_worker_t *const w = data;
+  w->num_volumes = volume;
+  return volume_fopen(
+    w->tmp_path != NULL ? w->tmp_path : w->job->out_path, volume
+  );
+}
+
+/**
+ * Gets the current time of a clock in seconds.
+ *
+ * @param clock_id The clock to use.
+ * @return Returns said time.
+ */
+NODISCARD
+static double now_secs( clockid_t clock_id ) {
+  struct timespec ts;
+  clock_gettime( clock_id, &ts );
+  return STATIC_CAST( double, ts.tv_sec ) +
+         STATIC_CAST( double, ts.tv_nsec ) / 1e9;
+}
+
+/**
+ * Fails a job with a message from \c errno unless it already failed.
+ *
+ * @param job The job.
+ * @param status The status to fail it with.
+ */
+static void batch_fail( batch_job_t *job, t2pd_status_t status ) {
+  if ( job->status != T2PD_OK )
+    return;
+  job->status = status;
+  free( job->errmsg );
+  job->errmsg = check_strdup( STRERROR );
+}
+
+/**
+ * Either renames or removes the temporary output files of a job.  Renaming
+ * stops at the first failure: that and all remaining temporary files are
+ * removed.
+ *
+ * @param w The batch_worker.
+ * @param job The job.
+ */
+static void batch_commit( batch_worker_t *w, batch_job_t *job ) {
+  for ( unsigned v = 1; v <= w->num_volumes; ++v ) {
+    char *const tmp = v == 1 ? w->tmp_path : volume_path( w->tmp_path, v );
+    if ( tmp == NULL ) {
+      batch_fail( job, T2PD_ERR_NOMEM );
+      continue;
+    }
+    if ( job->status == T2PD_OK ) {
+      char *const out = v == 1 ? job->out_path : volume_path( job->out_path, v );
+      if ( out == NULL )
+        batch_fail( job, T2PD_ERR_NOMEM );
+      else if ( rename( tmp, out ) == -1 )
+        batch_fail( job, T2PD_ERR_WRITE );
+      if ( out != job->out_path )
+        free( out );
+    }
+    if ( job->status != T2PD_OK )
+      unlink( tmp );
+    if ( tmp != w->tmp_path )
+      free( tmp );
+  } // for
+  free( w->tmp_path );
+  w->tmp_path = NULL;
+}
+
+/**
+ * Runs a single job.
+ *
+ * @param data The batch.
+ * @param worker The index of the worker.
+ * @param job_index The index of the job.
+ */
+static void batch_job( void *data, unsigned worker, size_t job_index ) {
+  batch_t *const b = data;
+  batch_worker_t *const w = &b->workers[ worker ];
+  batch_job_t *const job = &b->jobs[ job_index ];
+  w->job = job;
+
+  FILE *const fin = fopen( job->in_path, "r" );
+  if ( fin == NULL ) {
+    job->status = T2PD_ERR_READ;
+    job->errmsg = check_strdup( STRERROR );
+    return;
+  }
+  setvbuf( fin, w->in_io_buf, _IOFBF, IO_BUF_SIZE );
+
+  if ( b->verify ) {
+    job->status = t2pd_verify_file( w->t, fin );
+    struct stat sbuf;
+    if ( fstat( fileno( fin ), &sbuf ) == 0 )
+      job->in_bytes = sbuf.st_size;
+    fclose( fin );
+    goto done;
+  }
+
+  char const *out_path = job->out_path;
+  w->num_volumes = 1;
+  if ( b->atomic ) {
+    size_t const tmp_size = strlen( out_path ) + sizeof ".tmp";
+    w->tmp_path = MALLOC( char, tmp_size );
+    snprintf( w->tmp_path, tmp_size, "%s.tmp", out_path );
+    out_path = w->tmp_path;
+  }
+  FILE *const fout = fopen( out_path, "w" );
+  if ( fout == NULL ) {
+    job->status = T2PD_ERR_WRITE;
+    job->errmsg = check_strdup( STRERROR );
+    fclose( fin );
+    free( w->tmp_path );
+    w->tmp_path = NULL;
+    return;
+  }
+  setvbuf( fout, w->out_io_buf, _IOFBF, IO_BUF_SIZE );
+
+  job->status = b->decode ?
+    t2pd_decode_file( w->t, fin, fout ) :
+    t2pd_encode_file( w->t, job->doc_name, fin, fout );
+
+  struct stat sbuf;
+  if ( fstat( fileno( fin ), &sbuf ) == 0 )
+    job->in_bytes = sbuf.st_size;
+  fclose( fin );
+  if ( fflush( fout ) == EOF )
+    batch_fail( job, T2PD_ERR_WRITE );
+  if ( fstat( fileno( fout ), &sbuf ) == 0 )
+    job->out_bytes = sbuf.st_size;
+  if ( fclose( fout ) == EOF )
+    batch_fail( job, T2PD_ERR_WRITE );
+  for ( unsigned v = 2; v <= w->num_volumes; ++v ) {
+    char *const vpath = volume_path( out_path, v );
+    if ( vpath != NULL && stat( vpath, &sbuf ) == 0 )
+      job->out_bytes += sbuf.st_size;
+    free( vpath );
+  } // for
+  if ( w->tmp_path != NULL )
+    batch_commit( w, job );
+
+done:
+  if ( job->status != T2PD_OK && job->errmsg == NULL ) {
+    char const *const errmsg = t2pd_errmsg( w->t );
+    job->errmsg = check_strdup(
+      errmsg[0] != '\0' ? errmsg : t2pd_strerror( job->status )
+    );
+  }
+  job->done_secs = now_secs( CLOCK_MONOTONIC );
+}
+
+/**
+ * Reads jobs from a manifest file.
+ *
+ * @param b The batch to add to.
+ * @param path The path of the manifest file or `-` for standard input.
+ */
+static void batch_read_manifest( batch_t *b, char const *path ) {
+  bool const is_stdin = strcmp( path, "-" ) == 0;
+  FILE *const file = is_stdin ? stdin : check_fopen( path, "r" );
+  unsigned const want_fields = b->decode ? 2 : 3;
+
+  char *line = NULL;
+  size_t line_cap = 0;
+  unsigned line_no = 0;
+
+  for ( ssize_t len; (len = getline( &line, &line_cap, file )) != -1; ) {
+    ++line_no;
+    while ( len > 0 && (line[ len - 1 ] == '\n' || line[ len - 1 ] == '\r') )
+      line[ --len ] = '\0';
+    if ( len == 0 || line[0] == '#' )
+      continue;
+
+    char *fields[3];
+    unsigned num_fields = 0;
+    for ( char *f = line, *next; f != NULL; f = next ) {
+      next = strchr( f, '\t' );
+      if ( next != NULL )
+        *next++ = '\0';
+      if ( num_fields == want_fields ) {
+        num_fields = 0;                 // too many fields
+        break;
+      }
+      fields[ num_fields++ ] = f;
+    } // for
+    if ( num_fields != want_fields ) {
+      PMESSAGE_EXIT( EX_DATAERR,
+        "\"%s\", line %u: %u tab-separated fields expected\n",
+        path, line_no, want_fields
+      );
+    }
+
+    if ( b->decode )
+      batch_add( b, NULL, fields[0], fields[1] );
+    else
+      batch_add( b, fields[0], fields[1], fields[2] );
+  } // for
+
+  if ( ferror( file ) )
+    PERROR_EXIT( EX_NOINPUT );
+  free( line );
+  if ( !is_stdin )
+    fclose( file );
+}
+
+/**
+ * Compares two strings via `strcmp`(3) for `qsort`(3).
+ *
+ * @param i_data A pointer to the first `char*`.
+ * @param j_data A pointer to the second `char*`.
+ * @return Returns a number less than 0, 0, or greater than 0 if the first
+ * string is less than, equal to, or greater than the second, respectively.
+ */
+static int strcmp_ptrs( void const *i_data, void const *j_data ) {
+  char const *const *const pi = i_data;
+  char const *const *const pj = j_data;
+  return strcmp( *pi, *pj );
+}
+
+/**
+ * Adds jobs for every file in a directory having the input extension.
+ *
+ * @param b The batch to add to.
+ * @param dir_path The directory to scan.
+ * @param out_dir The directory to write output files to.
+ */
+static void batch_read_dir( batch_t *b, char const *dir_path,
+                            char const *out_dir ) {
+  char const *const in_ext  =
+    b->decode ? ".pdb" : b->html ? ".html" : ".txt";
+  char const *const out_ext =
+    !b->decode ? ".pdb" : b->html ? ".html" : ".txt";
+  size_t const ext_len = strlen( in_ext );
+
+  DIR *const dir = opendir( dir_path );
+  if ( dir == NULL ) {
+    PMESSAGE_EXIT( EX_NOINPUT,
+      "\"%s\": can not open: %s\n", dir_path, STRERROR
+    );
+  }
+
+  char **names = NULL;
+  size_t num_names = 0, names_cap = 0;
+  for ( struct dirent const *de; (de = readdir( dir )) != NULL; ) {
+    size_t const len = strlen( de->d_name );
+    if ( len <= ext_len || strcmp( de->d_name + len - ext_len, in_ext ) != 0 )
+      continue;
+    if ( num_names == names_cap ) {
+      names_cap = names_cap ? names_cap * 2 : 64;
+      names = check_realloc( names, names_cap * sizeof *names );
+    }
+    names[ num_names++ ] = check_strdup( de->d_name );
+  } // for
+  closedir( dir );
+
+  // sort so the order of jobs (and hence of results) is deterministic
+  qsort( names, num_names, sizeof *names, &strcmp_ptrs );
+
+  for ( size_t i = 0; i < num_names; ++i ) {
+    char *const name = names[i];
+    size_t const base_len = strlen( name ) - ext_len;
+
+    size_t const in_size = strlen( dir_path ) + 1 + strlen( name ) + 1;
+    char *const in_path = MALLOC( char, in_size );
+    snprintf( in_path, in_size, "%s/%s", dir_path, name );
+
+    name[ base_len ] = '\0';            // strip extension for doc_name
+    size_t const out_size =
+      strlen( out_dir ) + 1 + base_len + strlen( out_ext ) + 1;
+    char *const out_path = MALLOC( char, out_size );
+    snprintf( out_path, out_size, "%s/%s%s", out_dir, name, out_ext );
+
+    batch_add( b, name, in_path, out_path );
+    free( in_path );
+    free( out_path );
+    free( name );
+  } // for
+  free( names );
+}
+
+/**
+ * Creates the workers of a batch.
+ *
+ * @param b The batch to create the workers of.
+ * @param opts The conversion options.
+ * @param num_workers The number of worker threads.
+ */
+static void batch_start( batch_t *b, t2pd_options_t const *opts,
+                         unsigned num_workers ) {
+  b->workers = MALLOC( batch_worker_t, num_workers );
+  b->num_workers = num_workers;
+  for ( unsigned i = 0; i < num_workers; ++i ) {
+    batch_worker_t *const w = &b->workers[i];
+    t2pd_options_t w_opts = *opts;
+    w_opts.diag_fn = &batch_diag;
+    w_opts.diag_data = w;
+    if ( !b->decode ) {
+      w_opts.volume_fn = &batch_volume;
+      w_opts.volume_data = w;
+    }
+    w_opts.verbose = false;
+    if ( (w->t = t2pd_new( &w_opts )) == NULL )
+      PERROR_EXIT( EX_OSERR );
+    w->job = NULL;
+    w->in_io_buf = MALLOC( char, IO_BUF_SIZE );
+    w->out_io_buf = MALLOC( char, IO_BUF_SIZE );
+    w->tmp_path = NULL;
+    w->num_volumes = 0;
+  } // for
+}
+
+/**
+ * Frees the workers of a batch.
+ *
+ * @param b The batch to free the workers of.
+ */
+static void batch_stop( batch_t *b ) {
+  for ( unsigned i = 0; i < b->num_workers; ++i ) {
+    t2pd_free( b->workers[i].t );
+    free( b->workers[i].in_io_buf );
+    free( b->workers[i].out_io_buf );
+  } // for
+  free( b->workers );
+}
+
+/**
+ * Prints the results of all jobs and frees them.
+ *
+ * @param b The batch to report.
+ * @param in_bytes Incremented by the number of bytes read.
+ * @param out_bytes Incremented by the number of bytes written.
+ * @return Returns the number of jobs that failed.
+ */
+static size_t batch_report( batch_t *b, double *in_bytes, double *out_bytes ) {
+  size_t num_failed = 0;
+
+  for ( size_t i = 0; i < b->num_jobs; ++i ) {
+    batch_job_t *const job = &b->jobs[i];
+    if ( b->verify ) {
+      if ( job->status == T2PD_OK )
+        printf( "ok\t%s\n", job->in_path );
+      else
+        printf( "error\t%s\t%s\n", job->in_path, job->errmsg );
+      *in_bytes += STATIC_CAST( double, job->in_bytes );
+      num_failed += job->status != T2PD_OK;
+    } else if ( job->status == T2PD_OK ) {
+      printf( "ok\t%s\t%s\t%lld\t%lld",
+        job->in_path, job->out_path,
+        STATIC_CAST( long long, job->in_bytes ),
+        STATIC_CAST( long long, job->out_bytes )
+      );
+      if ( job->event_secs > 0 )        // latency since change
+        printf( "\t%.3f", (job->done_secs - job->event_secs) * 1000 );
+      putchar( '\n' );
+      *in_bytes += STATIC_CAST( double, job->in_bytes );
+      *out_bytes += STATIC_CAST( double, job->out_bytes );
+    } else {
+      printf( "error\t%s\t%s\t%s\n", job->in_path, job->out_path, job->errmsg );
+      ++num_failed;
+    }
+    free( job->doc_name );
+    free( job->in_path );
+    free( job->out_path );
+    free( job->errmsg );
+  } // for
+  b->num_jobs = 0;
+
+  if ( fflush( stdout ) == EOF )
+    PERROR_EXIT( EX_IOERR );
+  return num_failed;
+}
+
+/**
+ * Runs all jobs, prints their results, and frees them.
+ *
+ * @param b The batch to run.
+ * @param opts The conversion options.
+ * @param num_workers The number of worker threads.
+ * @return Returns `EXIT_SUCCESS` only if all jobs succeeded.
+ */
+NODISCARD
+static int batch_run( batch_t *b, t2pd_options_t const *opts,
+                      unsigned num_workers ) {
+  batch_start( b, opts, num_workers );
+
+  double const start_secs = now_secs( CLOCK_MONOTONIC );
+  double const start_cpu = now_secs( CLOCK_PROCESS_CPUTIME_ID );
+  pool_run( b->num_jobs, num_workers, &batch_job, b );
+  double const elapsed_secs = now_secs( CLOCK_MONOTONIC ) - start_secs;
+  double const cpu_secs = now_secs( CLOCK_PROCESS_CPUTIME_ID ) - start_cpu;
+
+  ////////// report results ///////////////////////////////////////////////////
+
+  size_t const num_jobs = b->num_jobs;
+  double in_bytes = 0, out_bytes = 0;
+  size_t const num_failed = batch_report( b, &in_bytes, &out_bytes );
+  free( b->jobs );
+
+  double const mb_in = in_bytes / (1024 * 1024);
+  char out_mb[ 32 ] = "";
+  if ( !b->verify )
+    snprintf( out_mb, sizeof out_mb, " -> %.2f MB", out_bytes / (1024 * 1024) );
+  PMESSAGE(
+    "%zu file%s (%zu failed), %.2f MB%s in %.3f s (%.3f s CPU) "
+    "on %u thread%s: %.2f MB/s, %.1f files/s\n",
+    num_jobs, num_jobs == 1 ? "" : "s", num_failed, mb_in, out_mb,
+    elapsed_secs, cpu_secs, num_workers, num_workers == 1 ? "" : "s",
+    elapsed_secs > 0 ? mb_in / elapsed_secs : 0,
+    elapsed_secs > 0 ? STATIC_CAST( double, num_jobs ) / elapsed_secs : 0
+  );
+
+  batch_stop( b );
+  return num_failed > 0 ? EX_DATAERR : EXIT_SUCCESS;
+}
+
+#ifdef HAVE_SYS_INOTIFY_H
+
+/**
+ * Events of interest on watched directories: a file written or moved into
+ * one, or a subdirectory created.
+ */
+#define WATCH_MASK    (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE)
+
+/**
+ * A changed file waiting for changes to it to stop.
+ */
+struct watch_pending {
+  char     *in_path;                    ///< Path of the input file.
+  double    first_secs;                 ///< Time of its first change.
+  double    last_secs;                  ///< Time of its latest change.
+};
+typedef struct watch_pending watch_pending_t;
+
+/**
+ * Watch mode state.
+ */
+struct watch {
+  int               fd;                 ///< inotify file descriptor.
+  char const       *src_dir;            ///< Directory tree being watched.
+  char const       *out_dir;            ///< Output directory or NULL.
+  char const       *in_ext;             ///< Input file extension.
+  char            **dirs;               ///< Directory paths by watch.
+  size_t            dirs_cap;           ///< Capacity of \a dirs.
+  watch_pending_t  *pending;            ///< Files waiting to be converted.
+  size_t            num_pending;        ///< Number of pending files.
+  size_t            pending_cap;        ///< Capacity of \a pending.
+};
+typedef struct watch watch_t;
+
+/**
+ * Set by the signal handler to stop watching.
+ */
+static volatile sig_atomic_t watch_stop;
+
+/**
+ * Records that a signal to stop watching was received.
+ *
+ * @param sig The signal.
+ */
+static void watch_on_signal( int sig ) {
+  (void)sig;
+  watch_stop = 1;
+}
+
+/**
+ * Makes a path from a directory and a file name.
+ *
+ * @param dir The directory.
+ * @param name The file name.
+ * @return Returns said path.  The caller is responsible for freeing it.
+ */
+NODISCARD
+static char* watch_path( char const *dir, char const *name ) {
+  size_t const size = strlen( dir ) + 1 + strlen( name ) + 1;
+  char *const path = MALLOC( char, size );
+  snprintf( path, size, "%s/%s", dir, name );
+  return path;
+}
+
+/**
+ * Checks whether a file name has the input extension.
+ *
+ * @param w The watch_t.
+ * @param name The file name.
+ * @return Returns `true` only if it does.
+ */
+NODISCARD
+static bool watch_is_input( watch_t const *w, char const *name ) {
+  size_t const len = strlen( name );
+  size_t const ext_len = strlen( w->in_ext );
+  return len > ext_len && name[0] != '.' &&
+         strcmp( name + len - ext_len, w->in_ext ) == 0;
+}
+
+/**
+ * Gets the path of the output file for an input file: either the same path
+ * but with a `.pdb` extension or, if there's an output directory, the same
+ * path relative to it.
+ *
+ * @param w The watch_t.
+ * @param in_path The path of the input file.
+ * @return Returns said path.  The caller is responsible for freeing it.
+ */
+NODISCARD
+static char* watch_out_path( watch_t const *w, char const *in_path ) {
+  char const *const rel_path = in_path + strlen( w->src_dir ) + 1;
+  size_t const rel_len = strlen( rel_path ) - strlen( w->in_ext );
+  char const *const dir = w->out_dir != NULL ? w->out_dir : w->src_dir;
+  size_t const size = strlen( dir ) + 1 + rel_len + sizeof ".pdb";
+  char *const out_path = MALLOC( char, size );
+  snprintf( out_path, size, "%s/%.*s.pdb", dir, (int)rel_len, rel_path );
+  return out_path;
+}
+
+/**
+ * Adds a file to those pending conversion or, if already pending, updates the
+ * time of its latest change.
+ *
+ * @param w The watch_t.
+ * @param in_path The path of the input file.  Ownership is taken.
+ */
+static void watch_pend( watch_t *w, char *in_path ) {
+  double const now = now_secs( CLOCK_MONOTONIC );
+  for ( size_t i = 0; i < w->num_pending; ++i ) {
+    if ( strcmp( w->pending[i].in_path, in_path ) == 0 ) {
+      w->pending[i].last_secs = now;
+      free( in_path );
+      return;
+    }
+  } // for
+  if ( w->num_pending == w->pending_cap ) {
+    w->pending_cap = w->pending_cap ? w->pending_cap * 2 : 16;
+    w->pending = check_realloc( w->pending,
+      w->pending_cap * sizeof *w->pending
+    );
+  }
+  w->pending[ w->num_pending++ ] = (watch_pending_t){
+    .in_path = in_path, .first_secs = now, .last_secs = now
+  };
+}
+
+/**
+ * Checks whether an output file is missing or older than its input file.
+ *
+ * @param w The watch_t.
+ * @param in_path The path of the input file.
+ * @param in_sbuf The status of the input file.
+ * @return Returns `true` only if it is.
+ */
+NODISCARD
+static bool watch_is_stale( watch_t const *w, char const *in_path,
+                            struct stat const *in_sbuf ) {
+  char *const out_path = watch_out_path( w, in_path );
+  struct stat out_sbuf;
+  bool const stale = stat( out_path, &out_sbuf ) == -1 ||
+    out_sbuf.st_mtim.tv_sec < in_sbuf->st_mtim.tv_sec ||
+    ( out_sbuf.st_mtim.tv_sec == in_sbuf->st_mtim.tv_sec &&
+      out_sbuf.st_mtim.tv_nsec < in_sbuf->st_mtim.tv_nsec );
+  free( out_path );
+  return stale;
+}
+
+/**
+ * Watches a directory and, recursively, its subdirectories, adding every input
+ * file whose output file is missing or older to those pending conversion.
+ * Symbolic links to directories aren't followed.
+ *
+ * @param w The watch_t.
+ * @param dir_path The path of the directory.
+ */
+static void watch_dir( watch_t *w, char const *dir_path ) {
+  int const wd = inotify_add_watch( w->fd, dir_path, WATCH_MASK );
+  if ( wd == -1 ) {
+    PMESSAGE( "\"%s\": can not watch: %s\n", dir_path, STRERROR );
+    return;
+  }
+  size_t const i = STATIC_CAST( size_t, wd );
+  if ( i >= w->dirs_cap ) {
+    size_t const old_cap = w->dirs_cap;
+    w->dirs_cap = i < 32 ? 64 : i * 2;
+    w->dirs = check_realloc( w->dirs, w->dirs_cap * sizeof *w->dirs );
+    memset( w->dirs + old_cap, 0, (w->dirs_cap - old_cap) * sizeof *w->dirs );
+  }
+  free( w->dirs[i] );
+  w->dirs[i] = check_strdup( dir_path );
+
+  DIR *const dir = opendir( dir_path );
+  if ( dir == NULL )
+    return;                             // removed since
+  for ( struct dirent const *de; (de = readdir( dir )) != NULL; ) {
+    if ( strcmp( de->d_name, "." ) == 0 || strcmp( de->d_name, ".." ) == 0 )
+      continue;
+    char *const path = watch_path( dir_path, de->d_name );
+    struct stat sbuf;
+    if ( lstat( path, &sbuf ) == 0 ) {
+      if ( S_ISDIR( sbuf.st_mode ) ) {
+        watch_dir( w, path );
+      } else if ( S_ISREG( sbuf.st_mode ) && watch_is_input( w, de->d_name ) &&
+                  watch_is_stale( w, path, &sbuf ) ) {
+        watch_pend( w, path );
+        continue;                       // path now owned by pending
+      }
+    }
+    free( path );
+  } // for
+  closedir( dir );
+}
+
+/**
+ * Reads and handles all available inotify events.
+ *
+ * @param w The watch_t.
+ */
+static void watch_read( watch_t *w ) {
+  union {
+    struct inotify_event  event;        // for alignment only
+    char                  buf[ 16 * 1024 ];
+  } u;
+  char const *const buf = u.buf;
+  ssize_t const len = read( w->fd, u.buf, sizeof u.buf );
+  if ( len == -1 ) {
+    if ( errno == EAGAIN || errno == EINTR )
+      return;
+    PERROR_EXIT( EX_IOERR );
+  }
+
+  for ( char const *p = buf; p < buf + len; ) {
+    struct inotify_event const *const e = (struct inotify_event const*)p;
+    p += sizeof *e + e->len;
+    size_t const i = STATIC_CAST( size_t, e->wd );
+
+    if ( (e->mask & IN_Q_OVERFLOW) != 0 ) {
+      watch_dir( w, w->src_dir );       // events lost: rescan everything
+      continue;
+    }
+    if ( e->wd < 0 || i >= w->dirs_cap || w->dirs[i] == NULL )
+      continue;
+    if ( (e->mask & IN_IGNORED) != 0 ) {
+      free( w->dirs[i] );
+      w->dirs[i] = NULL;
+      continue;
+    }
+    if ( e->len == 0 )
+      continue;
+
+    char *const path = watch_path( w->dirs[i], e->name );
+    if ( (e->mask & IN_ISDIR) != 0 ) {
+      if ( (e->mask & (IN_CREATE | IN_MOVED_TO)) != 0 )
+        watch_dir( w, path );
+    } else if ( (e->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) != 0 &&
+                watch_is_input( w, e->name ) ) {
+      watch_pend( w, path );
+      continue;                         // path now owned by pending
+    }
+    free( path );
+  } // for
+}
+
+/**
+ * Makes every missing directory of the parent of a path.
+ *
+ * @param path The path.
+ */
+static void watch_mkdirs( char const *path ) {
+  char *const dir = check_strdup( path );
+  for ( char *slash = dir; (slash = strchr( slash + 1, '/' )) != NULL; ) {
+    *slash = '\0';
+    mkdir( dir, 0777 );                 // fopen() will report any error
+    *slash = '/';
+  } // for
+  free( dir );
+}
+
+/**
+ * Adds a job for every pending file that hasn't changed for the debounce
+ * interval.
+ *
+ * @param w The watch_t.
+ * @param b The batch to add to.
+ * @param debounce_secs The debounce interval.
+ * @return Returns the number of seconds until the next pending file is due or
+ * -1 if none is.
+ */
+NODISCARD
+static double watch_due( watch_t *w, batch_t *b, double debounce_secs ) {
+  double const now = now_secs( CLOCK_MONOTONIC );
+  double next = -1;
+
+  for ( size_t i = 0; i < w->num_pending; ) {
+    watch_pending_t *const wp = &w->pending[i];
+    double const due_secs = wp->last_secs + debounce_secs - now;
+    if ( due_secs > 0 ) {
+      if ( next < 0 || due_secs < next )
+        next = due_secs;
+      ++i;
+      continue;
+    }
+
+    struct stat sbuf;
+    if ( stat( wp->in_path, &sbuf ) == 0 ) {  // not removed since
+      char *const out_path = watch_out_path( w, wp->in_path );
+      if ( w->out_dir != NULL )
+        watch_mkdirs( out_path );
+      char const *const slash = strrchr( wp->in_path, '/' );
+      char *const name = check_strdup( slash + 1 );
+      name[ strlen( name ) - strlen( w->in_ext ) ] = '\0';
+      batch_add( b, name, wp->in_path, out_path );
+      b->jobs[ b->num_jobs - 1 ].event_secs = wp->first_secs;
+      free( name );
+      free( out_path );
+    }
+    free( wp->in_path );
+    *wp = w->pending[ --w->num_pending ];
+  } // for
+
+  return next;
+}
+
+#endif /* HAVE_SYS_INOTIFY_H */
+
+////////// extern functions ///////////////////////////////////////////////////
+
+int batch_main( t2pd_options_t const *opts, bool decode, unsigned num_workers,
+                char const *src_path, char const *out_dir ) {
+  assert( opts != NULL );
+  assert( src_path != NULL );
+
+  batch_t b = { .decode = decode, .html = opts->html };
+
+  struct stat sbuf;
+  if ( strcmp( src_path, "-" ) != 0 && stat( src_path, &sbuf ) == 0 &&
+       S_ISDIR( sbuf.st_mode ) ) {
+    batch_read_dir( &b, src_path, out_dir != NULL ? out_dir : src_path );
+  } else {
+    if ( out_dir != NULL ) {
+      PMESSAGE_EXIT( EX_USAGE,
+        "output directory may be given only with an input directory\n%s", ""
+      );
+    }
+    batch_read_manifest( &b, src_path );
+  }
+
+  return batch_run( &b, opts, num_workers );
+}
+
+int batch_verify( t2pd_options_t const *opts, unsigned num_workers,
+                  size_t num_paths, char const *const paths[] ) {
+  assert( opts != NULL );
+  assert( paths != NULL );
+
+  batch_t b = { .decode = true, .verify = true };
+
+  if ( num_paths == 1 && strcmp( paths[0], "-" ) == 0 ) {
+    char *line = NULL;
+    size_t line_cap = 0;
+    for ( ssize_t len; (len = getline( &line, &line_cap, stdin )) != -1; ) {
+      while ( len > 0 && (line[ len - 1 ] == '\n' || line[ len - 1 ] == '\r') )
+        line[ --len ] = '\0';
+      if ( len > 0 )
+        batch_add( &b, NULL, line, NULL );
+    } // for
+    if ( ferror( stdin ) )
+      PERROR_EXIT( EX_NOINPUT );
+    free( line );
+  } else {
+    for ( size_t i = 0; i < num_paths; ++i )
+      batch_add( &b, NULL, paths[i], NULL );
+  }
+
+  return batch_run( &b, opts, num_workers );
+}
+
+int batch_watch( t2pd_options_t const *opts, unsigned num_workers,
+                 char const *src_dir, char const *out_dir,
+                 unsigned debounce_ms ) {
+  assert( opts != NULL );
+  assert( src_dir != NULL );
+
+#ifdef HAVE_SYS_INOTIFY_H
+  struct stat sbuf;
+  if ( stat( src_dir, &sbuf ) == -1 || !S_ISDIR( sbuf.st_mode ) ) {
+    PMESSAGE_EXIT( EX_NOINPUT, "\"%s\": not a directory\n", src_dir );
+  }
+
+  watch_t w = {
+    .src_dir = src_dir,
+    .out_dir = out_dir,
+    .in_ext = opts->html ? ".html" : ".txt"
+  };
+  if ( (w.fd = inotify_init1( IN_NONBLOCK | IN_CLOEXEC )) == -1 )
+    PERROR_EXIT( EX_OSERR );
+
+  struct sigaction sa;
+  memset( &sa, 0, sizeof sa );
+  sa.sa_handler = &watch_on_signal;     // no SA_RESTART: interrupt poll()
+  sigemptyset( &sa.sa_mask );
+  sigaction( SIGINT, &sa, NULL );
+  sigaction( SIGTERM, &sa, NULL );
+
+  batch_t b = { .atomic = true, .html = opts->html };
+  batch_start( &b, opts, num_workers );
+  watch_dir( &w, src_dir );
+
+  double const debounce_secs = debounce_ms / 1000.0;
+  while ( !watch_stop ) {
+    double const next_secs = watch_due( &w, &b, debounce_secs );
+    if ( b.num_jobs > 0 ) {
+      pool_run( b.num_jobs, num_workers, &batch_job, &b );
+      double in_bytes = 0, out_bytes = 0;
+      batch_report( &b, &in_bytes, &out_bytes );
+      continue;                         // more may be due by now
+    }
+
+    struct pollfd pfd = { .fd = w.fd, .events = POLLIN };
+    int const timeout_ms = next_secs < 0 ? -1 :
+      STATIC_CAST( int, next_secs * 1000 ) + 1;
+    int const n = poll( &pfd, 1, timeout_ms );
+    if ( n == -1 ) {
+      if ( errno == EINTR )
+        continue;
+      PERROR_EXIT( EX_OSERR );
+    }
+    if ( n > 0 )
+      watch_read( &w );
+  } // while
+
+  batch_stop( &b );
+  free( b.jobs );
+  for ( size_t i = 0; i < w.num_pending; ++i )
+    free( w.pending[i].in_path );
+  free( w.pending );
+  for ( size_t i = 0; i < w.dirs_cap; ++i )
+    free( w.dirs[i] );
+  free( w.dirs );
+  close( w.fd );
+  return EXIT_SUCCESS;
+#else
+  (void)num_workers;
+  (void)out_dir;
+  (void)debounce_ms;
+  PMESSAGE( "watch mode not supported on this system\n%s", "" );
+  return EX_UNAVAILABLE;
+#endif /* HAVE_SYS_INOTIFY_H */
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,99 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      batch.h
+**
+**      Copyright (C) 1998-2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#ifndef txt2pdbdoc_batch_H
+#define txt2pdbdoc_batch_H
+
+// local
+#include "pjl_config.h"
+#include "txt2pdbdoc.h"
+
+// standard
+#include <stdbool.h>
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Converts many files in one process.
+ *
+ * @param opts The conversion options.
+ * @param decode If `true`, decode Doc files to text; if `false`, encode.
+ * @param num_workers The number of worker threads.
+ * @param src_path The path of either a manifest file (or `-` for standard
+ * input) or a directory.  Each non-blank manifest line not starting with `#`
+ * is either _doc_name_ TAB _input_ TAB _output_ (when encoding) or _input_
+ * TAB _output_ (when decoding).  For a directory, every `.txt` file (when
+ * encoding), `.html` file (when encoding from HTML), or `.pdb` file (when
+ * decoding) in it is converted, the output being `.html` when decoding to
+ * HTML.
+ * @param out_dir For a directory, the directory to write output files to, or
+ * NULL for the same directory.  Must be NULL for a manifest.
+ * @return Returns `EXIT_SUCCESS` only if all conversions succeeded.
+ */
+NODISCARD
+int batch_main( t2pd_options_t const *opts, bool decode, unsigned num_workers,
+                char const *src_path, char const *out_dir );
+
+/**
+ * Verifies the integrity of many Doc files in one process via
+ * t2pd_verify_file().  For each file in the order given, a line is printed to
+ * standard output of either `ok` TAB _path_ or `error` TAB _path_ TAB
+ * _message_.
+ *
+ * @param opts The conversion options.
+ * @param num_workers The number of worker threads.
+ * @param num_paths The number of paths.
+ * @param paths The paths of the Doc files.  If the only path is `-`, the paths
+ * are instead read from standard input, one per line.
+ * @return Returns `EXIT_SUCCESS` only if all files are valid.
+ */
+NODISCARD
+int batch_verify( t2pd_options_t const *opts, unsigned num_workers,
+                  size_t num_paths, char const *const paths[] );
+
+/**
+ * Watches a directory tree via inotify(7) and encodes every text file written
+ * or moved into it once changes to it have stopped for a debounce interval.
+ * Files whose output file is missing or older are encoded at the start.  Each
+ * output file is written to a temporary file that is then renamed so readers
+ * never see a partial Doc file.  For each file encoded, a line is printed to
+ * standard output as for batch_main() but with the milliseconds from its first
+ * change until it was encoded appended.  Returns when `SIGINT` or `SIGTERM` is
+ * received.
+ *
+ * @param opts The conversion options.
+ * @param num_workers The number of worker threads.
+ * @param src_dir The directory to watch.
+ * @param out_dir The directory to write output files to, mirroring \a
+ * src_dir, or NULL for the same directory as each input file.
+ * @param debounce_ms The debounce interval in milliseconds.
+ * @return Returns `EXIT_SUCCESS` when stopped by a signal or `EX_UNAVAILABLE`
+ * if inotify(7) isn't supported.
+ */
+NODISCARD
+int batch_watch( t2pd_options_t const *opts, unsigned num_workers,
+                 char const *src_dir, char const *out_dir,
+                 unsigned debounce_ms );
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif /* txt2pdbdoc_batch_H */
+/* vim:set et sw=2 ts=2: */
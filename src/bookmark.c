@@ -0,0 +1,279 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      bookmark.c
+**
+**      Copyright (C) 1998-2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+// local
+#include "pjl_config.h"
+#include "common.h"
+#include "doc.h"
+#include "palm.h"
+#include "txt2pdbdoc.h"
+#include "unicode.h"
+#include "util.h"
+
+// standard
+#include <assert.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * States of scanning text for bookmarks.
+ */
+enum bm_state {
+  BM_LINE_START,                        ///< At start of line or indentation.
+  BM_MARKER,                            ///< Matching the marker.
+  BM_NAME_SPACE,                        ///< Skipping space after marker.
+  BM_NAME,                              ///< Copying the name.
+  BM_SKIP                               ///< Skipping to end of line.
+};
+
+////////// local functions ////////////////////////////////////////////////////
+
+/**
+ * Gets whether \a c is a space or tab.
+ *
+ * @param c The character to check.
+ * @return Returns `true` only if \a c is a space or tab.
+ */
+NODISCARD
+static inline bool is_blank( Byte c ) {
+  return c == ' ' || c == '\t';
+}
+
+/**
+ * Finds the bookmark marker in a final `<`_marker_`>` line, if any, of the
+ * text without reading all of it.  The position of \a fin is unchanged.
+ *
+ * @param t The handle.
+ * @param fin The file to read from.
+ * @param fin_size The number of bytes that will be read from \a fin.
+ * @param marker The buffer to receive the null-terminated marker, if any.
+ * @return Returns #T2PD_OK only if successful, even if there is no marker.
+ */
+NODISCARD
+static t2pd_status_t find_marker( t2pd_t *t, FILE *fin, uint64_t fin_size,
+                                  char marker[ T2PD_TAIL_SIZE_MAX + 1 ] ) {
+  long const pos = ftell( fin );
+  if ( pos == -1 )
+    return t2pd_read_error( t, fin );
+  size_t const tail_size = STATIC_CAST( size_t,
+    fin_size < T2PD_TAIL_SIZE_MAX ? fin_size : T2PD_TAIL_SIZE_MAX
+  );
+  char tail[ T2PD_TAIL_SIZE_MAX ];
+  T2PD_FSEEK( t, fin, pos + STATIC_CAST( long, fin_size - tail_size ),
+              SEEK_SET );
+  T2PD_FREAD( t, tail, tail_size, fin );
+  T2PD_FSEEK( t, fin, pos, SEEK_SET );
+
+  t2pd_tail_marker( tail, tail_size, tail_size == fin_size, marker );
+  return T2PD_OK;
+}
+
+/**
+ * Ends the name of the current bookmark by removing trailing whitespace.
+ *
+ * @param bm The bookmarks.
+ */
+static void end_name( bookmarks_t *bm ) {
+  char *const name = bm->list[ bm->count - 1 ].name;
+  while ( bm->name_len > 0 &&
+          isspace( STATIC_CAST( unsigned char, name[ bm->name_len - 1 ] ) ) ) {
+    name[ --bm->name_len ] = '\0';
+  }
+}
+
+////////// extern functions ///////////////////////////////////////////////////
+
+void t2pd_tail_marker( char const *tail, size_t tail_size, bool is_all,
+                       char marker[ T2PD_TAIL_SIZE_MAX + 1 ] ) {
+  assert( tail != NULL );
+  assert( tail_size <= T2PD_TAIL_SIZE_MAX );
+  assert( marker != NULL );
+  marker[0] = '\0';
+
+  size_t end = tail_size;
+  while ( end > 0 && isspace( STATIC_CAST( unsigned char, tail[ end-1 ] ) ) )
+    --end;
+  size_t begin = end;
+  while ( begin > 0 && tail[ begin - 1 ] != '\n' )
+    --begin;
+  if ( begin == 0 && !is_all )
+    return;                             // line longer than tail
+  while ( begin < end && is_blank( STATIC_CAST( Byte, tail[ begin ] ) ) )
+    ++begin;
+
+  if ( end - begin < 3 || tail[ begin ] != '<' || tail[ end - 1 ] != '>' )
+    return;
+  ++begin;
+  --end;
+  if ( memchr( tail + begin, '>', end - begin ) != NULL )
+    return;
+  memcpy( marker, tail + begin, end - begin );
+  marker[ end - begin ] = '\0';
+}
+
+t2pd_status_t t2pd_bookmarks_begin( t2pd_t *t, FILE *fin,
+                                     uint64_t fin_size ) {
+  assert( t != NULL );
+  assert( fin != NULL );
+
+  bookmarks_t *const bm = &t->bm;
+  bm->marker_len = 0;
+  bm->state = BM_LINE_START;
+  bm->offset = 0;
+  bm->count = bm->dropped = 0;
+  if ( t->opts.bookmark == NULL )
+    return T2PD_OK;
+
+  char tag_marker[ T2PD_TAIL_SIZE_MAX + 1 ];
+  char const *marker = t->opts.bookmark;
+  if ( t->opts.html ) {
+    //
+    // The text converted from HTML isn't in the file, so use the marker the
+    // conversion will use for <A NAME> tags.
+    //
+    if ( marker[0] == '\0' )
+      marker = T2PD_HTML_BOOKMARK;
+  }
+  else if ( marker[0] == '\0' ) {
+    t2pd_status_t const status = find_marker( t, fin, fin_size, tag_marker );
+    if ( status != T2PD_OK )
+      return status;
+    if ( tag_marker[0] == '\0' ) {
+      t2pd_warn( t, "no <marker> line at end of text; no bookmarks\n" );
+      return T2PD_OK;
+    }
+    marker = tag_marker;
+  }
+
+  //
+  // The marker is matched against transcoded text, so transcode it too.
+  //
+  size_t const len =
+    palm_from_utf8( marker, bm->marker, DOC_BOOKMARK_NAME_SIZE - 1 );
+  if ( len == 0 || memchr( bm->marker, '\n', len ) != NULL ) {
+    return t2pd_error( t, T2PD_ERR_ARG,
+      "\"%s\": invalid bookmark marker\n", marker
+    );
+  }
+
+  if ( bm->list == NULL ) {
+    bm->list = malloc( DOC_BOOKMARKS_MAX * sizeof *bm->list );
+    if ( bm->list == NULL )
+      return t2pd_error( t, T2PD_ERR_NOMEM, "%s\n", STRERROR );
+  }
+
+  //
+  // Every bookmark needs at least its marker and a newline (or, in HTML, its
+  // marker or an <A NAME> tag), so don't allow for more than a text of this
+  // size could possibly have.
+  //
+  size_t const bookmark_min = !t->opts.html ? len + 1 :
+    len < sizeof "<a name>" - 1 ? len : sizeof "<a name>" - 1;
+  uint64_t const max = fin_size / bookmark_min + 1;
+  bm->max = max < DOC_BOOKMARKS_MAX ? max : DOC_BOOKMARKS_MAX;
+  bm->marker_len = STATIC_CAST( unsigned, len );
+  return T2PD_OK;
+}
+
+void t2pd_bookmarks_end( t2pd_t *t ) {
+  assert( t != NULL );
+  bookmarks_t *const bm = &t->bm;
+  if ( bm->marker_len == 0 )
+    return;
+  if ( bm->state == BM_NAME )
+    end_name( bm );
+  if ( bm->state != BM_LINE_START )     // rest of line is in the next volume
+    bm->state = BM_SKIP;
+  if ( bm->dropped > 0 ) {
+    t2pd_warn( t, "%zu bookmarks beyond the first %zu ignored\n",
+      bm->dropped, bm->max
+    );
+  }
+}
+
+void t2pd_bookmarks_volume( t2pd_t *t ) {
+  assert( t != NULL );
+  bookmarks_t *const bm = &t->bm;
+  bm->offset = 0;
+  bm->count = bm->dropped = 0;
+}
+
+void t2pd_bookmarks_scan( t2pd_t *t, Byte c ) {
+  assert( t != NULL );
+  bookmarks_t *const bm = &t->bm;
+
+  switch ( bm->state ) {
+    case BM_LINE_START:
+      if ( is_blank( c ) || c == '\n' )
+        break;
+      bm->matched = 0;
+      bm->mark_offset = bm->offset;
+      bm->state = BM_MARKER;
+      FALLTHROUGH;
+
+    case BM_MARKER:
+      if ( c != bm->marker[ bm->matched ] ) {
+        bm->state = c == '\n' ? BM_LINE_START : BM_SKIP;
+        break;
+      }
+      if ( ++bm->matched < bm->marker_len )
+        break;
+      if ( bm->count == bm->max ) {
+        ++bm->dropped;
+        bm->state = BM_SKIP;
+        break;
+      }
+      doc_bookmark_t *const new_bm = &bm->list[ bm->count++ ];
+      memset( new_bm->name, 0, sizeof new_bm->name );
+      new_bm->position = bm->mark_offset;
+      bm->name_len = 0;
+      bm->state = BM_NAME_SPACE;
+      break;
+
+    case BM_NAME_SPACE:
+      if ( is_blank( c ) )
+        break;
+      bm->state = BM_NAME;
+      FALLTHROUGH;
+
+    case BM_NAME:
+      if ( c == '\n' || bm->name_len == DOC_BOOKMARK_NAME_SIZE - 1 ) {
+        end_name( bm );
+        bm->state = c == '\n' ? BM_LINE_START : BM_SKIP;
+        break;
+      }
+      char *const name = bm->list[ bm->count - 1 ].name;
+      name[ bm->name_len++ ] = STATIC_CAST( char, c );
+      break;
+
+    case BM_SKIP:
+      if ( c == '\n' )
+        bm->state = BM_LINE_START;
+      break;
+  } // switch
+
+  ++bm->offset;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* vim:set et sw=2 ts=2: */
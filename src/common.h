@@ -23,25 +23,487 @@
 #define txt2pdbdoc_common_H
 
 // local
+#include "doc.h"
 #include "palm.h"
+#include "txt2pdbdoc.h"
+#include "unicode.h"
 
 // standard
 #include <stddef.h>                     /* for size_t */
+#include <stdio.h>                      /* for FILE */
 
 ///////////////////////////////////////////////////////////////////////////////
 
 #define BUFFER_SIZE               6000  /* big enough for uncompressed record */
 
-#define NEW_BUFFER(B) (B)->data = MALLOC( Byte, (B)->len = BUFFER_SIZE )
+/**
+ * Reads exactly \a SIZE bytes or returns the status from t2pd_read_error().
+ */
+#define T2PD_FREAD(T,PTR,SIZE,STREAM) BLOCK(                  \
+  if ( fread( (PTR), 1, (SIZE), (STREAM) ) < (SIZE) )         \
+    return t2pd_read_error( (T), (STREAM) ); )
+
+/**
+ * Seeks or returns the status from t2pd_read_error().
+ */
+#define T2PD_FSEEK(T,STREAM,OFFSET,WHENCE) BLOCK(             \
+  if ( FSEEK_FN( (STREAM), (OFFSET), (WHENCE) ) == -1 )       \
+    return t2pd_read_error( (T), (STREAM) ); )
+
+/**
+ * Seeks to record entry \a I or returns the status from t2pd_read_error().
+ */
+#define T2PD_SEEK_REC(T,STREAM,I) BLOCK(                      \
+  if ( SEEK_REC( (STREAM), (I) ) == -1 )                      \
+    return t2pd_read_error( (T), (STREAM) ); )
+
+/**
+ * Writes exactly \a SIZE bytes or returns #T2PD_ERR_WRITE.
+ */
+#define T2PD_FWRITE(T,PTR,SIZE,STREAM) BLOCK(                 \
+  if ( fwrite( (PTR), 1, (SIZE), (STREAM) ) < (SIZE) )        \
+    return t2pd_error( (T), T2PD_ERR_WRITE, "%s\n", STRERROR ); )
 
 ///////////////////////////////////////////////////////////////////////////////
 
+/**
+ * A point in time as measured by both the wall clock and the CPU clock of the
+ * calling thread, used to measure conversion phases.
+ */
+struct t2pd_clock {
+  uint64_t  wall_ns;                    ///< Wall clock time.
+  uint64_t  cpu_ns;                     ///< Thread CPU time.
+};
+typedef struct t2pd_clock t2pd_clock_t;
+
 struct buffer {
   Byte   *data;
   size_t  len;
 };
 typedef struct buffer buffer_t;
 
+/**
+ * The state of scanning text for bookmarks while encoding.
+ */
+struct bookmarks {
+  Byte            marker[ DOC_BOOKMARK_NAME_SIZE ]; ///< Marker in PalmOS.
+  unsigned        marker_len;           ///< Length of \a marker; 0 = none.
+  unsigned        state;                ///< Scanning state.
+  unsigned        matched;              ///< Bytes of \a marker matched.
+  unsigned        name_len;             ///< Length of current name.
+  DWord           offset;               ///< Offset of next byte of text.
+  DWord           mark_offset;          ///< Offset of current marker.
+  doc_bookmark_t *list;                 ///< Bookmarks (host byte order).
+  size_t          count;                ///< Number of \a list used.
+  size_t          max;                  ///< Most bookmarks per volume.
+  size_t          dropped;              ///< Bookmarks beyond \a max.
+};
+typedef struct bookmarks bookmarks_t;
+
+/**
+ * The state of converting HTML while encoding; opaque outside html.c.
+ */
+typedef struct html html_t;
+
+/**
+ * The state of rendering Doc text as HTML; opaque outside render.c.
+ */
+typedef struct render render_t;
+
+/**
+ * A Doc file opened for decoding.
+ *
+ * @sa t2pd_doc_open()
+ */
+struct doc_file {
+  DatabaseHdrType header;               ///< PDB header.
+  unsigned        compression;          ///< Compression type.
+  unsigned        num_pdb_records;      ///< Number of PDB records.
+  unsigned        num_records;          ///< Number of text records.
+  unsigned        rec_size;             ///< Uncompressed text record size.
+  DWord           file_size;            ///< Size of the file.
+};
+typedef struct doc_file doc_file_t;
+
+/**
+ * The number of bytes at the end of text searched for a `<`_marker_`>` line.
+ */
+#define T2PD_TAIL_SIZE_MAX        64
+
+/**
+ * The bookmark marker written for `<A NAME>` tags while converting HTML unless
+ * \ref t2pd_options::bookmark "bookmark" gives one, as `html2pdbtxt` does.
+ */
+#define T2PD_HTML_BOOKMARK        "(*)"
+
+/**
+ * All the state of a conversion.
+ */
+struct t2pd {
+  t2pd_options_t  opts;                 ///< Options to use.
+  buffer_t        rec_buf;              ///< Uncompressed record buffer.
+  buffer_t        z_buf;                ///< Compressed record buffer.
+  size_t          buf_rec_size;         ///< Record size the buffers fit.
+  bookmarks_t     bm;                   ///< Bookmark scanning state.
+  html_t         *html;                 ///< HTML conversion state, if any.
+  render_t       *render;               ///< HTML rendering state, if any.
+  DWord          *offsets;              ///< Record offsets.
+  size_t          offsets_cap;          ///< Capacity of \a offsets.
+  FILE           *vol_spool;            ///< Text records of current volume.
+  char            errmsg[ 256 ];        ///< Most recent error message.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Prepares to scan text being encoded for bookmarks according to
+ * \ref t2pd_options::bookmark "bookmark".
+ *
+ * @param t The handle.
+ * @param fin The file that will be read from.  If the marker is to be taken
+ * from the end of the text, it must be seekable; its position is unchanged.
+ * @param fin_size The number of bytes that will be read from \a fin.
+ * @return Returns #T2PD_OK only if successful.
+ *
+ * @sa t2pd_bookmarks_scan()
+ */
+NODISCARD
+t2pd_status_t t2pd_bookmarks_begin( t2pd_t *t, FILE *fin,
+                                     uint64_t fin_size );
+
+/**
+ * Ends scanning the text of a volume for bookmarks and warns about any that
+ * had to be ignored.
+ *
+ * @param t The handle.
+ *
+ * @sa t2pd_bookmarks_volume()
+ */
+void t2pd_bookmarks_end( t2pd_t *t );
+
+/**
+ * Finds the bookmark marker in a final `<`_marker_`>` line, if any, of text.
+ *
+ * @param tail The end of the text.
+ * @param tail_size The size of \a tail; at most #T2PD_TAIL_SIZE_MAX.
+ * @param is_all If `true`, \a tail is all of the text.
+ * @param marker The buffer to receive the null-terminated marker or the empty
+ * string if none.
+ */
+void t2pd_tail_marker( char const *tail, size_t tail_size, bool is_all,
+                       char marker[ T2PD_TAIL_SIZE_MAX + 1 ] );
+
+/**
+ * Scans the next byte of transcoded text for bookmarks: lines that, ignoring
+ * leading whitespace, begin with the marker.  The text following the marker
+ * and any whitespace, up to #DOC_BOOKMARK_NAME_SIZE - 1 bytes, is the name.
+ *
+ * @param t The handle.
+ * @param c The byte.
+ *
+ * @sa t2pd_bookmarks_begin()
+ */
+void t2pd_bookmarks_scan( t2pd_t *t, Byte c );
+
+/**
+ * Starts scanning the text of the next volume for bookmarks: their positions
+ * are relative to the start of the text in their volume.
+ *
+ * @param t The handle.
+ *
+ * @sa t2pd_bookmarks_end()
+ */
+void t2pd_bookmarks_volume( t2pd_t *t );
+
+/**
+ * Opens a Doc file for decoding: reads and checks its header and record 0.
+ *
+ * @param t The handle.
+ * @param fin The file to read from, positioned at its start.  It must be
+ * seekable.
+ * @param doc The Doc file to initialize.
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+t2pd_status_t t2pd_doc_open( t2pd_t *t, FILE *fin, doc_file_t *doc );
+
+/**
+ * Reads the bookmark records, if any, that follow the text records.  Records
+ * that aren't the size of a bookmark are ignored.
+ *
+ * @param t The handle.
+ * @param fin The file to read from.
+ * @param doc The Doc file.
+ * @param list The array of at least #DOC_BOOKMARKS_MAX bookmarks to receive
+ * them with their positions in host byte order.
+ * @param count A pointer to receive the number of bookmarks.
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+t2pd_status_t t2pd_doc_read_bookmarks( t2pd_t *t, FILE *fin,
+                                       doc_file_t const *doc,
+                                       doc_bookmark_t *list, size_t *count );
+
+/**
+ * Reads a text record, uncompressing it if necessary.
+ *
+ * @param t The handle.
+ * @param fin The file to read from.
+ * @param doc The Doc file.
+ * @param rec_num The number of the text record.
+ * @param clock The clock to add the read and uncompress phases to.
+ * @param text A pointer to receive the buffer containing the text, valid
+ * until the next call.  The stored record is always in \a t->z_buf.
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+t2pd_status_t t2pd_doc_read_record( t2pd_t *t, FILE *fin,
+                                    doc_file_t const *doc, unsigned rec_num,
+                                    t2pd_clock_t *clock,
+                                    buffer_t const **text );
+
+/**
+ * Renders the text of a Doc file as HTML the way `pdbtxt2html -t` does.
+ *
+ * @param t The handle.
+ * @param fin The file to read from.
+ * @param doc The Doc file.
+ * @param fout The file to write to.
+ * @param clock The clock started when decoding began.
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+t2pd_status_t t2pd_render_html( t2pd_t *t, FILE *fin, doc_file_t const *doc,
+                                 FILE *fout, t2pd_clock_t *clock );
+
+/**
+ * Frees the state of rendering HTML, if any.
+ *
+ * @param r The render state or NULL.
+ */
+void t2pd_render_free( render_t *r );
+
+/**
+ * Prepares to convert HTML into Doc text while encoding.
+ *
+ * @param t The handle.
+ * @return Returns #T2PD_OK only if successful.
+ *
+ * @sa t2pd_html_getc()
+ */
+NODISCARD
+t2pd_status_t t2pd_html_begin( t2pd_t *t );
+
+/**
+ * Gets the next character of Doc text converted from HTML.
+ *
+ * @param t The handle.
+ * @param fin The file to read HTML from.
+ * @return Returns said character or \c EOF upon either end of file or error.
+ *
+ * @sa t2pd_html_begin()
+ */
+NODISCARD
+int t2pd_html_getc( t2pd_t *t, FILE *fin );
+
+/**
+ * Encodes text into a Doc file.
+ *
+ * @param t The handle.
+ * @param doc_name The name of the document.
+ * @param fin The file to read from.
+ * @param fin_size The number of bytes that will be read from \a fin.
+ * @param fout The file to write to.  It must be seekable.  If the text needs
+ * more than one volume, the rest are opened via
+ * \ref t2pd_options::volume_fn "volume_fn".
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+t2pd_status_t t2pd_encode( t2pd_t *t, char const *doc_name, FILE *fin,
+                           uint64_t fin_size, FILE *fout );
+
+/**
+ * Checks that compressed bytes uncompress to exactly the expected bytes
+ * without writing them anywhere.
+ *
+ * @param src The compressed bytes.
+ * @param src_len The number of bytes of \a src.
+ * @param expect The expected uncompressed bytes.
+ * @param expect_len The number of bytes of \a expect.
+ * @param mismatch A pointer to receive the offset into \a expect of the first
+ * mismatch, if any.
+ * @return Returns `true` only if \a src uncompresses to \a expect.
+ */
+NODISCARD
+bool t2pd_compress_check( uint8_t const *src, size_t src_len,
+                          uint8_t const *expect, size_t expect_len,
+                          size_t *mismatch );
+
+/**
+ * Emits a diagnostic message via the handle's diagnostic function, if any.
+ *
+ * @param t The handle.
+ * @param kind The kind of message.
+ * @param format The `printf`-style format string.
+ */
+ATTRIBUTE_FORMAT(( printf, 3, 4 ))
+void t2pd_diag( t2pd_t const *t, t2pd_diag_t kind, char const *format, ... );
+
+/**
+ * Sets the handle's error message for a failed doc_parse_header() or
+ * doc_parse_record0().
+ *
+ * @param t The handle.
+ * @param status The status from the failed function.
+ * @param dl The doc_layout it used.
+ * @return Returns #T2PD_ERR_NOT_DOC, #T2PD_ERR_COMPRESSION, or
+ * #T2PD_ERR_CORRUPT.
+ */
+t2pd_status_t t2pd_doc_error( t2pd_t *t, doc_status_t status,
+                              doc_layout_t const *dl );
+
+/**
+ * Sets the handle's error message.
+ *
+ * @param t The handle.
+ * @param status The status to return.
+ * @param format The `printf`-style format string.
+ * @return Returns \a status.
+ */
+ATTRIBUTE_FORMAT(( printf, 3, 4 ))
+t2pd_status_t t2pd_error( t2pd_t *t, t2pd_status_t status,
+                          char const *format, ... );
+
+/**
+ * Compresses a buffer using Doc compression, counting what the compressor does.
+ *
+ * @param src The bytes to compress.
+ * @param src_len The number of bytes of \a src.
+ * @param dst The buffer to receive the compressed bytes.  It must be at least
+ * #T2PD_COMPRESS_BOUND(\a src_len) bytes.
+ * @param dst_len A pointer to receive the number of compressed bytes.
+ * @param stats The statistics whose compressor counters to increment, or NULL.
+ * @return Returns #T2PD_OK only if successful.
+ *
+ * @sa t2pd_compress()
+ */
+t2pd_status_t t2pd_compress_counted( uint8_t const *src, size_t src_len,
+                                     uint8_t *dst, size_t *dst_len,
+                                     t2pd_stats_t *stats );
+
+/**
+ * Ensures \a t->rec_buf can hold an uncompressed record of \a rec_size bytes
+ * and \a t->z_buf the same record compressed.
+ *
+ * @param t The handle.
+ * @param rec_size The size of uncompressed records.
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+t2pd_status_t t2pd_buffers_reserve( t2pd_t *t, size_t rec_size );
+
+/**
+ * Ensures \a t->offsets can hold at least \a n record offsets.
+ *
+ * @param t The handle.
+ * @param n The number of offsets.
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+t2pd_status_t t2pd_offsets_reserve( t2pd_t *t, size_t n );
+
+/**
+ * Fills a buffer with up to \a size characters from the input file
+ * transcoded from UTF-8 into the PalmOS character set and, if
+ * \ref t2pd_options::html "html", converted from HTML.
+ *
+ * @param t The handle.
+ * @param fin The file to read from.
+ * @param buf The buffer to fill.
+ * @param size The most characters to fill it with.
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+t2pd_status_t t2pd_fill_buffer( t2pd_t *t, FILE *fin, buffer_t *buf,
+                                size_t size );
+
+/**
+ * Maps a PalmOS character into its corresponding UTF-8 octet sequence.
+ *
+ * @param t The handle.
+ * @param c The PalmOS character to map.
+ * @param utf8_char A buffer of at least #UTF8_CHAR_SIZE_MAX bytes to receive
+ * said sequence.
+ * @return Returns the length of said sequence or 0 if the PalmOS character can
+ * not be mapped into Unicode.
+ */
+NODISCARD
+unsigned t2pd_palm_to_utf8( t2pd_t const *t, Byte c, char8_t *utf8_char );
+
+/**
+ * Reads the next character of UTF-8 text transcoding it into the PalmOS
+ * character set.
+ *
+ * @param t The handle.
+ * @param fin The file to read from.
+ * @return Returns said character or \c EOF upon either end of file or error.
+ */
+NODISCARD
+int t2pd_read_char( t2pd_t *t, FILE *fin );
+
+/**
+ * Sets the handle's error message after a failed read or seek.
+ *
+ * @param t The handle.
+ * @param file The file that was read from.
+ * @return Returns #T2PD_ERR_READ if there was an I/O error or
+ * #T2PD_ERR_CORRUPT if end-of-file was reached prematurely.
+ */
+t2pd_status_t t2pd_read_error( t2pd_t *t, FILE *file );
+
+/**
+ * Resets the handle's statistics, if any, at the start of a conversion.
+ *
+ * @param t The handle.
+ * @param decode Is the conversion a decode?
+ * @param clock The clock to start.
+ */
+void t2pd_stats_begin( t2pd_t *t, bool decode, t2pd_clock_t *clock );
+
+/**
+ * Adds the time since \a clock to a phase of the handle's statistics, if any,
+ * then restarts \a clock so consecutive phases can be timed with one clock.
+ *
+ * @param t The handle.
+ * @param phase The phase that just ended.
+ * @param clock The clock started when \a phase began.
+ */
+void t2pd_stats_phase( t2pd_t *t, t2pd_phase_t phase, t2pd_clock_t *clock );
+
+/**
+ * Adds a record to the handle's statistics, if any, keeping it only if it is
+ * among the slowest.
+ *
+ * @param t The handle.
+ * @param rec_num The record number.
+ * @param in_len The size of the record before conversion.
+ * @param out_len The size of the record after conversion.
+ * @param start The wall clock time the record was started.
+ * @param clock The clock at the time the record was finished.
+ */
+void t2pd_stats_record( t2pd_t *t, unsigned rec_num, size_t in_len,
+                        size_t out_len, t2pd_clock_t const *start,
+                        t2pd_clock_t const *clock );
+
+/**
+ * Emits a character conversion warning unless warnings are suppressed.
+ *
+ * @param t The handle.
+ * @param format The `printf`-style format string.
+ */
+#define t2pd_warn(T,...) \
+  BLOCK( if ( !(T)->opts.no_warnings ) t2pd_diag( (T), T2PD_DIAG_WARNING, __VA_ARGS__ ); )
+
 ///////////////////////////////////////////////////////////////////////////////
 
 #endif /* txt2pdbdoc_common_H */
@@ -22,10 +22,13 @@
 // local
 #include "pjl_config.h"
 #include "common.h"
+#include "probes.h"
+#include "txt2pdbdoc.h"
 #include "util.h"
 
 // standard
 #include <assert.h>
+#include <stdbool.h>
 #include <stdlib.h>
 
 // constants
@@ -40,8 +43,9 @@
  * @param b The buffer to be affected.
  * @param c The byte.
  * @param space Is it a space?
+ * @param stats The statistics to count escapes in, or NULL.
  */
-static void put_byte( buffer_t *b, Byte c, bool *space ) {
+static void put_byte( buffer_t *b, Byte c, bool *space, t2pd_stats_t *stats ) {
   assert( b != NULL );
   assert( space != NULL );
 
@@ -61,36 +65,45 @@ static void put_byte( buffer_t *b, Byte c, bool *space ) {
     return;
   }
 
-  if ( (c >= 1 && c <= 8) || c >= 0x80 )
+  if ( (c >= 1 && c <= 8) || c >= 0x80 ) {
     b->data[ b->len++ ] = '\1';
+    if ( stats != NULL )
+      ++stats->literal_escapes;
+  }
 
   b->data[ b->len++ ] = c;
 }
 
 ////////// extern functions ///////////////////////////////////////////////////
 
+t2pd_status_t t2pd_compress( uint8_t const *src, size_t src_len,
+                             uint8_t *dst, size_t *dst_len ) {
+  return t2pd_compress_counted( src, src_len, dst, dst_len, NULL );
+}
+
 /**
- * Replaces the given buffer with a compressed version of itself.  I don't
- * understand this algorithm.  I just cleaned up the code.
- *
- * @param b The buffer to be compressed.
+ * Compresses a buffer.  I don't understand this algorithm.  I just cleaned up
+ * the code.
  */
-void compress( buffer_t *b ) {
-  assert( b != NULL );
+t2pd_status_t t2pd_compress_counted( uint8_t const *src, size_t src_len,
+                                     uint8_t *dst, size_t *dst_len,
+                                     t2pd_stats_t *stats ) {
+  if ( src == NULL || dst == NULL || dst_len == NULL )
+    return T2PD_ERR_ARG;
+  T2PD_PROBE1( compress_entry, src_len );
 
   bool space = false;
 
-  Byte *buf_orig;
-  Byte *p;                  // walking test hit; works up on successive matches
-  Byte *p_prev;
-  Byte *head;                           // current test string
+  Byte const *const buf_orig = src;
+  Byte const *p;            // walking test hit; works up on successive matches
+  Byte const *p_prev;
+  Byte const *head;                     // current test string
 
-  p = p_prev = head = buf_orig = b->data;
-  Byte *tail = head + 1;                // 1 past the current test buffer
-  Byte *const end = b->data + b->len;   // 1 past the end of the input buffer
+  p = p_prev = head = buf_orig;
+  Byte const *tail = head + 1;          // 1 past the current test buffer
+  Byte const *const end = buf_orig + src_len; // 1 past the end of the input
 
-  NEW_BUFFER( b );
-  b->len = 0;
+  buffer_t buf = { dst, 0 }, *const b = &buf;
 
   // loop, absorbing one more char from the input buffer on each pass
   while ( head != end ) {
@@ -103,6 +116,8 @@ void compress( buffer_t *b ) {
       p_prev, STATIC_CAST( size_t, tail - p_prev ),
       head, STATIC_CAST( size_t, tail - head )
     );
+    if ( stats != NULL )
+      ++stats->match_attempts;
 
     // on a mismatch or end of buffer, issued codes
     if ( !p || p == head || tail - head > (1 << COUNT_BITS) + 2 ||
@@ -110,14 +125,15 @@ void compress( buffer_t *b ) {
       // issued the codes
       // first, check for short runs
       if ( tail - head < 4 ) {
-        put_byte( b, *head++, &space );
+        put_byte( b, *head++, &space, stats );
       } else {
         size_t const dist = STATIC_CAST( size_t, head - p_prev );
         size_t const compound =
           (dist << COUNT_BITS) + STATIC_CAST( size_t, tail - head - 4 );
 
-        if ( dist >= ( 1 << DISP_BITS ) || tail - head - 4 > 7 )
-          PRINT_ERR( "%s: error: dist overflow\n", me );
+        // guaranteed by the window and run-length checks above
+        assert( dist < ( 1 << DISP_BITS ) );
+        assert( tail - head - 4 <= 7 );
 
         // for longer runs, issue a run-code
         // issue space char if required
@@ -128,6 +144,10 @@ void compress( buffer_t *b ) {
 
         b->data[ b->len++ ] = STATIC_CAST( Byte, 0x80 + (compound >> 8) );
         b->data[ b->len++ ] = compound & 0xFF;
+        if ( stats != NULL ) {
+          ++stats->matches;
+          stats->match_bytes += STATIC_CAST( uint64_t, tail - head - 1 );
+        }
         head = tail - 1;                // and start again
       }
       p_prev = buf_orig;                // start search again
@@ -140,7 +160,6 @@ void compress( buffer_t *b ) {
     if ( tail != end )
       ++tail;
   } // while
-  free( buf_orig );
 
   if ( space )
     b->data[ b->len++ ] = ' ';          // add left-over space
@@ -167,44 +186,136 @@ void compress( buffer_t *b ) {
       ++i;
     }
   } // for
-  b->len = j;
+
+  *dst_len = j;
+  T2PD_PROBE2( compress_return, src_len, j );
+  return T2PD_OK;
+}
+
+bool t2pd_compress_check( uint8_t const *src, size_t src_len,
+                          uint8_t const *expect, size_t expect_len,
+                          size_t *mismatch ) {
+  assert( src != NULL );
+  assert( expect != NULL );
+  assert( mismatch != NULL );
+
+  //
+  // This mirrors t2pd_uncompress() except that, rather than writing each byte,
+  // it compares it against the expected byte.  Since every byte prior to j
+  // has already matched, back-references can be resolved against expect[]
+  // itself, so no output buffer is needed.
+  //
+  size_t i, j;
+
+  for ( i = j = 0; i < src_len; ) {
+    unsigned c = src[ i++ ];
+
+    if ( c >= 1 && c <= 8 ) {
+      if ( i + c > src_len )
+        goto mismatch;
+      for ( ; c > 0; --c, ++i, ++j )
+        if ( j == expect_len || src[ i ] != expect[ j ] )
+          goto mismatch;
+    }
+    else if ( c <= 0x7F ) {
+      if ( j == expect_len || c != expect[ j ] )
+        goto mismatch;
+      ++j;
+    }
+    else if ( c >= 0xC0 ) {
+      if ( j + 2 > expect_len || expect[ j ] != ' ' )
+        goto mismatch;
+      if ( expect[ ++j ] != (c ^ 0x80) )
+        goto mismatch;
+      ++j;
+    }
+    else {
+      if ( i == src_len )
+        goto mismatch;
+      c = (c << 8) + src[ i++ ];
+      unsigned const di = (c & 0x3FFF) >> COUNT_BITS;
+      unsigned const n = (c & ((1 << COUNT_BITS) - 1)) + 3;
+      if ( di == 0 || di > j )
+        goto mismatch;
+      for ( unsigned k = 0; k < n; ++k, ++j )
+        if ( j == expect_len || expect[ j - di ] != expect[ j ] )
+          goto mismatch;
+    }
+  } // for
+
+  if ( j == expect_len )
+    return true;
+
+mismatch:
+  *mismatch = j;
+  return false;
 }
 
 /**
- * Replaces the given buffer with an uncompressed version of itself.
+ * Uncompresses a buffer compressed using Doc compression.
+ *
+ * @param src The bytes to uncompress.
+ * @param src_len The number of bytes of \a src.
+ * @param dst The buffer to receive the uncompressed bytes.
+ * @param dst_size The size of \a dst.
+ * @param dst_len A pointer to receive the number of uncompressed bytes.
+ * @return Returns #T2PD_OK only if successful or #T2PD_ERR_CORRUPT if not.
  *
- * @param b The buffer to be uncompressed.
+ * @sa t2pd_uncompress()
  */
-void uncompress( buffer_t *b ) {
-  assert( b != NULL );
-
-  Byte *const new_data = MALLOC( Byte, BUFFER_SIZE );
+NODISCARD
+static t2pd_status_t uncompress( uint8_t const *src, size_t src_len,
+                                 uint8_t *dst, size_t dst_size,
+                                 size_t *dst_len ) {
   size_t i, j;
 
-  for ( i = j = 0; i < b->len; ) {
-    unsigned c = b->data[ i++ ];
+  for ( i = j = 0; i < src_len; ) {
+    unsigned c = src[ i++ ];
 
     if ( c >= 1 && c <= 8 ) {
+      if ( i + c > src_len || j + c > dst_size )
+        return T2PD_ERR_CORRUPT;
       while ( c-- )                     // copy 'c' bytes
-        new_data[ j++ ] = b->data[ i++ ];
+        dst[ j++ ] = src[ i++ ];
     }
     else if ( c <= 0x7F ) {             // 0,09-7F = self
-      new_data[ j++ ] = STATIC_CAST( Byte, c );
+      if ( j + 1 > dst_size )
+        return T2PD_ERR_CORRUPT;
+      dst[ j++ ] = STATIC_CAST( Byte, c );
     }
     else if ( c >= 0xC0 ) {             // space + ASCII char
-      new_data[ j++ ] = ' ';
-      new_data[ j++ ] = STATIC_CAST( Byte, c ^ 0x80 );
+      if ( j + 2 > dst_size )
+        return T2PD_ERR_CORRUPT;
+      dst[ j++ ] = ' ';
+      dst[ j++ ] = STATIC_CAST( Byte, c ^ 0x80 );
     }
     else {                              // 80-BF = sequences
-      c = (c << 8) + b->data[ i++ ];
+      if ( i == src_len )
+        return T2PD_ERR_CORRUPT;
+      c = (c << 8) + src[ i++ ];
       unsigned const di = (c & 0x3FFF) >> COUNT_BITS;
-      for ( int n = (c & ((1 << COUNT_BITS) - 1)) + 3; n--; ++j )
-        new_data[ j ] = new_data[ j - di ];
+      unsigned const n = (c & ((1 << COUNT_BITS) - 1)) + 3;
+      if ( di == 0 || di > j || j + n > dst_size )
+        return T2PD_ERR_CORRUPT;
+      for ( unsigned k = 0; k < n; ++k, ++j )
+        dst[ j ] = dst[ j - di ];
     }
   } // for
-  free( b->data );
-  b->data = new_data;
-  b->len = j;
+
+  *dst_len = j;
+  return T2PD_OK;
+}
+
+t2pd_status_t t2pd_uncompress( uint8_t const *src, size_t src_len,
+                               uint8_t *dst, size_t dst_size,
+                               size_t *dst_len ) {
+  if ( src == NULL || dst == NULL || dst_len == NULL )
+    return T2PD_ERR_ARG;
+  T2PD_PROBE1( uncompress_entry, src_len );
+  t2pd_status_t const status =
+    uncompress( src, src_len, dst, dst_size, dst_len );
+  T2PD_PROBE2( uncompress_return, status, status == T2PD_OK ? *dst_len : 0 );
+  return status;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
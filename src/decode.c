@@ -23,8 +23,9 @@
 #include "pjl_config.h"
 #include "common.h"
 #include "doc.h"
-#include "options.h"
 #include "palm.h"
+#include "probes.h"
+#include "txt2pdbdoc.h"
 #include "unicode.h"
 #include "util.h"
 
@@ -36,48 +37,303 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sysexits.h>
-#include <unistd.h>
 
-#define GET_DWord(F,N) \
-  BLOCK( FREAD( (N), sizeof( DWord ), 1, (F) ); *(N) = ntohl( *(N) ); )
+#define GET_DWord(T,F,N) BLOCK( \
+  T2PD_FREAD( (T), (N), sizeof( DWord ), (F) ); *(N) = ntohl( *(N) ); )
 
-////////// extern declarations ////////////////////////////////////////////////
+////////// local functions ////////////////////////////////////////////////////
 
-extern FILE        *fin;
-extern char const  *fin_path;
-extern FILE        *fout;
+/**
+ * Checks the PDB header of a Doc file just read into \a doc->header.
+ *
+ * @param t The handle.
+ * @param doc The Doc file.
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+static t2pd_status_t doc_check_header( t2pd_t *t, doc_file_t *doc ) {
+  doc_layout_t dl;
+  doc_status_t const status =
+    doc_parse_header( &doc->header, !t->opts.no_check_doc, &dl );
+  if ( status != DOC_OK )
+    return t2pd_doc_error( t, status, &dl );
+  doc->num_pdb_records = dl.num_pdb_records;
+  return T2PD_OK;
+}
 
-extern bool         opt_no_check_doc;
-extern bool         opt_no_warnings;
-extern char32_t     opt_unmapped_codepoint;
-extern bool         opt_verbose;
+/**
+ * Reads and checks record 0 of a Doc file.
+ *
+ * @param t The handle.
+ * @param fin The file to read from, positioned at record 0.
+ * @param doc The Doc file.
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+static t2pd_status_t doc_read_record0( t2pd_t *t, FILE *fin,
+                                       doc_file_t *doc ) {
+  doc_record0_t rec0;
+  T2PD_FREAD( t, &rec0, sizeof rec0, fin );
+
+  doc_layout_t dl = { .num_pdb_records = doc->num_pdb_records };
+  doc_status_t const status = doc_parse_record0( &rec0, sizeof rec0, &dl );
+  if ( status != DOC_OK )
+    return t2pd_doc_error( t, status, &dl );
+  doc->compression = dl.compression;
+  doc->num_records = dl.num_records;
+  doc->rec_size = dl.rec_size;
+  return t2pd_buffers_reserve( t, doc->rec_size );
+}
 
-extern void uncompress( buffer_t* );
+/**
+ * Gets the maximum stored size of a text record of a Doc file.
+ *
+ * @param doc The Doc file.
+ * @return Returns said size.
+ */
+NODISCARD
+static size_t record_stored_max( doc_file_t const *doc ) {
+  return doc->compression == DOC_COMPRESSED ?
+    T2PD_COMPRESS_BOUND( doc->rec_size ) : doc->rec_size;
+}
 
-////////// local functions ////////////////////////////////////////////////////
+/**
+ * Gets the text of a record just read into \a t->z_buf, uncompressing it if
+ * necessary.
+ *
+ * @param t The handle.
+ * @param doc The Doc file.
+ * @param rec_num The number of the text record.
+ * @param clock The clock to add the uncompress phase to.
+ * @param text A pointer to receive the buffer containing the text.
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+static t2pd_status_t record_text( t2pd_t *t, doc_file_t const *doc,
+                                  unsigned rec_num, t2pd_clock_t *clock,
+                                  buffer_t const **text ) {
+  buffer_t const *const in_buf = &t->z_buf;
+  buffer_t *const out_buf = &t->rec_buf;
+
+  *text = in_buf;
+  if ( doc->compression == DOC_COMPRESSED ) {
+    if ( t2pd_uncompress( in_buf->data, in_buf->len, out_buf->data,
+                          doc->rec_size, &out_buf->len ) != T2PD_OK ) {
+      return t2pd_error( t, T2PD_ERR_CORRUPT,
+        "record %u: invalid compressed data or more than %u bytes\n",
+        rec_num, doc->rec_size
+      );
+    }
+    *text = out_buf;
+    t2pd_stats_phase( t, T2PD_PHASE_COMPRESS, clock );
+  }
+  return T2PD_OK;
+}
+
+/**
+ * Gets the offset and size of a record from the record list.
+ *
+ * @param t The handle.
+ * @param fin The file to read from.
+ * @param doc The Doc file.
+ * @param rec_num The record number.
+ * @param offset A pointer to receive the offset of the record.
+ * @param size A pointer to receive the size of the record.
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+static t2pd_status_t record_span( t2pd_t *t, FILE *fin, doc_file_t const *doc,
+                                  unsigned rec_num, DWord *offset,
+                                  DWord *size ) {
+  T2PD_SEEK_REC( t, fin, rec_num );
+  GET_DWord( t, fin, offset );
+
+  // read the next record offset to compute the record size
+  DWord next_offset;
+  if ( rec_num + 1 < doc->num_pdb_records ) {
+    T2PD_SEEK_REC( t, fin, rec_num + 1 );
+    GET_DWord( t, fin, &next_offset );
+  } else {
+    next_offset = doc->file_size;
+  }
+  if ( next_offset < *offset || next_offset > doc->file_size ) {
+    return t2pd_error( t, T2PD_ERR_CORRUPT,
+      "record %u: invalid offset\n", rec_num
+    );
+  }
+  *size = next_offset - *offset;
+  return T2PD_OK;
+}
+
+/**
+ * Skips bytes of a non-seekable Doc file up to an offset.
+ *
+ * @param t The handle.
+ * @param fin The file to read from.
+ * @param pos A pointer to the number of bytes read so far.
+ * @param offset The offset to skip to.
+ * @param rec_num The number of the record at \a offset.
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+static t2pd_status_t stream_skip( t2pd_t *t, FILE *fin, DWord *pos,
+                                  DWord offset, unsigned rec_num ) {
+  if ( offset < *pos ) {
+    return t2pd_error( t, T2PD_ERR_CORRUPT,
+      "record %u: offset %lu out of order; input must be seekable\n",
+      rec_num, STATIC_CAST( unsigned long, offset )
+    );
+  }
+  for ( ; *pos < offset; ++*pos ) {
+    if ( getc( fin ) == EOF )
+      return t2pd_read_error( t, fin );
+  } // for
+  return T2PD_OK;
+}
+
+/**
+ * Opens a non-seekable Doc file for decoding: reads and checks its header,
+ * reads its record list into \a t->offsets, and reads and checks record 0.
+ *
+ * @param t The handle.
+ * @param fin The file to read from, positioned at its start.
+ * @param doc The Doc file to initialize.
+ * @param pos A pointer to receive the number of bytes read.
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+static t2pd_status_t stream_open( t2pd_t *t, FILE *fin, doc_file_t *doc,
+                                  DWord *pos ) {
+  T2PD_FREAD( t, &doc->header, DatabaseHdrSize, fin );
+  t2pd_status_t status = doc_check_header( t, doc );
+  if ( status != T2PD_OK )
+    return status;
+
+  status = t2pd_offsets_reserve( t, doc->num_pdb_records );
+  if ( status != T2PD_OK )
+    return status;
+  for ( unsigned i = 0; i < doc->num_pdb_records; ++i ) {
+    RecordEntryType rec;
+    T2PD_FREAD( t, &rec, RecordEntrySize, fin );
+    t->offsets[i] = ntohl( rec.offset );
+  } // for
+  *pos = DatabaseHdrSize + RecordEntrySize * doc->num_pdb_records;
+
+  status = stream_skip( t, fin, pos, t->offsets[0], 0 );
+  if ( status != T2PD_OK )
+    return status;
+  status = doc_read_record0( t, fin, doc );
+  *pos += sizeof( doc_record0_t );
+  return status;
+}
 
 /**
- * Maps a PalmOS character into its corresponding UTF-8 octet sequence.
+ * Reads the next text record of a non-seekable Doc file, uncompressing it if
+ * necessary.  The size of the last record of the file is that of the rest of
+ * the file.
  *
- * @param c The PalmOS character to map.
- * @return Returns said sequence or NULL if the PalmOS character can not be
- * mapped into Unicode.
+ * @param t The handle.
+ * @param fin The file to read from.
+ * @param doc The Doc file.
+ * @param rec_num The number of the text record.
+ * @param pos A pointer to the number of bytes read so far.
+ * @param clock The clock to add the read and uncompress phases to.
+ * @param text A pointer to receive the buffer containing the text, valid
+ * until the next call.
+ * @return Returns #T2PD_OK only if successful.
  */
 NODISCARD
-static char8_t const* palm_to_utf8( Byte c ) {
+static t2pd_status_t stream_read_record( t2pd_t *t, FILE *fin,
+                                         doc_file_t const *doc,
+                                         unsigned rec_num, DWord *pos,
+                                         t2pd_clock_t *clock,
+                                         buffer_t const **text ) {
+  DWord const offset = t->offsets[ rec_num ];
+  t2pd_status_t const status = stream_skip( t, fin, pos, offset, rec_num );
+  if ( status != T2PD_OK )
+    return status;
+
+  size_t const stored_max = record_stored_max( doc );
+  buffer_t *const in_buf = &t->z_buf;
+
+  if ( rec_num + 1 < doc->num_pdb_records ) {
+    DWord const next_offset = t->offsets[ rec_num + 1 ];
+    if ( next_offset < offset ) {
+      return t2pd_error( t, T2PD_ERR_CORRUPT,
+        "record %u: invalid offset\n", rec_num
+      );
+    }
+    DWord const rec_size = next_offset - offset;
+    if ( rec_size > stored_max ) {
+      return t2pd_error( t, T2PD_ERR_CORRUPT,
+        "record %u: %lu bytes; more than %zu\n",
+        rec_num, STATIC_CAST( unsigned long, rec_size ), stored_max
+      );
+    }
+    T2PD_FREAD( t, in_buf->data, rec_size, fin );
+    in_buf->len = rec_size;
+  } else {
+    in_buf->len = fread( in_buf->data, 1, stored_max, fin );
+    if ( ferror( fin ) )
+      return t2pd_read_error( t, fin );
+    if ( in_buf->len == stored_max && getc( fin ) != EOF ) {
+      return t2pd_error( t, T2PD_ERR_CORRUPT,
+        "record %u: more than %zu bytes\n", rec_num, stored_max
+      );
+    }
+  }
+  *pos += STATIC_CAST( DWord, in_buf->len );
+  t2pd_stats_phase( t, T2PD_PHASE_READ, clock );
+
+  return record_text( t, doc, rec_num, clock, text );
+}
+
+/**
+ * Copies a non-seekable file to a temporary file.
+ *
+ * @param t The handle.
+ * @param fin The file to copy.
+ * @param ptmp A pointer to receive the temporary file positioned at its
+ * start.  The caller is responsible for closing it.
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+static t2pd_status_t spool( t2pd_t *t, FILE *fin, FILE **ptmp ) {
+  FILE *const tmp = tmpfile();
+  if ( tmp == NULL )
+    return t2pd_error( t, T2PD_ERR_WRITE, "%s\n", STRERROR );
+
+  char buf[ 64 * 1024 ];
+  for ( size_t n; (n = fread( buf, 1, sizeof buf, fin )) > 0; ) {
+    if ( fwrite( buf, 1, n, tmp ) < n ) {
+      fclose( tmp );
+      return t2pd_error( t, T2PD_ERR_WRITE, "%s\n", STRERROR );
+    }
+  } // for
+  if ( ferror( fin ) ) {
+    fclose( tmp );
+    return t2pd_read_error( t, fin );
+  }
+  rewind( tmp );
+  *ptmp = tmp;
+  return T2PD_OK;
+}
+
+////////// extern functions ///////////////////////////////////////////////////
+
+unsigned t2pd_palm_to_utf8( t2pd_t const *t, Byte c, char8_t *utf8_char ) {
   char32_t cp = palm_to_unicode( c );
+  char pc_buf[ PRINTABLE_CHAR_SIZE ];
 
   if ( cp == 0 ) {
-    if ( !opt_no_warnings )
-      PMESSAGE(
-        "\"%s\" (%s): PalmOS character does not map to Unicode%s\n",
-        printable_char( STATIC_CAST( char, c ) ), palm_to_string( c ),
-        (opt_unmapped_codepoint ? "" : ": skipped")
-      );
-    if ( !opt_unmapped_codepoint )
-      return NULL;
-    cp = opt_unmapped_codepoint;
+    t2pd_warn( t,
+      "\"%s\" (%s): PalmOS character does not map to Unicode%s\n",
+      printable_char( STATIC_CAST( char, c ), pc_buf ), palm_to_string( c ),
+      (t->opts.unmapped_codepoint ? "" : ": skipped")
+    );
+    if ( !t->opts.unmapped_codepoint )
+      return 0;
+    cp = t->opts.unmapped_codepoint;
   }
 
   switch ( cp ) {
@@ -87,122 +343,203 @@ static char8_t const* palm_to_utf8( Byte c ) {
       // These characters are not used in PalmOS and shouldn't be present;
       // but since we got them, skip them.
       //
-      if ( !opt_no_warnings )
-        PMESSAGE(
-          "\"%s\": character unused by PalmOS: skipped\n",
-          printable_char( STATIC_CAST( char, c ) )
-        );
-      return NULL;
+      t2pd_warn( t,
+        "\"%s\": character unused by PalmOS: skipped\n",
+        printable_char( STATIC_CAST( char, c ), pc_buf )
+      );
+      return 0;
   } // switch
 
-  static char8_t utf8_char[ UTF8_CHAR_SIZE_MAX + 1 /*NULL*/ ];
-  unsigned len;
-
   if ( cp_is_ascii( cp ) ) {
     if ( !(isspace( (int)cp ) || isprint( (int)cp )) ) {
-      PMESSAGE(
+      t2pd_diag( t, T2PD_DIAG_WARNING,
         "\"%s\" (%s): non-printable character found: skipped\n",
-        printable_char( STATIC_CAST( char, c ) ), palm_to_string( c )
+        printable_char( STATIC_CAST( char, c ), pc_buf ), palm_to_string( c )
       );
-      return NULL;
+      return 0;
     }
     utf8_char[0] = c;
-    len = 1;
-  } else {
-    len = utf8_encode( cp, utf8_char );
+    return 1;
   }
 
-  utf8_char[ len ] = '\0';
-  return utf8_char;
+  return utf8_encode( cp, utf8_char );
 }
 
-////////// extern functions ///////////////////////////////////////////////////
+t2pd_status_t t2pd_doc_open( t2pd_t *t, FILE *fin, doc_file_t *doc ) {
+  assert( t != NULL );
+  assert( fin != NULL );
+  assert( doc != NULL );
 
-/**
- * Decodes the source Doc file to a text file.
- */
-void decode( void ) {
-
-  ////////// open files, read header, ensure source is a Doc file /////////////
+  ////////// read header, ensure source is a Doc file /////////////////////////
 
-  DatabaseHdrType header;
-  FREAD( &header, DatabaseHdrSize, 1, fin );
-  if ( !opt_no_check_doc && (
-       strncmp( header.type,    DOC_TYPE,    sizeof header.type ) ||
-       strncmp( header.creator, DOC_CREATOR, sizeof header.creator ) ) ) {
-    PMESSAGE_EXIT( EX_DATAERR, "%s is not a Doc file\n", fin_path );
-  }
-
-  // without rec 0
-  int const num_records = ntohs( header.recordList.numRecords ) - 1;
+  T2PD_FREAD( t, &doc->header, DatabaseHdrSize, fin );
+  t2pd_status_t status = doc_check_header( t, doc );
+  if ( status != T2PD_OK )
+    return status;
 
   ////////// read record 0 ////////////////////////////////////////////////////
 
-  SEEK_REC( fin, 0 );
+  T2PD_SEEK_REC( t, fin, 0 );
   DWord offset;
-  GET_DWord( fin, &offset );            // get offset of rec 0
-  FSEEK( fin, offset, SEEK_SET );
-
-  doc_record0_t rec0;
-  FREAD( &rec0, sizeof rec0, 1, fin );
-
-  int const compression = ntohs( rec0.version );
-  switch ( compression ) {
-    case DOC_COMPRESSED:
-    case DOC_UNCOMPRESSED:
-      break;
-    default:
-      PMESSAGE_EXIT( EX_DATAERR,
-        "error: %d: unknown file compression type\n", compression
-      );
-  } // switch
+  GET_DWord( t, fin, &offset );         // get offset of rec 0
+  T2PD_FSEEK( t, fin, offset, SEEK_SET );
+  status = doc_read_record0( t, fin, doc );
+  if ( status != T2PD_OK )
+    return status;
+
+  T2PD_FSEEK( t, fin, 0, SEEK_END );
+  doc->file_size = STATIC_CAST( DWord, ftell( fin ) );
+  return T2PD_OK;
+}
 
-  ///////// read Doc file record-by-record ////////////////////////////////////
+t2pd_status_t t2pd_doc_read_bookmarks( t2pd_t *t, FILE *fin,
+                                       doc_file_t const *doc,
+                                       doc_bookmark_t *list, size_t *count ) {
+  assert( t != NULL );
+  assert( fin != NULL );
+  assert( doc != NULL );
+  assert( list != NULL );
+  assert( count != NULL );
+
+  *count = 0;
+  for ( unsigned rec_num = doc->num_records + 1;
+        rec_num < doc->num_pdb_records && *count < DOC_BOOKMARKS_MAX;
+        ++rec_num ) {
+    DWord offset, size;
+    t2pd_status_t const status =
+      record_span( t, fin, doc, rec_num, &offset, &size );
+    if ( status != T2PD_OK )
+      return status;
+    if ( size != sizeof( doc_bookmark_t ) )
+      continue;                         // not a bookmark: ignore it
+    doc_bookmark_t *const bm = &list[ *count ];
+    T2PD_FSEEK( t, fin, offset, SEEK_SET );
+    T2PD_FREAD( t, bm, sizeof *bm, fin );
+    bm->name[ DOC_BOOKMARK_NAME_SIZE - 1 ] = '\0';
+    bm->position = ntohl( bm->position );
+    ++*count;
+  } // for
+  return T2PD_OK;
+}
 
-  FSEEK( fin, 0, SEEK_END );
-  DWord const file_size = STATIC_CAST( DWord, ftell( fin ) );
+t2pd_status_t t2pd_doc_read_record( t2pd_t *t, FILE *fin,
+                                    doc_file_t const *doc, unsigned rec_num,
+                                    t2pd_clock_t *clock,
+                                    buffer_t const **text ) {
+  assert( t != NULL );
+  assert( fin != NULL );
+  assert( doc != NULL );
+  assert( clock != NULL );
+  assert( text != NULL );
+
+  DWord offset, rec_size;
+  t2pd_status_t const status =
+    record_span( t, fin, doc, rec_num, &offset, &rec_size );
+  if ( status != T2PD_OK )
+    return status;
+  size_t const stored_max = record_stored_max( doc );
+  if ( rec_size > stored_max ) {
+    return t2pd_error( t, T2PD_ERR_CORRUPT,
+      "record %u: %lu bytes; more than %zu\n",
+      rec_num, STATIC_CAST( unsigned long, rec_size ), stored_max
+    );
+  }
 
-  if ( opt_verbose )
-    PMESSAGE( "decoding \"%s\":", header.name );
+  buffer_t *const in_buf = &t->z_buf;
+  T2PD_FSEEK( t, fin, offset, SEEK_SET );
+  T2PD_FREAD( t, in_buf->data, rec_size, fin );
+  in_buf->len = rec_size;
+  t2pd_stats_phase( t, T2PD_PHASE_READ, clock );
 
-  buffer_t buf;
-  NEW_BUFFER( &buf );
-  for ( int rec_num = 1; rec_num <= num_records; ++rec_num ) {
+  return record_text( t, doc, rec_num, clock, text );
+}
 
-    // read the record offset
-    SEEK_REC( fin, rec_num );
-    GET_DWord( fin, &offset );
+t2pd_status_t t2pd_decode_file( t2pd_t *t, FILE *fin, FILE *fout ) {
+  if ( t == NULL || fin == NULL || fout == NULL )
+    return T2PD_ERR_ARG;
+
+  t2pd_status_t status;
+  bool const is_stream = FSEEK_FN( fin, 0, SEEK_CUR ) == -1;
+
+  if ( is_stream && t->opts.html ) {
+    //
+    // Rendering HTML reads the bookmark records after the text records first
+    // and may read the text records twice, so copy the input to a temporary
+    // file first.
+    //
+    FILE *tmp = NULL;
+    if ( (status = spool( t, fin, &tmp )) != T2PD_OK )
+      return status;
+    status = t2pd_decode_file( t, tmp, fout );
+    fclose( tmp );
+    return status;
+  }
 
-    // read the next record offset to compute the record size
-    DWord next_offset;
-    if ( rec_num < num_records ) {
-      SEEK_REC( fin, rec_num + 1 );
-      GET_DWord( fin, &next_offset );
-    } else {
-      next_offset = file_size;
-    }
-    DWord const rec_size = next_offset - offset;
+  t2pd_clock_t clock;
+  t2pd_stats_begin( t, /*decode=*/true, &clock );
 
-    // read the record
-    FSEEK( fin, offset, SEEK_SET );
-    FREAD( buf.data, 1, rec_size, fin );
-    buf.len = rec_size;
+  doc_file_t doc;
+  DWord pos = 0;                        // bytes read so far, if is_stream
+  status = is_stream ?
+    stream_open( t, fin, &doc, &pos ) :
+    t2pd_doc_open( t, fin, &doc );
+  if ( status != T2PD_OK )
+    return status;
+  if ( t->opts.html )
+    return t2pd_render_html( t, fin, &doc, fout, &clock );
 
-    if ( compression == DOC_COMPRESSED )
-      uncompress( &buf );
+  ///////// read Doc file record-by-record ////////////////////////////////////
 
-    for ( size_t i = 0; i < buf.len; ++i ) {
-      char8_t const *const utf8_char = palm_to_utf8( buf.data[i] );
-      if ( utf8_char )
-        FPRINTF( fout, "%s", utf8_char );
+  if ( t->opts.verbose )
+    t2pd_diag( t, T2PD_DIAG_INFO, "decoding \"%s\":", doc.header.name );
+
+  char8_t utf8_buf[ RECORD_SIZE_MAX * UTF8_CHAR_SIZE_MAX ];
+  uint64_t bytes_out = 0;
+  t2pd_stats_phase( t, T2PD_PHASE_READ, &clock );
+
+  for ( unsigned rec_num = 1; rec_num <= doc.num_records; ++rec_num ) {
+    T2PD_PROBE1( decode_record_start, rec_num );
+    t2pd_clock_t const rec_start = clock;
+
+    buffer_t const *text;
+    status = is_stream ?
+      stream_read_record( t, fin, &doc, rec_num, &pos, &clock, &text ) :
+      t2pd_doc_read_record( t, fin, &doc, rec_num, &clock, &text );
+    if ( status != T2PD_OK )
+      return status;
+    size_t const rec_size = t->z_buf.len;
+
+    // records larger than the default may need more than one write
+    size_t utf8_len = 0, written_len = 0;
+    for ( size_t i = 0; i < text->len; ++i ) {
+      if ( utf8_len > sizeof utf8_buf - UTF8_CHAR_SIZE_MAX ) {
+        T2PD_FWRITE( t, utf8_buf, utf8_len, fout );
+        written_len += utf8_len;
+        utf8_len = 0;
+      }
+      utf8_len += t2pd_palm_to_utf8( t, text->data[i], utf8_buf + utf8_len );
     } // for
+    t2pd_stats_phase( t, T2PD_PHASE_TRANSCODE, &clock );
 
-    if ( opt_verbose )
-      PRINT_ERR( " %d", num_records - rec_num );
+    T2PD_FWRITE( t, utf8_buf, utf8_len, fout );
+    utf8_len += written_len;
+    t2pd_stats_phase( t, T2PD_PHASE_WRITE, &clock );
+    t2pd_stats_record( t, rec_num, rec_size, utf8_len, &rec_start, &clock );
+    bytes_out += utf8_len;
+    T2PD_PROBE3( decode_record_end, rec_num, rec_size, utf8_len );
+
+    if ( t->opts.verbose )
+      t2pd_diag( t, T2PD_DIAG_PROGRESS, " %u", doc.num_records - rec_num );
   } // for
 
-  if ( opt_verbose )
-    FPUTC( '\n', stderr );
+  if ( t->opts.verbose )
+    t2pd_diag( t, T2PD_DIAG_PROGRESS, "\n" );
+
+  if ( t->opts.stats != NULL ) {
+    t->opts.stats->bytes_in = is_stream ? pos : doc.file_size;
+    t->opts.stats->bytes_out = bytes_out;
+  }
+  return T2PD_OK;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,104 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      doc.c
+**
+**      Copyright (C) 1998-2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+// local
+#include "pjl_config.h"
+#include "doc.h"
+#include "palm.h"
+
+// standard
+#include <assert.h>
+#include <sys/types.h>                  /* for FreeBSD */
+#include <netinet/in.h>                 /* for ntohl(), ntohs() */
+#include <string.h>
+
+////////// extern functions ///////////////////////////////////////////////////
+
+doc_status_t doc_parse_header( DatabaseHdrType const *hdr, bool check_doc,
+                               doc_layout_t *dl ) {
+  assert( hdr != NULL );
+  assert( dl != NULL );
+
+  if ( check_doc && (
+       strncmp( hdr->type,    DOC_TYPE,    sizeof hdr->type ) ||
+       strncmp( hdr->creator, DOC_CREATOR, sizeof hdr->creator ) ) ) {
+    return DOC_ERR_NOT_DOC;
+  }
+  dl->num_pdb_records = ntohs( hdr->recordList.numRecords );
+  return dl->num_pdb_records == 0 ? DOC_ERR_NO_RECORDS : DOC_OK;
+}
+
+doc_status_t doc_parse_record0( void const *rec0, size_t size,
+                                doc_layout_t *dl ) {
+  assert( dl != NULL );
+  assert( dl->num_pdb_records > 0 );
+
+  if ( size < sizeof( doc_record0_t ) )
+    return DOC_ERR_REC0_SHORT;
+  doc_record0_t r;
+  memcpy( &r, rec0, sizeof r );
+
+  dl->compression = ntohs( r.version );
+  switch ( dl->compression ) {
+    case DOC_COMPRESSED:
+    case DOC_UNCOMPRESSED:
+      break;
+    default:
+      return DOC_ERR_COMPRESSION;
+  } // switch
+
+  dl->doc_size = ntohl( r.doc_size );
+  dl->rec0_num_records = dl->num_records = ntohs( r.num_records );
+  if ( dl->num_records >= dl->num_pdb_records )
+    dl->num_records = dl->num_pdb_records - 1;  // without rec 0
+
+  dl->rec_size = ntohs( r.rec_size );
+  return dl->rec_size == 0 ? DOC_ERR_REC_SIZE : DOC_OK;
+}
+
+DWord doc_rec_offset( uint8_t const *rec_list, unsigned rec_num ) {
+  DWord offset;
+  memcpy( &offset, rec_list + RecordEntrySize * (size_t)rec_num,
+    sizeof offset
+  );
+  return ntohl( offset );
+}
+
+char const* doc_strerror( doc_status_t status ) {
+  switch ( status ) {
+    case DOC_OK:
+      return "success";
+    case DOC_ERR_NOT_DOC:
+      return "not a Doc file";
+    case DOC_ERR_NO_RECORDS:
+      return "no records";
+    case DOC_ERR_REC0_SHORT:
+      return "record 0: too short";
+    case DOC_ERR_COMPRESSION:
+      return "unknown file compression type";
+    case DOC_ERR_REC_SIZE:
+      return "record 0: record size 0";
+  } // switch
+  return "unknown error";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* vim:set et sw=2 ts=2: */
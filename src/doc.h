@@ -23,8 +23,14 @@
 #define txt2pdbdoc_doc_H
 
 // local
+#include "pjl_config.h"
 #include "palm.h"
 
+// standard
+#include <stdbool.h>
+#include <stddef.h>                     /* for size_t */
+#include <stdint.h>
+
 ///////////////////////////////////////////////////////////////////////////////
 
 #define DOC_CREATOR       "REAd"
@@ -45,6 +51,94 @@ struct doc_record0 {                    // 16 bytes total
 };
 typedef struct doc_record0 doc_record0_t;
 
+#define DOC_BOOKMARK_NAME_SIZE  16      /* 15 chars + 1 null terminator */
+#define DOC_BOOKMARKS_MAX       256     /* most made or read */
+
+/**
+ * A bookmark record follows the text records of a Doc file.  There may be any
+ * number of them, i.e., PDB header numRecords - 1 - doc_record0::num_records.
+ */
+struct doc_bookmark {                   // 20 bytes total
+  char  name[ DOC_BOOKMARK_NAME_SIZE ]; ///< Null-terminated name.
+  DWord position;                       ///< Offset into uncompressed text.
+};
+typedef struct doc_bookmark doc_bookmark_t;
+
+/**
+ * Status codes returned by the Doc file parsing functions.
+ */
+enum doc_status {
+  DOC_OK,                               ///< Success.
+  DOC_ERR_NOT_DOC,                      ///< Wrong type or creator.
+  DOC_ERR_NO_RECORDS,                   ///< The PDB file has no records.
+  DOC_ERR_REC0_SHORT,                   ///< Record 0 is too short.
+  DOC_ERR_COMPRESSION,                  ///< Unknown compression type.
+  DOC_ERR_REC_SIZE                      ///< Record 0 gives a record size of 0.
+};
+typedef enum doc_status doc_status_t;
+
+/**
+ * The layout of a Doc file as given by its PDB header and record 0.
+ */
+struct doc_layout {
+  unsigned  num_pdb_records;            ///< Number of PDB records.
+  unsigned  compression;                ///< Compression type.
+  DWord     doc_size;                   ///< Size in bytes, when uncompressed.
+  unsigned  rec0_num_records;           ///< Number of text records given.
+  unsigned  num_records;                ///< Number of text records.
+  unsigned  rec_size;                   ///< Uncompressed text record size.
+};
+typedef struct doc_layout doc_layout_t;
+
+////////// extern functions ///////////////////////////////////////////////////
+
+/**
+ * Checks the PDB header of a Doc file.
+ *
+ * @param hdr The PDB header.
+ * @param check_doc If `true`, checks the file's type and creator.
+ * @param dl The doc_layout to set \ref doc_layout::num_pdb_records
+ * "num_pdb_records" of.
+ * @return Returns #DOC_OK only if valid.
+ */
+NODISCARD
+doc_status_t doc_parse_header( DatabaseHdrType const *hdr, bool check_doc,
+                               doc_layout_t *dl );
+
+/**
+ * Checks record 0 of a Doc file.  Bookmark records may follow the text
+ * records, so the number of text records is taken from record 0 unless it's
+ * impossible.
+ *
+ * @param rec0 The bytes of record 0.
+ * @param size The number of bytes of \a rec0.
+ * @param dl The doc_layout set by doc_parse_header() to set the rest of.
+ * @return Returns #DOC_OK only if valid.
+ */
+NODISCARD
+doc_status_t doc_parse_record0( void const *rec0, size_t size,
+                                doc_layout_t *dl );
+
+/**
+ * Gets the file offset of a record.
+ *
+ * @param rec_list The record list following the PDB header.
+ * @param rec_num The PDB record number.
+ * @return Returns said offset.
+ */
+NODISCARD
+DWord doc_rec_offset( uint8_t const *rec_list, unsigned rec_num );
+
+/**
+ * Gets the message for a Doc file parsing status.
+ *
+ * @param status The status.
+ * @return Returns said message.  For #DOC_ERR_COMPRESSION, it's meant to
+ * follow the compression type.
+ */
+NODISCARD
+char const* doc_strerror( doc_status_t status );
+
 ///////////////////////////////////////////////////////////////////////////////
 
 #endif /* txt2pdbdoc_doc_H */
@@ -0,0 +1,193 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      docmap.c
+**
+**      Copyright (C) 2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+// local
+#include "pjl_config.h"
+#include "docmap.h"
+#include "doc.h"
+#include "palm.h"
+#include "txt2pdbdoc.h"
+#include "util.h"
+
+// standard
+#include <errno.h>
+#include <fcntl.h>                      /* for open() */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>                   /* for mmap() */
+#include <sysexits.h>
+#include <unistd.h>                     /* for close() */
+
+////////// local functions ////////////////////////////////////////////////////
+
+/**
+ * Sets the error message of a doc_map.
+ *
+ * @param d The doc_map to use.
+ * @param format The `printf()` format string.
+ * @return Always returns `false`.
+ */
+ATTRIBUTE_FORMAT(( printf, 2, 3 ))
+static bool doc_map_error( doc_map_t *d, char const *format, ... ) {
+  va_list args;
+  va_start( args, format );
+  vsnprintf( d->error, sizeof d->error, format, args );
+  va_end( args );
+  return false;
+}
+
+/**
+ * Gets the file offset of a record.
+ *
+ * @param d The doc_map to use.
+ * @param rec_num The PDB record number.
+ * @return Returns said offset.
+ */
+NODISCARD
+static size_t rec_offset( doc_map_t const *d, unsigned rec_num ) {
+  return doc_rec_offset( d->pdb + DatabaseHdrSize, rec_num );
+}
+
+/**
+ * Checks the header and record 0 of a mapped Doc file.
+ *
+ * @param d The doc_map to use.
+ * @param check_doc If `true`, checks the file's type and creator.
+ * @return Returns `true` only if valid.
+ */
+NODISCARD
+static bool doc_map_check( doc_map_t *d, bool check_doc ) {
+  if ( d->pdb_size < DatabaseHdrSize )
+    return doc_map_error( d, "not a Doc file" );
+  DatabaseHdrType hdr;
+  memcpy( &hdr, d->pdb, DatabaseHdrSize );
+  doc_layout_t dl;
+  doc_status_t status = doc_parse_header( &hdr, check_doc, &dl );
+  if ( status != DOC_OK )
+    return doc_map_error( d, "%s", doc_strerror( status ) );
+
+  size_t const name_len = strnlen( hdr.name, sizeof hdr.name );
+  size_t n = 0;
+  for ( size_t i = 0; i < name_len; ++i ) {
+    char32_t const cp = palm_to_unicode( STATIC_CAST( Byte, hdr.name[i] ) );
+    if ( cp == 0 )
+      d->name[ n++ ] = '?';
+    else
+      n += utf8_encode( cp, (char8_t*)d->name + n );
+  } // for
+  d->name[ n ] = '\0';
+
+  d->num_pdb_records = dl.num_pdb_records;
+  if ( DatabaseHdrSize + RecordEntrySize * (size_t)d->num_pdb_records >
+       d->pdb_size ) {
+    return doc_map_error( d, "record list beyond end of file" );
+  }
+
+  size_t const rec0_offset = rec_offset( d, 0 );
+  status = rec0_offset < d->pdb_size ?
+    doc_parse_record0( d->pdb + rec0_offset, d->pdb_size - rec0_offset, &dl ) :
+    DOC_ERR_REC0_SHORT;
+  if ( status == DOC_ERR_COMPRESSION ) {
+    return doc_map_error( d,
+      "%u: %s", dl.compression, doc_strerror( status )
+    );
+  }
+  if ( status != DOC_OK )
+    return doc_map_error( d, "%s", doc_strerror( status ) );
+  d->compressed = dl.compression == DOC_COMPRESSED;
+  d->num_records = dl.num_records;
+  d->rec_size = dl.rec_size;
+  return true;
+}
+
+////////// extern functions ///////////////////////////////////////////////////
+
+void doc_map_close( doc_map_t *d ) {
+  if ( d->pdb != NULL ) {
+    munmap( (void*)d->pdb, d->pdb_size );
+    d->pdb = NULL;
+  }
+}
+
+int doc_map_open( doc_map_t *d, char const *path, bool check_doc ) {
+  memset( d, 0, sizeof *d );
+  d->path = path;
+
+  int const fd = open( path, O_RDONLY );
+  if ( fd == -1 ) {
+    doc_map_error( d, "%s", STRERROR );
+    return EX_NOINPUT;
+  }
+  if ( fstat( fd, &d->st ) == -1 ) {
+    doc_map_error( d, "%s", STRERROR );
+    close( fd );
+    return EX_NOINPUT;
+  }
+  d->pdb_size = STATIC_CAST( size_t, d->st.st_size );
+  if ( d->pdb_size > 0 ) {
+    void *const p = mmap( NULL, d->pdb_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    if ( p == MAP_FAILED ) {
+      doc_map_error( d, "%s", STRERROR );
+      close( fd );
+      return EX_NOINPUT;
+    }
+    d->pdb = p;
+  }
+  close( fd );
+
+  if ( !doc_map_check( d, check_doc ) ) {
+    doc_map_close( d );
+    return EX_DATAERR;
+  }
+  return EXIT_SUCCESS;
+}
+
+bool doc_map_read( doc_map_t *d, unsigned rec_num, Byte *buf, size_t *len ) {
+  size_t const begin = rec_offset( d, rec_num );
+  size_t const end = rec_num + 1 < d->num_pdb_records ?
+    rec_offset( d, rec_num + 1 ) : d->pdb_size;
+  if ( begin > end || end > d->pdb_size )
+    return doc_map_error( d, "record %u: invalid offset", rec_num );
+
+  *len = end - begin;
+  if ( d->compressed ) {
+    if ( t2pd_uncompress( d->pdb + begin, *len, buf, d->rec_size,
+                          len ) != T2PD_OK ) {
+      return doc_map_error( d,
+        "record %u: invalid compressed data or more than %u bytes",
+        rec_num, d->rec_size
+      );
+    }
+  } else {
+    if ( *len > d->rec_size ) {
+      return doc_map_error( d,
+        "record %u: %zu bytes; more than %u", rec_num, *len, d->rec_size
+      );
+    }
+    memcpy( buf, d->pdb + begin, *len );
+  }
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* vim:set et sw=2 ts=2: */
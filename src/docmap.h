@@ -0,0 +1,101 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      docmap.h
+**
+**      Copyright (C) 2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#ifndef txt2pdbdoc_docmap_H
+#define txt2pdbdoc_docmap_H
+
+/**
+ * @file
+ * Declares functions for reading the text records of memory-mapped Doc files.
+ */
+
+// local
+#include "pjl_config.h"
+#include "palm.h"
+#include "unicode.h"
+
+// standard
+#include <stdbool.h>
+#include <stddef.h>                     /* for size_t */
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * A memory-mapped Doc file.
+ */
+struct doc_map {
+  char const     *path;                 ///< Path of the file.
+  uint8_t const  *pdb;                  ///< Its contents.
+  size_t          pdb_size;             ///< Size of \a pdb.
+  struct stat     st;                   ///< Its status when mapped.
+  char            name[ dmDBNameLength * UTF8_CHAR_SIZE_MAX ]; ///< As UTF-8.
+  bool            compressed;           ///< Are text records compressed?
+  unsigned        num_pdb_records;      ///< Number of PDB records.
+  unsigned        num_records;          ///< Number of text records.
+  unsigned        rec_size;             ///< Maximum size of a text record.
+  char            error[ 128 ];         ///< Message of the last error.
+};
+typedef struct doc_map doc_map_t;
+
+/**
+ * Memory-maps a Doc file and checks its header and record 0.
+ *
+ * @param d The doc_map to use.
+ * @param path The path of the file.
+ * @param check_doc If `true`, checks the file's type and creator.
+ * @return Returns `EXIT_SUCCESS` only if successful, `EX_NOINPUT` if the file
+ * can not be opened, or `EX_DATAERR` if it isn't a valid Doc file; in the
+ * latter two cases, \a d->error is set.
+ *
+ * @sa doc_map_close()
+ */
+NODISCARD
+int doc_map_open( doc_map_t *d, char const *path, bool check_doc );
+
+/**
+ * Reads a text record, uncompressing it if necessary.
+ *
+ * @param d The doc_map to use.
+ * @param rec_num The text record number in the range [1,num_records].
+ * @param buf The buffer to read into.  It must be at least \a d->rec_size
+ * bytes.
+ * @param len Set to the number of bytes read.
+ * @return Returns `true` only if successful; otherwise sets \a d->error.
+ */
+NODISCARD
+bool doc_map_read( doc_map_t *d, unsigned rec_num, Byte *buf, size_t *len );
+
+/**
+ * Unmaps a Doc file, if mapped.
+ *
+ * @param d The doc_map to use.
+ *
+ * @sa doc_map_open()
+ */
+void doc_map_close( doc_map_t *d );
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif /* txt2pdbdoc_docmap_H */
+/* vim:set et sw=2 ts=2: */
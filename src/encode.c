@@ -23,75 +23,240 @@
 #include "pjl_config.h"
 #include "common.h"
 #include "doc.h"
-#include "options.h"
 #include "palm.h"
+#include "probes.h"
+#include "txt2pdbdoc.h"
 #include "unicode.h"
 #include "util.h"
 
 // standard
 #include <assert.h>
 #include <ctype.h>
+#include <inttypes.h>                   /* for PRIu64 */
+#include <limits.h>                     /* for UINT_MAX */
 #include <sys/types.h>                  /* for FreeBSD */
 #include <netinet/in.h>                 /* for htonl() */
+#include <stddef.h>                     /* for offsetof */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
-#include <sysexits.h>
-#include <unistd.h>
 
-#define PUT_DWord(F,N) \
-  BLOCK( DWord t = (N); t = htonl(t); FWRITE( &t, sizeof t, 1, (F) ); )
+#define PUT_DWord(T,F,N) BLOCK( \
+  DWord t_ = (N); t_ = htonl(t_); T2PD_FWRITE( (T), &t_, sizeof t_, (F) ); )
 
-////////// extern declarations ////////////////////////////////////////////////
+/**
+ * How text is being encoded into one or more volumes.
+ */
+struct encode_plan {
+  unsigned  rec_size;                   ///< Size of uncompressed text records.
+  DWord     num_reserved;               ///< Most bookmark records per volume.
+  DWord     volume_max;                 ///< Most text records per volume.
+  uint64_t  text_left;                  ///< Most text not yet encoded.
+  uint64_t  rec_base;                   ///< Records in previous volumes.
+  uint64_t  total_before;               ///< Bytes before compression.
+  uint64_t  total_after;                ///< Bytes after compression.
+  uint64_t  bytes_out;                  ///< Bytes written to all volumes.
+};
+typedef struct encode_plan encode_plan_t;
 
-extern char const  *doc_name;
-extern FILE        *fin;
-extern FILE        *fout;
-extern char const  *fout_path;
+////////// local functions ////////////////////////////////////////////////////
 
-extern bool         opt_binary;
-extern bool         opt_compress;
-extern bool         opt_no_timestamp;
-extern bool         opt_no_warnings;
-extern bool         opt_verbose;
+/**
+ * Peeks at the next character on the given file stream, but does not advance
+ * the \c FILE pointer.
+ *
+ * @param file The file to peek from.
+ * @return Returns the next character, if any, or \c EOF if none or on error.
+ */
+NODISCARD
+static int peek_char( FILE *file ) {
+  int const c = getc( file );
+  if ( c != EOF )
+    ungetc( c, file );
+  return c;
+}
 
-extern void compress( buffer_t* );
+/**
+ * Appends a text record to \a t->vol_spool, creating it if necessary.
+ *
+ * @param t The handle.
+ * @param data The record to append.
+ * @param size The size of \a data.
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+static t2pd_status_t spool_append( t2pd_t *t, void const *data,
+                                   size_t size ) {
+  if ( t->vol_spool == NULL && (t->vol_spool = tmpfile()) == NULL )
+    return t2pd_error( t, T2PD_ERR_WRITE, "%s\n", STRERROR );
+  T2PD_FWRITE( t, data, size, t->vol_spool );
+  return T2PD_OK;
+}
 
-////////// local functions ////////////////////////////////////////////////////
+/**
+ * Copies the text records of the current volume from \a t->vol_spool.
+ *
+ * @param t The handle.
+ * @param text_len The number of bytes of text records.
+ * @param fout The file to write to.
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+static t2pd_status_t spool_copy( t2pd_t *t, DWord text_len, FILE *fout ) {
+  if ( text_len == 0 )
+    return T2PD_OK;
+  T2PD_FSEEK( t, t->vol_spool, 0, SEEK_SET );
+  Byte chunk[ 8192 ];
+  while ( text_len > 0 ) {
+    size_t const n = text_len < sizeof chunk ? text_len : sizeof chunk;
+    T2PD_FREAD( t, chunk, n, t->vol_spool );
+    T2PD_FWRITE( t, chunk, n, fout );
+    text_len -= STATIC_CAST( DWord, n );
+  } // while
+  return T2PD_OK;
+}
 
 /**
- * Fills a buffer with characters from the input file.
+ * Writes the bookmark records found while encoding.
  *
- * @param buf The buffer to fill.
+ * @param t The handle.
+ * @param fout The file to write to.
+ * @return Returns #T2PD_OK only if successful.
  */
-static void fill_buffer( buffer_t *buf ) {
-  assert( buf != NULL );
-  assert( buf->data != NULL );
-  buf->len = 0;
+NODISCARD
+static t2pd_status_t write_bookmarks( t2pd_t *t, FILE *fout ) {
+  bookmarks_t const *const bm = &t->bm;
+  for ( size_t i = 0; i < bm->count; ++i ) {
+    doc_bookmark_t bookmark = bm->list[i];
+    bookmark.position = htonl( bookmark.position );
+    T2PD_FWRITE( t, &bookmark, sizeof bookmark, fout );
+  } // for
+  return T2PD_OK;
+}
+
+/**
+ * Writes the header, record list, and record 0 of a Doc file now that what's
+ * in it is known, followed by its text records (in \a t->vol_spool, whose
+ * offsets in \a t->offsets are relative to its start) and its bookmark
+ * records.
+ *
+ * @param t The handle.
+ * @param fout The file to write to.
+ * @param name The name of the Doc file.
+ * @param rec_size The size of uncompressed text records.
+ * @param num_records The number of text records.
+ * @param doc_size The size of the text in PalmOS characters.
+ * @param text_len The number of bytes of text records.
+ * @param size A pointer to receive the size of the Doc file.
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+static t2pd_status_t write_volume( t2pd_t *t, FILE *fout, char const *name,
+                                   unsigned rec_size, DWord num_records,
+                                   DWord doc_size, DWord text_len,
+                                   uint64_t *size ) {
+  DWord const num_pdb_records =
+    1 /* rec 0 */ + num_records + STATIC_CAST( DWord, t->bm.count );
+  t2pd_status_t status = t2pd_offsets_reserve( t, num_pdb_records );
+  if ( status != T2PD_OK )
+    return status;
+
+  //
+  // Now that the number of records is known, the record list can be made
+  // exactly as large as it needs to be.
+  //
+  DWord offset = DatabaseHdrSize + RecordEntrySize * num_pdb_records;
+  t->offsets[0] = offset;
+  offset += STATIC_CAST( DWord, sizeof( doc_record0_t ) );
+  for ( DWord i = 1; i <= num_records; ++i )
+    t->offsets[i] += offset;
+  offset += text_len;
+  for ( DWord i = num_records + 1; i < num_pdb_records; ++i ) {
+    t->offsets[i] = offset;
+    offset += STATIC_CAST( DWord, sizeof( doc_bookmark_t ) );
+  }
+  *size = offset;
+
+  ////////// write header /////////////////////////////////////////////////////
+
+  DatabaseHdrType header;
+  memset( &header, 0, sizeof header );
+
+  memcpy( header.name, name, sizeof header.name );
+  if ( !t->opts.no_timestamp ) {
+    DWord const now = htonl( palm_date() );
+    header.creationDate                 = now;
+    header.modificationDate             = now;
+  }
+  memcpy( header.type,    DOC_TYPE,    sizeof header.type );
+  memcpy( header.creator, DOC_CREATOR, sizeof header.creator );
+  header.recordList.numRecords          =
+    htons( STATIC_CAST( Word, num_pdb_records ) );
+
+  T2PD_FWRITE( t, &header, DatabaseHdrSize, fout );
+
+  ////////// write record list ////////////////////////////////////////////////
+
+  DWord index = 0x40u << 24 | 0x6F8000u; // dirty + unique ID
+  for ( DWord i = 0; i < num_pdb_records; ++i ) {
+    PUT_DWord( t, fout, t->offsets[i] );
+    PUT_DWord( t, fout, index++ );
+  }
+
+  ////////// write record 0 ///////////////////////////////////////////////////
+
+  doc_record0_t rec0;
+  memset( &rec0, 0, sizeof rec0 );
+
+  rec0.version     = htons( t->opts.compress + 1 );
+  rec0.doc_size    = htonl( doc_size );
+  rec0.num_records = htons( STATIC_CAST( Word, num_records ) );
+  rec0.rec_size    = htons( STATIC_CAST( Word, rec_size ) );
+
+  T2PD_FWRITE( t, &rec0, sizeof rec0, fout );
+
+  ////////// write text and bookmarks /////////////////////////////////////////
+
+  status = spool_copy( t, text_len, fout );
+  if ( status != T2PD_OK )
+    return status;
+  return write_bookmarks( t, fout );
+}
+
+/**
+ * Reads the next character of UTF-8 text transcoding it to PalmOS.  Invalid
+ * UTF-8 and characters that can not be transcoded are skipped with a warning;
+ * binary characters are stripped if \ref t2pd_options::binary "binary".
+ *
+ * @param t The handle.
+ * @param fin The file to read from.
+ * @return Returns said character or \c EOF upon either end of file or error.
+ */
+NODISCARD
+static inline int read_char( t2pd_t *t, FILE *fin ) {
+  char pc_buf[ PRINTABLE_CHAR_SIZE ];
 
   for ( int c; (c = getc( fin )) != EOF; ) {
     char8_t c8 = STATIC_CAST( char8_t, c );
     unsigned const len = utf8_char_len( c8 );
     if ( len == 0 ) {
-      if ( !opt_no_warnings ) {
-        PMESSAGE(
-          "\"%s\": invalid UTF-8 start byte\n",
-          printable_char( STATIC_CAST( char, c ) )
-        );
-      }
+      t2pd_warn( t,
+        "\"%s\": invalid UTF-8 start byte\n",
+        printable_char( STATIC_CAST( char, c ), pc_buf )
+      );
       continue;
     }
 
     ////////// handle ASCII ///////////////////////////////////////////////////
 
     if ( len == 1 ) {
-      if ( opt_binary ) {
+      if ( t->opts.binary ) {
         if ( !(isspace( c ) || isprint( c )) )
           continue;
         switch ( c ) {
           case '\r':
-            if ( peekc( fin ) == '\n' )
+            if ( peek_char( fin ) == '\n' )
               continue;                     // CR+LF -> LF
             FALLTHROUGH;
           case '\f':
@@ -99,158 +264,426 @@ static void fill_buffer( buffer_t *buf ) {
             break;
         } // switch
       }
-      buf->data[ buf->len ] = c8;
+      return c8;
     }
 
     ////////// handle UTF-8 ///////////////////////////////////////////////////
 
-    else {
-      char8_t utf8_char[ UTF8_CHAR_SIZE_MAX ];
-      size_t u = 0;
-      utf8_char[ u++ ] = c8;
-      for ( size_t i = len; i > 1; --i ) {
-        if ( (c = getc( fin )) == EOF )
-          goto done;
-        c8 = STATIC_CAST( char8_t, c );
-        if ( utf8_char_len( c8 ) > 0 ) {
-          if ( !opt_no_warnings ) {
-            PMESSAGE(
-              "\"%s\": invalid UTF-8 continuation byte\n",
-              printable_char( STATIC_CAST( char, c ) )
-            );
-          }
-          goto next;
-        }
-        utf8_char[ u++ ] = c8;
-      } // for
-      char32_t const cp = utf8_decode( utf8_char );
-      if ( !(c8 = unicode_to_palm( cp )) ) {
-        if ( !opt_no_warnings ) {
-          PMESSAGE(
-            "\"%x04X\": Unicode codepoint does not map to PalmOS\n", cp
-          );
-        }
-        continue;
+    char8_t utf8_char[ UTF8_CHAR_SIZE_MAX ];
+    size_t u = 0;
+    utf8_char[ u++ ] = c8;
+    for ( size_t i = len; i > 1; --i ) {
+      if ( (c = getc( fin )) == EOF )
+        return EOF;
+      c8 = STATIC_CAST( char8_t, c );
+      if ( utf8_char_len( c8 ) > 0 ) {
+        t2pd_warn( t,
+          "\"%s\": invalid UTF-8 continuation byte\n",
+          printable_char( STATIC_CAST( char, c ), pc_buf )
+        );
+        goto next;
       }
-    }
-
-    buf->data[ buf->len ] = c8;
-    if ( ++buf->len == RECORD_SIZE_MAX )
-      break;
+      utf8_char[ u++ ] = c8;
+    } // for
+    char32_t const cp = utf8_decode( utf8_char );
+    Byte const pc = unicode_to_palm( cp );
+    if ( pc != 0 )
+      return pc;
+    t2pd_warn( t,
+      "\"%x04X\": Unicode codepoint does not map to PalmOS\n", cp
+    );
 
 next:
     NO_OP;
   } // for
 
-done:
-  if ( ferror( fin ) )
-    PERROR_EXIT( EX_NOINPUT );
+  return EOF;
 }
 
-////////// extern functions ///////////////////////////////////////////////////
-
 /**
- * Encodes the source text file into a Doc file.
+ * Makes the name of a Doc file: the document name, truncated with `...` if
+ * it's too long, followed by the volume number if there's more than one.
+ *
+ * @param name The buffer to receive the name.
+ * @param doc_name The document name.
+ * @param volume The volume number (1-based).
+ * @param num_volumes The number of volumes.
  */
-void encode( void ) {
-  struct stat sbuf;
-  FSTAT( fileno( fin ), &sbuf );
-  DWord const fin_size = STATIC_CAST( DWord, sbuf.st_size );
-
-  DWord num_records = fin_size / RECORD_SIZE_MAX;
-  if ( num_records * RECORD_SIZE_MAX < fin_size )
-    ++num_records;
+static void make_name( char name[ dmDBNameLength ], char const *doc_name,
+                       unsigned volume, unsigned num_volumes ) {
+  memset( name, 0, dmDBNameLength );
+  char suffix[ 24 ] = "";
+  if ( num_volumes > 1 )
+    snprintf( suffix, sizeof suffix, " %u/%u", volume, num_volumes );
+  size_t const name_max = dmDBNameLength - 1 - strlen( suffix );
+  size_t len = strlen( doc_name );
+  if ( len > name_max ) {
+    memcpy( name, doc_name, name_max - 3 );
+    memcpy( name + name_max - 3, "...", 3 );
+    len = name_max;
+  } else {
+    memcpy( name, doc_name, len );
+  }
+  strcpy( name + len, suffix );
+}
 
-  ////////// create and write header //////////////////////////////////////////
+/**
+ * Gets the most text records a volume can have: both the number of its
+ * records and the offset of every one must fit in a PDB file, and there may
+ * be no more than \ref t2pd_options::volume_records "volume_records".
+ *
+ * @param t The handle.
+ * @param plan The encoding plan.
+ * @return Returns said number.
+ */
+NODISCARD
+static DWord volume_records_max( t2pd_t const *t,
+                                 encode_plan_t const *plan ) {
+  DWord const by_count = 0xFFFFu - 1 /* rec 0 */ - plan->num_reserved;
+  uint64_t const stored_max = t->opts.compress ?
+    T2PD_COMPRESS_BOUND( STATIC_CAST( uint64_t, plan->rec_size ) ) :
+    plan->rec_size;
+  uint64_t const overhead = DatabaseHdrSize +
+    RecordEntrySize * (1 + STATIC_CAST( uint64_t, by_count ) +
+                       plan->num_reserved) +
+    sizeof( doc_record0_t ) + plan->num_reserved * sizeof( doc_bookmark_t );
+  uint64_t const by_size = (0xFFFFFFFFu - overhead) / stored_max;
+  DWord const records_max =
+    by_size < by_count ? STATIC_CAST( DWord, by_size ) : by_count;
+  return t->opts.volume_records > 0 && t->opts.volume_records < records_max ?
+    t->opts.volume_records : records_max;
+}
 
-  DatabaseHdrType header;
-  memset( &header, 0, sizeof header );
+/**
+ * Encodes the next part of the text as one Doc file.  Since the text may
+ * shrink when transcoded, how much of it there is (and so how many records
+ * there are) isn't known until it's all been read, so the text records are
+ * spooled to a temporary file until the header, record list, and record 0 are
+ * written.
+ *
+ * @param t The handle.
+ * @param plan The encoding plan.
+ * @param name The name of the Doc file.
+ * @param fin The file to read from.
+ * @param fout The file to write to.
+ * @param clock The clock to add phases to.
+ * @return Returns #T2PD_OK only if successful.
+ *
+ * @note The first text record must already be in \a t->rec_buf.
+ */
+NODISCARD
+static t2pd_status_t encode_volume( t2pd_t *t, encode_plan_t *plan,
+                                    char const *name, FILE *fin, FILE *fout,
+                                    t2pd_clock_t *clock ) {
+  uint64_t const text_records =
+    plan->text_left / plan->rec_size + (plan->text_left % plan->rec_size != 0);
+  DWord const records_max = text_records < plan->volume_max ?
+    STATIC_CAST( DWord, text_records ) : plan->volume_max;
+
+  ////////// encode text //////////////////////////////////////////////////////
+
+  buffer_t *const buf = &t->rec_buf;
+  if ( t->vol_spool != NULL )
+    T2PD_FSEEK( t, t->vol_spool, 0, SEEK_SET );
+  DWord num_records = 0;
+  DWord text_len = 0;
+  DWord doc_size = 0;
+  t2pd_status_t status;
+
+  for ( DWord rec_num = 1; rec_num <= plan->volume_max; ++rec_num ) {
+    t2pd_clock_t const rec_start = *clock;
+    if ( rec_num > 1 ) {                // record 1 was read by the caller
+      status = t2pd_fill_buffer( t, fin, buf, plan->rec_size );
+      if ( status != T2PD_OK )
+        return status;
+      t2pd_stats_phase( t, T2PD_PHASE_TRANSCODE, clock );
+    }
+    if ( buf->len == 0 )                // no empty records
+      break;
 
-  strncpy( header.name, doc_name, sizeof header.name - 1 );
-  if ( strlen( doc_name ) > sizeof header.name - 1 )
-    strncpy( header.name + sizeof header.name - 4, "...", 3 );
+    unsigned const doc_rec_num = STATIC_CAST( unsigned, plan->rec_base + rec_num );
+    T2PD_PROBE1( encode_record_start, doc_rec_num );
+    size_t const uncompressed_buf_len = buf->len;
+    buffer_t const *out = buf;
+    if ( t->opts.compress ) {
+      PJL_DISCARD t2pd_compress_counted( buf->data, buf->len, t->z_buf.data,
+                                         &t->z_buf.len, t->opts.stats );
+      out = &t->z_buf;
+      size_t mismatch;
+      if ( t->opts.verify_encode &&
+           !t2pd_compress_check( out->data, out->len, buf->data, buf->len,
+                                 &mismatch ) ) {
+        return t2pd_error( t, T2PD_ERR_VERIFY,
+          "record %u: compressed data does not round-trip at byte %zu\n",
+          doc_rec_num, mismatch
+        );
+      }
+      t2pd_stats_phase( t, T2PD_PHASE_COMPRESS, clock );
+    }
 
-  if ( !opt_no_timestamp ) {
-    DWord const now = htonl( palm_date() );
-    header.creationDate                 = now;
-    header.modificationDate             = now;
-  }
-  strncpy( header.type,    DOC_TYPE,    sizeof header.type );
-  strncpy( header.creator, DOC_CREATOR, sizeof header.creator );
-  header.recordList.numRecords          = htons( num_records + 1 /* rec 0 */ );
+    if ( (status = t2pd_offsets_reserve( t, 1 + rec_num )) != T2PD_OK ||
+         (status = spool_append( t, out->data, out->len )) != T2PD_OK ) {
+      return status;
+    }
+    t->offsets[ rec_num ] = text_len;
+    text_len += STATIC_CAST( DWord, out->len );
+    t2pd_stats_phase( t, T2PD_PHASE_WRITE, clock );
+    t2pd_stats_record(
+      t, doc_rec_num, uncompressed_buf_len, out->len, &rec_start, clock
+    );
+    T2PD_PROBE3(
+      encode_record_end, doc_rec_num, uncompressed_buf_len, out->len
+    );
+    num_records = rec_num;
+    doc_size += STATIC_CAST( DWord, uncompressed_buf_len );
+    plan->text_left -= plan->text_left < uncompressed_buf_len ?
+      plan->text_left : uncompressed_buf_len;
+
+    if ( !t->opts.verbose )
+      continue;
 
-  FWRITE( &header, DatabaseHdrSize, 1, fout );
+    if ( t->opts.compress ) {
+      t2pd_diag( t, T2PD_DIAG_PROGRESS,
+        "  record %2u: %5zu bytes -> %5zu (%2d%%)\n",
+        doc_rec_num, uncompressed_buf_len, out->len,
+        STATIC_CAST( int, 100.0 * STATIC_CAST( double, out->len ) /
+                          STATIC_CAST( double, uncompressed_buf_len ) )
+      );
+      plan->total_before += uncompressed_buf_len;
+      plan->total_after  += out->len;
+    } else {
+      t2pd_diag( t, T2PD_DIAG_PROGRESS,
+        " %u", rec_num < records_max ? records_max - rec_num + 1 : 1
+      );
+    }
+  } // for
 
-  ////////// write record offsets /////////////////////////////////////////////
+  if ( t->opts.verbose && !t->opts.compress )
+    t2pd_diag( t, T2PD_DIAG_PROGRESS, "\n" );
 
-  DWord num_offsets = num_records + 1;  // +1 for rec 0
-  DWord offset = DatabaseHdrSize + RecordEntrySize * num_offsets;
-  DWord index = 0x40u << 24 | 0x6F8000u; // dirty + unique ID
+  t2pd_bookmarks_end( t );
+  if ( t->bm.count > 0 && t->opts.verbose )
+    t2pd_diag( t, T2PD_DIAG_PROGRESS, "bookmarks: %zu\n", t->bm.count );
 
-  PUT_DWord( fout, offset );            // offset for rec 0
-  PUT_DWord( fout, index++ );
+  uint64_t size;
+  status = write_volume(
+    t, fout, name, plan->rec_size, num_records, doc_size, text_len, &size
+  );
+  if ( status != T2PD_OK )
+    return status;
+  t2pd_stats_phase( t, T2PD_PHASE_WRITE, clock );
 
-  while( --num_offsets ) {
-    PUT_DWord( fout, 0 );               // placeholder
-    PUT_DWord( fout, index++ );
-  }
+  plan->rec_base += num_records;
+  plan->bytes_out += size;
+  return T2PD_OK;
+}
 
-  ////////// write record 0 ///////////////////////////////////////////////////
+/**
+ * Renames every volume of a Doc file after the first volume has been named
+ * using a different number of volumes than there turned out to be.
+ *
+ * @param t The handle.
+ * @param doc_name The document name.
+ * @param vouts The files of the volumes.
+ * @param num_volumes The number of volumes.
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+static t2pd_status_t rename_volumes( t2pd_t *t, char const *doc_name,
+                                     FILE *const vouts[],
+                                     unsigned num_volumes ) {
+  for ( unsigned volume = 1; volume <= num_volumes; ++volume ) {
+    FILE *const vout = vouts[ volume - 1 ];
+    char name[ dmDBNameLength ];
+    make_name( name, doc_name, volume, num_volumes );
+    long const end = ftell( vout );
+    if ( end == -1 ||
+         FSEEK_FN( vout, offsetof( DatabaseHdrType, name ), SEEK_SET ) == -1 )
+      return t2pd_error( t, T2PD_ERR_WRITE, "%s\n", STRERROR );
+    T2PD_FWRITE( t, name, sizeof name, vout );
+    if ( FSEEK_FN( vout, end, SEEK_SET ) == -1 )
+      return t2pd_error( t, T2PD_ERR_WRITE, "%s\n", STRERROR );
+  } // for
+  return T2PD_OK;
+}
 
-  doc_record0_t rec0;
-  memset( &rec0, 0, sizeof rec0 );
+////////// extern functions ///////////////////////////////////////////////////
 
-  rec0.version     = htons( opt_compress + 1 );
-  rec0.doc_size    = htonl( fin_size );
-  rec0.num_records = htons( num_records );
-  rec0.rec_size    = htons( RECORD_SIZE_MAX );
+t2pd_status_t t2pd_fill_buffer( t2pd_t *t, FILE *fin, buffer_t *buf,
+                                size_t size ) {
+  assert( t != NULL );
+  assert( fin != NULL );
+  assert( buf != NULL );
+  assert( buf->data != NULL );
+  assert( size > 0 );
+  buf->len = 0;
 
-  FWRITE( &rec0, sizeof rec0, 1, fout );
+  for ( int c;
+        (c = t->opts.html ? t2pd_html_getc( t, fin ) : read_char( t, fin ))
+          != EOF; ) {
+    Byte const pc = STATIC_CAST( Byte, c );
+    buf->data[ buf->len ] = pc;
+    if ( t->bm.marker_len > 0 )
+      t2pd_bookmarks_scan( t, pc );
+    if ( ++buf->len == size )
+      break;
+  } // for
 
-  ////////// write text ///////////////////////////////////////////////////////
+  if ( ferror( fin ) )
+    return t2pd_read_error( t, fin );
+  return T2PD_OK;
+}
 
-  buffer_t buf;
-  NEW_BUFFER( &buf );
-  int total_before = 0, total_after = 0;
+int t2pd_read_char( t2pd_t *t, FILE *fin ) {
+  return read_char( t, fin );
+}
 
-  for ( DWord rec_num = 1; rec_num <= num_records; ++rec_num ) {
-    offset = STATIC_CAST( DWord, ftell( fout ) );
-    SEEK_REC( fout, rec_num );
-    PUT_DWord( fout, offset );
+t2pd_status_t t2pd_encode( t2pd_t *t, char const *doc_name, FILE *fin,
+                           uint64_t fin_size, FILE *fout ) {
+  assert( t != NULL );
+  assert( doc_name != NULL );
+  assert( fin != NULL );
+  assert( fout != NULL );
+
+  unsigned const rec_size =
+    t->opts.record_size != 0 ? t->opts.record_size : RECORD_SIZE_MAX;
+  if ( rec_size < T2PD_RECORD_SIZE_MIN || rec_size > T2PD_RECORD_SIZE_MAX ) {
+    return t2pd_error( t, T2PD_ERR_ARG,
+      "%u: record size not between %u and %u\n",
+      rec_size, T2PD_RECORD_SIZE_MIN, T2PD_RECORD_SIZE_MAX
+    );
+  }
+  t2pd_status_t status = t2pd_buffers_reserve( t, rec_size );
+  if ( status != T2PD_OK )
+    return status;
+
+  t2pd_clock_t clock;
+  t2pd_stats_begin( t, /*decode=*/false, &clock );
+
+  if ( t->opts.html && (status = t2pd_html_begin( t )) != T2PD_OK )
+    return status;
+
+  status = t2pd_bookmarks_begin( t, fin, fin_size );
+  if ( status != T2PD_OK )
+    return status;
+
+  encode_plan_t plan = {
+    .rec_size = rec_size,
+    //
+    // The number of bookmarks isn't known until all the text has been read,
+    // so leave room in each volume for the most there could be.
+    //
+    .num_reserved =
+      t->bm.marker_len > 0 ? STATIC_CAST( DWord, t->bm.max ) : 0,
+    //
+    // Transcoding never makes text larger, so its size is at most that of the
+    // file.  (Text converted from HTML may be a little larger, e.g., its
+    // title, so for it this is only an estimate.)
+    //
+    .text_left = fin_size
+  };
+  plan.volume_max = volume_records_max( t, &plan );
+
+  ////////// split into volumes if necessary //////////////////////////////////
+
+  uint64_t const num_records = fin_size / rec_size + (fin_size % rec_size != 0);
+  uint64_t const max_volumes64 = num_records <= plan.volume_max ? 1 :
+    (num_records - 1) / plan.volume_max + 1;
+  unsigned const max_volumes = max_volumes64 < UINT_MAX ?
+    STATIC_CAST( unsigned, max_volumes64 ) : UINT_MAX;
+
+  buffer_t *const buf = &t->rec_buf;
+  FILE **vouts = NULL;                  // all volumes' files
+  unsigned num_volumes = 0;
+
+  for (;;) {
+    t2pd_bookmarks_volume( t );
+    status = t2pd_fill_buffer( t, fin, buf, rec_size );
+    if ( status != T2PD_OK )
+      break;
+    t2pd_stats_phase( t, T2PD_PHASE_TRANSCODE, &clock );
+    if ( buf->len == 0 && num_volumes > 0 )
+      break;                            // no more text
+
+    unsigned const volume = num_volumes + 1;
+    FILE *vout = fout;
+    if ( volume > 1 ) {
+      if ( t->opts.volume_fn == NULL ) {
+        status = t2pd_error( t, T2PD_ERR_ARG,
+          "text too large for one Doc file\n"
+        );
+        break;
+      }
+      if ( volume == UINT_MAX ) {
+        status = t2pd_error( t, T2PD_ERR_ARG, "text too large\n" );
+        break;
+      }
+      vout = (*t->opts.volume_fn)( t->opts.volume_data, volume );
+      if ( vout == NULL ) {
+        status = t2pd_error( t, T2PD_ERR_WRITE,
+          "volume %u: %s\n", volume, STRERROR
+        );
+        break;
+      }
+    }
+    FILE **const new_vouts = realloc( vouts, volume * sizeof *vouts );
+    if ( new_vouts == NULL ) {
+      if ( vout != fout )
+        fclose( vout );
+      status = t2pd_error( t, T2PD_ERR_NOMEM, "%s\n", STRERROR );
+      break;
+    }
+    vouts = new_vouts;
+    vouts[ num_volumes++ ] = vout;
 
-    fill_buffer( &buf );
-    size_t const uncompressed_buf_len = buf.len;
-    if ( opt_compress )
-      compress( &buf );
+    char name[ dmDBNameLength ];
+    make_name( name, doc_name, volume, max_volumes );
+    if ( max_volumes > 1 && t->opts.verbose )
+      t2pd_diag( t, T2PD_DIAG_PROGRESS, "volume %u:\n", volume );
 
-    FSEEK( fout, offset, SEEK_SET );
-    FWRITE( buf.data, buf.len, 1, fout );
+    status = encode_volume( t, &plan, name, fin, vout, &clock );
+    if ( status != T2PD_OK )
+      break;
+  } // for
 
-    if ( !opt_verbose )
-      continue;
+  if ( status == T2PD_OK && num_volumes != max_volumes )
+    status = rename_volumes( t, doc_name, vouts, num_volumes );
 
-    if ( opt_compress ) {
-      PRINT_ERR(
-        "  record %2d: %5zu bytes -> %5zu (%2d%%)\n",
-        rec_num, uncompressed_buf_len, buf.len,
-        (int)( 100.0 * buf.len / uncompressed_buf_len )
+  for ( unsigned i = 1; i < num_volumes; ++i ) {
+    if ( fclose( vouts[i] ) == EOF && status == T2PD_OK ) {
+      status = t2pd_error( t, T2PD_ERR_WRITE,
+        "volume %u: %s\n", i + 1, STRERROR
       );
-      total_before += uncompressed_buf_len;
-      total_after  += buf.len;
-    } else {
-      PRINT_ERR( " %d", num_records - rec_num + 1 );
     }
   } // for
+  free( vouts );
+  if ( status != T2PD_OK )
+    return status;
+
+  if ( t->opts.verbose && t->opts.compress && plan.total_before > 0 ) {
+    t2pd_diag( t, T2PD_DIAG_PROGRESS, "\n-----\ntotal compression: %2d%%\n",
+      STATIC_CAST( int, 100.0 * STATIC_CAST( double, plan.total_after ) /
+                        STATIC_CAST( double, plan.total_before ) )
+    );
+  }
 
-  if ( opt_verbose ) {
-    if ( opt_compress ) {
-      PRINT_ERR( "\n-----\ntotal compression: %2d%%\n",
-        STATIC_CAST( int, 100.0 * total_after / total_before )
-      );
-    } else {
-      FPUTC( '\n', stderr );
-    }
+  if ( t->opts.stats != NULL ) {
+    t->opts.stats->bytes_in = fin_size;
+    t->opts.stats->bytes_out = plan.bytes_out;
   }
+  return T2PD_OK;
+}
+
+t2pd_status_t t2pd_encode_file( t2pd_t *t, char const *doc_name, FILE *fin,
+                                FILE *fout ) {
+  if ( t == NULL || doc_name == NULL || fin == NULL || fout == NULL )
+    return T2PD_ERR_ARG;
+  struct stat sbuf;
+  if ( fstat( fileno( fin ), &sbuf ) == -1 )
+    return t2pd_error( t, T2PD_ERR_READ, "%s\n", STRERROR );
+  return t2pd_encode(
+    t, doc_name, fin, STATIC_CAST( uint64_t, sbuf.st_size ), fout
+  );
 }
 
 ///////////////////////////////////////////////////////////////////////////////
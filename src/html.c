@@ -0,0 +1,1241 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      html.c
+**
+**      Copyright (C) 1998-2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/**
+ * @file
+ * Defines functions for converting HTML into Doc text while encoding, the way
+ * `html2pdbtxt` does, but reading the HTML a character at a time: a tokenizer
+ * strips tags and decodes entities and a normalizer collapses whitespace
+ * as it goes, so memory use is constant regardless of the size of the HTML.
+ */
+
+// local
+#include "pjl_config.h"
+#include "common.h"
+#include "doc.h"
+#include "palm.h"
+#include "txt2pdbdoc.h"
+#include "util.h"
+
+// standard
+#include <assert.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HTML_ALT_MAX              256   /* longest ALT text kept */
+#define HTML_ENTITY_MAX           32    /* longest entity name + 1 */
+#define HTML_HR_LEN               22    /* em dashes in a horizontal rule */
+#define HTML_NAME_MAX             16    /* longest tag/attribute name + 1 */
+#define HTML_OUT_SIZE             2048  /* most output from one character */
+#define HTML_TITLE_MAX            256   /* longest title kept */
+
+#define HTML_BULLET               0x95  /* bullet character on PalmOS */
+#define HTML_EM_DASH              0x97  /* em dash character on PalmOS */
+
+/**
+ * States of tokenizing HTML.
+ */
+enum html_state {
+  HS_TEXT,                              ///< Ordinary text.
+  HS_TAG_OPEN,                          ///< After `<`.
+  HS_TAG_NAME,                          ///< In a tag name.
+  HS_ATTRS,                             ///< Between attributes.
+  HS_ATTR_NAME,                         ///< In an attribute name.
+  HS_ATTR_EQ,                           ///< After an attribute name.
+  HS_ATTR_VALUE,                        ///< After `=`.
+  HS_ATTR_DQ,                           ///< In a `"`-quoted value.
+  HS_ATTR_SQ,                           ///< In a `'`-quoted value.
+  HS_ATTR_UNQ,                          ///< In an unquoted value.
+  HS_BANG,                              ///< After `<!`.
+  HS_BANG_DASH,                         ///< After `<!-`.
+  HS_COMMENT,                           ///< In a `<!--` comment.
+  HS_SKIP_TAG,                          ///< Skipping to `>`.
+  HS_RAW,                               ///< In `SCRIPT`, `STYLE`, or `TITLE`.
+  HS_RAW_LT,                            ///< Matching a raw text end tag.
+  HS_PRE,                               ///< In `PRE`.
+  HS_PRE_LT                             ///< Matching `</PRE`.
+};
+
+/**
+ * What to do at the `>` ending a skipped tag.
+ */
+enum html_skip {
+  SKIP_TAG,                             ///< Like any other tag.
+  SKIP_RAW_END,                         ///< End raw text.
+  SKIP_PRE_END                          ///< End `PRE`.
+};
+
+/**
+ * What whitespace to eat after certain constructs, like `html2pdbtxt` does.
+ */
+enum html_eat {
+  EAT_NONE,                             ///< Nothing.
+  EAT_ANCHOR,                           ///< Until content or another tag.
+  EAT_PRE                               ///< Until content.
+};
+
+/**
+ * What to emit for a tag.
+ */
+enum html_action {
+  HA_NONE,                              ///< Nothing: an ordinary tag.
+  HA_NL,                                ///< A newline.
+  HA_NL2,                               ///< Two newlines.
+  HA_BLOCKQUOTE,                        ///< Two newlines and a tab.
+  HA_DD,                                ///< A newline and a tab.
+  HA_HR,                                ///< A rule of em dashes on a line.
+  HA_LI,                                ///< A newline, bullet, and space.
+  HA_TD,                                ///< A space.
+  HA_ANCHOR,                            ///< A bookmark, if `NAME`.
+  HA_PRE,                               ///< Start of preformatted text.
+  HA_RAW                                ///< Start of ignored text.
+};
+
+/**
+ * An HTML element that isn't an ordinary tag.
+ */
+struct html_tag {
+  char const *name;                     ///< Its name in lower case.
+  Byte        open;                     ///< Its ::html_action when opened.
+  Byte        close;                    ///< Its ::html_action when closed.
+};
+typedef struct html_tag html_tag_t;
+
+/**
+ * An HTML named character entity reference.
+ */
+struct html_entity {
+  char const *name;                     ///< Its name.
+  Byte        c;                        ///< Its PalmOS character.
+};
+typedef struct html_entity html_entity_t;
+
+/**
+ * The state of converting HTML.
+ */
+struct html {
+  Byte        out[ HTML_OUT_SIZE ];     ///< Converted text.
+  size_t      out_len;                  ///< Length of \a out.
+  size_t      out_pos;                  ///< Position of next byte of \a out.
+  bool        done;                     ///< Reached end of input?
+
+  Byte        marker[ DOC_BOOKMARK_NAME_SIZE ]; ///< Bookmark marker.
+  size_t      marker_len;               ///< Length of \a marker.
+  bool        bookmarks;                ///< Were any bookmarks made?
+
+  // tokenizer
+  unsigned    state;                    ///< Current ::html_state.
+  unsigned    skip;                     ///< Current ::html_skip.
+  char        name[ HTML_NAME_MAX ];    ///< Tag name in lower case.
+  size_t      name_len;                 ///< Length of \a name.
+  bool        closing;                  ///< Is it an end tag?
+  char        attr[ HTML_NAME_MAX ];    ///< Attribute name in lower case.
+  size_t      attr_len;                 ///< Length of \a attr.
+  unsigned    attr_count;               ///< Number of attributes so far.
+  bool        a_name;                   ///< Is first attribute `NAME`?
+  bool        in_alt;                   ///< In `ALT` value?
+  Byte        alt[ HTML_ALT_MAX ];      ///< `ALT` value.
+  size_t      alt_len;                  ///< Length of \a alt.
+  bool        have_alt;                 ///< Is there a non-empty \a alt?
+  unsigned    dashes;                   ///< Consecutive `-` in a comment.
+  char const *raw_end;                  ///< End tag of raw text, e.g., `/pre`.
+  size_t      raw_matched;              ///< Bytes of \a raw_end matched.
+  bool        in_entity;                ///< In an entity reference?
+  char        entity[ HTML_ENTITY_MAX ]; ///< Entity name.
+  size_t      entity_len;               ///< Length of \a entity.
+
+  // title
+  bool        in_title;                 ///< Collecting \a title?
+  bool        title_done;               ///< Was a title seen?
+  Byte        title[ HTML_TITLE_MAX ];  ///< Title with whitespace collapsed.
+  size_t      title_len;                ///< Length of \a title.
+
+  // normalizer
+  bool        preamble_done;            ///< Was the title emitted?
+  bool        body_started;             ///< Was any text emitted?
+  bool        at_line_start;            ///< Nothing on the line yet?
+  bool        pending_space;            ///< Space before next content?
+  unsigned    pending_nl;               ///< Newlines before next content.
+  bool        in_pre;                   ///< In preformatted text?
+  unsigned    pre_spaces;               ///< Pending spaces in \a in_pre.
+  unsigned    eat;                      ///< Current ::html_eat.
+};
+
+/**
+ * Elements that aren't ordinary tags, sorted by name.
+ */
+static html_tag_t const HTML_TAGS[] = {
+  { "a",          HA_ANCHOR,      HA_NONE },
+  { "address",    HA_NL2,         HA_NL2  },
+  { "blockquote", HA_BLOCKQUOTE,  HA_NL2  },
+  { "br",         HA_NL,          HA_NL   },
+  { "center",     HA_NL,          HA_NL   },
+  { "dd",         HA_DD,          HA_NONE },
+  { "div",        HA_NL,          HA_NL   },
+  { "dl",         HA_NL2,         HA_NL2  },
+  { "dt",         HA_NL2,         HA_NL2  },
+  { "h1",         HA_NL2,         HA_NL2  },
+  { "h2",         HA_NL2,         HA_NL2  },
+  { "h3",         HA_NL2,         HA_NL2  },
+  { "h4",         HA_NL2,         HA_NL2  },
+  { "h5",         HA_NL2,         HA_NL2  },
+  { "h6",         HA_NL2,         HA_NL2  },
+  { "hr",         HA_HR,          HA_NONE },
+  { "li",         HA_LI,          HA_NONE },
+  { "ol",         HA_NL2,         HA_NL2  },
+  { "option",     HA_NL,          HA_NL   },
+  { "p",          HA_NL2,         HA_NL2  },
+  { "pre",        HA_PRE,         HA_NONE },
+  { "script",     HA_RAW,         HA_NONE },
+  { "select",     HA_NL,          HA_NL   },
+  { "style",      HA_RAW,         HA_NONE },
+  { "table",      HA_NL,          HA_NL   },
+  { "td",         HA_TD,          HA_NONE },
+  { "title",      HA_RAW,         HA_NONE },
+  { "tr",         HA_NL,          HA_NONE },
+  { "ul",         HA_NL2,         HA_NL2  },
+};
+
+/**
+ * Named character entity references, sorted by name, and their PalmOS
+ * characters exactly as `html2pdbtxt` has them.
+ */
+static html_entity_t const HTML_ENTITIES[] = {
+  { "AElig",   0xC6 },   // capital AE diphthong (ligature)
+  { "Aacute",  0xC1 },   // capital A, acute accent
+  { "Acirc",   0xC2 },   // capital A, circumflex accent
+  { "Agrave",  0xC0 },   // capital A, grave accent
+  { "Aring",   0xC5 },   // capital A, ring
+  { "Atilde",  0xC3 },   // capital A, tilde
+  { "Auml",    0xC4 },   // capital A, dieresis or umlaut mark
+  { "Ccedil",  0xC7 },   // capital C, cedilla
+  { "Dagger",  0x87 },   // double dagger
+  { "Dstrok",  0xD0 },   // capital Eth, Icelandic (Lynx)
+  { "ETH",     0xD0 },   // capital Eth, Icelandic
+  { "Eacute",  0xC9 },   // capital E, acute accent
+  { "Ecirc",   0xCA },   // capital E, circumflex accent
+  { "Egrave",  0xC8 },   // capital E, grave accent
+  { "Euml",    0xCB },   // capital E, dieresis or umlaut mark
+  { "Iacute",  0xCD },   // capital I, acute accent
+  { "Icirc",   0xCE },   // capital I, circumflex accent
+  { "Igrave",  0xCC },   // capital I, grave accent
+  { "Iuml",    0xCF },   // capital I, dieresis or umlaut mark
+  { "Ntilde",  0xD1 },   // capital N, tilde
+  { "OElig",   0x8C },   // latin capital ligature OE
+  { "Oacute",  0xD3 },   // capital O, acute accent
+  { "Ocirc",   0xD4 },   // capital O, circumflex accent
+  { "Ograve",  0xD2 },   // capital O, grave accent
+  { "Oslash",  0xD8 },   // capital O, slash
+  { "Otilde",  0xD5 },   // capital O, tilde
+  { "Ouml",    0xD6 },   // capital O, dieresis or umlaut mark
+  { "Scaron",  0x8A },   // latin capital letter S with caron
+  { "THORN",   0xDE },   // capital THORN, Icelandic
+  { "Uacute",  0xDA },   // capital U, acute accent
+  { "Ucirc",   0xDB },   // capital U, circumflex accent
+  { "Ugrave",  0xD9 },   // capital U, grave accent
+  { "Uuml",    0xDC },   // capital U, dieresis or umlaut mark
+  { "Yacute",  0xDD },   // capital Y, acute accent
+  { "Yuml",    0x9F },   // latin capital letter Y with diaeresis
+  { "aacute",  0xE1 },   // small a, acute accent
+  { "acirc",   0xE2 },   // small a, circumflex accent
+  { "acute",   0xB4 },   // spacing acute
+  { "aelig",   0xE6 },   // small ae diphthong (ligature)
+  { "agrave",  0xE0 },   // small a, grave accent
+  { "amp",     0x26 },
+  { "aring",   0xE5 },   // small a, ring
+  { "atilde",  0xE3 },   // small a, tilde
+  { "auml",    0xE4 },   // small a, dieresis or umlaut mark
+  { "bdquo",   0x84 },   // double low-9 (bottom) quotation mark
+  { "brkbar",  0xA6 },   // broken vertical bar (Lynx)
+  { "brvbar",  0xA6 },   // broken vertical bar
+  { "ccedil",  0xE7 },   // small c, cedilla
+  { "cedil",   0xB8 },   // spacing cedilla
+  { "cent",    0xA2 },   // cent (currency)
+  { "circ",    0x88 },   // modifier letter circumflex accent
+  { "clubs",   0x8E },   // club suit
+  { "copy",    0xA9 },   // copyright sign
+  { "curren",  0xA4 },   // general currency sign (currency)
+  { "dagger",  0x86 },   // dagger
+  { "deg",     0xB0 },   // degree sign
+  { "diams",   0x8D },   // diamond suit
+  { "die",     0xA8 },   // spacing dieresis (Lynx)
+  { "divide",  0xF7 },   // division sign
+  { "dstrok",  0xF0 },   // small eth, Icelandic (Lynx)
+  { "eacute",  0xE9 },   // small e, acute accent
+  { "ecirc",   0xEA },   // small e, circumflex accent
+  { "egrave",  0xE8 },   // small e, grave accent
+  { "emdash",  0x97 },   // dash the width of emsp (Lynx)
+  { "emsp",    0x80 },   // em space (HTML 2.0)
+  { "endash",  0x96 },   // dash the width of ensp (Lynx)
+  { "ensp",    0xA0 },   // en space (HTML 2.0)
+  { "eth",     0xF0 },   // small eth, Icelandic
+  { "euml",    0xEB },   // small e, dieresis or umlaut mark
+  { "fnof",    0x83 },   // Florin or Guilder (currency)
+  { "frac12",  0xBC },   // fraction 1/2
+  { "frac14",  0xBD },   // fraction 1/4
+  { "frac34",  0xBE },   // fraction 3/4
+  { "gt",      0x3E },
+  { "hearts",  0x8F },   // heart suit
+  { "hellip",  0x85 },   // horizontal ellipsis
+  { "hibar",   0xAF },   // spacing macron (Lynx)
+  { "iacute",  0xED },   // small i, acute accent
+  { "icirc",   0xEE },   // small i, circumflex accent
+  { "iexcl",   0xA1 },   // inverted exclamation mark
+  { "igrave",  0xEC },   // small i, grave accent
+  { "iquest",  0xBF },   // inverted question mark
+  { "iuml",    0xEF },   // small i, dieresis or umlaut mark
+  { "laquo",   0xAB },   // angle quotation mark, left
+  { "ldquo",   0x93 },   // left double quotation mark
+  { "lsaquo",  0x8B },   // left single angle quotation mark
+  { "lsquo",   0x91 },   // left single quotation mark
+  { "lt",      0x3C },
+  { "macr",    0xAF },   // spacing macron
+  { "mdash",   0x97 },   // dash the width of emsp (HTML 2.0)
+  { "micro",   0xB5 },   // micro sign
+  { "middot",  0xB7 },   // middle dot
+  { "nbsp",    0xA0 },   // non breaking space
+  { "ndash",   0x96 },   // dash the width of ensp (HTML 2.0)
+  { "not",     0xAC },   // negation sign
+  { "ntilde",  0xF1 },   // small n, tilde
+  { "oacute",  0xF3 },   // small o, acute accent
+  { "ocirc",   0xF4 },   // small o, circumflex accent
+  { "oelig",   0x9C },   // latin small ligature oe
+  { "ograve",  0xF2 },   // small o, grave accent
+  { "ordf",    0xAA },   // feminine ordinal indicator
+  { "ordm",    0xBA },   // masculine ordinal indicator
+  { "oslash",  0xF8 },   // small o, slash
+  { "otilde",  0xF5 },   // small o, tilde
+  { "ouml",    0xF6 },   // small o, dieresis or umlaut mark
+  { "para",    0xB6 },   // paragraph sign
+  { "permil",  0x89 },   // per mill sign
+  { "plusmn",  0xB1 },   // plus-or-minus sign
+  { "pound",   0xA3 },   // pound sterling (currency)
+  { "quot",    0x22 },
+  { "raquo",   0xBB },   // angle quotation mark, right
+  { "rdquo",   0x94 },   // right double quotation mark
+  { "reg",     0xAE },   // circled R registered sign
+  { "rsaquo",  0x8B },   // right single angle quotation mark
+  { "rsquo",   0x92 },   // right single quotation mark
+  { "sbquo",   0x82 },   // single low-9 (bottom) quotation mark
+  { "scaron",  0x9A },   // latin small letter s with caron
+  { "sect",    0xA7 },   // section sign
+  { "shy",     0xAD },   // soft hyphen
+  { "spades",  0x90 },   // spade suit
+  { "sup1",    0xB9 },   // superscript 1
+  { "sup2",    0xB2 },   // superscript 2
+  { "sup3",    0xB3 },   // superscript 3
+  { "szlig",   0xDF },   // small sharp s, German (sz ligature)
+  { "thinsp",  0xA0 },   // thin space (Lynx)
+  { "thorn",   0xFE },   // small thorn, Icelandic
+  { "tilde",   0x98 },   // small tilde
+  { "times",   0xD7 },   // multiplication sign
+  { "trade",   0x99 },   // trademark sign (HTML 2.0)
+  { "uacute",  0xFA },   // small u, acute accent
+  { "ucirc",   0xFB },   // small u, circumflex accent
+  { "ugrave",  0xF9 },   // small u, grave accent
+  { "uml",     0xA8 },   // spacing dieresis
+  { "uuml",    0xFC },   // small u, dieresis or umlaut mark
+  { "yacute",  0xFD },   // small y, acute accent
+  { "yen",     0xA5 },   // yen (currency)
+  { "yuml",    0xFF },   // small y, dieresis or umlaut mark
+};
+
+////////// local functions ////////////////////////////////////////////////////
+
+static void html_step( t2pd_t*, Byte );
+static void text_char( t2pd_t*, Byte );
+
+/**
+ * Compares an entity name to an ::html_entity for bsearch(3).
+ *
+ * @param key The entity name.
+ * @param elt The ::html_entity.
+ * @return Returns a number less than 0, 0, or greater than 0 if \a key is
+ * less than, equal to, or greater than the name of \a elt, respectively.
+ */
+NODISCARD
+static int html_entity_cmp( void const *key, void const *elt ) {
+  return strcmp( key, STATIC_CAST( html_entity_t const*, elt )->name );
+}
+
+/**
+ * Compares a tag name to an ::html_tag for bsearch(3).
+ *
+ * @param key The tag name.
+ * @param elt The ::html_tag.
+ * @return Returns a number less than 0, 0, or greater than 0 if \a key is
+ * less than, equal to, or greater than the name of \a elt, respectively.
+ */
+NODISCARD
+static int html_tag_cmp( void const *key, void const *elt ) {
+  return strcmp( key, STATIC_CAST( html_tag_t const*, elt )->name );
+}
+
+/**
+ * Gets whether \a c is HTML whitespace.
+ *
+ * @param c The character to check.
+ * @return Returns `true` only if \a c is whitespace.
+ */
+NODISCARD
+static inline bool is_space( Byte c ) {
+  return isspace( c ) != 0;
+}
+
+/**
+ * Appends a character in lower case to a tag or attribute name.  A name too
+ * long for \a buf is made to be #HTML_NAME_MAX long so it never matches.
+ *
+ * @param buf The buffer of at least #HTML_NAME_MAX bytes.
+ * @param len A pointer to the length of \a buf.
+ * @param c The character to append.
+ */
+static void name_add( char *buf, size_t *len, Byte c ) {
+  if ( *len < HTML_NAME_MAX - 1 )
+    buf[ (*len)++ ] = STATIC_CAST( char, tolower( c ) );
+  else
+    *len = HTML_NAME_MAX;
+}
+
+/**
+ * Null-terminates a tag or attribute name.
+ *
+ * @param buf The buffer of at least #HTML_NAME_MAX bytes.
+ * @param len The length of \a buf.
+ * @return Returns \a buf or the empty string if the name was too long.
+ */
+NODISCARD
+static char const* name_end( char *buf, size_t len ) {
+  if ( len >= HTML_NAME_MAX )
+    return "";
+  buf[ len ] = '\0';
+  return buf;
+}
+
+////////// normalizer /////////////////////////////////////////////////////////
+
+/**
+ * Appends a byte to the converted text.
+ *
+ * @param h The HTML state.
+ * @param c The byte.
+ */
+static inline void put( html_t *h, Byte c ) {
+  assert( h->out_len < HTML_OUT_SIZE );
+  h->out[ h->out_len++ ] = c;
+}
+
+/**
+ * Appends a byte of the body to the converted text, preceded by the title and
+ * a rule, if any, if it's the first.
+ *
+ * @param h The HTML state.
+ * @param c The byte.
+ */
+static void body_put( html_t *h, Byte c ) {
+  if ( !h->preamble_done ) {
+    h->preamble_done = true;
+    if ( h->title_len > 0 ) {
+      for ( size_t i = 0; i < h->title_len; ++i )
+        put( h, h->title[i] );
+      put( h, '\n' );
+      for ( unsigned i = 0; i < HTML_HR_LEN; ++i )
+        put( h, HTML_EM_DASH );
+      put( h, '\n' );
+    }
+  }
+  put( h, c );
+  h->body_started = true;
+}
+
+/**
+ * Emits pending newlines: at most one at the start of the body and at most
+ * two elsewhere, i.e., at most one blank line.
+ *
+ * @param h The HTML state.
+ */
+static void flush_nl( html_t *h ) {
+  unsigned const n = h->body_started || h->pending_nl == 0 ? h->pending_nl : 1;
+  for ( unsigned i = 0; i < n; ++i )
+    body_put( h, '\n' );
+  h->pending_nl = 0;
+}
+
+/**
+ * Emits a non-whitespace byte preceded by any pending whitespace.
+ *
+ * @param h The HTML state.
+ * @param c The byte.
+ */
+static void ev_content( html_t *h, Byte c ) {
+  h->eat = EAT_NONE;
+  flush_nl( h );
+  if ( h->pending_space ) {
+    body_put( h, ' ' );
+    h->pending_space = false;
+  }
+  body_put( h, c );
+  h->at_line_start = false;
+}
+
+/**
+ * Notes a newline: trailing spaces before it are dropped.
+ *
+ * @param h The HTML state.
+ */
+static void ev_nl( html_t *h ) {
+  if ( h->eat != EAT_NONE )
+    return;
+  h->pending_space = false;
+  if ( h->pending_nl < 2 )
+    ++h->pending_nl;
+  h->at_line_start = true;
+}
+
+/**
+ * Notes a space: consecutive spaces are collapsed and leading ones dropped.
+ *
+ * @param h The HTML state.
+ */
+static void ev_space( html_t *h ) {
+  if ( h->eat == EAT_NONE && !h->at_line_start )
+    h->pending_space = true;
+}
+
+/**
+ * Emits a tab unless whitespace is being eaten.
+ *
+ * @param h The HTML state.
+ */
+static void ev_tab( html_t *h ) {
+  if ( h->eat == EAT_NONE )
+    ev_content( h, '\t' );
+}
+
+/**
+ * Notes an ordinary tag: it stops eating whitespace after an anchor.
+ *
+ * @param h The HTML state.
+ */
+static void ev_tag( html_t *h ) {
+  if ( h->eat == EAT_ANCHOR )
+    h->eat = EAT_NONE;
+}
+
+/**
+ * Emits a character of preformatted text: only trailing spaces are dropped.
+ *
+ * @param h The HTML state.
+ * @param c The character.
+ */
+static void pre_char( html_t *h, Byte c ) {
+  if ( c == ' ' && h->pre_spaces < HTML_OUT_SIZE / 2 ) {
+    ++h->pre_spaces;
+    return;
+  }
+  if ( c != '\n' ) {
+    for ( ; h->pre_spaces > 0; --h->pre_spaces )
+      body_put( h, ' ' );
+  }
+  h->pre_spaces = 0;
+  body_put( h, c );
+}
+
+/**
+ * Emits a character from an entity reference.  It's never whitespace to be
+ * normalized even if it's a space.
+ *
+ * @param h The HTML state.
+ * @param c The character.
+ */
+static void ev_literal( html_t *h, Byte c ) {
+  if ( !h->in_pre ) {
+    ev_content( h, c );
+    return;
+  }
+  for ( ; h->pre_spaces > 0; --h->pre_spaces )
+    body_put( h, ' ' );
+  body_put( h, c );
+}
+
+/**
+ * Begins preformatted text on a line by itself.
+ *
+ * @param h The HTML state.
+ */
+static void pre_begin( html_t *h ) {
+  h->pending_space = false;
+  h->pending_nl = 0;
+  h->eat = EAT_NONE;
+  body_put( h, '\n' );
+  h->in_pre = true;
+  h->pre_spaces = 0;
+}
+
+/**
+ * Ends preformatted text: whitespace after it is eaten.
+ *
+ * @param h The HTML state.
+ */
+static void pre_end( html_t *h ) {
+  h->pre_spaces = 0;
+  body_put( h, '\n' );
+  h->in_pre = false;
+  h->at_line_start = true;
+  h->eat = EAT_PRE;
+}
+
+/**
+ * Emits a character of text other than an entity reference.
+ *
+ * @param h The HTML state.
+ * @param c The character.
+ */
+static void plain_char( html_t *h, Byte c ) {
+  if ( h->in_pre )
+    pre_char( h, c );
+  else if ( is_space( c ) )
+    ev_space( h );
+  else
+    ev_content( h, c );
+}
+
+////////// tokenizer //////////////////////////////////////////////////////////
+
+/**
+ * Emits the characters of an entity reference that turned out not to be one.
+ *
+ * @param t The handle.
+ */
+static void entity_flush( t2pd_t *t ) {
+  html_t *const h = t->html;
+  h->in_entity = false;
+  plain_char( h, '&' );
+  for ( size_t i = 0; i < h->entity_len; ++i )
+    plain_char( h, STATIC_CAST( Byte, h->entity[i] ) );
+}
+
+/**
+ * Emits the character of a complete entity reference.  Unknown named entities
+ * become a space; numeric ones are Unicode except that those in the range
+ * 0x80-0x9F are taken to be Windows-1252 as browsers do.
+ *
+ * @param t The handle.
+ */
+static void entity_decode( t2pd_t *t ) {
+  html_t *const h = t->html;
+  h->in_entity = false;
+  h->entity[ h->entity_len ] = '\0';
+
+  if ( h->entity[0] != '#' ) {
+    html_entity_t const *const e = bsearch(
+      h->entity, HTML_ENTITIES, ARRAY_SIZE( HTML_ENTITIES ),
+      sizeof HTML_ENTITIES[0], &html_entity_cmp
+    );
+    ev_literal( h, e != NULL ? e->c : ' ' );
+    return;
+  }
+
+  char const *digits = h->entity + 1;
+  int base = 10;
+  if ( *digits == 'x' || *digits == 'X' ) {
+    ++digits;
+    base = 16;
+  }
+  char *end;
+  unsigned long const cp = strtoul( digits, &end, base );
+  if ( *digits == '\0' || *end != '\0' ) {
+    entity_flush( t );
+    plain_char( h, ';' );
+    return;
+  }
+
+  Byte c = 0;
+  if ( cp >= 0x80 && cp <= 0x9F )
+    c = palm_to_unicode( STATIC_CAST( Byte, cp ) ) != 0 ?
+      STATIC_CAST( Byte, cp ) : 0;
+  else if ( cp <= 0x10FFFF )
+    c = unicode_to_palm( STATIC_CAST( char32_t, cp ) );
+  if ( c == 0 ) {
+    t2pd_warn( t,
+      "\"&%s;\": character does not map to PalmOS\n", h->entity
+    );
+    return;
+  }
+  ev_literal( h, c );
+}
+
+/**
+ * Ends text by emitting any unterminated entity reference as is.
+ *
+ * @param t The handle.
+ */
+static void text_end( t2pd_t *t ) {
+  if ( t->html->in_entity )
+    entity_flush( t );
+}
+
+/**
+ * Handles a character of text (including `ALT` text and preformatted text).
+ *
+ * @param t The handle.
+ * @param c The character.
+ */
+static void text_char( t2pd_t *t, Byte c ) {
+  html_t *const h = t->html;
+  if ( h->in_entity ) {
+    if ( c == ';' && h->entity_len > 0 ) {
+      entity_decode( t );
+      return;
+    }
+    if ( (isalnum( c ) || c == '_' || (c == '#' && h->entity_len == 0)) &&
+         h->entity_len < HTML_ENTITY_MAX - 1 ) {
+      h->entity[ h->entity_len++ ] = STATIC_CAST( char, c );
+      return;
+    }
+    entity_flush( t );
+  }
+  if ( c == '&' ) {
+    h->in_entity = true;
+    h->entity_len = 0;
+  }
+  else {
+    plain_char( h, c );
+  }
+}
+
+/**
+ * Adds a character to the title, collapsing whitespace.
+ *
+ * @param h The HTML state.
+ * @param c The character.
+ */
+static void title_add( html_t *h, Byte c ) {
+  if ( is_space( c ) ) {
+    if ( h->title_len == 0 || h->title[ h->title_len - 1 ] == ' ' )
+      return;
+    c = ' ';
+  }
+  if ( h->title_len < HTML_TITLE_MAX )
+    h->title[ h->title_len++ ] = c;
+}
+
+/**
+ * Handles a character of raw text, i.e., of `SCRIPT`, `STYLE`, or `TITLE`.
+ *
+ * @param h The HTML state.
+ * @param c The character.
+ */
+static void raw_char( html_t *h, Byte c ) {
+  if ( h->in_title )
+    title_add( h, c );
+}
+
+/**
+ * Gets the next character of the end tag of raw or preformatted text.
+ *
+ * @param h The HTML state.
+ * @return Returns said character or `\0` if the end tag has been matched.
+ */
+NODISCARD
+static inline char raw_expect( html_t const *h ) {
+  return h->raw_matched == 0 ? '/' : h->raw_end[ h->raw_matched - 1 ];
+}
+
+/**
+ * Handles a `<` and the characters after it that turned out not to start the
+ * end tag of raw or preformatted text.
+ *
+ * @param t The handle.
+ */
+static void raw_flush( t2pd_t *t ) {
+  html_t *const h = t->html;
+  size_t const matched = h->raw_matched;
+  h->raw_matched = 0;
+  for ( size_t i = 0; i <= matched; ++i ) {
+    Byte const c = STATIC_CAST( Byte,
+      i == 0 ? '<' : i == 1 ? '/' : h->raw_end[ i - 2 ]
+    );
+    if ( h->in_pre )
+      text_char( t, c );
+    else
+      raw_char( h, c );
+  } // for
+}
+
+/**
+ * Emits the `ALT` text of a tag in brackets.
+ *
+ * @param t The handle.
+ */
+static void emit_alt( t2pd_t *t ) {
+  html_t *const h = t->html;
+  ev_content( h, '[' );
+  for ( size_t i = 0; i < h->alt_len; ++i )
+    text_char( t, h->alt[i] );
+  text_end( t );
+  ev_content( h, ']' );
+}
+
+/**
+ * Emits a bookmark marker on a new line for an `<A NAME>` tag.
+ *
+ * @param h The HTML state.
+ */
+static void emit_anchor( html_t *h ) {
+  ev_tag( h );
+  ev_nl( h );
+  for ( size_t i = 0; i < h->marker_len; ++i )
+    ev_content( h, h->marker[i] );
+  h->eat = EAT_ANCHOR;
+  h->bookmarks = true;
+}
+
+/**
+ * Begins a new attribute.
+ *
+ * @param h The HTML state.
+ */
+static void attr_begin( html_t *h ) {
+  h->attr_len = 0;
+  h->in_alt = false;
+}
+
+/**
+ * Ends the name of an attribute.
+ *
+ * @param h The HTML state.
+ */
+static void attr_name_end( html_t *h ) {
+  char const *const attr = name_end( h->attr, h->attr_len );
+  if ( ++h->attr_count == 1 && strcmp( attr, "name" ) == 0 )
+    h->a_name = true;
+  h->in_alt = !h->have_alt && strcmp( attr, "alt" ) == 0;
+  h->alt_len = 0;
+}
+
+/**
+ * Ends the value of an attribute.  Like `html2pdbtxt`, only a non-empty
+ * `"`-quoted `ALT` value is used.
+ *
+ * @param h The HTML state.
+ * @param dq Was the value `"`-quoted?
+ */
+static void attr_value_end( html_t *h, bool dq ) {
+  if ( h->in_alt && dq && h->alt_len > 0 )
+    h->have_alt = true;
+  h->in_alt = false;
+}
+
+/**
+ * Adds a character to the value of an attribute.
+ *
+ * @param h The HTML state.
+ * @param c The character.
+ */
+static void attr_value_add( html_t *h, Byte c ) {
+  if ( h->in_alt && h->alt_len < HTML_ALT_MAX )
+    h->alt[ h->alt_len++ ] = c;
+}
+
+/**
+ * Begins a tag after its `<`.
+ *
+ * @param h The HTML state.
+ */
+static void tag_begin( html_t *h ) {
+  h->state = HS_TAG_OPEN;
+  h->name_len = 0;
+  h->closing = false;
+  h->attr_count = 0;
+  h->a_name = h->in_alt = h->have_alt = false;
+}
+
+/**
+ * Handles a complete tag at its `>`.
+ *
+ * @param t The handle.
+ */
+static void tag_end( t2pd_t *t ) {
+  html_t *const h = t->html;
+  h->state = HS_TEXT;
+
+  html_tag_t const *const tag = bsearch(
+    name_end( h->name, h->name_len ), HTML_TAGS, ARRAY_SIZE( HTML_TAGS ),
+    sizeof HTML_TAGS[0], &html_tag_cmp
+  );
+  unsigned const action =
+    tag == NULL ? HA_NONE : h->closing ? tag->close : tag->open;
+
+  switch ( action ) {
+    case HA_NONE:
+    case HA_ANCHOR:
+      if ( h->have_alt )
+        emit_alt( t );
+      else if ( action == HA_ANCHOR && h->a_name )
+        emit_anchor( h );
+      else
+        ev_tag( h );
+      break;
+    case HA_NL:
+      ev_nl( h );
+      break;
+    case HA_NL2:
+      ev_nl( h );
+      ev_nl( h );
+      break;
+    case HA_BLOCKQUOTE:
+      ev_nl( h );
+      ev_nl( h );
+      ev_tab( h );
+      break;
+    case HA_DD:
+      ev_nl( h );
+      ev_tab( h );
+      break;
+    case HA_HR:
+      ev_nl( h );
+      for ( unsigned i = 0; i < HTML_HR_LEN; ++i )
+        ev_content( h, HTML_EM_DASH );
+      ev_nl( h );
+      break;
+    case HA_LI:
+      ev_nl( h );
+      ev_content( h, HTML_BULLET );
+      ev_space( h );
+      break;
+    case HA_TD:
+      ev_space( h );
+      break;
+    case HA_PRE:
+      pre_begin( h );
+      h->raw_end = tag->name;
+      h->state = HS_PRE;
+      break;
+    case HA_RAW:
+      h->in_title = !h->title_done && !h->preamble_done &&
+                    strcmp( tag->name, "title" ) == 0;
+      h->raw_end = tag->name;
+      h->state = HS_RAW;
+      break;
+  } // switch
+}
+
+/**
+ * Handles the `>` ending a skipped tag.
+ *
+ * @param t The handle.
+ */
+static void skip_end( t2pd_t *t ) {
+  html_t *const h = t->html;
+  h->state = HS_TEXT;
+  switch ( h->skip ) {
+    case SKIP_TAG:
+      ev_tag( h );
+      break;
+    case SKIP_RAW_END:
+      if ( h->in_title ) {
+        if ( h->title_len > 0 && h->title[ h->title_len - 1 ] == ' ' )
+          --h->title_len;
+        h->in_title = false;
+        h->title_done = true;
+      }
+      break;
+    case SKIP_PRE_END:
+      pre_end( h );
+      break;
+  } // switch
+}
+
+/**
+ * Skips the rest of a tag.
+ *
+ * @param h The HTML state.
+ * @param skip What to do at its end.
+ */
+static void skip_to_gt( html_t *h, unsigned skip ) {
+  h->skip = skip;
+  h->state = HS_SKIP_TAG;
+}
+
+/**
+ * Converts the next character of HTML.
+ *
+ * @param t The handle.
+ * @param c The character.
+ */
+static void html_step( t2pd_t *t, Byte c ) {
+  html_t *const h = t->html;
+
+  switch ( h->state ) {
+    case HS_TEXT:
+      if ( c == '<' ) {
+        text_end( t );
+        tag_begin( h );
+      } else {
+        text_char( t, c );
+      }
+      break;
+
+    case HS_TAG_OPEN:
+      if ( c == '/' && !h->closing ) {
+        h->closing = true;
+      } else if ( isalpha( c ) ) {
+        name_add( h->name, &h->name_len, c );
+        h->state = HS_TAG_NAME;
+      } else if ( h->closing || c == '?' ) {
+        skip_to_gt( h, SKIP_TAG );      // bogus comment
+        if ( c == '>' )
+          skip_end( t );
+      } else if ( c == '!' ) {
+        h->state = HS_BANG;
+      } else {                          // not a tag after all
+        h->state = HS_TEXT;
+        text_char( t, '<' );
+        html_step( t, c );
+      }
+      break;
+
+    case HS_TAG_NAME:
+      if ( c == '>' )
+        tag_end( t );
+      else if ( is_space( c ) || c == '/' )
+        h->state = HS_ATTRS;
+      else
+        name_add( h->name, &h->name_len, c );
+      break;
+
+    case HS_ATTRS:
+      if ( c == '>' ) {
+        tag_end( t );
+      } else if ( !is_space( c ) && c != '/' ) {
+        attr_begin( h );
+        name_add( h->attr, &h->attr_len, c );
+        h->state = HS_ATTR_NAME;
+      }
+      break;
+
+    case HS_ATTR_NAME:
+      if ( c == '=' || c == '>' || c == '/' || is_space( c ) ) {
+        attr_name_end( h );
+        if ( c == '>' )
+          tag_end( t );
+        else
+          h->state = c == '=' ? HS_ATTR_VALUE :
+                     c == '/' ? HS_ATTRS : HS_ATTR_EQ;
+      } else {
+        name_add( h->attr, &h->attr_len, c );
+      }
+      break;
+
+    case HS_ATTR_EQ:
+      if ( c == '=' ) {
+        h->state = HS_ATTR_VALUE;
+      } else if ( !is_space( c ) ) {
+        h->state = HS_ATTRS;
+        html_step( t, c );
+      }
+      break;
+
+    case HS_ATTR_VALUE:
+      if ( c == '"' ) {
+        h->state = HS_ATTR_DQ;
+      } else if ( c == '\'' ) {
+        h->state = HS_ATTR_SQ;
+      } else if ( c == '>' ) {
+        tag_end( t );
+      } else if ( !is_space( c ) ) {
+        h->state = HS_ATTR_UNQ;
+        html_step( t, c );
+      }
+      break;
+
+    case HS_ATTR_DQ:
+    case HS_ATTR_SQ:
+      if ( c == (h->state == HS_ATTR_DQ ? '"' : '\'') ) {
+        attr_value_end( h, h->state == HS_ATTR_DQ );
+        h->state = HS_ATTRS;
+      } else {
+        attr_value_add( h, c );
+      }
+      break;
+
+    case HS_ATTR_UNQ:
+      if ( c == '>' || is_space( c ) ) {
+        attr_value_end( h, /*dq=*/false );
+        if ( c == '>' )
+          tag_end( t );
+        else
+          h->state = HS_ATTRS;
+      } else {
+        attr_value_add( h, c );
+      }
+      break;
+
+    case HS_BANG:
+    case HS_BANG_DASH:
+      if ( c == '-' ) {
+        if ( h->state == HS_BANG ) {
+          h->state = HS_BANG_DASH;
+        } else {
+          h->state = HS_COMMENT;
+          h->dashes = 0;
+        }
+      } else {
+        skip_to_gt( h, SKIP_TAG );      // declaration
+        html_step( t, c );
+      }
+      break;
+
+    case HS_COMMENT:
+      if ( c == '>' && h->dashes >= 2 ) {
+        h->state = HS_TEXT;
+        ev_tag( h );
+      } else {
+        h->dashes = c == '-' ? h->dashes + 1 : 0;
+      }
+      break;
+
+    case HS_SKIP_TAG:
+      if ( c == '>' )
+        skip_end( t );
+      break;
+
+    case HS_RAW:
+    case HS_PRE:
+      if ( c == '<' ) {
+        text_end( t );
+        h->raw_matched = 0;
+        h->state = h->state == HS_RAW ? HS_RAW_LT : HS_PRE_LT;
+      } else if ( h->state == HS_RAW ) {
+        raw_char( h, c );
+      } else {
+        text_char( t, c );
+      }
+      break;
+
+    case HS_RAW_LT:
+    case HS_PRE_LT:
+      if ( tolower( c ) == raw_expect( h ) ) {
+        ++h->raw_matched;
+        if ( raw_expect( h ) == '\0' ) {
+          skip_to_gt(
+            h, h->state == HS_RAW_LT ? SKIP_RAW_END : SKIP_PRE_END
+          );
+        }
+      } else {
+        raw_flush( t );
+        h->state = h->state == HS_RAW_LT ? HS_RAW : HS_PRE;
+        html_step( t, c );
+      }
+      break;
+  } // switch
+}
+
+/**
+ * Ends converting HTML at end of input: emits a final newline and, if any
+ * bookmarks were made, a `<`_marker_`>` line as `html2pdbtxt` does.
+ *
+ * @param t The handle.
+ */
+static void html_end( t2pd_t *t ) {
+  html_t *const h = t->html;
+  if ( h->in_pre ) {
+    if ( h->state == HS_PRE_LT )
+      raw_flush( t );
+    text_end( t );
+    pre_end( h );
+  }
+  else if ( h->state == HS_TEXT ) {
+    text_end( t );
+  }
+  flush_nl( h );
+  body_put( h, '\n' );
+  if ( h->bookmarks ) {
+    put( h, '<' );
+    for ( size_t i = 0; i < h->marker_len; ++i )
+      put( h, h->marker[i] );
+    put( h, '>' );
+    put( h, '\n' );
+  }
+  h->done = true;
+}
+
+/**
+ * Resets the state of converting HTML.
+ *
+ * @param h The HTML state.
+ */
+static void html_reset( html_t *h ) {
+  Byte marker[ DOC_BOOKMARK_NAME_SIZE ];
+  size_t const marker_len = h->marker_len;
+  memcpy( marker, h->marker, marker_len );
+  memset( h, 0, sizeof *h );
+  memcpy( h->marker, marker, marker_len );
+  h->marker_len = marker_len;
+  h->at_line_start = true;
+}
+
+////////// extern functions ///////////////////////////////////////////////////
+
+t2pd_status_t t2pd_html_begin( t2pd_t *t ) {
+  assert( t != NULL );
+
+  if ( t->html == NULL && (t->html = malloc( sizeof *t->html )) == NULL )
+    return t2pd_error( t, T2PD_ERR_NOMEM, "%s\n", STRERROR );
+  html_t *const h = t->html;
+
+  char const *const marker =
+    t->opts.bookmark != NULL && t->opts.bookmark[0] != '\0' ?
+      t->opts.bookmark : T2PD_HTML_BOOKMARK;
+  h->marker_len = palm_from_utf8( marker, h->marker, sizeof h->marker - 1 );
+  if ( h->marker_len == 0 || strpbrk( marker, ">\n" ) != NULL ) {
+    return t2pd_error( t, T2PD_ERR_ARG,
+      "\"%s\": invalid bookmark marker\n", marker
+    );
+  }
+
+  html_reset( h );
+  return T2PD_OK;
+}
+
+int t2pd_html_getc( t2pd_t *t, FILE *fin ) {
+  assert( t != NULL );
+  assert( t->html != NULL );
+  html_t *const h = t->html;
+
+  while ( h->out_pos == h->out_len ) {
+    if ( h->done )
+      return EOF;
+    h->out_len = h->out_pos = 0;
+    int const c = t2pd_read_char( t, fin );
+    if ( c == EOF )
+      html_end( t );
+    else
+      html_step( t, STATIC_CAST( Byte, c ) );
+  } // while
+  return h->out[ h->out_pos++ ];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,444 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      libtxt2pdbdoc.c
+**
+**      Copyright (C) 1998-2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+// local
+#include "pjl_config.h"
+#include "common.h"
+#include "probes.h"
+#include "txt2pdbdoc.h"
+#include "util.h"
+
+// standard
+#include <assert.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+////////// local functions ////////////////////////////////////////////////////
+
+/**
+ * Opens a `FILE` for a duplicate of \a fd so that closing it doesn't close
+ * \a fd.
+ *
+ * @param t The handle.
+ * @param fd The file descriptor.
+ * @param mode The `fdopen`(3) mode.
+ * @param pfile A pointer to receive the `FILE`.
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+static t2pd_status_t fdopen_dup( t2pd_t *t, int fd, char const *mode,
+                                 FILE **pfile ) {
+  int const dup_fd = dup( fd );
+  if ( dup_fd == -1 )
+    return t2pd_error( t, T2PD_ERR_ARG, "%s\n", STRERROR );
+  if ( (*pfile = fdopen( dup_fd, mode )) == NULL ) {
+    close( dup_fd );
+    return t2pd_error( t, T2PD_ERR_NOMEM, "%s\n", STRERROR );
+  }
+  return T2PD_OK;
+}
+
+/**
+ * Reads all of a file descriptor into memory.
+ *
+ * @param t The handle.
+ * @param fd The file descriptor to read from.
+ * @param pbuf A pointer to receive the bytes read that the caller must free.
+ * @param plen A pointer to receive the number of bytes read.
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+static t2pd_status_t read_all( t2pd_t *t, int fd, void **pbuf,
+                               size_t *plen ) {
+  size_t cap = BUFSIZ, len = 0;
+  char *buf = malloc( cap );
+  if ( buf == NULL )
+    return t2pd_error( t, T2PD_ERR_NOMEM, "%s\n", STRERROR );
+
+  for (;;) {
+    if ( len == cap ) {
+      char *const new_buf = realloc( buf, cap *= 2 );
+      if ( new_buf == NULL ) {
+        free( buf );
+        return t2pd_error( t, T2PD_ERR_NOMEM, "%s\n", STRERROR );
+      }
+      buf = new_buf;
+    }
+    ssize_t const n = read( fd, buf + len, cap - len );
+    if ( n == 0 )
+      break;
+    if ( n == -1 ) {
+      if ( errno == EINTR )
+        continue;
+      free( buf );
+      return t2pd_error( t, T2PD_ERR_READ, "%s\n", STRERROR );
+    }
+    len += STATIC_CAST( size_t, n );
+  } // for
+
+  *pbuf = buf;
+  *plen = len;
+  return T2PD_OK;
+}
+
+/**
+ * Writes all of \a buf to a file descriptor.
+ *
+ * @param t The handle.
+ * @param fd The file descriptor to write to.
+ * @param buf The bytes to write.
+ * @param len The number of bytes of \a buf.
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+static t2pd_status_t write_all( t2pd_t *t, int fd, void const *buf,
+                                size_t len ) {
+  for ( char const *p = buf; len > 0; ) {
+    ssize_t const n = write( fd, p, len );
+    if ( n == -1 ) {
+      if ( errno == EINTR )
+        continue;
+      return t2pd_error( t, T2PD_ERR_WRITE, "%s\n", STRERROR );
+    }
+    p += n;
+    len -= STATIC_CAST( size_t, n );
+  } // for
+  return T2PD_OK;
+}
+
+////////// extern functions ///////////////////////////////////////////////////
+
+t2pd_status_t t2pd_buffers_reserve( t2pd_t *t, size_t rec_size ) {
+  assert( t != NULL );
+  if ( rec_size <= t->buf_rec_size )
+    return T2PD_OK;
+
+  Byte *const rec_data = realloc( t->rec_buf.data, rec_size );
+  if ( rec_data == NULL )
+    return t2pd_error( t, T2PD_ERR_NOMEM, "%s\n", STRERROR );
+  t->rec_buf.data = rec_data;
+
+  Byte *const z_data = realloc( t->z_buf.data, T2PD_COMPRESS_BOUND( rec_size ) );
+  if ( z_data == NULL )
+    return t2pd_error( t, T2PD_ERR_NOMEM, "%s\n", STRERROR );
+  t->z_buf.data = z_data;
+
+  t->buf_rec_size = rec_size;
+  return T2PD_OK;
+}
+
+t2pd_status_t t2pd_offsets_reserve( t2pd_t *t, size_t n ) {
+  assert( t != NULL );
+  if ( n <= t->offsets_cap )
+    return T2PD_OK;
+
+  DWord *const offsets = realloc( t->offsets, n * sizeof *offsets );
+  if ( offsets == NULL )
+    return t2pd_error( t, T2PD_ERR_NOMEM, "%s\n", STRERROR );
+  t->offsets = offsets;
+  t->offsets_cap = n;
+  return T2PD_OK;
+}
+
+t2pd_status_t t2pd_decode_fd( t2pd_t *t, int in_fd, int out_fd ) {
+  if ( t == NULL )
+    return T2PD_ERR_ARG;
+
+  // non-seekable input is decoded as it's read
+  if ( lseek( in_fd, 0, SEEK_SET ) == -1 && errno != ESPIPE )
+    return t2pd_error( t, T2PD_ERR_READ, "%s\n", STRERROR );
+
+  t2pd_status_t status;
+  FILE *fin, *fout;
+  if ( (status = fdopen_dup( t, in_fd, "r", &fin )) != T2PD_OK )
+    return status;
+  if ( (status = fdopen_dup( t, out_fd, "w", &fout )) != T2PD_OK ) {
+    fclose( fin );
+    return status;
+  }
+  status = t2pd_decode_file( t, fin, fout );
+  fclose( fin );
+  if ( fclose( fout ) == EOF && status == T2PD_OK )
+    status = t2pd_error( t, T2PD_ERR_WRITE, "%s\n", STRERROR );
+  return status;
+}
+
+t2pd_status_t t2pd_decode_mem( t2pd_t *t, void const *in, size_t in_len,
+                               void **out, size_t *out_len ) {
+  if ( t == NULL || in == NULL || out == NULL || out_len == NULL )
+    return T2PD_ERR_ARG;
+  if ( in_len < DatabaseHdrSize )
+    return t2pd_error( t, T2PD_ERR_CORRUPT, "unexpected end of file\n" );
+
+  FILE *const fin = fmemopen( (void*)in, in_len, "r" );
+  if ( fin == NULL )
+    return t2pd_error( t, T2PD_ERR_NOMEM, "%s\n", STRERROR );
+  char *out_buf = NULL;
+  FILE *const fout = open_memstream( &out_buf, out_len );
+  if ( fout == NULL ) {
+    fclose( fin );
+    return t2pd_error( t, T2PD_ERR_NOMEM, "%s\n", STRERROR );
+  }
+
+  t2pd_status_t status = t2pd_decode_file( t, fin, fout );
+  fclose( fin );
+  if ( fclose( fout ) == EOF && status == T2PD_OK )
+    status = t2pd_error( t, T2PD_ERR_NOMEM, "%s\n", STRERROR );
+  if ( status == T2PD_OK )
+    *out = out_buf;
+  else
+    free( out_buf );
+  return status;
+}
+
+void t2pd_diag( t2pd_t const *t, t2pd_diag_t kind, char const *format,
+                ... ) {
+  assert( t != NULL );
+  assert( format != NULL );
+
+  bool const probe_warning = T2PD_PROBES && kind == T2PD_DIAG_WARNING;
+  if ( t->opts.diag_fn == NULL && !probe_warning )
+    return;
+  char msg[ 256 ];
+  va_list args;
+  va_start( args, format );
+  vsnprintf( msg, sizeof msg, format, args );
+  va_end( args );
+  if ( probe_warning )
+    T2PD_PROBE1( warning, msg );
+  if ( t->opts.diag_fn != NULL )
+    (*t->opts.diag_fn)( t->opts.diag_data, kind, msg );
+}
+
+t2pd_status_t t2pd_doc_error( t2pd_t *t, doc_status_t status,
+                              doc_layout_t const *dl ) {
+  assert( dl != NULL );
+  switch ( status ) {
+    case DOC_ERR_NOT_DOC:
+      return t2pd_error( t, T2PD_ERR_NOT_DOC, "%s\n", doc_strerror( status ) );
+    case DOC_ERR_COMPRESSION:
+      return t2pd_error( t, T2PD_ERR_COMPRESSION,
+        "%u: %s\n", dl->compression, doc_strerror( status )
+      );
+    default:
+      return t2pd_error( t, T2PD_ERR_CORRUPT, "%s\n", doc_strerror( status ) );
+  } // switch
+}
+
+t2pd_status_t t2pd_encode_fd( t2pd_t *t, char const *doc_name, int in_fd,
+                              int out_fd ) {
+  if ( t == NULL || doc_name == NULL )
+    return T2PD_ERR_ARG;
+
+  t2pd_status_t status;
+  struct stat sbuf;
+
+  if ( fstat( in_fd, &sbuf ) == -1 )
+    return t2pd_error( t, T2PD_ERR_READ, "%s\n", STRERROR );
+
+  if ( !S_ISREG( sbuf.st_mode ) ) {
+    //
+    // Encoding needs to know the input size in advance, so read non-regular
+    // input into memory first.
+    //
+    void *in = NULL;
+    size_t in_len = 0;
+    if ( (status = read_all( t, in_fd, &in, &in_len )) != T2PD_OK )
+      return status;
+    void *out;
+    size_t out_len;
+    status = t2pd_encode_mem( t, doc_name, in, in_len, &out, &out_len );
+    free( in );
+    if ( status == T2PD_OK ) {
+      status = write_all( t, out_fd, out, out_len );
+      free( out );
+    }
+    return status;
+  }
+
+  FILE *fin;
+  if ( (status = fdopen_dup( t, in_fd, "r", &fin )) != T2PD_OK )
+    return status;
+
+  //
+  // Encoding also needs to seek within its output, so write to memory first
+  // if the output isn't seekable from its start.
+  //
+  bool const out_is_seekable = lseek( out_fd, 0, SEEK_CUR ) == 0;
+  char *out_buf = NULL;
+  size_t out_len;
+  FILE *fout;
+  if ( out_is_seekable )
+    status = fdopen_dup( t, out_fd, "w", &fout );
+  else if ( (fout = open_memstream( &out_buf, &out_len )) == NULL )
+    status = t2pd_error( t, T2PD_ERR_NOMEM, "%s\n", STRERROR );
+  if ( status != T2PD_OK ) {
+    fclose( fin );
+    return status;
+  }
+
+  status = t2pd_encode(
+    t, doc_name, fin, STATIC_CAST( uint64_t, sbuf.st_size ), fout
+  );
+  fclose( fin );
+  if ( fclose( fout ) == EOF && status == T2PD_OK )
+    status = t2pd_error( t, T2PD_ERR_WRITE, "%s\n", STRERROR );
+  if ( !out_is_seekable ) {
+    if ( status == T2PD_OK )
+      status = write_all( t, out_fd, out_buf, out_len );
+    free( out_buf );
+  }
+  return status;
+}
+
+t2pd_status_t t2pd_encode_mem( t2pd_t *t, char const *doc_name,
+                               void const *in, size_t in_len,
+                               void **out, size_t *out_len ) {
+  if ( t == NULL || doc_name == NULL || (in == NULL && in_len > 0) ||
+       out == NULL || out_len == NULL ) {
+    return T2PD_ERR_ARG;
+  }
+
+  //
+  // Some implementations of fmemopen(3) reject zero-length buffers, but
+  // t2pd_encode() never reads from an empty input anyway.
+  //
+  static char const EMPTY[1];
+  FILE *const fin = in_len > 0 ?
+    fmemopen( (void*)in, in_len, "r" ) :
+    fmemopen( (void*)EMPTY, sizeof EMPTY, "r" );
+  if ( fin == NULL )
+    return t2pd_error( t, T2PD_ERR_NOMEM, "%s\n", STRERROR );
+  char *out_buf = NULL;
+  FILE *const fout = open_memstream( &out_buf, out_len );
+  if ( fout == NULL ) {
+    fclose( fin );
+    return t2pd_error( t, T2PD_ERR_NOMEM, "%s\n", STRERROR );
+  }
+
+  t2pd_status_t status = t2pd_encode(
+    t, doc_name, fin, STATIC_CAST( uint64_t, in_len ), fout
+  );
+  fclose( fin );
+  if ( fclose( fout ) == EOF && status == T2PD_OK )
+    status = t2pd_error( t, T2PD_ERR_NOMEM, "%s\n", STRERROR );
+  if ( status == T2PD_OK )
+    *out = out_buf;
+  else
+    free( out_buf );
+  return status;
+}
+
+t2pd_status_t t2pd_error( t2pd_t *t, t2pd_status_t status,
+                          char const *format, ... ) {
+  assert( t != NULL );
+  assert( format != NULL );
+
+  va_list args;
+  va_start( args, format );
+  vsnprintf( t->errmsg, sizeof t->errmsg, format, args );
+  va_end( args );
+
+  // strip the trailing newline
+  size_t const len = strlen( t->errmsg );
+  if ( len > 0 && t->errmsg[ len - 1 ] == '\n' )
+    t->errmsg[ len - 1 ] = '\0';
+  return status;
+}
+
+char const* t2pd_errmsg( t2pd_t const *t ) {
+  return t != NULL ? t->errmsg : "";
+}
+
+void t2pd_free( t2pd_t *t ) {
+  if ( t == NULL )
+    return;
+  free( t->rec_buf.data );
+  free( t->z_buf.data );
+  free( t->bm.list );
+  free( t->html );
+  free( t->offsets );
+  if ( t->vol_spool != NULL )
+    fclose( t->vol_spool );
+  t2pd_render_free( t->render );
+  free( t );
+}
+
+t2pd_t* t2pd_new( t2pd_options_t const *opts ) {
+  t2pd_t *const t = calloc( 1, sizeof *t );
+  if ( t == NULL )
+    return NULL;
+  if ( opts != NULL )
+    t->opts = *opts;
+  else
+    t2pd_options_init( &t->opts );
+
+  if ( t2pd_buffers_reserve( t, RECORD_SIZE_MAX ) != T2PD_OK ) {
+    t2pd_free( t );
+    return NULL;
+  }
+  return t;
+}
+
+void t2pd_options_init( t2pd_options_t *opts ) {
+  assert( opts != NULL );
+  memset( opts, 0, sizeof *opts );
+  opts->binary = true;
+  opts->compress = true;
+}
+
+t2pd_status_t t2pd_read_error( t2pd_t *t, FILE *file ) {
+  assert( file != NULL );
+  if ( ferror( file ) )
+    return t2pd_error( t, T2PD_ERR_READ, "%s\n", STRERROR );
+  return t2pd_error( t, T2PD_ERR_CORRUPT, "unexpected end of file\n" );
+}
+
+void t2pd_set_options( t2pd_t *t, t2pd_options_t const *opts ) {
+  assert( t != NULL );
+  if ( opts != NULL )
+    t->opts = *opts;
+  else
+    t2pd_options_init( &t->opts );
+}
+
+char const* t2pd_strerror( t2pd_status_t status ) {
+  switch ( status ) {
+    case T2PD_OK             : return "success";
+    case T2PD_ERR_ARG        : return "invalid argument";
+    case T2PD_ERR_NOMEM      : return "out of memory";
+    case T2PD_ERR_READ       : return "read error";
+    case T2PD_ERR_WRITE      : return "write error";
+    case T2PD_ERR_NOT_DOC    : return "not a Doc file";
+    case T2PD_ERR_COMPRESSION: return "unknown file compression type";
+    case T2PD_ERR_CORRUPT    : return "malformed Doc file";
+    case T2PD_ERR_VERIFY     : return "round-trip verification failed";
+  } // switch
+  return "unknown error";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* vim:set et sw=2 ts=2: */
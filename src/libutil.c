@@ -0,0 +1,77 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      libutil.c
+**
+**      Copyright (C) 1998-2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+** 
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+** 
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/**
+ * @file
+ * Utility functions used by libtxt2pdbdoc.  Unlike those in util.c, none of
+ * these ever exit.
+ */
+
+// local
+#include "pjl_config.h"
+#include "util.h"
+
+// standard
+#include <assert.h>
+#include <ctype.h>
+#include <string.h>
+
+////////// extern functions ///////////////////////////////////////////////////
+
+uint8_t const* mem_find( uint8_t const *m, size_t m_len, uint8_t const *b,
+                         size_t b_len ) {
+  assert( m != NULL );
+  assert( b != NULL );
+
+  for ( size_t i = m_len - b_len + 1; i > 0; --i, ++m )
+    if ( *m == *b && memcmp( m, b, b_len ) == 0 )
+      return m;
+  return NULL;
+}
+
+char const* printable_char( char c, char buf[ PRINTABLE_CHAR_SIZE ] ) {
+  assert( buf != NULL );
+
+  switch( c ) {
+    case '\0': return "\\0";
+    case '\a': return "\\a";
+    case '\b': return "\\b";
+    case '\f': return "\\f";
+    case '\n': return "\\n";
+    case '\r': return "\\r";
+    case '\t': return "\\t";
+    case '\v': return "\\v";
+  } // switch
+
+  if ( isprint( c ) ) {
+    buf[0] = c;
+    buf[1] = '\0';
+  }
+  else {
+    snprintf(
+      buf, PRINTABLE_CHAR_SIZE, "\\x%02X", STATIC_CAST( unsigned char, c )
+    );
+  }
+  return buf;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* vim:set et sw=2 ts=2: */
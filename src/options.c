@@ -23,11 +23,14 @@
 #include "pjl_config.h"
 #include "common.h"
 #include "options.h"
+#include "unicode.h"
 #include "util.h"
 
 // standard
 #include <assert.h>
 #include <stdbool.h>
+#include <stdlib.h>                     /* for free() */
+#include <string.h>
 #include <sysexits.h>
 
 ////////// extern declarations ////////////////////////////////////////////////
@@ -56,6 +59,31 @@ void check_required( char const *opts, char const *req_opts ) {
   } // for
 }
 
+char32_t parse_codepoint( char const *s ) {
+  assert( s != NULL );
+
+  if ( s[0] != '\0' && s[1] == '\0' )   // assume single-char ASCII
+    return STATIC_CAST( char32_t, s[0] );
+
+  char const *const s0 = s;
+  char *t = NULL;
+
+  if ( (s[0] == 'U' || s[0] == 'u') && s[1] == '+' ) {
+    // convert [uU]+NNNN to 0xNNNN so strtoull() will grok it
+    t = check_strdup( s );
+    s = memcpy( t, "0x", 2 );
+  }
+  uint64_t const cp = parse_ull( s );
+  free( t );
+
+  if ( cp_is_valid( cp ) )
+    return STATIC_CAST( char32_t, cp );
+  PMESSAGE_EXIT( EX_USAGE,
+    "\"%s\": invalid Unicode code-point for -%c\n",
+    s0, 'U'
+  );
+}
+
 void check_mutually_exclusive( char const *opts1, char const *opts2 ) {
   assert( opts1 != NULL );
   assert( opts2 != NULL );
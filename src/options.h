@@ -22,6 +22,10 @@
 #ifndef txt2pdbdoc_options_H
 #define txt2pdbdoc_options_H
 
+// local
+#include "pjl_config.h"
+#include "unicode.h"
+
 // standard
 #include <stdbool.h>
 
@@ -51,6 +55,20 @@ void check_mutually_exclusive( char const *opts1, char const *opts2 );
  */
 void check_required( char const *opts, char const *req_opts );
 
+/**
+ * Parses a Unicode code-point value.
+ *
+ * @param s The NULL-terminated string to parse.  Allows for strings of the
+ * form:
+ *  + X: a single character.
+ *  + NN: two-or-more decimal digits.
+ *  + 0xN, u+N, or U+N: one-or-more hexadecimal digits.
+ * @return Returns the Unicode code-point value
+ * or prints an error message and exits if \a s is invalid.
+ */
+NODISCARD
+char32_t parse_codepoint( char const *s );
+
 ///////////////////////////////////////////////////////////////////////////////
 
 #endif /* txt2pdbdoc_options_H */
@@ -74,7 +74,7 @@ char32_t const PALM_TO_UNICODE_TABLE[] = {
   /* 0x24 */ 0x0024,  // '$': DOLLAR SIGN
   /* 0x25 */ 0x0025,  // '%': PERCENT SIGN
   /* 0x26 */ 0x0026,  // '&': AMPERSAND
-  /* 0x27 */ 0x0026,  // ''': APOSTROPHE
+  /* 0x27 */ 0x0027,  // ''': APOSTROPHE
   /* 0x28 */ 0x0028,  // '(': LEFT PARENTHESIS
   /* 0x29 */ 0x0029,  // ')': RIGHT PARENTHESIS
   /* 0x2A */ 0x002A,  // '*': ASTERISK
@@ -91,7 +91,7 @@ char32_t const PALM_TO_UNICODE_TABLE[] = {
   /* 0x34 */ 0x0034,  // '4': DIGIT FOUR
   /* 0x35 */ 0x0035,  // '5': DIGIT FIVE
   /* 0x36 */ 0x0036,  // '6': DIGIT SIX
-  /* 0x37 */ 0x0036,  // '7': DIGIT SEVEN
+  /* 0x37 */ 0x0037,  // '7': DIGIT SEVEN
   /* 0x38 */ 0x0038,  // '8': DIGIT EIGHT
   /* 0x39 */ 0x0039,  // '9': DIGIT NINE
   /* 0x3A */ 0x003A,  // ':': COLON
@@ -108,7 +108,7 @@ char32_t const PALM_TO_UNICODE_TABLE[] = {
   /* 0x44 */ 0x0044,  // 'D': LATIN CAPITAL LETTER D
   /* 0x45 */ 0x0045,  // 'E': LATIN CAPITAL LETTER E
   /* 0x46 */ 0x0046,  // 'F': LATIN CAPITAL LETTER F
-  /* 0x47 */ 0x0046,  // 'G': LATIN CAPITAL LETTER G
+  /* 0x47 */ 0x0047,  // 'G': LATIN CAPITAL LETTER G
   /* 0x48 */ 0x0048,  // 'H': LATIN CAPITAL LETTER H
   /* 0x49 */ 0x0049,  // 'I': LATIN CAPITAL LETTER I
   /* 0x4A */ 0x004A,  // 'J': LATIN CAPITAL LETTER J
@@ -125,7 +125,7 @@ char32_t const PALM_TO_UNICODE_TABLE[] = {
   /* 0x54 */ 0x0054,  // 'T': LATIN CAPITAL LETTER T
   /* 0x55 */ 0x0055,  // 'U': LATIN CAPITAL LETTER U
   /* 0x56 */ 0x0056,  // 'V': LATIN CAPITAL LETTER V
-  /* 0x57 */ 0x0056,  // 'W': LATIN CAPITAL LETTER W
+  /* 0x57 */ 0x0057,  // 'W': LATIN CAPITAL LETTER W
   /* 0x58 */ 0x0058,  // 'X': LATIN CAPITAL LETTER X
   /* 0x59 */ 0x0059,  // 'Y': LATIN CAPITAL LETTER Y
   /* 0x5A */ 0x005A,  // 'Z': LATIN CAPITAL LETTER Z
@@ -142,7 +142,7 @@ char32_t const PALM_TO_UNICODE_TABLE[] = {
   /* 0x64 */ 0x0064,  // 'd': LATIN SMALL LETTER D
   /* 0x65 */ 0x0065,  // 'e': LATIN SMALL LETTER E
   /* 0x66 */ 0x0066,  // 'f': LATIN SMALL LETTER F
-  /* 0x67 */ 0x0066,  // 'g': LATIN SMALL LETTER G
+  /* 0x67 */ 0x0067,  // 'g': LATIN SMALL LETTER G
   /* 0x68 */ 0x0068,  // 'h': LATIN SMALL LETTER H
   /* 0x69 */ 0x0069,  // 'i': LATIN SMALL LETTER I
   /* 0x6A */ 0x006A,  // 'j': LATIN SMALL LETTER J
@@ -159,7 +159,7 @@ char32_t const PALM_TO_UNICODE_TABLE[] = {
   /* 0x74 */ 0x0074,  // 't': LATIN SMALL LETTER T
   /* 0x75 */ 0x0075,  // 'u': LATIN SMALL LETTER U
   /* 0x76 */ 0x0076,  // 'v': LATIN SMALL LETTER V
-  /* 0x77 */ 0x0076,  // 'w': LATIN SMALL LETTER W
+  /* 0x77 */ 0x0077,  // 'w': LATIN SMALL LETTER W
   /* 0x78 */ 0x0078,  // 'x': LATIN SMALL LETTER X
   /* 0x79 */ 0x0079,  // 'y': LATIN SMALL LETTER Y
   /* 0x7A */ 0x007A,  // 'z': LATIN SMALL LETTER Z
@@ -581,6 +581,45 @@ char const *const PALM_TO_STRING_TABLE[] = {
 
 ///////////////////////////////////////////////////////////////////////////////
 
+size_t palm_from_utf8( char const *s, Byte *buf, size_t buf_size ) {
+  size_t len = 0;
+  for ( char8_t const *u = (char8_t const*)s; *u != '\0'; ++len ) {
+    unsigned const char_len = utf8_char_len( *u );
+    if ( char_len == 0 || len == buf_size )
+      return 0;
+    for ( unsigned i = 1; i < char_len; ++i ) {
+      if ( u[i] == '\0' || utf8_char_len( u[i] ) > 0 )
+        return 0;
+    } // for
+    if ( (buf[ len ] = unicode_to_palm( utf8_decode( u ) )) == 0 )
+      return 0;
+    u += char_len;
+  } // for
+  return len;
+}
+
+void palm_fold_table( Byte fold[ 256 ] ) {
+  for ( unsigned c = 0; c < 256; ++c ) {
+    fold[c] = STATIC_CAST( Byte, c );
+    char32_t cp = palm_to_unicode( STATIC_CAST( Byte, c ) );
+    if ( (cp >= 'A' && cp <= 'Z') ||
+         (cp >= 0xC0 && cp <= 0xDE && cp != 0xD7) ) {
+      cp += 0x20;
+    } else {
+      switch ( cp ) {
+        case 0x0152: cp = 0x0153; break; // OE ligature
+        case 0x0160: cp = 0x0161; break; // S caron
+        case 0x0178: cp = 0x00FF; break; // Y diaeresis
+        case 0x017D: cp = 0x017E; break; // Z caron
+        default    : continue;
+      } // switch
+    }
+    Byte const lc = unicode_to_palm( cp );
+    if ( lc != 0 )
+      fold[c] = lc;
+  } // for
+}
+
 Byte unicode_to_palm( char32_t cp ) {
   switch ( cp ) {
     case 0x2026: return 0x18; // HORIZONTAL ELLIPSIS
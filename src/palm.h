@@ -28,6 +28,7 @@
 #include "util.h"
 
 // standard
+#include <stddef.h>                     /* for size_t */
 #include <stdint.h>
 #ifdef HAVE_TIME_H
 #include <time.h>                       /* for time() */
@@ -144,6 +145,28 @@ char32_t palm_to_unicode( Byte c ) {
   return PALM_TO_UNICODE_TABLE[ c ];
 }
 
+/**
+ * Fills a table that maps every PalmOS character having a lower-case
+ * equivalent to it and every other character to itself.
+ *
+ * @param fold The table to fill.
+ */
+void palm_fold_table( Byte fold[ 256 ] );
+
+/**
+ * Transcodes a null-terminated UTF-8 string into PalmOS characters.
+ *
+ * @param s The string to transcode.
+ * @param buf The buffer to receive the PalmOS characters.  It is not
+ * null-terminated.
+ * @param buf_size The size of \a buf.
+ * @return Returns the number of PalmOS characters or 0 if \a s either is
+ * empty, is invalid UTF-8, contains a character that can not be mapped into a
+ * PalmOS character, or needs more than \a buf_size of them.
+ */
+NODISCARD
+size_t palm_from_utf8( char const *s, Byte *buf, size_t buf_size );
+
 /**
  * Maps a Unicode codepoint into its corresponding PalmOS character.
  *
@@ -22,23 +22,61 @@
 // local
 #include "pjl_config.h"
 #include "common.h"
+#include "doc.h"
 #include "options.h"
 #include "palm.h"
+#include "token.h"
 #include "util.h"
 
 // standard
 #include <ctype.h>
 #include <sys/types.h>
 #include <arpa/inet.h>                  /* for ntohs(), ntohl() */
+#include <fcntl.h>                      /* for open() */
+#include <getopt.h>
+#include <limits.h>                     /* for UINT_MAX */
+#include <stdarg.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>                   /* for mmap() */
+#include <sys/stat.h>
 #include <sysexits.h>
-#include <unistd.h>                     /* for getopt() */
+#include <unistd.h>                     /* for read() */
 
-#define BUF_SIZE  4096
-#define ROW_SIZE  16                    /* bytes per dump row */
+#define CHUNK_SIZE    (3 * 16 * 1024)   /* multiple of ROW_SIZE and 3 */
+#define OUT_BUF_SIZE  (64 * 1024)       /* output buffer size */
+#define ROW_SIZE      16                /* bytes per dump row */
+#define ROW_LEN_MAX   80                /* max chars per formatted row */
+
+/**
+ * Compression and token statistics of one or more text records.
+ */
+struct rec_stats {
+  size_t  stored;                       ///< Bytes as stored.
+  size_t  expanded;                     ///< Bytes when uncompressed.
+  size_t  literals;                     ///< Literal bytes.
+  size_t  escapes;                      ///< Escape runs...
+  size_t  escaped;                      ///< ...and the bytes therein.
+  size_t  space_chars;                  ///< Space + character pairs.
+  size_t  backrefs;                     ///< Back-references...
+  size_t  backref_bytes;                ///< ...and the bytes they expand to.
+};
+typedef struct rec_stats rec_stats_t;
+
+/**
+ * Information about a Doc file.
+ */
+struct doc_info {
+  uint8_t const  *rec_list;             ///< The record list.
+  Word            num_pdb_records;      ///< Number of PDB records.
+  Word            num_records;          ///< Number of text records.
+  bool            compressed;           ///< Are text records compressed?
+  unsigned        first;                ///< First selected text record.
+  unsigned        last;                 ///< Last selected text record.
+};
+typedef struct doc_info doc_info_t;
 
 ////////// extern variables ///////////////////////////////////////////////////
 
@@ -46,33 +84,103 @@ char const  *me;
 
 ////////// local variables ////////////////////////////////////////////////////
 
-static FILE  *fin;                      // file to read from
-static FILE  *fout;                     // file to write to
+static FILE          *fout;             // file to write to
+static uint8_t const *pdb;              // contents of the PDB file, if mapped
+static size_t         pdb_size;         // size of the PDB file, if mapped
+static int            pdb_fd = -1;      // PDB file to stream, if not mapped
+static size_t         pdb_pos;          // current position within pdb_fd
+static uint8_t       *pdb_head;         // header & record list, if not mapped
+static uint8_t       *rec_buf;          // record, if not mapped...
+static size_t         rec_buf_cap;      // ...and its capacity
+static uint8_t       *text_buf;         // expanded text of a record...
+static size_t         text_buf_cap;     // ...and its capacity
 
-static bool   opt_header_only = false;
 static bool   opt_data_only = false;
+static bool   opt_header_only = false;
+static bool   opt_json = false;
+static bool   opt_payload = false;
+static bool   opt_stats = false;
+static bool   opt_tokens = false;
+static bool   opt_list = false;
+
+static unsigned rec_first = 0;          // first record to dump
+static unsigned rec_last = UINT_MAX;    // last record to dump
+
+static char   out_buf[ OUT_BUF_SIZE ];  // buffered output...
+static size_t out_len;                  // ...and its length
+
+static char   hex_pair[ 256 ][ 2 ];     // byte -> 2 hex digits
+static char   ascii_char[ 256 ];        // byte -> itself if printable or '.'
 
 ////////// local functions ////////////////////////////////////////////////////
 
-static void clean_up( void );
-static void dump_pdb_header( DatabaseHdrType const* );
-static void dump_rec_header( Word, RecordEntryType const* );
-static void dump_row( DWord, uint8_t const*, DWord );
-static void process_options( int, char*[] );
-static void usage( void );
+static void     clean_up( void );
+static void     dump_pdb_header( DatabaseHdrType const* );
+static void     dump_rec_header( Word, RecordEntryType const* );
+static void     dump_rec_entry( Word, uint8_t const*, size_t, size_t );
+static void     dump_rec_json( uint8_t const*, size_t, size_t, bool );
+static void     dump_rec_rows( size_t, size_t );
+static void     doc_read_info( DatabaseHdrType const*, doc_info_t* );
+static size_t   doc_record( doc_info_t const*, Word, uint8_t const** );
+static void     dump_row( DWord, uint8_t const*, DWord );
+static void     dump_stats( DatabaseHdrType const* );
+static void     dump_tokens( DatabaseHdrType const* );
+static void     init_tables( void );
+static void     json_pdb_header( DatabaseHdrType const* );
+static void     json_string( char const*, size_t );
+static void     open_pdb( char const* );
+static void     out_base64( uint8_t const*, size_t );
+static void     out_flush( void );
+static void     out_printf( char const*, ... );
+static void     out_quoted( uint8_t const*, size_t );
+static void     parse_rec_range( char const* );
+static size_t   pdb_chunk( size_t, size_t, uint8_t const** );
+static uint8_t const* pdb_read_head( size_t );
+static size_t   pdb_record( size_t, size_t, uint8_t const** );
+static void     process_options( int, char*[] );
+static size_t   rec_end( uint8_t const*, Word, Word );
+static size_t   rec_size( size_t, size_t );
+static void     stats_add( rec_stats_t*, rec_stats_t const* );
+static void     stats_print( char const*, rec_stats_t const*, char const* );
+static void     usage( void );
 
 ////////// main ///////////////////////////////////////////////////////////////
 
 int main( int argc, char *argv[] ) {
   atexit( clean_up );
   process_options( argc, argv );
+  init_tables();
 
   ////////// read PDB header //////////////////////////////////////////////////
 
   DatabaseHdrType hdr;
-  FREAD( &hdr, DatabaseHdrSize, 1, fin );
+  memcpy( &hdr, pdb_read_head( DatabaseHdrSize ), DatabaseHdrSize );
+
+  if ( opts_given['r'] && rec_first >= ntohs( hdr.recordList.numRecords ) ) {
+    PMESSAGE_EXIT( EX_USAGE,
+      "record %u out of range; file has %u records\n",
+      rec_first, ntohs( hdr.recordList.numRecords )
+    );
+  }
 
-  if ( !opt_data_only ) {
+  if ( opt_stats ) {
+    dump_stats( &hdr );
+    exit( EXIT_SUCCESS );
+  }
+  if ( opt_tokens ) {
+    dump_tokens( &hdr );
+    exit( EXIT_SUCCESS );
+  }
+
+  if ( opt_json ) {
+    json_pdb_header( &hdr );
+    if ( opt_header_only ) {
+      out_printf( "\n}\n" );
+      exit( EXIT_SUCCESS );
+    }
+    out_printf( ",\n  \"records\": [" );
+  }
+  else if ( !opt_data_only ) {
     dump_pdb_header( &hdr );
     if ( opt_header_only )
       exit( EXIT_SUCCESS );
@@ -81,67 +189,123 @@ int main( int argc, char *argv[] ) {
   ////////// read records /////////////////////////////////////////////////////
 
   Word const num_records = ntohs( hdr.recordList.numRecords );
-  for ( Word rec_num = 0; rec_num < num_records; ++rec_num ) {
+  uint8_t const *const rec_list =
+    pdb_read_head( DatabaseHdrSize + RecordEntrySize * (size_t)num_records )
+    + DatabaseHdrSize;
+
+  // Only the record list is needed to find the selected records, so records
+  // before the first are skipped without being read when mapped.
+  unsigned const end_rec = rec_last < num_records ? rec_last + 1 : num_records;
+
+  if ( opt_list ) {
+    out_printf(
+      "===================================================================\n"
+      "%5s %8s %8s  %s\n",
+      "Rec", "Offset", "Size", "Attributes"
+    );
+  }
+
+  for ( unsigned rec_num = rec_first; rec_num < end_rec; ++rec_num ) {
 
     // read record
+    uint8_t const *const entry = rec_list + RecordEntrySize * rec_num;
     RecordEntryType rec;
-    SEEK_REC( fin, rec_num );
-    FREAD( &rec, RecordEntrySize, 1, fin );
+    memcpy( &rec, entry, RecordEntrySize );
 
-    if ( !opt_data_only ) {
-      dump_rec_header( rec_num, &rec );
-      if ( opt_header_only )
-        exit( EXIT_SUCCESS );
-    }
+    size_t const offset = ntohl( rec.offset );
+    size_t const end = rec_end( rec_list, num_records, STATIC_CAST( Word, rec_num ) );
 
-    // get offset to record payload
-    DWord offset = ntohl( rec.offset ), next_offset;
-    if ( rec_num < num_records - 1 ) {
-      SEEK_REC( fin, rec_num + 1 );
-      FREAD( &rec, RecordEntrySize, 1, fin );
-      next_offset = ntohl( rec.offset );
-    } else {
-      FSEEK( fin, 0, SEEK_END );
-      next_offset = STATIC_CAST( DWord, ftell( fin ) );
+    if ( opt_list )
+      dump_rec_entry( STATIC_CAST( Word, rec_num ), entry, offset, end );
+    else if ( opt_json )
+      dump_rec_json( entry, offset, end, rec_num == rec_first );
+    else {
+      if ( !opt_data_only )
+        dump_rec_header( STATIC_CAST( Word, rec_num ), &rec );
+      dump_rec_rows( offset, end );
     }
-
-    // read record payload
-    FSEEK( fin, offset, SEEK_SET );
-    uint8_t buf[ BUF_SIZE ];
-    FREAD( buf, 1, next_offset - offset + 1, fin );
-    uint8_t const *pbuf = buf;
-
-    while ( offset < next_offset ) {
-      DWord row_len = next_offset - offset;
-      if ( row_len > ROW_SIZE )
-        row_len = ROW_SIZE;
-      dump_row( offset, pbuf, row_len );
-      offset += ROW_SIZE;
-      pbuf += ROW_SIZE;
-    } // while
   } // for
 
+  if ( opt_json )
+    out_printf( "%s]\n}\n", rec_first < end_rec ? "\n  " : "" );
+
   exit( EXIT_SUCCESS );
 }
 
 ////////// miscellaneous functions ////////////////////////////////////////////
 
 static void clean_up( void ) {
-  if ( fin != NULL )
-    fclose( fin );
-  if ( fout != NULL )
+  if ( fout != NULL ) {
+    out_flush();
     fclose( fout );
+  }
+  if ( pdb != NULL )
+    munmap( (void*)pdb, pdb_size );
+  if ( pdb_fd != -1 )
+    close( pdb_fd );
+  free( pdb_head );
+  free( rec_buf );
+  free( text_buf );
+}
+
+/**
+ * Reads the record list and record 0 of a Doc file.  If it's not a Doc file,
+ * prints an error message and exits.
+ *
+ * @param hdr The PDB header.
+ * @param doc The doc_info to fill in.
+ */
+static void doc_read_info( DatabaseHdrType const *hdr, doc_info_t *doc ) {
+  doc_layout_t dl;
+  doc_status_t status = doc_parse_header( hdr, /*check_doc=*/true, &dl );
+  if ( status == DOC_OK ) {
+    doc->num_pdb_records = STATIC_CAST( Word, dl.num_pdb_records );
+    doc->rec_list = pdb_read_head(
+      DatabaseHdrSize + RecordEntrySize * (size_t)doc->num_pdb_records
+    ) + DatabaseHdrSize;
+    uint8_t const *rec;
+    size_t const rec_len = doc_record( doc, 0, &rec );
+    status = doc_parse_record0( rec, rec_len, &dl );
+  }
+  if ( status == DOC_ERR_COMPRESSION ) {
+    PMESSAGE_EXIT( EX_DATAERR,
+      "%u: %s\n", dl.compression, doc_strerror( status )
+    );
+  }
+  if ( status != DOC_OK )
+    PMESSAGE_EXIT( EX_DATAERR, "%s\n", doc_strerror( status ) );
+  doc->compressed = dl.compression == DOC_COMPRESSED;
+  doc->num_records = STATIC_CAST( Word, dl.num_records );
+
+  doc->first = rec_first > 1 ? rec_first : 1;
+  doc->last = rec_last < doc->num_records ? rec_last : doc->num_records;
+}
+
+/**
+ * Gets a whole record of a Doc file.
+ *
+ * @param doc The doc_info.
+ * @param rec_num The record number.
+ * @param prec A pointer to receive a pointer to the record.
+ * @return Returns the size of the record.
+ */
+static size_t doc_record( doc_info_t const *doc, Word rec_num,
+                          uint8_t const **prec ) {
+  return pdb_record(
+    doc_rec_offset( doc->rec_list, rec_num ),
+    rec_end( doc->rec_list, doc->num_pdb_records, rec_num ), prec
+  );
 }
 
 static void dump_pdb_header( DatabaseHdrType const *hdr ) {
-  FPRINTF( fout,
-    "   Name: %s\n"
+  out_printf(
+    "   Name: %.*s\n"
     "Version: %d\n"
     "   Type: %c%c%c%c\n"
     "Creator: %c%c%c%c\n"
     "Records: %d\n",
 
-    hdr->name,
+    STATIC_CAST( int, sizeof hdr->name ), hdr->name,
     ntohs( hdr->version ),
     hdr->type[0], hdr->type[1], hdr->type[2], hdr->type[3],
     hdr->creator[0], hdr->creator[1], hdr->creator[2], hdr->creator[3],
@@ -149,8 +313,31 @@ static void dump_pdb_header( DatabaseHdrType const *hdr ) {
   );
 }
 
+/**
+ * Dumps a record entry as a single line of the record table.
+ *
+ * @param rec_num The record number.
+ * @param entry The raw record entry.
+ * @param offset The file offset of the record's payload.
+ * @param end The file offset just past the record's payload or `SIZE_MAX` for
+ * the end of file.
+ */
+static void dump_rec_entry( Word rec_num, uint8_t const *entry,
+                            size_t offset, size_t end ) {
+  RecordEntryType rec;
+  memcpy( &rec, entry, RecordEntrySize );
+  out_printf(
+    "%5u %08zX %8zu  [%c] Delete [%c] Dirty [%c] Busy [%c] Secret\n",
+    rec_num, offset, rec_size( offset, end ),
+    rec.attributes.delete ? 'X' : ' ',
+    rec.attributes.dirty  ? 'X' : ' ',
+    rec.attributes.busy   ? 'X' : ' ',
+    rec.attributes.secret ? 'X' : ' '
+  );
+}
+
 static void dump_rec_header( Word rec_num, RecordEntryType const *rec ) {
-  FPRINTF( fout,
+  out_printf(
     "===================================================================\n"
     "Rec %4d: [%c] Delete [%c] Dirty [%c] Busy [%c] Secret\n"
     "-------------------------------------------------------------------\n",
@@ -162,43 +349,651 @@ static void dump_rec_header( Word rec_num, RecordEntryType const *rec ) {
   );
 }
 
+/**
+ * Dumps a record as a JSON object.
+ *
+ * @param entry The raw record entry.
+ * @param offset The file offset of the record's payload.
+ * @param end The file offset just past the record's payload or `SIZE_MAX` for
+ * the end of file.
+ * @param is_first If `true`, this is the first record dumped.
+ */
+static void dump_rec_json( uint8_t const *entry, size_t offset, size_t end,
+                           bool is_first ) {
+  // use the raw bytes since the order of bit-fields is compiler-dependent
+  out_printf(
+    "%s\n    { \"offset\": %zu, \"attributes\": %u, \"unique_id\": %u",
+    is_first ? "" : ",", offset, entry[4],
+    STATIC_CAST( unsigned, entry[5] << 16 | entry[6] << 8 | entry[7] )
+  );
+
+  size_t size = 0;
+  if ( opt_payload )
+    out_printf( ", \"data\": \"" );
+  for ( uint8_t const *chunk;; ) {
+    size_t const n = pdb_chunk( offset + size, end, &chunk );
+    if ( n == 0 )
+      break;
+    if ( opt_payload )
+      out_base64( chunk, n );
+    size += n;
+  } // for
+  if ( opt_payload )
+    out_printf( "\"" );
+
+  out_printf( ", \"size\": %zu }", size );
+}
+
+/**
+ * Dumps a record's payload as rows of hexadecimal and ASCII.
+ *
+ * @param offset The file offset of the record's payload.
+ * @param end The file offset just past the record's payload or `SIZE_MAX` for
+ * the end of file.
+ */
+static void dump_rec_rows( size_t offset, size_t end ) {
+  size_t size = 0;
+  for ( uint8_t const *chunk;; ) {
+    size_t const n = pdb_chunk( offset + size, end, &chunk );
+    if ( n == 0 )
+      break;
+    for ( size_t i = 0; i < n; i += ROW_SIZE ) {
+      DWord const row_len = STATIC_CAST( DWord,
+        n - i < ROW_SIZE ? n - i : ROW_SIZE
+      );
+      dump_row( STATIC_CAST( DWord, offset + size + i ), chunk + i, row_len );
+    } // for
+    size += n;
+  } // for
+}
+
+/**
+ * Dumps a row of bytes in both hexadecimal and ASCII, e.g.:
+ *
+ *      0000006E: 4465 6320 7C20 4F63 7420 7C20 4865 7820  Dec | Oct | Hex
+ *
+ * @param offset The file offset of the row.
+ * @param row The bytes of the row.
+ * @param row_len The number of bytes in the row; at most #ROW_SIZE.
+ */
 static void dump_row( DWord offset, uint8_t const *row, DWord row_len ) {
+  if ( out_len + ROW_LEN_MAX > OUT_BUF_SIZE )
+    out_flush();
+  char *p = out_buf + out_len;
+
   // print offset
-  FPRINTF( fout, "%08X:", offset );
+  for ( int shift = 24; shift >= 0; shift -= 8 ) {
+    char const *const hex = hex_pair[ (offset >> shift) & 0xFF ];
+    *p++ = hex[0];
+    *p++ = hex[1];
+  } // for
+  *p++ = ':';
 
   // print hex part
   DWord row_pos;
   for ( row_pos = 0; row_pos < row_len; ++row_pos ) {
     if ( row_pos % 2 == 0 )
-      FPUTC( ' ', fout );
-    FPRINTF( fout, "%02X", (unsigned)row[ row_pos ] );
+      *p++ = ' ';
+    char const *const hex = hex_pair[ row[ row_pos ] ];
+    *p++ = hex[0];
+    *p++ = hex[1];
   } // for
 
   // print padding if necessary (last row only)
   while ( row_pos < ROW_SIZE ) {
     if ( row_pos++ % 2 == 0 )
-      FPUTC( ' ', fout );
-    FPRINTF( fout, "  " );
+      *p++ = ' ';
+    *p++ = ' ';
+    *p++ = ' ';
   } // while
 
   // print ASCII part
-  FPRINTF( fout, "  " );
+  *p++ = ' ';
+  *p++ = ' ';
   for ( row_pos = 0; row_pos < row_len; ++row_pos )
-    FPUTC( isprint( row[ row_pos ] ) ? row[ row_pos ] : '.', fout );
-  FPUTC( '\n', fout );
+    *p++ = ascii_char[ row[ row_pos ] ];
+  *p++ = '\n';
+
+  out_len = STATIC_CAST( size_t, p - out_buf );
+}
+
+/**
+ * Dumps per-record and whole-file compression and token statistics of a Doc
+ * file.  Only the tokens are examined: nothing is actually uncompressed.
+ *
+ * @param hdr The PDB header.
+ */
+static void dump_stats( DatabaseHdrType const *hdr ) {
+  doc_info_t doc;
+  doc_read_info( hdr, &doc );
+
+  size_t len_hist[ DOC_TOKEN_LEN_MAX + 1 ] = { 0 };
+  size_t dist_hist[ DOC_TOKEN_DIST_BITS ] = { 0 };
+  rec_stats_t total = { 0 };
+  bool any_corrupt = false;
+
+  out_printf(
+    "%5s %8s %8s %6s %8s %8s %8s %8s %8s %8s\n",
+    "Rec", "Stored", "Expanded", "Ratio", "Literal", "Escape", "Escaped",
+    "SpChar", "BackRef", "RefBytes"
+  );
+
+  for ( unsigned rec_num = doc.first; rec_num <= doc.last; ++rec_num ) {
+    uint8_t const *rec;
+    size_t const rec_len = doc_record( &doc, STATIC_CAST( Word, rec_num ), &rec );
+
+    rec_stats_t rs = { .stored = rec_len };
+    char corrupt[ 40 ] = "";
+
+    if ( !doc.compressed ) {
+      rs.expanded = rs.literals = rec_len;
+    } else {
+      doc_tokenizer_t dt;
+      doc_tokenizer_init( &dt, rec, rec_len );
+      doc_token_t tok;
+      doc_token_status_t status;
+      while ( (status = doc_token_next( &dt, &tok )) == DOC_TOKEN_OK ) {
+        switch ( tok.kind ) {
+          case DOC_TOKEN_LITERAL:
+            ++rs.literals;
+            break;
+          case DOC_TOKEN_ESCAPE:
+            ++rs.escapes;
+            rs.escaped += tok.dst_len;
+            break;
+          case DOC_TOKEN_SPACE_CHAR:
+            ++rs.space_chars;
+            break;
+          case DOC_TOKEN_BACKREF:
+            ++rs.backrefs;
+            rs.backref_bytes += tok.dst_len;
+            ++len_hist[ tok.dst_len ];
+            unsigned bucket = 0;
+            for ( unsigned d = tok.distance; d > 1; d >>= 1 )
+              ++bucket;
+            ++dist_hist[ bucket ];
+            break;
+        } // switch
+      } // while
+      rs.expanded = dt.dst_pos;
+      if ( status == DOC_TOKEN_CORRUPT ) {
+        snprintf( corrupt, sizeof corrupt, "  corrupt at %zu", dt.src_pos );
+        any_corrupt = true;
+      }
+    }
+
+    char rec_num_buf[ 8 ];
+    snprintf( rec_num_buf, sizeof rec_num_buf, "%u", rec_num );
+    stats_print( rec_num_buf, &rs, corrupt );
+    stats_add( &total, &rs );
+  } // for
+
+  stats_print( "Total", &total, "" );
+
+  if ( doc.compressed ) {
+    out_printf( "\nBack-reference lengths:\n" );
+    for ( unsigned len = DOC_TOKEN_LEN_MIN; len <= DOC_TOKEN_LEN_MAX; ++len )
+      out_printf( "  %9u: %10zu\n", len, len_hist[ len ] );
+    out_printf( "\nBack-reference distances:\n" );
+    for ( unsigned b = 0; b < DOC_TOKEN_DIST_BITS; ++b ) {
+      out_printf( "  %4u-%4u: %10zu\n", 1u << b, (2u << b) - 1, dist_hist[b] );
+    }
+  }
+
+  if ( any_corrupt )
+    exit( EX_DATAERR );
+}
+
+/**
+ * Dumps every token of every text record of a compressed Doc file, one per
+ * line, e.g.:
+ *
+ *         Out     In Kind Token                    Text
+ *      000000 000000 esc  E2 80 99                 "\xE2\x80\x99"
+ *      000003 000004 lit  54                       "T"
+ *      000004 000005 ref  dist  123 len  5         "he qu"
+ *      000009 000007 spc  E1                       " a"
+ *
+ * where _Out_ is the offset within the expanded record, _In_ is the offset
+ * within the compressed record, and _Text_ is what the token expands to.
+ *
+ * @param hdr The PDB header.
+ */
+static void dump_tokens( DatabaseHdrType const *hdr ) {
+  doc_info_t doc;
+  doc_read_info( hdr, &doc );
+  if ( !doc.compressed )
+    PMESSAGE_EXIT( EX_DATAERR, "Doc file is not compressed%s\n", "" );
+
+  for ( unsigned rec_num = doc.first; rec_num <= doc.last; ++rec_num ) {
+    uint8_t const *rec;
+    size_t const rec_len = doc_record( &doc, STATIC_CAST( Word, rec_num ), &rec );
+
+    out_printf(
+      "===================================================================\n"
+      "Rec %4u: %zu bytes\n"
+      "-------------------------------------------------------------------\n"
+      "   Out     In Kind Token                    Text\n",
+      rec_num, rec_len
+    );
+
+    doc_tokenizer_t dt;
+    doc_tokenizer_init( &dt, rec, rec_len );
+    doc_token_t tok;
+    doc_token_status_t status;
+    while ( (status = doc_token_next( &dt, &tok )) == DOC_TOKEN_OK ) {
+      if ( tok.dst_pos + tok.dst_len > text_buf_cap ) {
+        text_buf_cap = (tok.dst_pos + tok.dst_len) * 2;
+        text_buf = check_realloc( text_buf, text_buf_cap );
+      }
+      uint8_t *const text = text_buf + tok.dst_pos;
+      char detail[ 32 ];
+      char const *kind = NULL;
+
+      switch ( tok.kind ) {
+        case DOC_TOKEN_LITERAL:
+          kind = "lit";
+          snprintf( detail, sizeof detail, "%02X", tok.bytes[0] );
+          text[0] = tok.bytes[0];
+          break;
+        case DOC_TOKEN_ESCAPE:
+          kind = "esc";
+          for ( size_t i = 0; i < tok.dst_len; ++i ) {
+            snprintf( detail + i * 3, sizeof detail - i * 3, "%s%02X",
+                      i > 0 ? " " : "", tok.bytes[i] );
+          }
+          memcpy( text, tok.bytes, tok.dst_len );
+          break;
+        case DOC_TOKEN_SPACE_CHAR:
+          kind = "spc";
+          snprintf( detail, sizeof detail, "%02X", rec[ tok.src_pos ] );
+          text[0] = ' ';
+          text[1] = rec[ tok.src_pos ] ^ 0x80;
+          break;
+        case DOC_TOKEN_BACKREF:
+          kind = "ref";
+          snprintf( detail, sizeof detail, "dist %4u len %2zu",
+                    tok.distance, tok.dst_len );
+          for ( size_t i = 0; i < tok.dst_len; ++i )
+            text[i] = text[ i - tok.distance ];
+          break;
+      } // switch
+
+      out_printf(
+        "%06zX %06zX %-4s %-24s ", tok.dst_pos, tok.src_pos, kind, detail
+      );
+      out_quoted( text, tok.dst_len );
+      out_printf( "\n" );
+    } // while
+
+    if ( status == DOC_TOKEN_CORRUPT ) {
+      out_flush();
+      PMESSAGE_EXIT( EX_DATAERR,
+        "record %u: corrupt token at %zu\n", rec_num, dt.src_pos
+      );
+    }
+  } // for
+}
+
+/**
+ * Initializes the lookup tables used by dump_row().
+ */
+static void init_tables( void ) {
+  static char const HEX_DIGIT[] = "0123456789ABCDEF";
+  for ( unsigned b = 0; b < 256; ++b ) {
+    hex_pair[b][0] = HEX_DIGIT[ b >> 4 ];
+    hex_pair[b][1] = HEX_DIGIT[ b & 0xF ];
+    ascii_char[b] = isprint( (int)b ) ? STATIC_CAST( char, b ) : '.';
+  } // for
+}
+
+/**
+ * Dumps a PDB header as the start of a JSON object.
+ *
+ * @param hdr The PDB header.
+ */
+static void json_pdb_header( DatabaseHdrType const *hdr ) {
+  out_printf( "{\n  \"name\": " );
+  json_string( hdr->name, strnlen( hdr->name, sizeof hdr->name ) );
+  out_printf(
+    ",\n"
+    "  \"attributes\": %u,\n"
+    "  \"version\": %u,\n"
+    "  \"creation_date\": %lu,\n"
+    "  \"modification_date\": %lu,\n"
+    "  \"last_backup_date\": %lu,\n"
+    "  \"modification_number\": %lu,\n"
+    "  \"app_info_id\": %lu,\n"
+    "  \"sort_info_id\": %lu,\n"
+    "  \"type\": ",
+    ntohs( hdr->attributes ),
+    ntohs( hdr->version ),
+    STATIC_CAST( unsigned long, ntohl( hdr->creationDate ) ),
+    STATIC_CAST( unsigned long, ntohl( hdr->modificationDate ) ),
+    STATIC_CAST( unsigned long, ntohl( hdr->lastBackupDate ) ),
+    STATIC_CAST( unsigned long, ntohl( hdr->modificationNumber ) ),
+    STATIC_CAST( unsigned long, ntohl( hdr->appInfoID ) ),
+    STATIC_CAST( unsigned long, ntohl( hdr->sortInfoID ) )
+  );
+  json_string( hdr->type, sizeof hdr->type );
+  out_printf( ",\n  \"creator\": " );
+  json_string( hdr->creator, sizeof hdr->creator );
+  out_printf(
+    ",\n"
+    "  \"unique_id_seed\": %lu,\n"
+    "  \"num_records\": %u",
+    STATIC_CAST( unsigned long, ntohl( hdr->uniqueIDSeed ) ),
+    ntohs( hdr->recordList.numRecords )
+  );
+}
+
+/**
+ * Dumps a string as a quoted JSON string.  Bytes outside of printable ASCII
+ * are escaped as the ISO 8859-1 characters they'd be.
+ *
+ * @param s The string.
+ * @param s_len The length of \a s.
+ */
+static void json_string( char const *s, size_t s_len ) {
+  out_printf( "\"" );
+  for ( size_t i = 0; i < s_len; ++i ) {
+    unsigned char const c = STATIC_CAST( unsigned char, s[i] );
+    if ( c == '"' || c == '\\' )
+      out_printf( "\\%c", c );
+    else if ( c < 0x20 || c > 0x7E )
+      out_printf( "\\u%04X", c );
+    else
+      out_printf( "%c", c );
+  } // for
+  out_printf( "\"" );
+}
+
+/**
+ * Opens a PDB file.  If it's a regular file, it's mapped into memory;
+ * otherwise (e.g., it's a pipe), it's streamed in chunks.
+ *
+ * @param path The path of the PDB file.
+ */
+static void open_pdb( char const *path ) {
+  int const fd = open( path, O_RDONLY );
+  if ( fd == -1 )
+    PMESSAGE_EXIT( EX_NOINPUT, "\"%s\": can not open: %s\n", path, STRERROR );
+
+  struct stat sbuf;
+  FSTAT( fd, &sbuf );
+  if ( S_ISREG( sbuf.st_mode ) && sbuf.st_size > 0 ) {
+    size_t const size = STATIC_CAST( size_t, sbuf.st_size );
+    void *const p = mmap( NULL, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    if ( p != MAP_FAILED ) {
+      (void)posix_madvise( p, size, POSIX_MADV_SEQUENTIAL );
+      pdb = p;
+      pdb_size = size;
+      close( fd );
+      return;
+    }
+  }
+  pdb_fd = fd;
+}
+
+/**
+ * Appends the base64 encoding of bytes to the output buffer.
+ *
+ * @param data The bytes to encode.
+ * @param data_len The number of bytes.  Unless it's the last call for a given
+ * payload, it must be a multiple of 3.
+ */
+static void out_base64( uint8_t const *data, size_t data_len ) {
+  static char const B64[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+  for ( size_t i = 0; i < data_len; i += 3 ) {
+    if ( out_len + 4 > OUT_BUF_SIZE )
+      out_flush();
+    char *const p = out_buf + out_len;
+    size_t const left = data_len - i;
+    unsigned const v = STATIC_CAST( unsigned,
+      data[i] << 16 |
+      (left > 1 ? data[i+1] << 8 : 0) |
+      (left > 2 ? data[i+2] : 0)
+    );
+    p[0] = B64[ v >> 18 ];
+    p[1] = B64[ (v >> 12) & 0x3F ];
+    p[2] = left > 1 ? B64[ (v >> 6) & 0x3F ] : '=';
+    p[3] = left > 2 ? B64[ v & 0x3F ] : '=';
+    out_len += 4;
+  } // for
+}
+
+/**
+ * Writes buffered output to \a fout.
+ */
+static void out_flush( void ) {
+  FWRITE( out_buf, 1, out_len, fout );
+  out_len = 0;
+}
+
+/**
+ * Appends `printf`-formatted output to the output buffer.
+ *
+ * @param format The `printf`-style format string.
+ */
+static void out_printf( char const *format, ... ) {
+  for ( unsigned try = 0; try < 2; ++try ) {
+    va_list args;
+    va_start( args, format );
+    int const n = vsnprintf(
+      out_buf + out_len, OUT_BUF_SIZE - out_len, format, args
+    );
+    va_end( args );
+    if ( n < 0 )
+      PERROR_EXIT( EX_IOERR );
+    if ( out_len + STATIC_CAST( size_t, n ) < OUT_BUF_SIZE ) {
+      out_len += STATIC_CAST( size_t, n );
+      return;
+    }
+    out_flush();                        // didn't fit: flush and retry
+  } // for
+  PMESSAGE_EXIT( EX_SOFTWARE, "output too long for buffer%s\n", "" );
+}
+
+/**
+ * Appends bytes to the output buffer as a quoted string where `"`, `\`, and
+ * non-printable bytes are escaped as in C.
+ *
+ * @param bytes The bytes.
+ * @param bytes_len The number of bytes.
+ */
+static void out_quoted( uint8_t const *bytes, size_t bytes_len ) {
+  out_printf( "\"" );
+  for ( size_t i = 0; i < bytes_len; ++i ) {
+    switch ( bytes[i] ) {
+      case '"' : out_printf( "\\\"" ); break;
+      case '\\': out_printf( "\\\\" ); break;
+      case '\n': out_printf( "\\n" );  break;
+      case '\r': out_printf( "\\r" );  break;
+      case '\t': out_printf( "\\t" );  break;
+      default:
+        if ( bytes[i] >= 0x20 && bytes[i] <= 0x7E )
+          out_printf( "%c", bytes[i] );
+        else
+          out_printf( "\\x%02X", bytes[i] );
+    } // switch
+  } // for
+  out_printf( "\"" );
+}
+
+/**
+ * Parses a record range of the form _FIRST_[`-`[_LAST_]] into \ref rec_first
+ * and \ref rec_last.  If `-` is given without _LAST_, the range extends to
+ * the last record.
+ *
+ * @param s The NULL-terminated string to parse.
+ */
+static void parse_rec_range( char const *s ) {
+  char const *const dash = strchr( s, '-' );
+  if ( dash == NULL ) {
+    rec_first = rec_last = STATIC_CAST( unsigned, parse_ull( s ) );
+    return;
+  }
+  size_t const first_len = STATIC_CAST( size_t, dash - s );
+  char first_buf[ 24 ];
+  if ( first_len == 0 || first_len >= sizeof first_buf )
+    PMESSAGE_EXIT( EX_USAGE, "\"%s\": invalid record range\n", s );
+  memcpy( first_buf, s, first_len );
+  first_buf[ first_len ] = '\0';
+  rec_first = STATIC_CAST( unsigned, parse_ull( first_buf ) );
+  if ( dash[1] != '\0' )
+    rec_last = STATIC_CAST( unsigned, parse_ull( dash + 1 ) );
+  if ( rec_first > rec_last )
+    PMESSAGE_EXIT( EX_USAGE, "\"%s\": invalid record range\n", s );
+}
+
+/**
+ * Gets the next chunk of the PDB file.
+ *
+ * @param offset The file offset of the chunk.  When streaming, it must not be
+ * less than the end of the previous chunk.
+ * @param end The file offset just past the last byte wanted or `SIZE_MAX` for
+ * the end of file.
+ * @param pchunk A pointer to receive a pointer to the chunk.
+ * @return Returns the size of the chunk, at most #CHUNK_SIZE; 0 only at \a end
+ * or the end of file.
+ */
+static size_t pdb_chunk( size_t offset, size_t end, uint8_t const **pchunk ) {
+  static uint8_t chunk_buf[ CHUNK_SIZE ];
+
+  if ( pdb != NULL ) {
+    if ( end > pdb_size )
+      end = pdb_size;
+    if ( offset >= end )
+      return 0;
+    *pchunk = pdb + offset;
+    return end - offset < CHUNK_SIZE ? end - offset : CHUNK_SIZE;
+  }
+
+  if ( offset >= end )
+    return 0;
+  if ( offset < pdb_pos ) {
+    PMESSAGE_EXIT( EX_DATAERR,
+      "offset %zu out of order; input must be seekable\n", offset
+    );
+  }
+  size_t want = end - offset < CHUNK_SIZE ? end - offset : CHUNK_SIZE;
+  size_t got = 0;
+  for ( bool skipping = true; got < want; ) {
+    if ( skipping && pdb_pos == offset )
+      skipping = false;
+    size_t const max = skipping ?
+      (offset - pdb_pos < CHUNK_SIZE ? offset - pdb_pos : CHUNK_SIZE) :
+      want - got;
+    ssize_t const n = read( pdb_fd, chunk_buf + (skipping ? 0 : got), max );
+    if ( n == -1 )
+      PERROR_EXIT( EX_NOINPUT );
+    if ( n == 0 )
+      break;
+    pdb_pos += STATIC_CAST( size_t, n );
+    if ( !skipping )
+      got += STATIC_CAST( size_t, n );
+  } // for
+  *pchunk = chunk_buf;
+  return got;
+}
+
+/**
+ * Gets the start of the PDB file, i.e., its header and record list.
+ *
+ * @param size The number of bytes needed.  When streaming, it must be at least
+ * as large as in the previous call.
+ * @return Returns a pointer to the start of the file.  If the file is shorter
+ * than \a size, prints an error message and exits.
+ */
+static uint8_t const* pdb_read_head( size_t size ) {
+  if ( pdb != NULL ) {
+    if ( size <= pdb_size )
+      return pdb;
+  } else {
+    pdb_head = check_realloc( pdb_head, size );
+    while ( pdb_pos < size ) {
+      ssize_t const n = read( pdb_fd, pdb_head + pdb_pos, size - pdb_pos );
+      if ( n == -1 )
+        PERROR_EXIT( EX_NOINPUT );
+      if ( n == 0 )
+        break;
+      pdb_pos += STATIC_CAST( size_t, n );
+    } // while
+    if ( pdb_pos >= size )
+      return pdb_head;
+  }
+  PMESSAGE_EXIT( EX_DATAERR,
+    "file too short for %s\n",
+    size == DatabaseHdrSize ? "PDB header" : "record list"
+  );
+}
+
+/**
+ * Gets a whole record of the PDB file.
+ *
+ * @param offset The file offset of the record.  When streaming, it must not be
+ * less than the end of the previous record.
+ * @param end The file offset just past the record or `SIZE_MAX` for the end of
+ * file.
+ * @param prec A pointer to receive a pointer to the record.
+ * @return Returns the size of the record.
+ */
+static size_t pdb_record( size_t offset, size_t end, uint8_t const **prec ) {
+  if ( pdb != NULL ) {
+    if ( end > pdb_size )
+      end = pdb_size;
+    *prec = pdb + offset;
+    return offset < end ? end - offset : 0;
+  }
+
+  size_t len = 0;
+  for ( uint8_t const *chunk;; ) {
+    size_t const n = pdb_chunk( offset + len, end, &chunk );
+    if ( n == 0 )
+      break;
+    if ( len + n > rec_buf_cap ) {
+      rec_buf_cap = (len + n) * 2;
+      rec_buf = check_realloc( rec_buf, rec_buf_cap );
+    }
+    memcpy( rec_buf + len, chunk, n );
+    len += n;
+  } // for
+  *prec = rec_buf;
+  return len;
 }
 
 static void process_options( int argc, char *argv[] ) {
-  static char const opts[] = "dhV";     // command line options
+  static char const SHORT_OPTS[] = "dhjlpr:stV";
+  static struct option const LONG_OPTS[] = {
+    { "data-only",    no_argument,        NULL, 'd' },
+    { "header-only",  no_argument,        NULL, 'h' },
+    { "json",         no_argument,        NULL, 'j' },
+    { "list",         no_argument,        NULL, 'l' },
+    { "payload",      no_argument,        NULL, 'p' },
+    { "records",      required_argument,  NULL, 'r' },
+    { "stats",        no_argument,        NULL, 's' },
+    { "tokens",       no_argument,        NULL, 't' },
+    { "version",      no_argument,        NULL, 'V' },
+    { NULL,           0,                  NULL, 0   }
+  };
 
   me = strrchr( argv[0], '/' );         // determine base name...
   me = me ? me + 1 : argv[0];           // ...of executable
 
   opterr = 1;
-  for ( int opt; (opt = getopt( argc, argv, opts )) != EOF; ) {
+  for ( int opt;
+        (opt = getopt_long( argc, argv, SHORT_OPTS, LONG_OPTS, NULL )) != EOF; ) {
     switch ( opt ) {
       case 'd': opt_data_only = true;               break;
       case 'h': opt_header_only = true;             break;
+      case 'j': opt_json = true;                    break;
+      case 'l': opt_list = true;                    break;
+      case 'p': opt_payload = true;                 break;
+      case 'r': parse_rec_range( optarg );          break;
+      case 's': opt_stats = true;                   break;
+      case 't': opt_tokens = true;                  break;
       case 'V': printf( "pdbdump %s\n", VERSION );  exit( EXIT_SUCCESS );
       default : usage();
     } // switch
@@ -207,16 +1002,21 @@ static void process_options( int argc, char *argv[] ) {
   argc -= optind;
   argv += optind - 1;
 
-  check_mutually_exclusive( "d", "h" );
-  check_mutually_exclusive( "V", "dh" );
+  check_mutually_exclusive( "d", "hjl" );
+  check_mutually_exclusive( "h", "lpr" );
+  check_mutually_exclusive( "l", "jpst" );
+  check_mutually_exclusive( "s", "dhjpt" );
+  check_mutually_exclusive( "t", "dhjp" );
+  check_mutually_exclusive( "V", "dhjlprst" );
+  check_required( "p", "j" );
 
   switch ( argc ) {
     case 1:
-      fin  = check_fopen( argv[1], "rb" );
+      open_pdb( argv[1] );
       fout = stdout;
       break;
     case 2:
-      fin  = check_fopen( argv[1], "rb" );
+      open_pdb( argv[1] );
       fout = check_fopen( argv[2], "wb" );
       break;
     default:
@@ -224,18 +1024,101 @@ static void process_options( int argc, char *argv[] ) {
   } // switch
 }
 
+/**
+ * Gets the file offset just past a record, i.e., the offset of the next.
+ *
+ * @param rec_list The record list.
+ * @param num_records The number of records.
+ * @param rec_num The record number.
+ * @return Returns said offset or `SIZE_MAX` for the last record since it
+ * extends to the end of file.
+ */
+static size_t rec_end( uint8_t const *rec_list, Word num_records,
+                       Word rec_num ) {
+  return rec_num + 1 < num_records ?
+    doc_rec_offset( rec_list, rec_num + 1u ) : SIZE_MAX;
+}
+
+/**
+ * Gets the size of a record without reading it, if possible.
+ *
+ * @param offset The file offset of the record.
+ * @param end The file offset just past the record or `SIZE_MAX` for the end of
+ * file.
+ * @return Returns said size.
+ */
+static size_t rec_size( size_t offset, size_t end ) {
+  if ( pdb != NULL ) {
+    if ( end > pdb_size )
+      end = pdb_size;
+    return offset < end ? end - offset : 0;
+  }
+  size_t size = 0;
+  for ( uint8_t const *chunk;; ) {
+    size_t const n = pdb_chunk( offset + size, end, &chunk );
+    if ( n == 0 )
+      break;
+    size += n;
+  } // for
+  return size;
+}
+
+/**
+ * Adds record statistics to a total.
+ *
+ * @param total The total to add to.
+ * @param rs The statistics to add.
+ */
+static void stats_add( rec_stats_t *total, rec_stats_t const *rs ) {
+  total->stored        += rs->stored;
+  total->expanded      += rs->expanded;
+  total->literals      += rs->literals;
+  total->escapes       += rs->escapes;
+  total->escaped       += rs->escaped;
+  total->space_chars   += rs->space_chars;
+  total->backrefs      += rs->backrefs;
+  total->backref_bytes += rs->backref_bytes;
+}
+
+/**
+ * Prints a line of record statistics.
+ *
+ * @param label The label for the line.
+ * @param rs The statistics.
+ * @param suffix Text to append to the line.
+ */
+static void stats_print( char const *label, rec_stats_t const *rs,
+                         char const *suffix ) {
+  out_printf(
+    "%5s %8zu %8zu %5.1f%% %8zu %8zu %8zu %8zu %8zu %8zu%s\n",
+    label, rs->stored, rs->expanded,
+    rs->expanded ? 100.0 * (double)rs->stored / (double)rs->expanded : 0.0,
+    rs->literals, rs->escapes, rs->escaped, rs->space_chars, rs->backrefs,
+    rs->backref_bytes, suffix
+  );
+}
+
 /**
  * Prints the usage message to standard error and exits.
  */
 static void usage( void ) {
   PRINT_ERR(
-"usage: %s [-dhV] file.pdb [file.txt]\n"
+"usage: %s [-d|-h|-l] [-r range] file.pdb [file.txt]\n"
+"       %s -j [-h|-p] [-r range] file.pdb [file.json]\n"
+"       %s {-s|-t} [-r range] file.pdb [file.txt]\n"
+"       %s -V\n"
 "\n"
 "options:\n"
-"  -d  Dump data only.\n"
-"  -h  Dump header only.\n"
-"  -V  Print version and exit.\n"
-    , me
+"  -d        Dump data only.\n"
+"  -h        Dump header only.\n"
+"  -j        Dump as JSON.\n"
+"  -l        Dump header and record table only.\n"
+"  -p        Include base64-encoded payloads in JSON.\n"
+"  -r range  Dump only records first[-[last]].\n"
+"  -s        Dump compression statistics of a Doc file.\n"
+"  -t        Dump compression tokens of a Doc file.\n"
+"  -V        Print version and exit.\n"
+    , me, me, me, me
   );
   exit( EX_USAGE );
 }
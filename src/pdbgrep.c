@@ -0,0 +1,521 @@
+/*
+**      pdbgrep -- Search Doc files for Palm Pilots
+**      pdbgrep.c
+**
+**      Copyright (C) 2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/**
+ * @file
+ * Defines a program that searches the text of Doc files for a string.
+ *
+ * The string is transcoded to PalmOS once and searched for in the PalmOS text
+ * of each record as it's uncompressed, so only the lines of matches are ever
+ * transcoded to UTF-8.  The end of each record is carried over to the start of
+ * the next so matches and their lines may span records.  Files are searched
+ * in parallel.
+ */
+
+// local
+#include "pjl_config.h"
+#include "docmap.h"
+#include "options.h"
+#include "palm.h"
+#include "pool.h"
+#include "txt2pdbdoc.h"
+#include "unicode.h"
+#include "util.h"
+
+// standard
+#include <getopt.h>
+#include <inttypes.h>                   /* for PRIu64 */
+#include <limits.h>                     /* for UINT_MAX */
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+
+#define CONTEXT_MAX   60                /* most context each side of a match */
+#define OUT_FLUSH_MAX (64 * 1024)       /* most output buffered per worker */
+#define PATTERN_MAX   1024              /* longest string to search for */
+
+/** Most text carried over from one record to the next. */
+#define CARRY_MAX     (PATTERN_MAX + 2 * CONTEXT_MAX)
+
+#define EXIT_NO_MATCH 1                 /* like grep(1) */
+
+/**
+ * Per-worker state that's reused for every file the worker searches.
+ */
+struct grep_worker {
+  Byte   *text;                         ///< Text window.
+  Byte   *folded;                       ///< Case-folded \a text (`-i` only).
+  size_t  text_cap;                     ///< Capacity of \a text and \a folded.
+  char   *out;                          ///< Output for the current file...
+  size_t  out_len;                      ///< ...its length...
+  size_t  out_cap;                      ///< ...and its capacity.
+  bool    owns_out;                     ///< Holds \c out_mtx until file ends?
+};
+typedef struct grep_worker grep_worker_t;
+
+/**
+ * A file being searched.
+ */
+struct grep_file {
+  doc_map_t doc;                        ///< The Doc file.
+  uint64_t  matches;                    ///< Number of matches.
+};
+typedef struct grep_file grep_file_t;
+
+////////// extern variables ///////////////////////////////////////////////////
+
+char const  *me;
+
+////////// local variables ////////////////////////////////////////////////////
+
+static bool           opt_count;        // print only counts
+static bool           opt_ignore_case;  // ignore case
+static bool           opt_list;         // print only names of matching files
+static bool           opt_no_check_doc; // don't check type & creator
+static unsigned       opt_jobs;         // number of threads
+
+static char const *const
+                     *paths;            // files to search
+static size_t         num_paths;        // number of them
+
+static Byte           pattern[ PATTERN_MAX ]; // string to search for...
+static size_t         pattern_len;      // ...its length...
+static size_t         pattern_rare;     // ...and index of its rarest byte
+
+static Byte           fold[ 256 ];      // PalmOS character -> lower case
+static grep_worker_t *workers;          // one per worker
+
+static pthread_mutex_t out_mtx = PTHREAD_MUTEX_INITIALIZER;
+static int            exit_status = EXIT_NO_MATCH; // guarded by out_mtx
+
+////////// local functions ////////////////////////////////////////////////////
+
+static void process_options( int, char*[] );
+static void usage( void );
+
+/**
+ * Appends bytes to the output of a worker.
+ *
+ * @param w The worker.
+ * @param s The bytes to append.
+ * @param len The number of bytes.
+ */
+static void out_append( grep_worker_t *w, char const *s, size_t len ) {
+  if ( w->out_len + len > w->out_cap ) {
+    while ( w->out_len + len > w->out_cap )
+      w->out_cap = w->out_cap ? w->out_cap * 2 : 4096;
+    w->out = check_realloc( w->out, w->out_cap );
+  }
+  memcpy( w->out + w->out_len, s, len );
+  w->out_len += len;
+}
+
+/**
+ * Appends PalmOS characters transcoded into UTF-8 to the output of a worker.
+ * Characters that can't be transcoded are appended as `?`.
+ *
+ * @param w The worker.
+ * @param s The PalmOS characters.
+ * @param len The number of characters.
+ */
+static void out_palm( grep_worker_t *w, Byte const *s, size_t len ) {
+  for ( size_t i = 0; i < len; ++i ) {
+    char8_t utf8[ UTF8_CHAR_SIZE_MAX ];
+    char32_t const cp = palm_to_unicode( s[i] );
+    if ( cp == 0 )
+      out_append( w, "?", 1 );
+    else
+      out_append( w, (char const*)utf8, utf8_encode( cp, utf8 ) );
+  } // for
+}
+
+/**
+ * Writes the output of a worker for a file so far once there's a lot of it.
+ * So the output for different files is still never interleaved, the worker
+ * keeps \c out_mtx until its file ends; other workers buffer their output
+ * meanwhile, waiting only if they too have a lot of it.
+ *
+ * @param w The worker.
+ */
+static void out_spill( grep_worker_t *w ) {
+  if ( w->out_len < OUT_FLUSH_MAX )
+    return;
+  if ( !w->owns_out ) {
+    pthread_mutex_lock( &out_mtx );
+    w->owns_out = true;
+  }
+  fwrite( w->out, 1, w->out_len, stdout );
+  w->out_len = 0;
+}
+
+/**
+ * Writes the output of a worker for a file, if any, and merges its exit
+ * status.  The output for each file is written all at once (or after that
+ * written by out_spill()) so output for different files is never
+ * interleaved.
+ *
+ * @param w The worker.
+ * @param status The exit status for the file.
+ */
+static void out_flush( grep_worker_t *w, int status ) {
+  if ( !w->owns_out )
+    pthread_mutex_lock( &out_mtx );
+  if ( w->out_len > 0 )
+    fwrite( w->out, 1, w->out_len, stdout );
+  if ( status != EXIT_NO_MATCH && exit_status != EX_DATAERR &&
+       exit_status != EX_NOINPUT ) {
+    exit_status = status;
+  }
+  pthread_mutex_unlock( &out_mtx );
+  w->owns_out = false;
+  w->out_len = 0;
+}
+
+/**
+ * Prints an error message about a file.
+ *
+ * @param path The path of the file.
+ * @param format The `printf()` format string.
+ */
+ATTRIBUTE_FORMAT(( printf, 2, 3 ))
+static void file_error( char const *path, char const *format, ... ) {
+  char msg[ 256 ];
+  va_list args;
+  va_start( args, format );
+  vsnprintf( msg, sizeof msg, format, args );
+  va_end( args );
+  PMESSAGE( "%s: %s\n", path, msg );
+}
+
+/**
+ * Finds the first occurrence of #pattern: candidates are found by using
+ * memchr(3), typically vectorized, to skip to the next occurrence of the
+ * pattern's rarest byte.
+ *
+ * @param m The start of memory to search within.
+ * @param m_len The number of bytes of \a m.
+ * @return Returns a pointer to the match within \a m or NULL if none.
+ */
+NODISCARD
+static Byte const* find( Byte const *m, size_t m_len ) {
+  if ( m_len < pattern_len )
+    return NULL;
+  Byte const rare = pattern[ pattern_rare ];
+  Byte const *p = m + pattern_rare;
+  Byte const *const end = m + m_len - pattern_len + pattern_rare + 1;
+  while ( p < end ) {
+    p = memchr( p, rare, STATIC_CAST( size_t, end - p ) );
+    if ( p == NULL )
+      break;
+    Byte const *const match = p - pattern_rare;
+    if ( memcmp( match, pattern, pattern_len ) == 0 )
+      return match;
+    ++p;
+  } // while
+  return NULL;
+}
+
+/**
+ * Chooses the byte of #pattern least likely to occur in text to find
+ * candidate matches with.
+ */
+static void init_rare( void ) {
+  static char const COMMON[] = " etaoinsrhldcumfpgwybvkxjqz\n.,";
+  unsigned best_rank = UINT_MAX;
+  for ( size_t i = 0; i < pattern_len; ++i ) {
+    char const *const common =
+      pattern[i] != '\0' ? strchr( COMMON, pattern[i] ) : NULL;
+    unsigned const rank = common == NULL ? 0 :
+      STATIC_CAST( unsigned, sizeof COMMON - STATIC_CAST( size_t, common - COMMON ) );
+    if ( rank < best_rank ) {
+      best_rank = rank;
+      pattern_rare = i;
+    }
+  } // for
+}
+
+/**
+ * Reports a match: the path and name of the file, the offset of the match
+ * within the text, and the line containing it.
+ *
+ * @param w The worker.
+ * @param f The file.
+ * @param offset The offset of the match within the text.
+ * @param line The start of the line, limited to #CONTEXT_MAX characters
+ * before the match.
+ * @param line_len The length of the line.
+ */
+static void report( grep_worker_t *w, grep_file_t const *f, uint64_t offset,
+                    Byte const *line, size_t line_len ) {
+  char buf[ 32 ];
+  out_append( w, f->doc.path, strlen( f->doc.path ) );
+  out_append( w, ":", 1 );
+  out_append( w, f->doc.name, strlen( f->doc.name ) );
+  out_append( w, buf,
+    STATIC_CAST( size_t, snprintf( buf, sizeof buf, ":%" PRIu64 ":", offset ) )
+  );
+  out_palm( w, line, line_len );
+  out_append( w, "\n", 1 );
+  out_spill( w );
+}
+
+/**
+ * Searches the text of a Doc file.
+ *
+ * @param w The worker.
+ * @param f The file.
+ * @return Returns `EXIT_SUCCESS` if found, #EXIT_NO_MATCH if not, or
+ * `EX_DATAERR` if a record of \a f is invalid.
+ */
+NODISCARD
+static int grep_doc( grep_worker_t *w, grep_file_t *f ) {
+  doc_map_t *const d = &f->doc;
+  size_t const rec_size = d->rec_size;
+
+  if ( CARRY_MAX + rec_size > w->text_cap ) {
+    w->text_cap = CARRY_MAX + rec_size;
+    w->text = check_realloc( w->text, w->text_cap );
+    if ( opt_ignore_case )
+      w->folded = check_realloc( w->folded, w->text_cap );
+  }
+  Byte *const text = w->text;
+  Byte const *const hay = opt_ignore_case ? w->folded : text;
+
+  uint64_t base = 0;                    // text offset of text[0]
+  size_t carry = 0;                     // bytes carried over
+  size_t search_from = 0;               // where to resume searching
+
+  for ( unsigned rec_num = 1; rec_num <= d->num_records; ++rec_num ) {
+    ////////// append record's text ///////////////////////////////////////////
+
+    size_t len;
+    if ( !doc_map_read( d, rec_num, text + carry, &len ) ) {
+      file_error( d->path, "%s", d->error );
+      return EX_DATAERR;
+    }
+    if ( opt_ignore_case ) {
+      for ( size_t i = carry; i < carry + len; ++i )
+        w->folded[i] = fold[ text[i] ];
+    }
+    size_t const text_len = carry + len;
+    bool const is_last = rec_num == d->num_records;
+
+    ////////// search it //////////////////////////////////////////////////////
+
+    size_t held = text_len;             // match whose line isn't all here
+    size_t pos = search_from;
+    for ( Byte const *m;
+          (m = find( hay + pos, text_len - pos )) != NULL; ) {
+      size_t const at = STATIC_CAST( size_t, m - hay );
+      size_t const after_max = at + pattern_len + CONTEXT_MAX;
+      size_t line_end = at + pattern_len;
+      while ( line_end < text_len && line_end < after_max &&
+              text[ line_end ] != '\n' ) {
+        ++line_end;
+      }
+      if ( line_end == text_len && line_end < after_max && !is_last ) {
+        held = at;                      // line continues in next record
+        break;
+      }
+
+      ++f->matches;
+      if ( opt_list )
+        return EXIT_SUCCESS;
+      if ( !opt_count ) {
+        size_t const before_min = at > CONTEXT_MAX ? at - CONTEXT_MAX : 0;
+        size_t line = at;
+        while ( line > before_min && text[ line - 1 ] != '\n' )
+          --line;
+        report( w, f, base + at, text + line, line_end - line );
+      }
+      pos = at + pattern_len;
+    } // for
+
+    ////////// carry end over to next record //////////////////////////////////
+
+    size_t next = held;
+    if ( held == text_len ) {
+      next = text_len >= pattern_len ? text_len - (pattern_len - 1) : 0;
+      if ( next < pos )
+        next = pos;
+    }
+    size_t const keep = next > CONTEXT_MAX ? next - CONTEXT_MAX : 0;
+    carry = text_len - keep;
+    memmove( text, text + keep, carry );
+    if ( opt_ignore_case )
+      memmove( w->folded, w->folded + keep, carry );
+    base += keep;
+    search_from = next - keep;
+  } // for
+
+  return f->matches > 0 ? EXIT_SUCCESS : EXIT_NO_MATCH;
+}
+
+/**
+ * Searches a single file.
+ *
+ * @param data Not used.
+ * @param worker The index of the worker.
+ * @param job The index of the file in #paths.
+ */
+static void grep_job( void *data, unsigned worker, size_t job ) {
+  (void)data;
+  grep_worker_t *const w = &workers[ worker ];
+  grep_file_t f = { .matches = 0 };
+  doc_map_t *const d = &f.doc;
+
+  int status = doc_map_open( d, paths[ job ], !opt_no_check_doc );
+  if ( status != EXIT_SUCCESS ) {
+    file_error( d->path, "%s", d->error );
+    out_flush( w, status );
+    return;
+  }
+  status = grep_doc( w, &f );
+  doc_map_close( d );
+
+  if ( status != EX_DATAERR ) {
+    if ( opt_list && f.matches > 0 ) {
+      out_append( w, d->path, strlen( d->path ) );
+      out_append( w, "\n", 1 );
+    }
+    else if ( opt_count ) {
+      char buf[ 32 ];
+      out_append( w, d->path, strlen( d->path ) );
+      out_append( w, ":", 1 );
+      out_append( w, d->name, strlen( d->name ) );
+      out_append( w, buf,
+        STATIC_CAST( size_t,
+          snprintf( buf, sizeof buf, ":%" PRIu64 "\n", f.matches )
+        )
+      );
+    }
+  }
+  out_flush( w, status );
+}
+
+////////// main ///////////////////////////////////////////////////////////////
+
+int main( int argc, char *argv[] ) {
+  process_options( argc, argv );
+  init_rare();
+
+  workers = check_realloc( NULL, opt_jobs * sizeof *workers );
+  memset( workers, 0, opt_jobs * sizeof *workers );
+  pool_run( num_paths, opt_jobs, &grep_job, NULL );
+
+  if ( fflush( stdout ) == EOF || ferror( stdout ) )
+    PERROR_EXIT( EX_IOERR );
+  exit( exit_status );
+}
+
+////////// local functions ////////////////////////////////////////////////////
+
+/**
+ * Parses command-line options and sets the string to search for.
+ *
+ * @param argc The command-line argument count.
+ * @param argv The command-line argument values.
+ */
+static void process_options( int argc, char *argv[] ) {
+  static char const SHORT_OPTS[] = "cDij:lV";
+  static struct option const LONG_OPTS[] = {
+    { "count",              no_argument,        NULL, 'c' },
+    { "no-check-doc",       no_argument,        NULL, 'D' },
+    { "ignore-case",        no_argument,        NULL, 'i' },
+    { "jobs",               required_argument,  NULL, 'j' },
+    { "files-with-matches", no_argument,        NULL, 'l' },
+    { "version",            no_argument,        NULL, 'V' },
+    { NULL,                 0,                  NULL, 0   }
+  };
+
+  me = strrchr( argv[0], '/' );         // determine base name...
+  me = me ? me + 1 : argv[0];           // ...of executable
+
+  opterr = 1;
+  for ( int opt;
+        (opt = getopt_long( argc, argv, SHORT_OPTS, LONG_OPTS, NULL )) != EOF; ) {
+    switch ( opt ) {
+      case 'c': opt_count = true;                                     break;
+      case 'D': opt_no_check_doc = true;                              break;
+      case 'i': opt_ignore_case = true;                               break;
+      case 'j': opt_jobs = STATIC_CAST( unsigned, parse_ull( optarg ) ); break;
+      case 'l': opt_list = true;                                      break;
+      case 'V': printf( "pdbgrep %s\n", VERSION );  exit( EXIT_SUCCESS );
+      default : usage();
+    } // switch
+    opts_given[ opt ] = true;
+  } // for
+  argc -= optind;
+  argv += optind - 1;
+
+  check_mutually_exclusive( "c", "l" );
+
+  if ( argc < 2 )
+    usage();
+
+  pattern_len = palm_from_utf8( argv[1], pattern, sizeof pattern );
+  if ( pattern_len == 0 ) {
+    PMESSAGE_EXIT( EX_USAGE,
+      "\"%s\": empty, invalid, longer than %d characters, "
+      "or not in the PalmOS character set\n",
+      argv[1], PATTERN_MAX
+    );
+  }
+  if ( opt_ignore_case ) {
+    palm_fold_table( fold );
+    for ( size_t i = 0; i < pattern_len; ++i )
+      pattern[i] = fold[ pattern[i] ];
+  }
+
+  paths = (char const *const*)argv + 2;
+  num_paths = STATIC_CAST( size_t, argc - 1 );
+  if ( opt_jobs == 0 )
+    opt_jobs = pool_default_workers();
+  if ( opt_jobs > num_paths )
+    opt_jobs = STATIC_CAST( unsigned, num_paths );
+}
+
+/**
+ * Prints the usage message to standard error and exits.
+ */
+static void usage( void ) {
+  PRINT_ERR(
+"usage: %s [-c|-l] [-Di] [-j jobs] string file.pdb...\n"
+"       %s -V\n"
+"\n"
+"options:\n"
+"  -c        Print only the number of matches in each file.\n"
+"  -D        Don't check a file's type and creator.\n"
+"  -i        Ignore case.\n"
+"  -j jobs   Search files using this many threads.\n"
+"  -l        Print only the paths of files that match.\n"
+"  -V        Print version and exit.\n"
+    , me, me
+  );
+  exit( EX_USAGE );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,1413 @@
+/*
+**      pdbindex -- Index Doc files for Palm Pilots
+**      pdbindex.c
+**
+**      Copyright (C) 2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/**
+ * @file
+ * Defines a program that builds and queries an inverted index of the words of
+ * Doc files.
+ *
+ * A word is a maximal run of PalmOS letters and digits; it's indexed in lower
+ * case.  For every word, the index lists every occurrence as its document,
+ * word number, and text offset; word numbers make phrases lookups exact
+ * without reading the text.  Documents are decoded only when building the
+ * index (and only those whose size or modification time changed since the
+ * index was last built) or to print the lines of matches.
+ *
+ * An index file is written once and memory-mapped to be read.  All integers
+ * are little-endian.  It contains, in order:
+ *
+ *  + A header of #IDX_HDR_SIZE bytes:
+ *    + The magic number #IDX_MAGIC.
+ *    + The number of documents and words (4 bytes each).
+ *    + The file offsets of the document table, word table, string table,
+ *      record table, and postings (8 bytes each).
+ *  + The document table having one entry of #IDX_DOC_SIZE bytes per document:
+ *    + The file size and modification time in nanoseconds (8 bytes each).
+ *    + The string table offsets of the file path and document name, and the
+ *      record table index of the first text record (4 bytes each).
+ *    + The number of text records and record size (2 bytes each).
+ *  + The word table having one entry of #IDX_TERM_SIZE bytes per word sorted
+ *    by word:
+ *    + The string table offset of the word and its number of occurrences (4
+ *      bytes each).
+ *    + The offset of its postings relative to the start of the postings (8
+ *      bytes).
+ *  + The string table of null-terminated strings.  Words are in PalmOS.
+ *  + The record table: for every document, the text offset of every text
+ *    record plus the text size (4 bytes each).
+ *  + The postings: for every word, for every document it occurs in, in order,
+ *    the document number relative to that of the previous document and the
+ *    number of occurrences followed by, for every occurrence, its word number
+ *    and text offset relative to those of the previous occurrence, all as
+ *    variable-length integers.
+ */
+
+// local
+#include "pjl_config.h"
+#include "docmap.h"
+#include "options.h"
+#include "palm.h"
+#include "pool.h"
+#include "unicode.h"
+#include "util.h"
+
+// standard
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>                      /* for open() */
+#include <getopt.h>
+#include <inttypes.h>                   /* for PRIu64 */
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>                   /* for mmap() */
+#include <sys/stat.h>
+#include <sysexits.h>
+#include <unistd.h>                     /* for close() */
+
+#define CONTEXT_MAX   60                /* most context each side of a match */
+#define PHRASE_MAX    32                /* most words in a query */
+#define TERM_MAX      64                /* longest word indexed */
+
+#define IDX_MAGIC     "T2PDIDX1"        /* index file magic number */
+#define IDX_MAGIC_LEN (sizeof IDX_MAGIC - 1)
+#define IDX_HDR_SIZE  56                /* size of index file header */
+#define IDX_DOC_SIZE  32                /* size of document table entry */
+#define IDX_TERM_SIZE 16                /* size of word table entry */
+
+#define EXIT_NO_MATCH 1                 /* like grep(1) */
+
+/**
+ * A growable byte buffer.
+ */
+struct vbuf {
+  Byte   *data;                         ///< The bytes.
+  size_t  len;                          ///< Number of bytes used.
+  size_t  cap;                          ///< Number of bytes allocated.
+};
+typedef struct vbuf vbuf_t;
+
+/**
+ * A word and its occurrences.
+ *
+ * @remarks In the table of a single document, \a enc contains just the
+ * occurrences; in the table being built for the index, it contains postings
+ * as they're written to the index file.
+ */
+struct term {
+  Byte     *str;                        ///< The word in PalmOS.
+  size_t    len;                        ///< Length of \a str.
+  uint32_t  hash;                       ///< Hash of \a str.
+  uint32_t  count;                      ///< Number of occurrences.
+  uint32_t  last_doc;                   ///< Document of the last occurrence.
+  uint32_t  last_ord;                   ///< Word number of the last one.
+  uint32_t  last_off;                   ///< Text offset of the last one.
+  vbuf_t    enc;                        ///< Encoded occurrences.
+};
+typedef struct term term_t;
+
+/**
+ * A hash table of words.
+ */
+struct term_table {
+  term_t   *terms;                      ///< The words.
+  uint32_t  num_terms;                  ///< Number of words.
+  uint32_t  cap;                        ///< Capacity of \a terms.
+  uint32_t *slots;                      ///< Indices+1 of \a terms; 0 = empty.
+  uint32_t  num_slots;                  ///< Number of slots; a power of 2.
+};
+typedef struct term_table term_table_t;
+
+/**
+ * A document in the index being built.
+ */
+struct build_doc {
+  char const *path;                     ///< Path of the file.
+  char const *name;                     ///< Document name as UTF-8.
+  uint64_t    size;                     ///< Size of the file.
+  uint64_t    mtime;                    ///< Modification time of the file.
+  uint32_t   *rec_starts;               ///< Text offsets of records + size.
+  unsigned    num_records;              ///< Number of text records.
+  unsigned    rec_size;                 ///< Maximum size of a text record.
+};
+typedef struct build_doc build_doc_t;
+
+/**
+ * A memory-mapped index file.
+ */
+struct index {
+  uint8_t const  *map;                  ///< The index file.
+  size_t          size;                 ///< Size of \a map.
+  uint32_t        num_docs;             ///< Number of documents.
+  uint32_t        num_terms;            ///< Number of words.
+  uint8_t const  *docs;                 ///< Document table.
+  uint8_t const  *terms;                ///< Word table.
+  char const     *strings;              ///< String table...
+  size_t          strings_size;         ///< ...and its size.
+  uint8_t const  *recs;                 ///< Record table...
+  size_t          num_recs;             ///< ...and its number of entries.
+  uint8_t const  *postings;             ///< Postings...
+  size_t          postings_size;        ///< ...and their size.
+};
+typedef struct index index_t;
+
+/**
+ * An occurrence of a word.
+ */
+struct posting {
+  uint32_t  doc;                        ///< Document number.
+  uint32_t  ord;                        ///< Word number.
+  uint32_t  off;                        ///< Text offset.
+};
+typedef struct posting posting_t;
+
+/**
+ * The state of splitting text into words.
+ */
+struct tokenizer {
+  Byte      word[ TERM_MAX ];           ///< Current word, in lower case.
+  size_t    len;                        ///< Length of the current word.
+  bool      too_long;                   ///< Is the current word too long?
+  uint32_t  start;                      ///< Text offset of the current word.
+  uint32_t  ord;                        ///< Word number of the current word.
+};
+typedef struct tokenizer tokenizer_t;
+
+////////// extern variables ///////////////////////////////////////////////////
+
+char const  *me;
+
+////////// local variables ////////////////////////////////////////////////////
+
+static bool           opt_count;        // print only counts
+static bool           opt_list;         // print only names of matching files
+static bool           opt_no_check_doc; // don't check type & creator
+static bool           opt_query;        // query rather than build
+static unsigned       opt_jobs;         // number of threads
+
+static char const    *index_path;       // path of the index file
+static char const *const
+                     *args;             // files to index or words to find
+static size_t         num_args;         // number of them
+
+static Byte           fold[ 256 ];      // PalmOS character -> lower case
+static bool           is_word[ 256 ];   // is PalmOS character in a word?
+
+static index_t        old_index;        // index being updated, if any
+static build_doc_t   *docs;             // documents of the new index
+static uint32_t       num_docs;         // number of them
+static term_table_t   terms;            // words of the new index
+static Byte         **worker_bufs;      // record buffer of each worker
+static size_t        *worker_buf_caps;  // capacity of each
+
+static pthread_mutex_t mtx = PTHREAD_MUTEX_INITIALIZER;
+static int            exit_status = EXIT_SUCCESS; // guarded by mtx
+
+////////// local functions ////////////////////////////////////////////////////
+
+static void process_options( int, char*[] );
+static void usage( void );
+
+/**
+ * Prints an error message about a file and records the exit status.
+ *
+ * @param status The exit status.
+ * @param path The path of the file.
+ * @param format The `printf()` format string.
+ */
+ATTRIBUTE_FORMAT(( printf, 3, 4 ))
+static void file_error( int status, char const *path, char const *format,
+                        ... ) {
+  char msg[ 256 ];
+  va_list args_;
+  va_start( args_, format );
+  vsnprintf( msg, sizeof msg, format, args_ );
+  va_end( args_ );
+  pthread_mutex_lock( &mtx );
+  PMESSAGE( "%s: %s\n", path, msg );
+  if ( exit_status == EXIT_SUCCESS || exit_status == EXIT_NO_MATCH )
+    exit_status = status;
+  pthread_mutex_unlock( &mtx );
+}
+
+/**
+ * Reads a little-endian integer.
+ *
+ * @param p A pointer to the integer.
+ * @param n The number of bytes of the integer.
+ * @return Returns said integer.
+ */
+NODISCARD
+static uint64_t get_le( uint8_t const *p, unsigned n ) {
+  uint64_t v = 0;
+  while ( n-- > 0 )
+    v = v << 8 | p[n];
+  return v;
+}
+
+/**
+ * Reads a variable-length integer.
+ *
+ * @param p A pointer to the pointer to the integer; it's advanced past it.
+ * @param end A pointer to one past the last byte that may be read.
+ * @param v Set to the integer.
+ * @return Returns `true` only if successful.
+ */
+NODISCARD
+static bool get_varint( uint8_t const **p, uint8_t const *end, uint32_t *v ) {
+  *v = 0;
+  for ( unsigned shift = 0; shift < 35 && *p < end; shift += 7 ) {
+    Byte const b = *(*p)++;
+    *v |= STATIC_CAST( uint32_t, b & 0x7F ) << shift;
+    if ( (b & 0x80) == 0 )
+      return true;
+  } // for
+  return false;
+}
+
+/**
+ * Gets the modification time of a file.
+ *
+ * @param st The status of the file.
+ * @return Returns its modification time in nanoseconds.
+ */
+NODISCARD
+static uint64_t mtime_ns( struct stat const *st ) {
+  return STATIC_CAST( uint64_t, st->st_mtim.tv_sec ) * 1000000000u +
+         STATIC_CAST( uint64_t, st->st_mtim.tv_nsec );
+}
+
+/**
+ * Writes a little-endian integer.
+ *
+ * @param v The integer.
+ * @param n The number of bytes to write.
+ * @param fout The file to write to.
+ */
+static void put_le( uint64_t v, unsigned n, FILE *fout ) {
+  Byte buf[8];
+  for ( unsigned i = 0; i < n; ++i, v >>= 8 )
+    buf[i] = STATIC_CAST( Byte, v );
+  FWRITE( buf, 1, n, fout );
+}
+
+/**
+ * Appends bytes to a vbuf.
+ *
+ * @param vb The vbuf to append to.
+ * @param p The bytes to append.
+ * @param len The number of bytes.
+ */
+static void vbuf_append( vbuf_t *vb, void const *p, size_t len ) {
+  if ( vb->len + len > vb->cap ) {
+    while ( vb->len + len > vb->cap )
+      vb->cap = vb->cap ? vb->cap * 2 : 8;
+    vb->data = check_realloc( vb->data, vb->cap );
+  }
+  memcpy( vb->data + vb->len, p, len );
+  vb->len += len;
+}
+
+/**
+ * Appends a variable-length integer to a vbuf.
+ *
+ * @param vb The vbuf to append to.
+ * @param v The integer.
+ */
+static void vbuf_varint( vbuf_t *vb, uint32_t v ) {
+  Byte buf[5];
+  size_t n = 0;
+  for ( ; v >= 0x80; v >>= 7 )
+    buf[ n++ ] = STATIC_CAST( Byte, v | 0x80 );
+  buf[ n++ ] = STATIC_CAST( Byte, v );
+  vbuf_append( vb, buf, n );
+}
+
+/**
+ * Compares two words the way they're sorted in an index.
+ *
+ * @param s1 The first word.
+ * @param len1 The length of \a s1.
+ * @param s2 The second word.
+ * @param len2 The length of \a s2.
+ * @return Returns a number less than 0, 0, or greater than 0 if \a s1 is
+ * less than, equal to, or greater than \a s2, respectively.
+ */
+NODISCARD
+static int term_cmp( Byte const *s1, size_t len1, Byte const *s2,
+                     size_t len2 ) {
+  int const cmp = memcmp( s1, s2, len1 < len2 ? len1 : len2 );
+  if ( cmp != 0 )
+    return cmp;
+  return len1 < len2 ? -1 : len1 > len2;
+}
+
+/**
+ * Compares two words for qsort(3).
+ *
+ * @param p1 A pointer to a pointer to the first term.
+ * @param p2 A pointer to a pointer to the second term.
+ * @return Returns as term_cmp() does.
+ */
+NODISCARD
+static int term_ptr_cmp( void const *p1, void const *p2 ) {
+  term_t const *const t1 = *STATIC_CAST( term_t const *const*, p1 );
+  term_t const *const t2 = *STATIC_CAST( term_t const *const*, p2 );
+  return term_cmp( t1->str, t1->len, t2->str, t2->len );
+}
+
+/**
+ * Frees the words of a term_table.
+ *
+ * @param tt The term_table to free.
+ */
+static void term_table_free( term_table_t *tt ) {
+  for ( uint32_t i = 0; i < tt->num_terms; ++i ) {
+    free( tt->terms[i].str );
+    free( tt->terms[i].enc.data );
+  } // for
+  free( tt->terms );
+  free( tt->slots );
+  memset( tt, 0, sizeof *tt );
+}
+
+/**
+ * Gets a word from a term_table, adding it if it's not there.
+ *
+ * @param tt The term_table to use.
+ * @param str The word.
+ * @param len The length of \a str.
+ * @return Returns said word.
+ */
+NODISCARD
+static term_t* term_table_get( term_table_t *tt, Byte const *str, size_t len ) {
+  uint32_t hash = 2166136261u;          // FNV-1a
+  for ( size_t i = 0; i < len; ++i )
+    hash = (hash ^ str[i]) * 16777619u;
+
+  if ( tt->num_terms >= tt->num_slots / 2 ) {
+    uint32_t const num_slots = tt->num_slots ? tt->num_slots * 2 : 1024;
+    uint32_t *const slots = check_realloc( NULL, num_slots * sizeof *slots );
+    memset( slots, 0, num_slots * sizeof *slots );
+    for ( uint32_t i = 0; i < tt->num_terms; ++i ) {
+      uint32_t s = tt->terms[i].hash & (num_slots - 1);
+      while ( slots[s] != 0 )
+        s = (s + 1) & (num_slots - 1);
+      slots[s] = i + 1;
+    } // for
+    free( tt->slots );
+    tt->slots = slots;
+    tt->num_slots = num_slots;
+  }
+
+  uint32_t s = hash & (tt->num_slots - 1);
+  for ( ; tt->slots[s] != 0; s = (s + 1) & (tt->num_slots - 1) ) {
+    term_t *const t = &tt->terms[ tt->slots[s] - 1 ];
+    if ( t->hash == hash && t->len == len && memcmp( t->str, str, len ) == 0 )
+      return t;
+  } // for
+
+  if ( tt->num_terms == tt->cap ) {
+    tt->cap = tt->cap ? tt->cap * 2 : 256;
+    tt->terms = check_realloc( tt->terms, tt->cap * sizeof *tt->terms );
+  }
+  term_t *const t = &tt->terms[ tt->num_terms ];
+  memset( t, 0, sizeof *t );
+  t->str = check_realloc( NULL, len );
+  memcpy( t->str, str, len );
+  t->len = len;
+  t->hash = hash;
+  tt->slots[s] = ++tt->num_terms;
+  return t;
+}
+
+/**
+ * Adds the occurrences of a word in a document to the postings of a word.
+ *
+ * @param t The word to add to.
+ * @param doc The document number.
+ * @param count The number of occurrences.
+ * @param enc The encoded occurrences.
+ * @param enc_len The number of bytes of \a enc.
+ */
+static void term_add_doc( term_t *t, uint32_t doc, uint32_t count,
+                          Byte const *enc, size_t enc_len ) {
+  vbuf_varint( &t->enc, doc - t->last_doc );
+  vbuf_varint( &t->enc, count );
+  vbuf_append( &t->enc, enc, enc_len );
+  t->last_doc = doc;
+  t->count += count;
+}
+
+/**
+ * Initializes #fold and #is_word.
+ */
+static void init_tables( void ) {
+  palm_fold_table( fold );
+  for ( unsigned c = 0; c < 256; ++c ) {
+    if ( fold[c] != c )
+      is_word[c] = is_word[ fold[c] ] = true;
+    else if ( c < 0x80 && isalnum( STATIC_CAST( int, c ) ) )
+      is_word[c] = true;
+  } // for
+  is_word[ 0xDF ] = true;               // sharp s
+}
+
+/**
+ * Splits text into words and adds them to a term_table.
+ *
+ * @param k The tokenizer to use.
+ * @param tt The term_table to add to.
+ * @param text The text.
+ * @param len The length of \a text; if 0, ends the current word, if any.
+ * @param base The text offset of \a text.
+ */
+static void tokenize( tokenizer_t *k, term_table_t *tt, Byte const *text,
+                      size_t len, uint32_t base ) {
+  for ( size_t i = 0; i <= len; ++i ) {
+    if ( i < len && is_word[ text[i] ] ) {
+      if ( k->len == 0 && !k->too_long )
+        k->start = base + STATIC_CAST( uint32_t, i );
+      if ( k->len < TERM_MAX )
+        k->word[ k->len++ ] = fold[ text[i] ];
+      else
+        k->too_long = true;
+      continue;
+    }
+    if ( i == len && len > 0 )
+      break;                            // word may continue in next record
+    if ( k->len == 0 )
+      continue;
+    if ( !k->too_long ) {
+      term_t *const t = term_table_get( tt, k->word, k->len );
+      vbuf_varint( &t->enc, k->ord - t->last_ord );
+      vbuf_varint( &t->enc, k->start - t->last_off );
+      t->last_ord = k->ord;
+      t->last_off = k->start;
+      ++t->count;
+    }
+    ++k->ord;                           // count words too long anyway
+    k->len = 0;
+    k->too_long = false;
+  } // for
+}
+
+////////// index reading //////////////////////////////////////////////////////
+
+/**
+ * Prints an error message that an index is corrupt and exits.
+ *
+ * @param path The path of the index.
+ */
+static void index_corrupt( char const *path ) {
+  PMESSAGE_EXIT( EX_DATAERR, "%s: corrupt index\n", path );
+}
+
+/**
+ * Gets a string from an index.
+ *
+ * @param ix The index to use.
+ * @param off The string table offset of the string.
+ * @return Returns said string; exits if invalid.
+ */
+NODISCARD
+static char const* index_str( index_t const *ix, uint64_t off ) {
+  if ( off >= ix->strings_size ||
+       memchr( ix->strings + off, '\0', ix->strings_size - off ) == NULL ) {
+    index_corrupt( index_path );
+  }
+  return ix->strings + off;
+}
+
+/**
+ * Gets a document from an index.
+ *
+ * @param ix The index to use.
+ * @param i The document number.
+ * @param d Set to the document.  Its \a rec_starts points to a copy.
+ */
+static void index_doc( index_t const *ix, uint32_t i, build_doc_t *d ) {
+  uint8_t const *const e = ix->docs + (size_t)i * IDX_DOC_SIZE;
+  d->size = get_le( e, 8 );
+  d->mtime = get_le( e + 8, 8 );
+  d->path = index_str( ix, get_le( e + 16, 4 ) );
+  d->name = index_str( ix, get_le( e + 20, 4 ) );
+  uint64_t const rec = get_le( e + 24, 4 );
+  d->num_records = STATIC_CAST( unsigned, get_le( e + 28, 2 ) );
+  d->rec_size = STATIC_CAST( unsigned, get_le( e + 30, 2 ) );
+  if ( rec + d->num_records + 1 > ix->num_recs )
+    index_corrupt( index_path );
+  d->rec_starts = MALLOC( uint32_t, d->num_records + 1 );
+  for ( unsigned r = 0; r <= d->num_records; ++r )
+    d->rec_starts[r] = STATIC_CAST( uint32_t,
+      get_le( ix->recs + (rec + r) * 4, 4 )
+    );
+}
+
+/**
+ * Gets a word from an index.
+ *
+ * @param ix The index to use.
+ * @param i The word number.
+ * @param count Set to the number of occurrences.
+ * @param p Set to the start of its postings.
+ * @param end Set to one past the end of its postings.
+ * @return Returns the word.
+ */
+static char const* index_term( index_t const *ix, uint32_t i, uint32_t *count,
+                               uint8_t const **p, uint8_t const **end ) {
+  uint8_t const *const e = ix->terms + (size_t)i * IDX_TERM_SIZE;
+  char const *const str = index_str( ix, get_le( e, 4 ) );
+  *count = STATIC_CAST( uint32_t, get_le( e + 4, 4 ) );
+  uint64_t const begin = get_le( e + 8, 8 );
+  uint64_t const next = i + 1 < ix->num_terms ?
+    get_le( e + IDX_TERM_SIZE + 8, 8 ) : ix->postings_size;
+  if ( begin > next || next > ix->postings_size )
+    index_corrupt( index_path );
+  *p = ix->postings + begin;
+  *end = ix->postings + next;
+  return str;
+}
+
+/**
+ * Memory-maps an index file.
+ *
+ * @param ix The index to use.
+ * @param path The path of the index file.
+ * @return Returns `true` only if successful or `false` only if the file
+ * doesn't exist; exits on any other error.
+ */
+NODISCARD
+static bool index_open( index_t *ix, char const *path ) {
+  int const fd = open( path, O_RDONLY );
+  if ( fd == -1 ) {
+    if ( errno == ENOENT )
+      return false;
+    PMESSAGE_EXIT( EX_NOINPUT, "%s: %s\n", path, STRERROR );
+  }
+  struct stat st;
+  FSTAT( fd, &st );
+  ix->size = STATIC_CAST( size_t, st.st_size );
+  if ( ix->size < IDX_HDR_SIZE )
+    index_corrupt( path );
+  void *const p = mmap( NULL, ix->size, PROT_READ, MAP_PRIVATE, fd, 0 );
+  if ( p == MAP_FAILED )
+    PMESSAGE_EXIT( EX_NOINPUT, "%s: %s\n", path, STRERROR );
+  close( fd );
+  ix->map = p;
+
+  uint8_t const *const h = ix->map;
+  if ( memcmp( h, IDX_MAGIC, IDX_MAGIC_LEN ) != 0 )
+    PMESSAGE_EXIT( EX_DATAERR, "%s: not an index file\n", path );
+  ix->num_docs = STATIC_CAST( uint32_t, get_le( h + 8, 4 ) );
+  ix->num_terms = STATIC_CAST( uint32_t, get_le( h + 12, 4 ) );
+  uint64_t const docs_off = get_le( h + 16, 8 );
+  uint64_t const terms_off = get_le( h + 24, 8 );
+  uint64_t const strings_off = get_le( h + 32, 8 );
+  uint64_t const recs_off = get_le( h + 40, 8 );
+  uint64_t const postings_off = get_le( h + 48, 8 );
+  if ( docs_off != IDX_HDR_SIZE ||
+       terms_off != docs_off + (uint64_t)ix->num_docs * IDX_DOC_SIZE ||
+       strings_off != terms_off + (uint64_t)ix->num_terms * IDX_TERM_SIZE ||
+       recs_off < strings_off ||
+       postings_off < recs_off || (postings_off - recs_off) % 4 != 0 ||
+       postings_off > ix->size ) {
+    index_corrupt( path );
+  }
+  ix->docs = h + docs_off;
+  ix->terms = h + terms_off;
+  ix->strings = (char const*)h + strings_off;
+  ix->strings_size = STATIC_CAST( size_t, recs_off - strings_off );
+  ix->recs = h + recs_off;
+  ix->num_recs = STATIC_CAST( size_t, (postings_off - recs_off) / 4 );
+  ix->postings = h + postings_off;
+  ix->postings_size = ix->size - STATIC_CAST( size_t, postings_off );
+  return true;
+}
+
+////////// building ///////////////////////////////////////////////////////////
+
+/**
+ * Adds the postings of an existing index for documents that are unchanged to
+ * the new index.
+ *
+ * @param remap For each document number of the old index, the number of the
+ * same document in the new index or `UINT32_MAX` if it's not unchanged.
+ */
+static void reuse_postings( uint32_t const *remap ) {
+  for ( uint32_t i = 0; i < old_index.num_terms; ++i ) {
+    uint32_t count;
+    uint8_t const *p, *end;
+    char const *const str = index_term( &old_index, i, &count, &p, &end );
+    term_t *t = NULL;
+    uint32_t doc = 0;
+    while ( count > 0 ) {
+      uint32_t doc_delta, n, v;
+      if ( !get_varint( &p, end, &doc_delta ) || !get_varint( &p, end, &n ) ||
+           n == 0 || n > count ) {
+        index_corrupt( index_path );
+      }
+      doc += doc_delta;
+      count -= n;
+      uint8_t const *const enc = p;
+      for ( uint32_t j = 0; j < 2 * n; ++j ) {
+        if ( !get_varint( &p, end, &v ) )
+          index_corrupt( index_path );
+      } // for
+      if ( doc >= old_index.num_docs )
+        index_corrupt( index_path );
+      if ( remap[ doc ] == UINT32_MAX )
+        continue;
+      if ( t == NULL )
+        t = term_table_get( &terms, (Byte const*)str, strlen( str ) );
+      term_add_doc( t, remap[ doc ], n, enc, STATIC_CAST( size_t, p - enc ) );
+    } // while
+  } // for
+}
+
+/**
+ * Decodes a document, splits its text into words, and adds them to the new
+ * index.
+ *
+ * @param data Not used.
+ * @param worker The index of the worker.
+ * @param job The index of the file in #args.
+ */
+static void index_job( void *data, unsigned worker, size_t job ) {
+  (void)data;
+  doc_map_t d;
+  int const status = doc_map_open( &d, args[ job ], !opt_no_check_doc );
+  if ( status != EXIT_SUCCESS ) {
+    file_error( status, d.path, "%s", d.error );
+    return;
+  }
+
+  if ( d.rec_size > worker_buf_caps[ worker ] ) {
+    worker_buf_caps[ worker ] = d.rec_size;
+    worker_bufs[ worker ] =
+      check_realloc( worker_bufs[ worker ], worker_buf_caps[ worker ] );
+  }
+  Byte *const buf = worker_bufs[ worker ];
+
+  term_table_t tt = { .terms = NULL };
+  tokenizer_t k = { .len = 0 };
+  uint32_t *const rec_starts = MALLOC( uint32_t, d.num_records + 1 );
+  uint32_t text_size = 0;
+
+  for ( unsigned rec_num = 1; rec_num <= d.num_records; ++rec_num ) {
+    size_t len;
+    if ( !doc_map_read( &d, rec_num, buf, &len ) ) {
+      file_error( EX_DATAERR, d.path, "%s", d.error );
+      doc_map_close( &d );
+      term_table_free( &tt );
+      free( rec_starts );
+      return;
+    }
+    rec_starts[ rec_num - 1 ] = text_size;
+    tokenize( &k, &tt, buf, len, text_size );
+    text_size += STATIC_CAST( uint32_t, len );
+  } // for
+  tokenize( &k, &tt, NULL, 0, text_size );
+  rec_starts[ d.num_records ] = text_size;
+  doc_map_close( &d );
+
+  pthread_mutex_lock( &mtx );
+  uint32_t const doc = num_docs++;
+  docs[ doc ] = (build_doc_t){
+    .path = d.path,
+    .name = check_strdup( d.name ),
+    .size = STATIC_CAST( uint64_t, d.st.st_size ),
+    .mtime = mtime_ns( &d.st ),
+    .rec_starts = rec_starts,
+    .num_records = d.num_records,
+    .rec_size = d.rec_size
+  };
+  for ( uint32_t i = 0; i < tt.num_terms; ++i ) {
+    term_t const *const lt = &tt.terms[i];
+    term_add_doc(
+      term_table_get( &terms, lt->str, lt->len ), doc, lt->count,
+      lt->enc.data, lt->enc.len
+    );
+  } // for
+  pthread_mutex_unlock( &mtx );
+  term_table_free( &tt );
+}
+
+/**
+ * Writes the new index to a temporary file, then renames it to #index_path.
+ */
+static void index_write( void ) {
+  term_t **const sorted = MALLOC( term_t*, terms.num_terms + 1 );
+  for ( uint32_t i = 0; i < terms.num_terms; ++i )
+    sorted[i] = &terms.terms[i];
+  qsort( sorted, terms.num_terms, sizeof *sorted, &term_ptr_cmp );
+
+  uint64_t strings_size = 0;
+  uint64_t num_recs = 0;
+  for ( uint32_t i = 0; i < num_docs; ++i ) {
+    strings_size += strlen( docs[i].path ) + 1 + strlen( docs[i].name ) + 1;
+    num_recs += docs[i].num_records + 1;
+  } // for
+  for ( uint32_t i = 0; i < terms.num_terms; ++i )
+    strings_size += terms.terms[i].len + 1;
+  if ( strings_size > UINT32_MAX || num_recs > UINT32_MAX )
+    PMESSAGE_EXIT( EX_SOFTWARE, "%s: index too large\n", index_path );
+
+  uint64_t const docs_off = IDX_HDR_SIZE;
+  uint64_t const terms_off = docs_off + (uint64_t)num_docs * IDX_DOC_SIZE;
+  uint64_t const strings_off =
+    terms_off + (uint64_t)terms.num_terms * IDX_TERM_SIZE;
+  uint64_t const recs_off = strings_off + strings_size;
+  uint64_t const postings_off = recs_off + num_recs * 4;
+
+  size_t const tmp_len = strlen( index_path ) + sizeof ".tmp";
+  char *const tmp_path = MALLOC( char, tmp_len );
+  snprintf( tmp_path, tmp_len, "%s.tmp", index_path );
+  FILE *const fout = fopen( tmp_path, "wb" );
+  if ( fout == NULL )
+    PMESSAGE_EXIT( EX_CANTCREAT, "%s: %s\n", tmp_path, STRERROR );
+
+  ////////// header ///////////////////////////////////////////////////////////
+
+  FWRITE( IDX_MAGIC, 1, IDX_MAGIC_LEN, fout );
+  put_le( num_docs, 4, fout );
+  put_le( terms.num_terms, 4, fout );
+  put_le( docs_off, 8, fout );
+  put_le( terms_off, 8, fout );
+  put_le( strings_off, 8, fout );
+  put_le( recs_off, 8, fout );
+  put_le( postings_off, 8, fout );
+
+  ////////// document & word tables ///////////////////////////////////////////
+
+  uint64_t str_off = 0, rec = 0;
+  for ( uint32_t i = 0; i < num_docs; ++i ) {
+    build_doc_t const *const d = &docs[i];
+    put_le( d->size, 8, fout );
+    put_le( d->mtime, 8, fout );
+    put_le( str_off, 4, fout );
+    str_off += strlen( d->path ) + 1;
+    put_le( str_off, 4, fout );
+    str_off += strlen( d->name ) + 1;
+    put_le( rec, 4, fout );
+    rec += d->num_records + 1;
+    put_le( d->num_records, 2, fout );
+    put_le( d->rec_size, 2, fout );
+  } // for
+  uint64_t post_off = 0;
+  for ( uint32_t i = 0; i < terms.num_terms; ++i ) {
+    put_le( str_off, 4, fout );
+    str_off += sorted[i]->len + 1;
+    put_le( sorted[i]->count, 4, fout );
+    put_le( post_off, 8, fout );
+    post_off += sorted[i]->enc.len;
+  } // for
+
+  ////////// strings, records, & postings /////////////////////////////////////
+
+  for ( uint32_t i = 0; i < num_docs; ++i ) {
+    FWRITE( docs[i].path, 1, strlen( docs[i].path ) + 1, fout );
+    FWRITE( docs[i].name, 1, strlen( docs[i].name ) + 1, fout );
+  } // for
+  for ( uint32_t i = 0; i < terms.num_terms; ++i ) {
+    FWRITE( sorted[i]->str, 1, sorted[i]->len, fout );
+    FPUTC( '\0', fout );
+  } // for
+  for ( uint32_t i = 0; i < num_docs; ++i ) {
+    for ( unsigned r = 0; r <= docs[i].num_records; ++r )
+      put_le( docs[i].rec_starts[r], 4, fout );
+  } // for
+  for ( uint32_t i = 0; i < terms.num_terms; ++i )
+    FWRITE( sorted[i]->enc.data, 1, sorted[i]->enc.len, fout );
+
+  if ( fclose( fout ) == EOF )
+    PERROR_EXIT( EX_IOERR );
+  if ( rename( tmp_path, index_path ) == -1 )
+    PMESSAGE_EXIT( EX_CANTCREAT, "%s: %s\n", index_path, STRERROR );
+  free( tmp_path );
+  free( sorted );
+}
+
+/**
+ * Compares the paths of two documents of the old index for qsort(3).
+ *
+ * @param p1 A pointer to the first document number.
+ * @param p2 A pointer to the second document number.
+ * @return Returns as strcmp(3) does.
+ */
+NODISCARD
+static int old_doc_cmp( void const *p1, void const *p2 ) {
+  uint32_t const i1 = *STATIC_CAST( uint32_t const*, p1 );
+  uint32_t const i2 = *STATIC_CAST( uint32_t const*, p2 );
+  uint8_t const *const e1 = old_index.docs + (size_t)i1 * IDX_DOC_SIZE;
+  uint8_t const *const e2 = old_index.docs + (size_t)i2 * IDX_DOC_SIZE;
+  return strcmp(
+    index_str( &old_index, get_le( e1 + 16, 4 ) ),
+    index_str( &old_index, get_le( e2 + 16, 4 ) )
+  );
+}
+
+/**
+ * Builds or updates the index.
+ */
+static void build( void ) {
+  bool const have_old = index_open( &old_index, index_path );
+  build_doc_t *old_docs = NULL;
+  char const **old_paths = NULL;
+  if ( num_args == 0 ) {                // update every document in the index
+    if ( !have_old )
+      PMESSAGE_EXIT( EX_NOINPUT, "%s: %s\n", index_path, strerror( ENOENT ) );
+    old_paths = MALLOC( char const*, old_index.num_docs + 1 );
+    for ( uint32_t i = 0; i < old_index.num_docs; ++i ) {
+      uint8_t const *const e = old_index.docs + (size_t)i * IDX_DOC_SIZE;
+      old_paths[i] = index_str( &old_index, get_le( e + 16, 4 ) );
+    } // for
+    args = old_paths;
+    num_args = old_index.num_docs;
+  }
+
+  docs = MALLOC( build_doc_t, num_args + 1 );
+  bool *const unchanged = MALLOC( bool, num_args + 1 );
+  memset( unchanged, 0, num_args );
+  uint32_t *remap = NULL;
+
+  if ( have_old && old_index.num_docs > 0 ) {
+    //
+    // Find the documents whose size and modification time haven't changed.
+    //
+    uint32_t const n = old_index.num_docs;
+    uint32_t *const by_path = MALLOC( uint32_t, n );
+    remap = MALLOC( uint32_t, n );
+    for ( uint32_t i = 0; i < n; ++i ) {
+      by_path[i] = i;
+      remap[i] = UINT32_MAX;
+    } // for
+    qsort( by_path, n, sizeof *by_path, &old_doc_cmp );
+
+    old_docs = MALLOC( build_doc_t, n );
+    for ( size_t a = 0; a < num_args; ++a ) {
+      struct stat st;
+      if ( stat( args[a], &st ) == -1 )
+        continue;                       // reported by index_job()
+      uint32_t lo = 0, hi = n;          // find by path
+      while ( lo < hi ) {
+        uint32_t const mid = lo + (hi - lo) / 2;
+        uint8_t const *const e = old_index.docs + (size_t)by_path[mid] *
+          IDX_DOC_SIZE;
+        int const cmp = strcmp(
+          args[a], index_str( &old_index, get_le( e + 16, 4 ) )
+        );
+        if ( cmp == 0 ) {
+          lo = mid;
+          break;
+        }
+        if ( cmp < 0 )
+          hi = mid;
+        else
+          lo = mid + 1;
+      } // while
+      if ( lo >= hi )
+        continue;
+      uint32_t const i = by_path[ lo ];
+      if ( remap[i] != UINT32_MAX )
+        continue;                       // given more than once
+      index_doc( &old_index, i, &old_docs[i] );
+      if ( old_docs[i].size != STATIC_CAST( uint64_t, st.st_size ) ||
+           old_docs[i].mtime != mtime_ns( &st ) ) {
+        free( old_docs[i].rec_starts );
+        continue;
+      }
+      remap[i] = 0;
+      unchanged[a] = true;
+    } // for
+
+    //
+    // Unchanged documents get the first numbers in the new index, in the same
+    // order as in the old index, so their postings remain in order.
+    //
+    for ( uint32_t i = 0; i < n; ++i ) {
+      if ( remap[i] == UINT32_MAX )
+        continue;
+      remap[i] = num_docs;
+      docs[ num_docs++ ] = old_docs[i];
+    } // for
+    reuse_postings( remap );
+    free( by_path );
+  }
+
+  //
+  // Decode the rest.
+  //
+  size_t num_jobs = 0;
+  char const **const job_paths = MALLOC( char const*, num_args + 1 );
+  for ( size_t a = 0; a < num_args; ++a ) {
+    if ( !unchanged[a] )
+      job_paths[ num_jobs++ ] = args[a];
+  } // for
+  args = job_paths;
+  if ( num_jobs > 0 ) {
+    unsigned jobs = opt_jobs ? opt_jobs : pool_default_workers();
+    if ( jobs > num_jobs )
+      jobs = STATIC_CAST( unsigned, num_jobs );
+    worker_bufs = MALLOC( Byte*, jobs );
+    worker_buf_caps = MALLOC( size_t, jobs );
+    memset( worker_bufs, 0, jobs * sizeof *worker_bufs );
+    memset( worker_buf_caps, 0, jobs * sizeof *worker_buf_caps );
+    pool_run( num_jobs, jobs, &index_job, NULL );
+  }
+
+  index_write();
+  free( job_paths );
+  free( unchanged );
+  free( remap );
+  free( old_docs );
+  free( old_paths );
+}
+
+////////// querying ///////////////////////////////////////////////////////////
+
+/**
+ * Finds a word in the index.
+ *
+ * @param ix The index to use.
+ * @param word The word in PalmOS.
+ * @param len The length of \a word.
+ * @return Returns the word number or `UINT32_MAX` if not found.
+ */
+NODISCARD
+static uint32_t find_term( index_t const *ix, Byte const *word, size_t len ) {
+  uint32_t lo = 0, hi = ix->num_terms;
+  while ( lo < hi ) {
+    uint32_t const mid = lo + (hi - lo) / 2;
+    uint8_t const *const e = ix->terms + (size_t)mid * IDX_TERM_SIZE;
+    char const *const str = index_str( ix, get_le( e, 4 ) );
+    int const cmp = term_cmp( word, len, (Byte const*)str, strlen( str ) );
+    if ( cmp == 0 )
+      return mid;
+    if ( cmp < 0 )
+      hi = mid;
+    else
+      lo = mid + 1;
+  } // while
+  return UINT32_MAX;
+}
+
+/**
+ * Decodes all the postings of a word.
+ *
+ * @param ix The index to use.
+ * @param term The word number.
+ * @param count Set to the number of postings.
+ * @return Returns said postings.
+ */
+NODISCARD
+static posting_t* get_postings( index_t const *ix, uint32_t term,
+                                uint32_t *count ) {
+  uint8_t const *p, *end;
+  index_term( ix, term, count, &p, &end );
+  posting_t *const postings = MALLOC( posting_t, *count + 1 );
+  uint32_t doc = 0;
+  for ( uint32_t i = 0; i < *count; ) {
+    uint32_t doc_delta, n;
+    if ( !get_varint( &p, end, &doc_delta ) || !get_varint( &p, end, &n ) ||
+         n == 0 || n > *count - i ) {
+      index_corrupt( index_path );
+    }
+    doc += doc_delta;
+    if ( doc >= ix->num_docs )
+      index_corrupt( index_path );
+    uint32_t ord = 0, off = 0;
+    for ( ; n > 0; --n, ++i ) {
+      uint32_t ord_delta, off_delta;
+      if ( !get_varint( &p, end, &ord_delta ) ||
+           !get_varint( &p, end, &off_delta ) ) {
+        index_corrupt( index_path );
+      }
+      ord += ord_delta;
+      off += off_delta;
+      postings[i] = (posting_t){ .doc = doc, .ord = ord, .off = off };
+    } // for
+  } // for
+  return postings;
+}
+
+/**
+ * Checks whether a word occurs in a document at a word number.
+ *
+ * @param postings The postings of the word.
+ * @param count The number of \a postings.
+ * @param doc The document number.
+ * @param ord The word number.
+ * @return Returns a pointer to the posting or NULL if none.
+ */
+NODISCARD
+static posting_t const* has_posting( posting_t const *postings, uint32_t count,
+                                     uint32_t doc, uint32_t ord ) {
+  uint32_t lo = 0, hi = count;
+  while ( lo < hi ) {
+    uint32_t const mid = lo + (hi - lo) / 2;
+    posting_t const *const m = &postings[ mid ];
+    if ( m->doc == doc && m->ord == ord )
+      return m;
+    if ( m->doc < doc || (m->doc == doc && m->ord < ord) )
+      lo = mid + 1;
+    else
+      hi = mid;
+  } // while
+  return NULL;
+}
+
+/**
+ * Prints PalmOS characters transcoded into UTF-8.  Characters that can't be
+ * transcoded are printed as `?` and newlines (of phrases spanning lines) are
+ * printed as spaces.
+ *
+ * @param s The PalmOS characters.
+ * @param len The number of characters.
+ */
+static void print_palm( Byte const *s, size_t len ) {
+  for ( size_t i = 0; i < len; ++i ) {
+    char8_t utf8[ UTF8_CHAR_SIZE_MAX ];
+    char32_t const cp = palm_to_unicode( s[i] );
+    if ( cp == 0 )
+      FPUTC( '?', stdout );
+    else if ( cp == '\n' )
+      FPUTC( ' ', stdout );
+    else
+      FWRITE( utf8, 1, utf8_encode( cp, utf8 ), stdout );
+  } // for
+}
+
+/**
+ * Prints a match: the path and name of the document, the text offset of the
+ * match, and the line containing it, decompressing only the records needed.
+ *
+ * @param d The document, mapped.
+ * @param doc The document number of \a d.
+ * @param rec_starts The text offsets of its records.
+ * @param off The text offset of the match.
+ * @param end The text offset of one past the end of the match.
+ * @return Returns `true` only if successful.
+ */
+NODISCARD
+static bool print_match( doc_map_t *d, uint32_t doc,
+                         uint32_t const *rec_starts, uint32_t off,
+                         uint32_t end ) {
+  static Byte    *text;                 // text of records first to last
+  static size_t   text_cap;
+  static uint32_t text_doc = UINT32_MAX; // document text is of
+  static unsigned text_first, text_last;
+
+  uint32_t const text_size = rec_starts[ d->num_records ];
+  if ( end > text_size ) {
+    snprintf( d->error, sizeof d->error, "text size differs from index" );
+    return false;
+  }
+  uint32_t const from = off > CONTEXT_MAX ? off - CONTEXT_MAX : 0;
+  uint32_t const to = text_size - end > CONTEXT_MAX ?
+    end + CONTEXT_MAX : text_size;
+
+  unsigned first = 1, last = d->num_records;
+  while ( first < last && rec_starts[ first ] <= from )
+    ++first;
+  while ( last > first && rec_starts[ last - 1 ] >= to )
+    --last;
+
+  if ( text_doc != doc || text_first != first || text_last != last ) {
+    text_doc = UINT32_MAX;
+    size_t const cap = (size_t)(last - first + 1) * d->rec_size;
+    if ( cap > text_cap ) {
+      text_cap = cap;
+      text = check_realloc( text, text_cap );
+    }
+    size_t len = 0;
+    for ( unsigned r = first; r <= last; ++r ) {
+      size_t rec_len;
+      if ( !doc_map_read( d, r, text + len, &rec_len ) )
+        return false;
+      if ( rec_len != rec_starts[r] - rec_starts[ r - 1 ] ) {
+        snprintf( d->error, sizeof d->error,
+          "record %u: size differs from index", r
+        );
+        return false;
+      }
+      len += rec_len;
+    } // for
+    text_doc = doc;
+    text_first = first;
+    text_last = last;
+  }
+
+  uint32_t const skew = rec_starts[ first - 1 ]; // text offset of text[0]
+  uint32_t line = off;
+  while ( line > from && text[ line - 1 - skew ] != '\n' )
+    --line;
+  uint32_t line_end = end;
+  while ( line_end < to && text[ line_end - skew ] != '\n' )
+    ++line_end;
+
+  FPRINTF( stdout, "%s:%s:%" PRIu32 ":", d->path, d->name, off );
+  print_palm( text + (line - skew), line_end - line );
+  FPUTC( '\n', stdout );
+  return true;
+}
+
+/**
+ * Looks up the words given on the command line as a phrase and prints the
+ * results.
+ */
+static void query( void ) {
+  index_t ix;
+  if ( !index_open( &ix, index_path ) )
+    PMESSAGE_EXIT( EX_NOINPUT, "%s: %s\n", index_path, strerror( ENOENT ) );
+
+  ////////// split arguments into words ///////////////////////////////////////
+
+  Byte words[ PHRASE_MAX ][ TERM_MAX ];
+  size_t word_lens[ PHRASE_MAX ];
+  size_t num_words = 0;
+  for ( size_t a = 0; a < num_args; ++a ) {
+    Byte buf[ PHRASE_MAX * (TERM_MAX + 1) ];
+    size_t const len = palm_from_utf8( args[a], buf, sizeof buf );
+    if ( len == 0 ) {
+      PMESSAGE_EXIT( EX_USAGE,
+        "\"%s\": empty, invalid, too long, "
+        "or not in the PalmOS character set\n",
+        args[a]
+      );
+    }
+    for ( size_t i = 0; i < len; ) {
+      if ( !is_word[ buf[i] ] ) {
+        ++i;
+        continue;
+      }
+      if ( num_words == PHRASE_MAX )
+        PMESSAGE_EXIT( EX_USAGE, "more than %d words\n", PHRASE_MAX );
+      size_t n = 0;
+      for ( ; i < len && is_word[ buf[i] ]; ++i, ++n ) {
+        if ( n == TERM_MAX )
+          exit( EXIT_NO_MATCH );        // too long to have been indexed
+        words[ num_words ][ n ] = fold[ buf[i] ];
+      } // for
+      word_lens[ num_words++ ] = n;
+    } // for
+  } // for
+  if ( num_words == 0 )
+    PMESSAGE_EXIT( EX_USAGE, "%s\n", "no words to find" );
+
+  ////////// find phrase //////////////////////////////////////////////////////
+
+  posting_t *postings[ PHRASE_MAX ];
+  uint32_t counts[ PHRASE_MAX ];
+  size_t rarest = 0;
+  for ( size_t w = 0; w < num_words; ++w ) {
+    uint32_t const term = find_term( &ix, words[w], word_lens[w] );
+    if ( term == UINT32_MAX )
+      exit( EXIT_NO_MATCH );
+    postings[w] = get_postings( &ix, term, &counts[w] );
+    if ( counts[w] < counts[ rarest ] )
+      rarest = w;
+  } // for
+
+  exit_status = EXIT_NO_MATCH;
+  doc_map_t d = { .pdb = NULL };
+  build_doc_t doc = { .rec_starts = NULL };
+  uint32_t cur_doc = UINT32_MAX;        // document d & doc are of
+  bool doc_ok = false;                  // can its matches be printed?
+  uint64_t doc_matches = 0;
+
+  for ( uint32_t i = 0; i <= counts[ rarest ]; ++i ) {
+    posting_t const *const r = i < counts[ rarest ] ?
+      &postings[ rarest ][i] : NULL;
+
+    if ( r == NULL || r->doc != cur_doc ) {
+      if ( cur_doc != UINT32_MAX ) {    // finish previous document
+        if ( opt_count && doc_matches > 0 )
+          FPRINTF( stdout, "%s:%s:%" PRIu64 "\n",
+            doc.path, doc.name, doc_matches
+          );
+        doc_map_close( &d );
+        free( doc.rec_starts );
+        doc.rec_starts = NULL;
+      }
+      if ( r == NULL )
+        break;
+      cur_doc = r->doc;
+      doc_matches = 0;
+      index_doc( &ix, cur_doc, &doc );
+      doc_ok = opt_count || opt_list;
+    }
+
+    if ( r->ord < rarest )
+      continue;
+    uint32_t const ord0 = r->ord - STATIC_CAST( uint32_t, rarest );
+    posting_t const *first = NULL, *last = NULL;
+    size_t w = 0;
+    for ( ; w < num_words; ++w ) {
+      posting_t const *const p = has_posting(
+        postings[w], counts[w], r->doc, ord0 + STATIC_CAST( uint32_t, w )
+      );
+      if ( p == NULL )
+        break;
+      if ( w == 0 )
+        first = p;
+      last = p;
+    } // for
+    if ( w < num_words )
+      continue;
+
+    if ( exit_status == EXIT_NO_MATCH )
+      exit_status = EXIT_SUCCESS;
+    if ( opt_list ) {
+      if ( doc_matches++ == 0 )
+        FPRINTF( stdout, "%s\n", doc.path );
+      continue;
+    }
+    if ( opt_count ) {
+      ++doc_matches;
+      continue;
+    }
+
+    if ( doc_matches++ == 0 ) {         // first match: map document
+      int const status = doc_map_open( &d, doc.path, !opt_no_check_doc );
+      if ( status != EXIT_SUCCESS ) {
+        file_error( status, doc.path, "%s", d.error );
+        continue;
+      }
+      if ( STATIC_CAST( uint64_t, d.st.st_size ) != doc.size ||
+           mtime_ns( &d.st ) != doc.mtime ||
+           d.num_records != doc.num_records ) {
+        file_error( EX_DATAERR, doc.path,
+          "changed since indexed; run %s again", me
+        );
+        doc_map_close( &d );
+        continue;
+      }
+      doc_ok = true;
+    }
+    if ( !doc_ok )
+      continue;
+    uint32_t const end =
+      last->off + STATIC_CAST( uint32_t, word_lens[ num_words - 1 ] );
+    if ( !print_match( &d, cur_doc, doc.rec_starts, first->off, end ) ) {
+      file_error( EX_DATAERR, doc.path, "%s", d.error );
+      doc_ok = false;
+    }
+  } // for
+
+  for ( size_t w = 0; w < num_words; ++w )
+    free( postings[w] );
+}
+
+////////// main ///////////////////////////////////////////////////////////////
+
+int main( int argc, char *argv[] ) {
+  process_options( argc, argv );
+  init_tables();
+
+  if ( opt_query )
+    query();
+  else
+    build();
+
+  if ( fflush( stdout ) == EOF || ferror( stdout ) )
+    PERROR_EXIT( EX_IOERR );
+  exit( exit_status );
+}
+
+////////// local functions ////////////////////////////////////////////////////
+
+/**
+ * Parses command-line options.
+ *
+ * @param argc The command-line argument count.
+ * @param argv The command-line argument values.
+ */
+static void process_options( int argc, char *argv[] ) {
+  static char const SHORT_OPTS[] = "cDj:lqV";
+  static struct option const LONG_OPTS[] = {
+    { "count",              no_argument,        NULL, 'c' },
+    { "no-check-doc",       no_argument,        NULL, 'D' },
+    { "jobs",               required_argument,  NULL, 'j' },
+    { "files-with-matches", no_argument,        NULL, 'l' },
+    { "query",              no_argument,        NULL, 'q' },
+    { "version",            no_argument,        NULL, 'V' },
+    { NULL,                 0,                  NULL, 0   }
+  };
+
+  me = strrchr( argv[0], '/' );         // determine base name...
+  me = me ? me + 1 : argv[0];           // ...of executable
+
+  opterr = 1;
+  for ( int opt;
+        (opt = getopt_long( argc, argv, SHORT_OPTS, LONG_OPTS, NULL )) != EOF; ) {
+    switch ( opt ) {
+      case 'c': opt_count = true;                                     break;
+      case 'D': opt_no_check_doc = true;                              break;
+      case 'j': opt_jobs = STATIC_CAST( unsigned, parse_ull( optarg ) ); break;
+      case 'l': opt_list = true;                                      break;
+      case 'q': opt_query = true;                                     break;
+      case 'V': printf( "pdbindex %s\n", VERSION );  exit( EXIT_SUCCESS );
+      default : usage();
+    } // switch
+    opts_given[ opt ] = true;
+  } // for
+  argc -= optind;
+  argv += optind;
+
+  check_mutually_exclusive( "c", "l" );
+  check_mutually_exclusive( "q", "j" );
+  check_required( "cl", "q" );
+
+  if ( argc < 1 || (opt_query && argc < 2) )
+    usage();
+
+  index_path = argv[0];
+  args = (char const *const*)argv + 1;
+  num_args = STATIC_CAST( size_t, argc - 1 );
+}
+
+/**
+ * Prints the usage message to standard error and exits.
+ */
+static void usage( void ) {
+  PRINT_ERR(
+"usage: %s [-D] [-j jobs] index [file.pdb...]\n"
+"       %s -q [-c|-l] [-D] index word...\n"
+"       %s -V\n"
+"\n"
+"options:\n"
+"  -c        Print only the number of matches in each file.\n"
+"  -D        Don't check a file's type and creator.\n"
+"  -j jobs   Index files using this many threads.\n"
+"  -l        Print only the paths of files that match.\n"
+"  -q        Find words as a phrase.\n"
+"  -V        Print version and exit.\n"
+    , me, me, me
+  );
+  exit( EX_USAGE );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,210 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      pool.c
+**
+**      Copyright (C) 1998-2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+// local
+#include "pjl_config.h"
+#include "pool.h"
+#include "util.h"
+
+// standard
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>                     /* for strerror() */
+#include <sysexits.h>
+#include <unistd.h>                     /* for sysconf() */
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * The jobs not yet started by a worker.
+ */
+struct pool_range {
+  pthread_mutex_t mtx;                  ///< Guards \a begin and \a end.
+  size_t          begin;                ///< First job not yet started.
+  size_t          end;                  ///< One past the last job.
+};
+typedef struct pool_range pool_range_t;
+
+/**
+ * Shared state of one pool_run() call.
+ */
+struct pool {
+  pool_job_fn     job_fn;               ///< Function to run each job.
+  void           *data;                 ///< Passed to \a job_fn.
+  unsigned        num_workers;          ///< Number of workers.
+  pool_range_t   *ranges;               ///< One range per worker.
+};
+typedef struct pool pool_t;
+
+/**
+ * The argument passed to each worker thread.
+ */
+struct pool_worker {
+  pool_t         *pool;                 ///< The pool the worker belongs to.
+  unsigned        index;                ///< The worker's index.
+  pthread_t       thread;               ///< The worker's thread.
+};
+typedef struct pool_worker pool_worker_t;
+
+////////// local functions ////////////////////////////////////////////////////
+
+/**
+ * Takes the next job from the front of a worker's own range.
+ *
+ * @param range The worker's range.
+ * @param pjob A pointer to receive the job index.
+ * @return Returns `true` only if a job was taken.
+ */
+NODISCARD
+static bool pool_pop( pool_range_t *range, size_t *pjob ) {
+  pthread_mutex_lock( &range->mtx );
+  bool const got = range->begin < range->end;
+  if ( got )
+    *pjob = range->begin++;
+  pthread_mutex_unlock( &range->mtx );
+  return got;
+}
+
+/**
+ * Steals the back half of the largest range of another worker into
+ * \a worker's own (empty) range.
+ *
+ * @param pool The pool.
+ * @param worker The index of the stealing worker.
+ * @return Returns `true` only if any jobs were stolen.
+ */
+NODISCARD
+static bool pool_steal( pool_t *pool, unsigned worker ) {
+  for (;;) {
+    // find the victim with the most jobs remaining
+    unsigned victim = worker;
+    size_t victim_left = 0;
+    for ( unsigned i = 0; i < pool->num_workers; ++i ) {
+      if ( i == worker )
+        continue;
+      pool_range_t *const r = &pool->ranges[i];
+      pthread_mutex_lock( &r->mtx );
+      size_t const left = r->end - r->begin;
+      pthread_mutex_unlock( &r->mtx );
+      if ( left > victim_left ) {
+        victim = i;
+        victim_left = left;
+      }
+    } // for
+    if ( victim == worker )
+      return false;
+
+    pool_range_t *const from = &pool->ranges[ victim ];
+    pthread_mutex_lock( &from->mtx );
+    size_t const left = from->end - from->begin;
+    if ( left == 0 ) {                  // emptied since we looked: retry
+      pthread_mutex_unlock( &from->mtx );
+      continue;
+    }
+    size_t const mid = from->end - (left + 1) / 2;
+    size_t const end = from->end;
+    from->end = mid;
+    pthread_mutex_unlock( &from->mtx );
+
+    pool_range_t *const to = &pool->ranges[ worker ];
+    pthread_mutex_lock( &to->mtx );
+    to->begin = mid;
+    to->end = end;
+    pthread_mutex_unlock( &to->mtx );
+    return true;
+  } // for
+}
+
+/**
+ * The thread main function of a worker.
+ *
+ * @param arg The pool_worker.
+ * @return Returns NULL.
+ */
+static void* pool_thread( void *arg ) {
+  pool_worker_t const *const w = arg;
+  pool_t *const pool = w->pool;
+  pool_range_t *const range = &pool->ranges[ w->index ];
+
+  do {
+    for ( size_t job; pool_pop( range, &job ); )
+      (*pool->job_fn)( pool->data, w->index, job );
+  } while ( pool_steal( pool, w->index ) );
+
+  return NULL;
+}
+
+////////// extern functions ///////////////////////////////////////////////////
+
+unsigned pool_default_workers( void ) {
+  long const n = sysconf( _SC_NPROCESSORS_ONLN );
+  return n > 0 ? STATIC_CAST( unsigned, n ) : 1;
+}
+
+void pool_run( size_t num_jobs, unsigned num_workers, pool_job_fn job_fn,
+               void *data ) {
+  assert( job_fn != NULL );
+
+  if ( num_workers > num_jobs )
+    num_workers = STATIC_CAST( unsigned, num_jobs );
+  if ( num_workers <= 1 ) {
+    for ( size_t job = 0; job < num_jobs; ++job )
+      (*job_fn)( data, 0, job );
+    return;
+  }
+
+  pool_t pool = {
+    .job_fn = job_fn,
+    .data = data,
+    .num_workers = num_workers,
+    .ranges = MALLOC( pool_range_t, num_workers )
+  };
+  pool_worker_t *const workers = MALLOC( pool_worker_t, num_workers );
+
+  for ( unsigned i = 0; i < num_workers; ++i ) {
+    pool_range_t *const r = &pool.ranges[i];
+    pthread_mutex_init( &r->mtx, NULL );
+    r->begin = num_jobs *  i      / num_workers;
+    r->end   = num_jobs * (i + 1) / num_workers;
+  } // for
+
+  for ( unsigned i = 0; i < num_workers; ++i ) {
+    workers[i].pool = &pool;
+    workers[i].index = i;
+    int const err = pthread_create( &workers[i].thread, NULL, &pool_thread,
+                                    &workers[i] );
+    if ( err != 0 )
+      PMESSAGE_EXIT( EX_OSERR, "can not create thread: %s\n", strerror( err ) );
+  } // for
+
+  for ( unsigned i = 0; i < num_workers; ++i )
+    pthread_join( workers[i].thread, NULL );
+
+  for ( unsigned i = 0; i < num_workers; ++i )
+    pthread_mutex_destroy( &pool.ranges[i].mtx );
+  free( workers );
+  free( pool.ranges );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,78 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      pool.h
+**
+**      Copyright (C) 1998-2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#ifndef txt2pdbdoc_pool_H
+#define txt2pdbdoc_pool_H
+
+/**
+ * @file
+ * Declares a work-stealing thread pool for running a fixed set of jobs.
+ *
+ * Jobs are identified by index.  Each worker starts with a contiguous range of
+ * indices that it runs front to back; a worker that runs out steals the back
+ * half of the largest remaining range of another worker.
+ */
+
+// local
+#include "pjl_config.h"
+
+// standard
+#include <stddef.h>                     /* for size_t */
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * The signature for a function that runs a job.
+ *
+ * @param data The \a data passed to pool_run().
+ * @param worker The index of the worker running the job, in the range
+ * [0,num_workers).  A worker runs only one job at a time, so per-worker state
+ * indexed by \a worker needs no locking.
+ * @param job The index of the job to run.
+ */
+typedef void (*pool_job_fn)( void *data, unsigned worker, size_t job );
+
+/**
+ * Gets the default number of workers, i.e., the number of online processors.
+ *
+ * @return Returns said number, at least 1.
+ */
+NODISCARD
+unsigned pool_default_workers( void );
+
+/**
+ * Runs jobs [0,num_jobs) on \a num_workers threads and waits for them all to
+ * complete.
+ * Prints an error message and exits if threads can not be created.
+ *
+ * @param num_jobs The number of jobs.
+ * @param num_workers The number of workers.  If 1, jobs are run in the
+ * calling thread.
+ * @param job_fn The function to call for each job.
+ * @param data Passed to \a job_fn.
+ */
+void pool_run( size_t num_jobs, unsigned num_workers, pool_job_fn job_fn,
+               void *data );
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif /* txt2pdbdoc_pool_H */
+/* vim:set et sw=2 ts=2: */
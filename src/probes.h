@@ -0,0 +1,73 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      probes.h
+**
+**      Copyright (C) 1998-2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#ifndef txt2pdbdoc_probes_H
+#define txt2pdbdoc_probes_H
+
+/**
+ * @file
+ * Declares USDT static probes for tracing conversions in production, e.g., via
+ * **bpftrace**(8) (see the `bpftrace` directory for sample scripts).  All
+ * probes are in the `txt2pdbdoc` provider:
+ *
+ *  Probe                   | Arguments
+ *  ------------------------|---------------------------------------------
+ *  `encode_record_start`   | record number
+ *  `encode_record_end`     | record number, text bytes, stored bytes
+ *  `decode_record_start`   | record number
+ *  `decode_record_end`     | record number, stored bytes, text bytes
+ *  `compress_entry`        | source bytes
+ *  `compress_return`       | source bytes, compressed bytes
+ *  `uncompress_entry`      | source bytes
+ *  `uncompress_return`     | ::t2pd_status, uncompressed bytes (if OK)
+ *  `warning`               | message
+ *
+ * Each probe is a single `nop` instruction unless traced.  Probes are compiled
+ * out entirely if `sys/sdt.h` isn't available or configure was given
+ * `--disable-probes`.
+ */
+
+// local
+#include "pjl_config.h"
+#include "util.h"
+
+#ifdef ENABLE_PROBES
+# include <sys/sdt.h>
+# define T2PD_PROBES              1
+
+# define T2PD_PROBE1(NAME,A1) \
+    DTRACE_PROBE1( txt2pdbdoc, NAME, (A1) )
+# define T2PD_PROBE2(NAME,A1,A2) \
+    DTRACE_PROBE2( txt2pdbdoc, NAME, (A1), (A2) )
+# define T2PD_PROBE3(NAME,A1,A2,A3) \
+    DTRACE_PROBE3( txt2pdbdoc, NAME, (A1), (A2), (A3) )
+#else
+# define T2PD_PROBES              0
+
+# define T2PD_PROBE1(NAME,A1)             NO_OP
+# define T2PD_PROBE2(NAME,A1,A2)          NO_OP
+# define T2PD_PROBE3(NAME,A1,A2,A3)       NO_OP
+#endif /* ENABLE_PROBES */
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif /* txt2pdbdoc_probes_H */
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,929 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      render.c
+**
+**      Copyright (C) 1998-2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/**
+ * @file
+ * Defines functions for rendering the text of a Doc file as HTML while
+ * decoding, the way `pdbtxt2html -t` does.
+ *
+ * Lines that, ignoring leading whitespace, begin with the bookmark marker are
+ * headings whose level is given by the indentation after the marker.  The
+ * table of contents comes from the bookmark records, if any; otherwise from a
+ * single pass over the text records looking for headings before they're
+ * rendered.  Output is written through a block buffer.
+ */
+
+// local
+#include "pjl_config.h"
+#include "common.h"
+#include "doc.h"
+#include "palm.h"
+#include "probes.h"
+#include "txt2pdbdoc.h"
+#include "unicode.h"
+#include "util.h"
+
+// standard
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RENDER_OUT_SIZE           (64 * 1024)
+#define RENDER_OUT_SLACK          16    /* most bytes written for 1 char */
+
+/**
+ * An entry in the table of contents.
+ */
+struct toc_entry {
+  DWord       pos;                      ///< Offset of it in the text.
+  unsigned    level;                    ///< Heading level; 1 = top.
+  size_t      name;                     ///< Offset of its name in names.
+  size_t      name_len;                 ///< Length of its name.
+};
+typedef struct toc_entry toc_entry_t;
+
+/**
+ * The state of rendering Doc text as HTML.
+ */
+struct render {
+  FILE           *fout;                 ///< File to write to.
+  char8_t         out[ RENDER_OUT_SIZE ]; ///< Output block buffer.
+  size_t          out_len;              ///< Length of \a out.
+  uint64_t        bytes_out;            ///< Total bytes written.
+  int             out_errno;            ///< Value of `errno` if writing failed.
+
+  Byte            marker[ T2PD_TAIL_SIZE_MAX + 1 ]; ///< Bookmark marker.
+  size_t          marker_len;           ///< Length of \a marker; 0 = none.
+  bool            stopped;              ///< Was the `<`_marker_`>` line seen?
+
+  Byte           *line;                 ///< Current line.
+  size_t          line_len;             ///< Length of \a line.
+  size_t          line_cap;             ///< Capacity of \a line.
+  Byte           *anchor;               ///< Current anchor name.
+  size_t          anchor_cap;           ///< Capacity of \a anchor.
+
+  doc_bookmark_t  bookmarks[ DOC_BOOKMARKS_MAX ]; ///< Bookmark records.
+  toc_entry_t    *toc;                  ///< Table of contents.
+  size_t          toc_len;              ///< Length of \a toc.
+  size_t          toc_cap;              ///< Capacity of \a toc.
+  size_t          toc_next;             ///< Next entry to render an anchor for.
+  Byte           *names;                ///< Names of all \a toc entries.
+  size_t          names_len;            ///< Length of \a names.
+  size_t          names_cap;            ///< Capacity of \a names.
+
+  bool            have_indent;          ///< Is \a indent set?
+  unsigned        indent;               ///< Indentation of first heading.
+  bool            header_done;          ///< Was the header written?
+  bool            after_heading;        ///< Was the last line a heading?
+  unsigned        br;                   ///< Pending line breaks.
+};
+
+/**
+ * The signature for a function called for every line of text.
+ *
+ * @param t The handle.
+ * @param line The line without its newline.
+ * @param len The length of \a line.
+ * @param pos The offset of \a line in the text.
+ * @param next_pos The offset of the next line in the text.
+ * @return Returns #T2PD_OK only if successful.
+ */
+typedef t2pd_status_t (*line_fn)( t2pd_t *t, Byte const *line, size_t len,
+                                  DWord pos, DWord next_pos );
+
+////////// local functions ////////////////////////////////////////////////////
+
+/**
+ * Ensures an array has the capacity for at least \a need elements.
+ *
+ * @param t The handle.
+ * @param p A pointer to the array.
+ * @param cap A pointer to the capacity of the array.
+ * @param need The number of elements needed.
+ * @param size The size of an element.
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+static t2pd_status_t reserve( t2pd_t *t, void *p, size_t *cap, size_t need,
+                              size_t size ) {
+  if ( need <= *cap )
+    return T2PD_OK;
+  size_t new_cap = *cap > 0 ? *cap * 2 : 64;
+  while ( new_cap < need )
+    new_cap *= 2;
+  void **const pp = p;
+  void *const new_p = realloc( *pp, new_cap * size );
+  if ( new_p == NULL )
+    return t2pd_error( t, T2PD_ERR_NOMEM, "%s\n", STRERROR );
+  *pp = new_p;
+  *cap = new_cap;
+  return T2PD_OK;
+}
+
+/**
+ * Compares two ::toc_entry by position for qsort(3).
+ *
+ * @param i_data A pointer to the first ::toc_entry.
+ * @param j_data A pointer to the second ::toc_entry.
+ * @return Returns a number less than 0, 0, or greater than 0 if the first's
+ * position is less than, equal to, or greater than the second's,
+ * respectively.
+ */
+NODISCARD
+static int toc_entry_cmp( void const *i_data, void const *j_data ) {
+  toc_entry_t const *const i = i_data;
+  toc_entry_t const *const j = j_data;
+  return (i->pos > j->pos) - (i->pos < j->pos);
+}
+
+/**
+ * Trims leading and trailing whitespace.
+ *
+ * @param s A pointer to the start of the text.
+ * @param len A pointer to the length of the text.
+ */
+static void trim( Byte const **s, size_t *len ) {
+  while ( *len > 0 && isspace( (*s)[0] ) )
+    ++*s, --*len;
+  while ( *len > 0 && isspace( (*s)[ *len - 1 ] ) )
+    --*len;
+}
+
+/**
+ * Gets whether a trimmed line is the final `<`_marker_`>` line.
+ *
+ * @param r The render state.
+ * @param line The line.
+ * @param len The length of \a line.
+ * @return Returns `true` only if it is.
+ */
+NODISCARD
+static bool is_marker_line( render_t const *r, Byte const *line, size_t len ) {
+  return  r->marker_len > 0 && len >= r->marker_len + 2 &&
+          line[0] == '<' && line[ r->marker_len + 1 ] == '>' &&
+          memcmp( line + 1, r->marker, r->marker_len ) == 0;
+}
+
+/**
+ * Parses a trimmed line as a heading, i.e., one that begins with the marker.
+ * The level of the first heading is 1; those of the rest are 1 plus how much
+ * more they are indented after the marker than the first.
+ *
+ * @param r The render state.
+ * @param line The line.
+ * @param len The length of \a line.
+ * @param heading A pointer to receive the heading text.
+ * @param heading_len A pointer to receive the length of \a heading.
+ * @return Returns the heading level or 0 if the line isn't a heading.
+ */
+NODISCARD
+static unsigned parse_heading( render_t *r, Byte const *line, size_t len,
+                               Byte const **heading, size_t *heading_len ) {
+  if ( r->marker_len == 0 || len < r->marker_len ||
+       memcmp( line, r->marker, r->marker_len ) != 0 ) {
+    return 0;
+  }
+  size_t i = r->marker_len;
+  unsigned indent = 0;
+  for ( ; i < len && isspace( line[i] ); ++i )
+    ++indent;
+  *heading = line + i;
+  *heading_len = len - i;
+
+  if ( !r->have_indent ) {
+    r->have_indent = true;
+    r->indent = indent;
+  }
+  return indent > r->indent ? indent - r->indent + 1 : 1;
+}
+
+/**
+ * Adds an entry to the table of contents.
+ *
+ * @param t The handle.
+ * @param pos The offset of the entry in the text.
+ * @param level The heading level.
+ * @param name The name.
+ * @param name_len The length of \a name.
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+static t2pd_status_t toc_add( t2pd_t *t, DWord pos, unsigned level,
+                              Byte const *name, size_t name_len ) {
+  render_t *const r = t->render;
+  t2pd_status_t status = reserve(
+    t, &r->toc, &r->toc_cap, r->toc_len + 1, sizeof *r->toc
+  );
+  if ( status == T2PD_OK ) {
+    status = reserve(
+      t, &r->names, &r->names_cap, r->names_len + name_len, 1
+    );
+  }
+  if ( status != T2PD_OK )
+    return status;
+  if ( name_len > 0 )
+    memcpy( r->names + r->names_len, name, name_len );
+  r->toc[ r->toc_len++ ] = (toc_entry_t){
+    .pos = pos, .level = level, .name = r->names_len, .name_len = name_len
+  };
+  r->names_len += name_len;
+  return T2PD_OK;
+}
+
+////////// output /////////////////////////////////////////////////////////////
+
+/**
+ * Writes the output block buffer.
+ *
+ * @param r The render state.
+ */
+static void out_flush( render_t *r ) {
+  if ( r->out_len > 0 && r->out_errno == 0 &&
+       fwrite( r->out, 1, r->out_len, r->fout ) < r->out_len ) {
+    r->out_errno = errno;
+  }
+  r->bytes_out += r->out_len;
+  r->out_len = 0;
+}
+
+/**
+ * Ensures the output block buffer has room for #RENDER_OUT_SLACK bytes.
+ *
+ * @param r The render state.
+ */
+static inline void out_reserve( render_t *r ) {
+  if ( r->out_len > RENDER_OUT_SIZE - RENDER_OUT_SLACK )
+    out_flush( r );
+}
+
+/**
+ * Writes an ASCII string as is.
+ *
+ * @param r The render state.
+ * @param s The string.
+ */
+static void out_str( render_t *r, char const *s ) {
+  for ( ; *s != '\0'; ++s ) {
+    out_reserve( r );
+    r->out[ r->out_len++ ] = STATIC_CAST( char8_t, *s );
+  } // for
+}
+
+/**
+ * Writes PalmOS text transcoded to UTF-8 and escaped for HTML.
+ *
+ * @param t The handle.
+ * @param s The text.
+ * @param len The length of \a s.
+ */
+static void out_text( t2pd_t *t, Byte const *s, size_t len ) {
+  render_t *const r = t->render;
+  for ( size_t i = 0; i < len; ++i ) {
+    switch ( s[i] ) {
+      case '"': out_str( r, "&quot;" ); continue;
+      case '&': out_str( r, "&amp;"  ); continue;
+      case '<': out_str( r, "&lt;"   ); continue;
+      case '>': out_str( r, "&gt;"   ); continue;
+    } // switch
+    out_reserve( r );
+    r->out_len += t2pd_palm_to_utf8( t, s[i], r->out + r->out_len );
+  } // for
+}
+
+/**
+ * Writes the anchor name for a heading: `pdbtxt2html` deletes punctuation
+ * special in URLs, trims whitespace, lowers case, and changes runs of spaces
+ * and underscores into a single underscore.
+ *
+ * @param t The handle.
+ * @param s The heading.
+ * @param len The length of \a s.
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+static t2pd_status_t out_anchor( t2pd_t *t, Byte const *s, size_t len ) {
+  render_t *const r = t->render;
+  t2pd_status_t const status = reserve( t, &r->anchor, &r->anchor_cap, len, 1 );
+  if ( status != T2PD_OK )
+    return status;
+
+  size_t n = 0;
+  for ( size_t i = 0; i < len; ++i ) {
+    if ( s[i] == '\0' || strchr( "[]\"#%&+/:;<=>?@\\^`{|}~", s[i] ) == NULL )
+      r->anchor[ n++ ] = s[i];
+  } // for
+  Byte const *a = r->anchor;
+  trim( &a, &n );
+
+  Byte prev = '\0';
+  for ( size_t i = 0; i < n; ++i ) {
+    Byte c = a[i];
+    if ( c == ' ' )
+      c = '_';
+    else if ( c >= 'A' && c <= 'Z' )
+      c = STATIC_CAST( Byte, tolower( c ) );
+    if ( c == '_' && prev == '_' )
+      continue;
+    out_text( t, &c, 1 );
+    prev = c;
+  } // for
+  return T2PD_OK;
+}
+
+////////// URLs ///////////////////////////////////////////////////////////////
+
+/**
+ * Gets whether \a c is a "word" character, i.e., `[A-Za-z0-9_]`.
+ *
+ * @param c The character to check.
+ * @return Returns `true` only if it is.
+ */
+NODISCARD
+static inline bool is_word( Byte c ) {
+  return c < 0x80 && (isalnum( c ) || c == '_');
+}
+
+/**
+ * Gets the length of the longest run of characters in a set.
+ *
+ * @param s The text.
+ * @param len The length of \a s.
+ * @param set The set of characters other than word characters.
+ * @return Returns said length.
+ */
+NODISCARD
+static size_t span( Byte const *s, size_t len, char const *set ) {
+  size_t n = 0;
+  while ( n < len && (is_word( s[n] ) || (s[n] != '\0' &&
+          strchr( set, s[n] ) != NULL)) ) {
+    ++n;
+  }
+  return n;
+}
+
+/**
+ * Matches an optional _user_[`:`_password_]`@`.
+ *
+ * @param s The text.
+ * @param len The length of \a s.
+ * @return Returns the length matched or 0.
+ */
+NODISCARD
+static size_t match_user( Byte const *s, size_t len ) {
+  if ( len < 3 || !isalpha( s[0] ) || s[0] >= 0x80 )
+    return 0;
+  size_t n = 1 + span( s + 1, len - 1, "-." );
+  if ( n == 1 )
+    return 0;
+  if ( n < len && s[n] == ':' ) {
+    size_t const pw = span( s + n + 1, len - n - 1, "" );
+    if ( pw == 0 )
+      return 0;
+    n += 1 + pw;
+  }
+  return n < len && s[n] == '@' ? n + 1 : 0;
+}
+
+/**
+ * Matches a host name: a word character, then word characters, `-`, or `.`,
+ * ending in a word character.
+ *
+ * @param s The text.
+ * @param len The length of \a s.
+ * @return Returns the length matched or 0.
+ */
+NODISCARD
+static size_t match_host( Byte const *s, size_t len ) {
+  if ( len < 2 || !is_word( s[0] ) )
+    return 0;
+  size_t n = 1 + span( s + 1, len - 1, "-." );
+  while ( n > 1 && !is_word( s[ n - 1 ] ) )
+    --n;
+  return n > 1 ? n : 0;
+}
+
+/**
+ * Matches an optional `:`_port_.
+ *
+ * @param s The text.
+ * @param len The length of \a s.
+ * @return Returns the length matched or 0.
+ */
+NODISCARD
+static size_t match_port( Byte const *s, size_t len ) {
+  if ( len < 2 || s[0] != ':' )
+    return 0;
+  size_t n = 1;
+  while ( n < len && isdigit( s[n] ) )
+    ++n;
+  return n > 1 ? n : 0;
+}
+
+/**
+ * Matches an optional path: word characters, `-`, `%`, `/`, `.`, or `~`, not
+ * ending in `.`.
+ *
+ * @param s The text.
+ * @param len The length of \a s.
+ * @return Returns the length matched or 0.
+ */
+NODISCARD
+static size_t match_path( Byte const *s, size_t len ) {
+  size_t n = span( s, len, "-%/.~" );
+  while ( n > 0 && s[ n - 1 ] == '.' )
+    --n;
+  return n;
+}
+
+/**
+ * Matches an optional `?`_query_.
+ *
+ * @param s The text.
+ * @param len The length of \a s.
+ * @return Returns the length matched or 0.
+ */
+NODISCARD
+static size_t match_query( Byte const *s, size_t len ) {
+  if ( len < 2 || s[0] != '?' )
+    return 0;
+  size_t const n = span( s + 1, len - 1, "-!$%&'()*+,./=?~" );
+  return n > 0 ? n + 1 : 0;
+}
+
+/**
+ * Matches an e-mail address.
+ *
+ * @param s The text.
+ * @param len The length of \a s.
+ * @return Returns the length matched or 0.
+ */
+NODISCARD
+static size_t match_e_mail( Byte const *s, size_t len ) {
+  if ( len < 4 || !isalpha( s[0] ) || s[0] >= 0x80 )
+    return 0;
+  size_t n = 1 + span( s + 1, len - 1, "-." );
+  if ( n == 1 || n == len || s[n] != '@' )
+    return 0;
+  size_t const at = ++n;
+  n += span( s + n, len - n, "-." );
+  while ( n > at && !(isalpha( s[ n - 1 ] ) && s[ n - 1 ] < 0x80) )
+    --n;
+  return n > at + 1 ? n : 0;
+}
+
+/**
+ * Matches a URL of one of the schemes `pdbtxt2html` recognizes.
+ *
+ * @param s The text.
+ * @param len The length of \a s.
+ * @return Returns the length matched or 0.
+ */
+NODISCARD
+static size_t match_url( Byte const *s, size_t len ) {
+  enum { USER = 1 << 0, PORT = 1 << 1, PATH = 1 << 2, QUERY = 1 << 3 };
+  static struct {
+    char const *scheme;
+    unsigned    parts;
+  } const SCHEMES[] = {
+    { "ftp://",     USER | PORT | PATH          },
+    { "gopher://",         PORT | PATH          },
+    { "http://",           PORT | PATH | QUERY  },
+    { "https://",          PORT | PATH | QUERY  },
+    { "telnet://",  USER | PORT                 },
+    { "wais://",           PORT | PATH | QUERY  },
+  };
+
+  if ( len > 7 && memcmp( s, "mailto:", 7 ) == 0 ) {
+    size_t const n = match_e_mail( s + 7, len - 7 );
+    return n > 0 ? 7 + n : 0;
+  }
+  if ( len > 5 && memcmp( s, "news:", 5 ) == 0 && s[5] >= 'a' &&
+       s[5] <= 'z' ) {
+    size_t const n = match_host( s + 5, len - 5 );
+    return n > 0 ? 5 + n : 0;
+  }
+
+  for ( size_t i = 0; i < ARRAY_SIZE( SCHEMES ); ++i ) {
+    size_t n = strlen( SCHEMES[i].scheme );
+    if ( len <= n || memcmp( s, SCHEMES[i].scheme, n ) != 0 )
+      continue;
+    unsigned const parts = SCHEMES[i].parts;
+    if ( (parts & USER) != 0 )
+      n += match_user( s + n, len - n );
+    size_t const host = match_host( s + n, len - n );
+    if ( host == 0 )
+      return 0;
+    n += host;
+    if ( (parts & PORT) != 0 )
+      n += match_port( s + n, len - n );
+    if ( (parts & PATH) != 0 )
+      n += match_path( s + n, len - n );
+    if ( (parts & QUERY) != 0 )
+      n += match_query( s + n, len - n );
+    return n;
+  } // for
+  return 0;
+}
+
+/**
+ * Writes text escaped for HTML with URLs and e-mail addresses made into
+ * links.
+ *
+ * @param t The handle.
+ * @param s The text.
+ * @param len The length of \a s.
+ */
+static void out_linked( t2pd_t *t, Byte const *s, size_t len ) {
+  render_t *const r = t->render;
+  size_t plain = 0;                     // start of text not yet written
+  for ( size_t i = 0; i < len; ) {
+    bool e_mail = false;
+    size_t n = 0;
+    if ( isalpha( s[i] ) && s[i] < 0x80 &&
+         (i == 0 || !isalpha( s[ i - 1 ] ) || s[ i - 1 ] >= 0x80 ||
+          strchr( "fghmntw", s[i] ) != NULL) ) {
+      n = match_url( s + i, len - i );
+      if ( n == 0 )
+        e_mail = (n = match_e_mail( s + i, len - i )) > 0;
+    }
+    if ( n == 0 ) {
+      ++i;
+      continue;
+    }
+    out_text( t, s + plain, i - plain );
+    out_str( r, e_mail ? "<A HREF=\"mailto:" : "<A HREF=\"" );
+    out_text( t, s + i, n );
+    out_str( r, "\">" );
+    out_text( t, s + i, n );
+    out_str( r, "</A>" );
+    i = plain = i + n;
+  } // for
+  out_text( t, s + plain, len - plain );
+}
+
+////////// rendering //////////////////////////////////////////////////////////
+
+/**
+ * Writes the HTML header and the table of contents, if any.
+ *
+ * @param t The handle.
+ * @param title The title.
+ * @param title_len The length of \a title.
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+static t2pd_status_t out_header( t2pd_t *t, Byte const *title,
+                                 size_t title_len ) {
+  render_t *const r = t->render;
+  r->header_done = true;
+
+  out_str( r,
+    "<HTML><HEAD>"
+    "<META HTTP-EQUIV=\"Content-Type\" CONTENT=\"text/html; charset=UTF-8\">"
+    "<TITLE>"
+  );
+  out_text( t, title, title_len );
+  out_str( r, "</TITLE></HEAD><BODY><H1>" );
+  out_text( t, title, title_len );
+  out_str( r, "</H1><HR>\n" );
+  if ( r->toc_len == 0 )
+    return T2PD_OK;
+
+  out_str( r, "<H2>Contents</H2><DL><DT><DL>" );
+  unsigned last_level = 1;
+  for ( size_t i = 0; i < r->toc_len; ++i ) {
+    toc_entry_t const *const e = &r->toc[i];
+    for ( ; last_level < e->level; ++last_level )
+      out_str( r, "\n<DD><DL COMPACT>" );
+    for ( ; last_level > e->level; --last_level )
+      out_str( r, "\n</DL>" );
+    Byte const *const name = r->names + e->name;
+    out_str( r, "\n<DT><A HREF=\"#" );
+    t2pd_status_t const status = out_anchor( t, name, e->name_len );
+    if ( status != T2PD_OK )
+      return status;
+    out_str( r, e->level == 1 ? "\"><B>" : "\">" );
+    out_text( t, name, e->name_len );
+    out_str( r, e->level == 1 ? "</B></A>" : "</A>" );
+  } // for
+  out_str( r, "\n" );
+  for ( ; last_level > 0; --last_level )
+    out_str( r, "</DL>" );
+  out_str( r, "</DL><P><HR><P>\n" );
+  return T2PD_OK;
+}
+
+/**
+ * Writes pending line breaks: a blank line becomes a new paragraph.
+ *
+ * @param r The render state.
+ */
+static void out_br( render_t *r ) {
+  if ( r->br > 1 )
+    out_str( r, "\n<P>\n" );
+  else if ( r->br == 1 )
+    out_str( r, "<BR>\n" );
+  r->br = 0;
+}
+
+/**
+ * Scans a line for a heading to add to the table of contents.
+ *
+ * @param t The handle.
+ * @param line The line.
+ * @param len The length of \a line.
+ * @param pos The offset of \a line in the text.
+ * @param next_pos The offset of the next line in the text.
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+static t2pd_status_t scan_line( t2pd_t *t, Byte const *line, size_t len,
+                                DWord pos, DWord next_pos ) {
+  (void)next_pos;
+  render_t *const r = t->render;
+  trim( &line, &len );
+  if ( is_marker_line( r, line, len ) ) {
+    r->stopped = true;
+    return T2PD_OK;
+  }
+  Byte const *heading;
+  size_t heading_len;
+  unsigned const level = parse_heading( r, line, len, &heading, &heading_len );
+  return level > 0 ? toc_add( t, pos, level, heading, heading_len ) : T2PD_OK;
+}
+
+/**
+ * Renders a line as HTML.
+ *
+ * @param t The handle.
+ * @param line The line.
+ * @param len The length of \a line.
+ * @param pos The offset of \a line in the text.
+ * @param next_pos The offset of the next line in the text.
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+static t2pd_status_t render_line( t2pd_t *t, Byte const *line, size_t len,
+                                  DWord pos, DWord next_pos ) {
+  (void)pos;
+  render_t *const r = t->render;
+  trim( &line, &len );
+  if ( is_marker_line( r, line, len ) ) {
+    r->stopped = true;
+    return T2PD_OK;
+  }
+  if ( len == 0 ) {
+    if ( r->after_heading )
+      r->after_heading = false;
+    else
+      ++r->br;
+    return T2PD_OK;
+  }
+
+  t2pd_status_t status;
+  if ( !r->header_done && (status = out_header( t, line, len )) != T2PD_OK )
+    return status;
+
+  size_t anchors_end = r->toc_next;
+  while ( anchors_end < r->toc_len && r->toc[ anchors_end ].pos < next_pos )
+    ++anchors_end;
+
+  Byte const *heading = line;
+  size_t heading_len = len;
+  unsigned level = parse_heading( r, line, len, &heading, &heading_len );
+  if ( level == 0 && r->marker_len == 0 && anchors_end > r->toc_next )
+    level = 1;                          // bookmarked line, but no marker
+
+  out_br( r );
+  for ( ; r->toc_next < anchors_end; ++r->toc_next ) {
+    toc_entry_t const *const e = &r->toc[ r->toc_next ];
+    out_str( r, "<A NAME=\"" );
+    if ( (status = out_anchor( t, r->names + e->name, e->name_len )) != T2PD_OK )
+      return status;
+    out_str( r, level > 0 ? "\"></A>\n" : "\"></A>" );
+  } // for
+
+  if ( level > 0 ) {
+    char tag[ 16 ];
+    snprintf( tag, sizeof tag, "<H%u>", level );
+    out_str( r, tag );
+    out_linked( t, heading, heading_len );
+    snprintf( tag, sizeof tag, "</H%u>", level );
+    out_str( r, tag );
+    r->after_heading = true;
+  } else {
+    out_linked( t, line, len );
+    r->br = 1;
+    r->after_heading = false;
+  }
+  return T2PD_OK;
+}
+
+/**
+ * Calls a function for every line of the text until the `<`_marker_`>` line,
+ * if any.  Only rendering adds per-record statistics.
+ *
+ * @param t The handle.
+ * @param fin The file to read from.
+ * @param doc The Doc file.
+ * @param clock The clock to add phases to.
+ * @param fn The function to call.
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+static t2pd_status_t for_each_line( t2pd_t *t, FILE *fin,
+                                    doc_file_t const *doc,
+                                    t2pd_clock_t *clock, line_fn fn ) {
+  render_t *const r = t->render;
+  r->stopped = false;
+  r->have_indent = false;
+  r->line_len = 0;
+  DWord pos = 0, line_pos = 0;
+  t2pd_status_t status = T2PD_OK;
+
+  bool const rendering = fn == &render_line;
+
+  for ( unsigned rec_num = 1;
+        rec_num <= doc->num_records && !r->stopped; ++rec_num ) {
+    if ( rendering )
+      T2PD_PROBE1( decode_record_start, rec_num );
+    t2pd_clock_t const rec_start = *clock;
+    uint64_t const rec_bytes_out = r->bytes_out + r->out_len;
+
+    buffer_t const *text;
+    status = t2pd_doc_read_record( t, fin, doc, rec_num, clock, &text );
+    if ( status != T2PD_OK )
+      return status;
+    size_t const rec_size = t->z_buf.len;
+    for ( size_t i = 0; i < text->len && !r->stopped; ++i, ++pos ) {
+      Byte const c = text->data[i];
+      if ( c == '\n' ) {
+        status = (*fn)( t, r->line, r->line_len, line_pos, pos + 1 );
+        if ( status != T2PD_OK )
+          return status;
+        r->line_len = 0;
+        line_pos = pos + 1;
+        continue;
+      }
+      status = reserve( t, &r->line, &r->line_cap, r->line_len + 1, 1 );
+      if ( status != T2PD_OK )
+        return status;
+      r->line[ r->line_len++ ] = c;
+    } // for
+    t2pd_stats_phase( t, T2PD_PHASE_TRANSCODE, clock );
+
+    if ( rendering ) {
+      size_t const html_len =
+        STATIC_CAST( size_t, r->bytes_out + r->out_len - rec_bytes_out );
+      t2pd_stats_record( t, rec_num, rec_size, html_len, &rec_start, clock );
+      T2PD_PROBE3( decode_record_end, rec_num, rec_size, html_len );
+    }
+  } // for
+
+  if ( r->line_len > 0 && !r->stopped )
+    status = (*fn)( t, r->line, r->line_len, line_pos, pos );
+  return status;
+}
+
+/**
+ * Finds the bookmark marker in a final `<`_marker_`>` line of the text, if
+ * any, by reading only the last text record or two.
+ *
+ * @param t The handle.
+ * @param fin The file to read from.
+ * @param doc The Doc file.
+ * @param clock The clock to add phases to.
+ * @return Returns #T2PD_OK only if successful, even if there is no marker.
+ */
+NODISCARD
+static t2pd_status_t find_marker( t2pd_t *t, FILE *fin, doc_file_t const *doc,
+                                  t2pd_clock_t *clock ) {
+  render_t *const r = t->render;
+  char tail[ T2PD_TAIL_SIZE_MAX ];
+  size_t tail_size = 0;
+  unsigned rec_num = doc->num_records;
+
+  for ( ; rec_num > 0 && tail_size < T2PD_TAIL_SIZE_MAX; --rec_num ) {
+    buffer_t const *text;
+    t2pd_status_t const status =
+      t2pd_doc_read_record( t, fin, doc, rec_num, clock, &text );
+    if ( status != T2PD_OK )
+      return status;
+    size_t const room = T2PD_TAIL_SIZE_MAX - tail_size;
+    size_t const n = text->len < room ? text->len : room;
+    memmove( tail + n, tail, tail_size );
+    memcpy( tail, text->data + text->len - n, n );
+    tail_size += n;
+  } // for
+
+  char marker[ T2PD_TAIL_SIZE_MAX + 1 ];
+  t2pd_tail_marker( tail, tail_size, rec_num == 0, marker );
+  r->marker_len = strlen( marker );
+  memcpy( r->marker, marker, r->marker_len );
+  return T2PD_OK;
+}
+
+////////// extern functions ///////////////////////////////////////////////////
+
+t2pd_status_t t2pd_render_html( t2pd_t *t, FILE *fin, doc_file_t const *doc,
+                                FILE *fout, t2pd_clock_t *clock ) {
+  assert( t != NULL );
+  assert( fin != NULL );
+  assert( doc != NULL );
+  assert( fout != NULL );
+  assert( clock != NULL );
+
+  if ( t->render == NULL &&
+       (t->render = calloc( 1, sizeof *t->render )) == NULL ) {
+    return t2pd_error( t, T2PD_ERR_NOMEM, "%s\n", STRERROR );
+  }
+  render_t *const r = t->render;
+  r->fout = fout;
+  r->out_len = 0;
+  r->bytes_out = 0;
+  r->out_errno = 0;
+  r->toc_len = r->toc_next = r->names_len = 0;
+  r->header_done = r->after_heading = false;
+  r->br = 0;
+
+  t2pd_status_t status = find_marker( t, fin, doc, clock );
+  if ( status != T2PD_OK )
+    return status;
+
+  ////////// build table of contents //////////////////////////////////////////
+
+  size_t num_bookmarks;
+  status = t2pd_doc_read_bookmarks( t, fin, doc, r->bookmarks, &num_bookmarks );
+  if ( status != T2PD_OK )
+    return status;
+  if ( num_bookmarks > 0 ) {
+    for ( size_t i = 0; i < num_bookmarks; ++i ) {
+      doc_bookmark_t const *const bm = &r->bookmarks[i];
+      status = toc_add( t, bm->position, 1, (Byte const*)bm->name,
+                        strlen( bm->name ) );
+      if ( status != T2PD_OK )
+        return status;
+    } // for
+    qsort( r->toc, r->toc_len, sizeof *r->toc, &toc_entry_cmp );
+  }
+  else if ( r->marker_len > 0 ) {
+    status = for_each_line( t, fin, doc, clock, &scan_line );
+    if ( status != T2PD_OK )
+      return status;
+  }
+
+  ////////// render text //////////////////////////////////////////////////////
+
+  status = for_each_line( t, fin, doc, clock, &render_line );
+  if ( status != T2PD_OK )
+    return status;
+  if ( !r->header_done && (status = out_header( t, NULL, 0 )) != T2PD_OK )
+    return status;
+  out_br( r );
+  out_str( r, "\n<HR><SMALL>End of document</SMALL></BODY></HTML>\n" );
+  out_flush( r );
+  t2pd_stats_phase( t, T2PD_PHASE_WRITE, clock );
+  if ( r->out_errno != 0 ) {
+    return t2pd_error( t, T2PD_ERR_WRITE, "%s\n", strerror( r->out_errno ) );
+  }
+
+  if ( t->opts.stats != NULL ) {
+    t->opts.stats->bytes_in = doc->file_size;
+    t->opts.stats->bytes_out = r->bytes_out;
+  }
+  return T2PD_OK;
+}
+
+void t2pd_render_free( render_t *r ) {
+  if ( r == NULL )
+    return;
+  free( r->anchor );
+  free( r->line );
+  free( r->names );
+  free( r->toc );
+  free( r );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* vim:set et sw=2 ts=2: */
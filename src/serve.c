@@ -0,0 +1,763 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      serve.c
+**
+**      Copyright (C) 1998-2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+// local
+#include "pjl_config.h"
+#include "serve.h"
+#include "txt2pdbdoc.h"
+#include "util.h"
+
+// standard
+#include <assert.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>                   /* for struct timeval */
+#include <sys/un.h>
+#include <sysexits.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FRAME_HDR_SIZE        4         /* big-endian length */
+#define REQ_HDR_SIZE          7         /* op + opts + codepoint + name len */
+#define QUEUE_PER_WORKER      4         /* pending connections per worker */
+#define DIAG_SIZE_MAX         (64 * 1024) /* diagnostics per response */
+#define IDLE_POLL_MS          100       /* kept-alive connection poll interval */
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * A growable byte buffer.
+ */
+struct serve_buf {
+  uint8_t  *data;                       ///< The bytes.
+  size_t    len;                        ///< Number of bytes used.
+  size_t    cap;                        ///< Number of bytes allocated.
+};
+typedef struct serve_buf serve_buf_t;
+
+/**
+ * A bounded queue of accepted connections waiting for a worker.
+ */
+struct serve_queue {
+  pthread_mutex_t mtx;                  ///< Guards all other members.
+  pthread_cond_t  not_empty;            ///< Signaled when a fd is added.
+  pthread_cond_t  not_full;             ///< Signaled when a fd is removed.
+  int            *fds;                  ///< Ring buffer of connections.
+  size_t          cap;                  ///< Capacity of \a fds.
+  size_t          head;                 ///< Index of the oldest connection.
+  size_t          count;                ///< Number of connections queued.
+  bool            closed;               ///< No more connections will come.
+};
+typedef struct serve_queue serve_queue_t;
+
+/**
+ * Server state shared by all workers.
+ */
+struct serve {
+  serve_queue_t   queue;                ///< Connections to serve.
+  unsigned        timeout_secs;         ///< Per-request timeout.
+  size_t          max_size;             ///< Maximum request size.
+};
+typedef struct serve serve_t;
+
+/**
+ * Per-worker state that's reused for every connection the worker serves.
+ */
+struct serve_worker {
+  serve_t        *s;                    ///< The server.
+  pthread_t       thread;               ///< The worker's thread.
+  t2pd_t         *t;                    ///< Conversion handle.
+  serve_buf_t     req;                  ///< Request frame.
+  serve_buf_t     resp;                 ///< Response frame sans payload.
+  serve_buf_t     diag;                 ///< Diagnostics of current request.
+};
+typedef struct serve_worker serve_worker_t;
+
+/**
+ * Set by the signal handler to request shutdown.
+ */
+static volatile sig_atomic_t serve_stop;
+
+////////// local functions ////////////////////////////////////////////////////
+
+/**
+ * Ensures a buffer can hold at least \a len bytes.
+ *
+ * @param buf The buffer.
+ * @param len The number of bytes.
+ * @return Returns `true` only if successful; if not, the buffer is unchanged.
+ */
+NODISCARD
+static bool buf_reserve( serve_buf_t *buf, size_t len ) {
+  if ( len > buf->cap ) {
+    uint8_t *const data = realloc( buf->data, len );
+    if ( data == NULL )
+      return false;
+    buf->data = data;
+    buf->cap = len;
+  }
+  return true;
+}
+
+/**
+ * Appends bytes to a buffer, growing it as needed.
+ *
+ * @param buf The buffer to append to.
+ * @param data The bytes to append.
+ * @param len The number of bytes to append.
+ * @return Returns `true` only if successful.
+ */
+NODISCARD
+static bool buf_append( serve_buf_t *buf, void const *data, size_t len ) {
+  if ( buf->len + len > buf->cap ) {
+    size_t cap = buf->cap ? buf->cap : 256;
+    while ( buf->len + len > cap )
+      cap *= 2;
+    if ( !buf_reserve( buf, cap ) )
+      return false;
+  }
+  memcpy( buf->data + buf->len, data, len );
+  buf->len += len;
+  return true;
+}
+
+/**
+ * Appends a big-endian 32-bit integer to a buffer.
+ *
+ * @param buf The buffer to append to.
+ * @param n The integer to append.
+ * @return Returns `true` only if successful.
+ */
+NODISCARD
+static bool buf_append_u32( serve_buf_t *buf, uint32_t n ) {
+  uint8_t const be[4] = {
+    STATIC_CAST( uint8_t, n >> 24 ), STATIC_CAST( uint8_t, n >> 16 ),
+    STATIC_CAST( uint8_t, n >>  8 ), STATIC_CAST( uint8_t, n       )
+  };
+  return buf_append( buf, be, sizeof be );
+}
+
+/**
+ * Gets a big-endian 32-bit integer.
+ *
+ * @param p A pointer to the integer's first byte.
+ * @return Returns said integer.
+ */
+NODISCARD
+static uint32_t get_u32( uint8_t const *p ) {
+  return STATIC_CAST( uint32_t, p[0] ) << 24 |
+         STATIC_CAST( uint32_t, p[1] ) << 16 |
+         STATIC_CAST( uint32_t, p[2] ) <<  8 |
+         STATIC_CAST( uint32_t, p[3] );
+}
+
+/**
+ * Gets the number of milliseconds remaining until \a deadline.
+ *
+ * @param deadline The deadline on the `CLOCK_MONOTONIC` clock.
+ * @return Returns said number or 0 if \a deadline has passed.
+ */
+NODISCARD
+static int ms_until( struct timespec const *deadline ) {
+  struct timespec now;
+  clock_gettime( CLOCK_MONOTONIC, &now );
+  long long const ms = (deadline->tv_sec - now.tv_sec) * 1000LL +
+                       (deadline->tv_nsec - now.tv_nsec) / 1000000;
+  return ms > 0 ? STATIC_CAST( int, ms ) : 0;
+}
+
+/**
+ * Receives exactly \a len bytes from a socket.
+ *
+ * @param fd The socket to receive from.
+ * @param buf The buffer to receive into.
+ * @param len The number of bytes to receive.
+ * @param deadline The time by which all bytes must have been received, or
+ * NULL for none.  If not NULL, receiving also stops when the server is
+ * stopping.
+ * @return Returns 1 upon success, 0 if the peer closed the connection before
+ * sending any bytes, or -1 upon error, timeout, or a partial read.
+ */
+NODISCARD
+static int recv_all( int fd, void *buf, size_t len,
+                     struct timespec const *deadline ) {
+  uint8_t *p = buf;
+  for ( size_t got = 0; got < len; ) {
+    if ( deadline != NULL ) {
+      // poll in slices to notice the server stopping
+      int const ms = ms_until( deadline );
+      struct pollfd pfd = { .fd = fd, .events = POLLIN };
+      int const ready = poll( &pfd, 1, ms < IDLE_POLL_MS ? ms : IDLE_POLL_MS );
+      if ( (ready == -1 && errno == EINTR) ||
+           (ready == 0 && ms > 0 && !serve_stop) ) {
+        continue;
+      }
+      if ( ready <= 0 ) {
+        if ( ready == 0 )
+          errno = ETIMEDOUT;
+        return -1;
+      }
+    }
+    ssize_t const n = recv( fd, p + got, len - got, 0 );
+    if ( n == -1 ) {
+      if ( errno == EINTR )
+        continue;
+      return -1;
+    }
+    if ( n == 0 ) {
+      if ( got == 0 )
+        return 0;
+      errno = EPROTO;
+      return -1;
+    }
+    got += STATIC_CAST( size_t, n );
+  } // for
+  return 1;
+}
+
+/**
+ * Sends exactly \a len bytes to a socket.
+ *
+ * @param fd The socket to send to.
+ * @param buf The bytes to send.
+ * @param len The number of bytes to send.
+ * @return Returns `true` only if successful.
+ */
+NODISCARD
+static bool send_all( int fd, void const *buf, size_t len ) {
+  uint8_t const *p = buf;
+  while ( len > 0 ) {
+    ssize_t const n = send( fd, p, len, MSG_NOSIGNAL );
+    if ( n == -1 ) {
+      if ( errno == EINTR )
+        continue;
+      return false;
+    }
+    p += n;
+    len -= STATIC_CAST( size_t, n );
+  } // while
+  return true;
+}
+
+/**
+ * Fills in a Unix domain socket address.
+ *
+ * @param addr The address to fill in.
+ * @param path The path of the socket.
+ */
+static void set_sockaddr( struct sockaddr_un *addr, char const *path ) {
+  memset( addr, 0, sizeof *addr );
+  addr->sun_family = AF_UNIX;
+  if ( strlen( path ) >= sizeof addr->sun_path )
+    PMESSAGE_EXIT( EX_USAGE, "\"%s\": socket path too long\n", path );
+  strcpy( addr->sun_path, path );
+}
+
+////////// server /////////////////////////////////////////////////////////////
+
+/**
+ * Collects diagnostic messages for the current request up to
+ * #DIAG_SIZE_MAX bytes; the rest are dropped.
+ *
+ * @param data The serve_worker.
+ * @param kind The kind of message.
+ * @param msg The message.
+ */
+static void serve_diag( void *data, t2pd_diag_t kind, char const *msg ) {
+  serve_worker_t *const w = data;
+  size_t const len = strlen( msg );
+  if ( kind == T2PD_DIAG_WARNING && w->diag.len + len <= DIAG_SIZE_MAX &&
+       !buf_append( &w->diag, msg, len ) ) {
+    w->diag.len = 0;                    // out of memory: drop them all
+  }
+}
+
+/**
+ * Sends a response.
+ *
+ * @param w The worker.
+ * @param fd The connection.
+ * @param status The status of the conversion.
+ * @param errmsg The error message.
+ * @param out The converted output.
+ * @param out_len The number of bytes of \a out.
+ * @return Returns `true` only if successful.
+ */
+static bool serve_respond( serve_worker_t *w, int fd, t2pd_status_t status,
+                           char const *errmsg, void const *out,
+                           size_t out_len ) {
+  size_t const errmsg_len = strlen( errmsg );
+  size_t const frame_len =
+    1 + 4 + errmsg_len + 4 + w->diag.len + out_len;
+  if ( frame_len > UINT32_MAX )
+    return false;
+
+  uint8_t const status_byte = STATIC_CAST( uint8_t, status );
+  w->resp.len = 0;
+  return buf_append_u32( &w->resp, STATIC_CAST( uint32_t, frame_len ) ) &&
+         buf_append( &w->resp, &status_byte, 1 ) &&
+         buf_append_u32( &w->resp, STATIC_CAST( uint32_t, errmsg_len ) ) &&
+         buf_append( &w->resp, errmsg, errmsg_len ) &&
+         buf_append_u32( &w->resp, STATIC_CAST( uint32_t, w->diag.len ) ) &&
+         buf_append( &w->resp, w->diag.data, w->diag.len ) &&
+         send_all( fd, w->resp.data, w->resp.len ) &&
+         send_all( fd, out, out_len );
+}
+
+/**
+ * Serves one request from a connection.
+ *
+ * @param w The worker.
+ * @param fd The connection.
+ * @return Returns `true` only if the connection may be used for another
+ * request.
+ */
+NODISCARD
+static bool serve_request( serve_worker_t *w, int fd ) {
+  struct timespec deadline;
+  clock_gettime( CLOCK_MONOTONIC, &deadline );
+  deadline.tv_sec += w->s->timeout_secs;
+
+  w->diag.len = 0;
+
+  uint8_t frame_hdr[ FRAME_HDR_SIZE ];
+  if ( recv_all( fd, frame_hdr, sizeof frame_hdr, &deadline ) != 1 )
+    return false;
+  size_t const req_len = get_u32( frame_hdr );
+  if ( req_len > w->s->max_size ) {
+    char errmsg[ 80 ];
+    snprintf( errmsg, sizeof errmsg,
+      "request of %zu bytes exceeds maximum of %zu", req_len, w->s->max_size
+    );
+    serve_respond( w, fd, T2PD_ERR_ARG, errmsg, NULL, 0 );
+    return false;                       // can't resync: close connection
+  }
+
+  if ( !buf_reserve( &w->req, req_len ) ) {
+    serve_respond( w, fd, T2PD_ERR_NOMEM, "out of memory", NULL, 0 );
+    return false;                       // can't resync: close connection
+  }
+  w->req.len = req_len;
+  if ( recv_all( fd, w->req.data, req_len, &deadline ) != 1 )
+    return false;
+
+  uint8_t const *const req = w->req.data;
+  size_t const name_len = req_len >= REQ_HDR_SIZE ? req[6] : 0;
+  if ( req_len < REQ_HDR_SIZE + name_len ||
+       (req[0] != 'd' && req[0] != 'e') ) {
+    serve_respond( w, fd, T2PD_ERR_ARG, "malformed request", NULL, 0 );
+    return false;
+  }
+
+  t2pd_options_t opts;
+  t2pd_options_init( &opts );
+  opts.binary        = !(req[1] & SERVE_OPT_NO_BINARY);
+  opts.compress      = !(req[1] & SERVE_OPT_NO_COMPRESS);
+  opts.no_check_doc  = (req[1] & SERVE_OPT_NO_CHECK_DOC) != 0;
+  opts.no_timestamp  = (req[1] & SERVE_OPT_NO_TIMESTAMP) != 0;
+  opts.no_warnings   = (req[1] & SERVE_OPT_NO_WARNINGS) != 0;
+  opts.verify_encode = (req[1] & SERVE_OPT_VERIFY_ENCODE) != 0;
+  opts.html          = (req[1] & SERVE_OPT_HTML) != 0;
+  opts.unmapped_codepoint = get_u32( req + 2 );
+  opts.diag_fn = &serve_diag;
+  opts.diag_data = w;
+  t2pd_set_options( w->t, &opts );
+
+  char doc_name[ 256 ];
+  memcpy( doc_name, req + REQ_HDR_SIZE, name_len );
+  doc_name[ name_len ] = '\0';
+  uint8_t const *const payload = req + REQ_HDR_SIZE + name_len;
+  size_t const payload_len = req_len - REQ_HDR_SIZE - name_len;
+
+  void *out = NULL;
+  size_t out_len = 0;
+  t2pd_status_t const status = req[0] == 'd' ?
+    t2pd_decode_mem( w->t, payload, payload_len, &out, &out_len ) :
+    t2pd_encode_mem( w->t, doc_name, payload, payload_len, &out, &out_len );
+
+  bool const ok = status == T2PD_OK ?
+    serve_respond( w, fd, status, "", out, out_len ) :
+    serve_respond( w, fd, status, t2pd_errmsg( w->t ), NULL, 0 );
+  free( out );
+  return ok;
+}
+
+/**
+ * Waits for the next request on a kept-alive connection.  So idle clients
+ * can't starve the pool, it gives up early if other connections are waiting
+ * for a worker or the server is stopping.
+ *
+ * @param w The worker.
+ * @param fd The connection.
+ * @return Returns `true` only if a request (or the peer closing the
+ * connection) is arriving.
+ */
+NODISCARD
+static bool serve_await( serve_worker_t *w, int fd ) {
+  serve_queue_t *const q = &w->s->queue;
+  struct timespec deadline;
+  clock_gettime( CLOCK_MONOTONIC, &deadline );
+  deadline.tv_sec += w->s->timeout_secs;
+
+  for (;;) {
+    int const ms = ms_until( &deadline );
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    int const ready = poll( &pfd, 1, ms < IDLE_POLL_MS ? ms : IDLE_POLL_MS );
+    if ( ready > 0 )
+      return true;
+    if ( (ready == -1 && errno != EINTR) || ms == 0 || serve_stop )
+      return false;
+    pthread_mutex_lock( &q->mtx );
+    bool const others_waiting = q->count > 0;
+    pthread_mutex_unlock( &q->mtx );
+    if ( others_waiting )
+      return false;
+  } // for
+}
+
+/**
+ * The thread main function of a worker.
+ *
+ * @param arg The serve_worker.
+ * @return Returns NULL.
+ */
+static void* serve_thread( void *arg ) {
+  serve_worker_t *const w = arg;
+  serve_queue_t *const q = &w->s->queue;
+
+  for (;;) {
+    pthread_mutex_lock( &q->mtx );
+    while ( q->count == 0 && !q->closed )
+      pthread_cond_wait( &q->not_empty, &q->mtx );
+    if ( q->count == 0 ) {              // closed and drained
+      pthread_mutex_unlock( &q->mtx );
+      break;
+    }
+    int const fd = q->fds[ q->head ];
+    q->head = (q->head + 1) % q->cap;
+    --q->count;
+    pthread_cond_signal( &q->not_full );
+    pthread_mutex_unlock( &q->mtx );
+
+    while ( serve_request( w, fd ) && serve_await( w, fd ) )
+      ;
+    close( fd );
+  } // for
+
+  return NULL;
+}
+
+/**
+ * Records that a shutdown signal was received.
+ *
+ * @param sig The signal.
+ */
+static void serve_on_signal( int sig ) {
+  (void)sig;
+  serve_stop = 1;
+}
+
+/**
+ * Creates, binds, and listens on a Unix domain socket, replacing a stale
+ * socket left behind by a server that's no longer running.
+ *
+ * @param path The path of the socket.
+ * @return Returns the socket.
+ */
+NODISCARD
+static int serve_listen( char const *path ) {
+  struct sockaddr_un addr;
+  set_sockaddr( &addr, path );
+
+  int const fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+  if ( fd == -1 )
+    PERROR_EXIT( EX_OSERR );
+
+  if ( bind( fd, (struct sockaddr*)&addr, sizeof addr ) == -1 ) {
+    if ( errno != EADDRINUSE )
+      goto error;
+    struct stat sbuf;
+    if ( stat( path, &sbuf ) == -1 || !S_ISSOCK( sbuf.st_mode ) )
+      goto error;
+    int const probe = socket( AF_UNIX, SOCK_STREAM, 0 );
+    bool const alive = probe != -1 &&
+      connect( probe, (struct sockaddr*)&addr, sizeof addr ) == 0;
+    if ( probe != -1 )
+      close( probe );
+    if ( alive ) {
+      errno = EADDRINUSE;
+      goto error;
+    }
+    unlink( path );
+    if ( bind( fd, (struct sockaddr*)&addr, sizeof addr ) == -1 )
+      goto error;
+  }
+
+  if ( listen( fd, SOMAXCONN ) == -1 )
+    goto error;
+  return fd;
+
+error:
+  PMESSAGE_EXIT( EX_UNAVAILABLE, "\"%s\": %s\n", path, STRERROR );
+}
+
+////////// client /////////////////////////////////////////////////////////////
+
+t2pd_status_t serve_client( char const *socket_path,
+                            t2pd_options_t const *opts, bool decode,
+                            char const *doc_name, FILE *fin, FILE *fout,
+                            char *errmsg, size_t errmsg_size ) {
+  assert( socket_path != NULL );
+  assert( opts != NULL );
+  assert( fin != NULL );
+  assert( fout != NULL );
+  assert( errmsg != NULL );
+
+  size_t const name_len = decode ? 0 : strlen( doc_name );
+  if ( name_len > 255 )
+    PMESSAGE_EXIT( EX_USAGE, "\"%s\": document name too long\n", doc_name );
+
+  serve_buf_t req = { NULL, 0, 0 };
+  uint8_t hdr[ FRAME_HDR_SIZE + REQ_HDR_SIZE ] = { 0 };
+  if ( !buf_append( &req, hdr, sizeof hdr ) ||
+       !buf_append( &req, doc_name, name_len ) ) {
+    PERROR_EXIT( EX_OSERR );
+  }
+  for (;;) {
+    if ( !buf_reserve( &req, req.len + 65536 ) )
+      PERROR_EXIT( EX_OSERR );
+    size_t const n = fread( req.data + req.len, 1, req.cap - req.len, fin );
+    req.len += n;
+    if ( n == 0 )
+      break;
+  } // for
+  if ( ferror( fin ) )
+    PERROR_EXIT( EX_NOINPUT );
+  if ( req.len - FRAME_HDR_SIZE > UINT32_MAX )
+    PMESSAGE_EXIT( EX_DATAERR, "input too large%s\n", "" );
+
+  uint8_t *const p = req.data;
+  uint32_t const frame_len = STATIC_CAST( uint32_t, req.len - FRAME_HDR_SIZE );
+  uint32_t const cp = opts->unmapped_codepoint;
+  p[0] = STATIC_CAST( uint8_t, frame_len >> 24 );
+  p[1] = STATIC_CAST( uint8_t, frame_len >> 16 );
+  p[2] = STATIC_CAST( uint8_t, frame_len >>  8 );
+  p[3] = STATIC_CAST( uint8_t, frame_len       );
+  p[4] = decode ? 'd' : 'e';
+  p[5] = STATIC_CAST( uint8_t,
+    (opts->binary        ? 0 : SERVE_OPT_NO_BINARY    ) |
+    (opts->compress      ? 0 : SERVE_OPT_NO_COMPRESS  ) |
+    (opts->no_check_doc  ? SERVE_OPT_NO_CHECK_DOC  : 0) |
+    (opts->no_timestamp  ? SERVE_OPT_NO_TIMESTAMP  : 0) |
+    (opts->no_warnings   ? SERVE_OPT_NO_WARNINGS   : 0) |
+    (opts->verify_encode ? SERVE_OPT_VERIFY_ENCODE : 0) |
+    (opts->html          ? SERVE_OPT_HTML          : 0)
+  );
+  p[6] = STATIC_CAST( uint8_t, cp >> 24 );
+  p[7] = STATIC_CAST( uint8_t, cp >> 16 );
+  p[8] = STATIC_CAST( uint8_t, cp >>  8 );
+  p[9] = STATIC_CAST( uint8_t, cp       );
+  p[10] = STATIC_CAST( uint8_t, name_len );
+
+  struct sockaddr_un addr;
+  set_sockaddr( &addr, socket_path );
+  int const fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+  if ( fd == -1 )
+    PERROR_EXIT( EX_OSERR );
+  if ( connect( fd, (struct sockaddr*)&addr, sizeof addr ) == -1 )
+    PMESSAGE_EXIT( EX_UNAVAILABLE, "\"%s\": %s\n", socket_path, STRERROR );
+  if ( !send_all( fd, req.data, req.len ) )
+    PMESSAGE_EXIT( EX_PROTOCOL, "\"%s\": %s\n", socket_path, STRERROR );
+
+  //
+  // Reuse the request buffer for the response.
+  //
+  errno = 0;
+  uint8_t frame_hdr[ FRAME_HDR_SIZE ];
+  if ( recv_all( fd, frame_hdr, sizeof frame_hdr, NULL ) != 1 )
+    goto protocol_error;
+  size_t const resp_len = get_u32( frame_hdr );
+  if ( !buf_reserve( &req, resp_len ) )
+    PERROR_EXIT( EX_OSERR );
+  if ( recv_all( fd, req.data, resp_len, NULL ) != 1 )
+    goto protocol_error;
+  close( fd );
+
+  uint8_t const *r = req.data;
+  uint8_t const *const end = r + resp_len;
+  if ( resp_len < 1 + 4 )
+    goto protocol_error;
+  t2pd_status_t const status = STATIC_CAST( t2pd_status_t, *r++ );
+  size_t const errmsg_len = get_u32( r );
+  r += 4;
+  if ( STATIC_CAST( size_t, end - r ) < errmsg_len + 4 )
+    goto protocol_error;
+  snprintf( errmsg, errmsg_size, "%.*s", STATIC_CAST( int, errmsg_len ), r );
+  r += errmsg_len;
+  size_t const diag_len = get_u32( r );
+  r += 4;
+  if ( STATIC_CAST( size_t, end - r ) < diag_len )
+    goto protocol_error;
+
+  // pass each diagnostic line to the caller's diag_fn
+  for ( char const *line = (char const*)r, *diag_end = line + diag_len;
+        line < diag_end; ) {
+    char const *nl = memchr( line, '\n', STATIC_CAST( size_t, diag_end - line ) );
+    nl = nl != NULL ? nl + 1 : diag_end;
+    if ( opts->diag_fn != NULL ) {
+      char msg[ 256 ];
+      snprintf( msg, sizeof msg, "%.*s", STATIC_CAST( int, nl - line ), line );
+      (*opts->diag_fn)( opts->diag_data, T2PD_DIAG_WARNING, msg );
+    }
+    line = nl;
+  } // for
+  r += diag_len;
+
+  if ( status == T2PD_OK )
+    FWRITE( r, 1, STATIC_CAST( size_t, end - r ), fout );
+  free( req.data );
+  return status;
+
+protocol_error:
+  PMESSAGE_EXIT( EX_PROTOCOL,
+    "\"%s\": %s\n", socket_path, errno ? STRERROR : "malformed response"
+  );
+}
+
+////////// extern functions ///////////////////////////////////////////////////
+
+int serve_main( char const *socket_path, unsigned num_workers,
+                unsigned timeout_secs, size_t max_size ) {
+  assert( socket_path != NULL );
+  assert( num_workers > 0 );
+
+  int const listen_fd = serve_listen( socket_path );
+
+  struct sigaction sa;
+  memset( &sa, 0, sizeof sa );
+  sa.sa_handler = &serve_on_signal;     // no SA_RESTART: interrupt accept()
+  sigemptyset( &sa.sa_mask );
+  sigaction( SIGINT, &sa, NULL );
+  sigaction( SIGTERM, &sa, NULL );
+  signal( SIGPIPE, SIG_IGN );
+
+  serve_t s = { .timeout_secs = timeout_secs, .max_size = max_size };
+  serve_queue_t *const q = &s.queue;
+  pthread_mutex_init( &q->mtx, NULL );
+  pthread_cond_init( &q->not_empty, NULL );
+  pthread_condattr_t not_full_attr;
+  pthread_condattr_init( &not_full_attr );
+  pthread_condattr_setclock( &not_full_attr, CLOCK_MONOTONIC );
+  pthread_cond_init( &q->not_full, &not_full_attr );
+  pthread_condattr_destroy( &not_full_attr );
+  q->cap = num_workers * QUEUE_PER_WORKER;
+  q->fds = MALLOC( int, q->cap );
+
+  //
+  // Block the shutdown signals in the workers so they're delivered to this
+  // thread and interrupt accept().
+  //
+  sigset_t stop_sigs, old_sigs;
+  sigemptyset( &stop_sigs );
+  sigaddset( &stop_sigs, SIGINT );
+  sigaddset( &stop_sigs, SIGTERM );
+  pthread_sigmask( SIG_BLOCK, &stop_sigs, &old_sigs );
+
+  serve_worker_t *const workers = MALLOC( serve_worker_t, num_workers );
+  for ( unsigned i = 0; i < num_workers; ++i ) {
+    serve_worker_t *const w = &workers[i];
+    *w = (serve_worker_t){ .s = &s };
+    if ( (w->t = t2pd_new( NULL )) == NULL )
+      PERROR_EXIT( EX_OSERR );
+    int const err = pthread_create( &w->thread, NULL, &serve_thread, w );
+    if ( err != 0 )
+      PMESSAGE_EXIT( EX_OSERR, "can not create thread: %s\n", strerror( err ) );
+  } // for
+  pthread_sigmask( SIG_SETMASK, &old_sigs, NULL );
+
+  while ( !serve_stop ) {
+    int const fd = accept( listen_fd, NULL, NULL );
+    if ( fd == -1 ) {
+      if ( errno == EINTR || errno == ECONNABORTED )
+        continue;
+      PMESSAGE( "accept: %s\n", STRERROR );
+      break;
+    }
+    struct timeval const tv = { .tv_sec = timeout_secs };
+    setsockopt( fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof tv );
+
+    pthread_mutex_lock( &q->mtx );
+    while ( q->count == q->cap && !serve_stop ) {
+      // wait in slices since a signal doesn't interrupt the wait
+      struct timespec until;
+      clock_gettime( CLOCK_MONOTONIC, &until );
+      until.tv_nsec += IDLE_POLL_MS * 1000000L;
+      if ( until.tv_nsec >= 1000000000L ) {
+        ++until.tv_sec;
+        until.tv_nsec -= 1000000000L;
+      }
+      pthread_cond_timedwait( &q->not_full, &q->mtx, &until );
+    } // while
+    if ( serve_stop ) {
+      pthread_mutex_unlock( &q->mtx );
+      close( fd );
+      break;
+    }
+    q->fds[ (q->head + q->count++) % q->cap ] = fd;
+    pthread_cond_signal( &q->not_empty );
+    pthread_mutex_unlock( &q->mtx );
+  } // while
+
+  close( listen_fd );
+  unlink( socket_path );
+
+  pthread_mutex_lock( &q->mtx );
+  q->closed = true;
+  pthread_cond_broadcast( &q->not_empty );
+  pthread_mutex_unlock( &q->mtx );
+
+  for ( unsigned i = 0; i < num_workers; ++i ) {
+    serve_worker_t *const w = &workers[i];
+    pthread_join( w->thread, NULL );
+    t2pd_free( w->t );
+    free( w->req.data );
+    free( w->resp.data );
+    free( w->diag.data );
+  } // for
+  free( workers );
+  free( q->fds );
+  pthread_cond_destroy( &q->not_full );
+  pthread_cond_destroy( &q->not_empty );
+  pthread_mutex_destroy( &q->mtx );
+
+  return EXIT_SUCCESS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,119 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      serve.h
+**
+**      Copyright (C) 1998-2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#ifndef txt2pdbdoc_serve_H
+#define txt2pdbdoc_serve_H
+
+/**
+ * @file
+ * Declares a conversion server listening on a Unix domain socket and a client
+ * for it.
+ *
+ * Every message in either direction is a frame: a 4-byte big-endian length _N_
+ * followed by _N_ bytes.  A connection may carry any number of requests, each
+ * answered by exactly one response, in order.
+ *
+ * A request frame is:
+ *
+ *  Bytes | Contents
+ *  ------|---------------------------------------------------------
+ *  1     | Operation: `e` (encode) or `d` (decode).
+ *  1     | Options: bitwise-or of `SERVE_OPT_*` values.
+ *  4     | Unmapped codepoint (big-endian) or 0 for none.
+ *  1     | Length _L_ of the document name (encode only; else 0).
+ *  _L_   | The document name.
+ *  rest  | The text (encode) or Doc file (decode) to convert.
+ *
+ * A response frame is:
+ *
+ *  Bytes | Contents
+ *  ------|---------------------------------------------------------
+ *  1     | The ::t2pd_status of the conversion.
+ *  4     | Length _E_ of the error message (big-endian).
+ *  _E_   | The error message, if any.
+ *  4     | Length _D_ of diagnostic messages (big-endian).
+ *  _D_   | Diagnostic (warning) messages, each ending in a newline.
+ *  rest  | The Doc file (encode) or text (decode), if successful.
+ */
+
+// local
+#include "pjl_config.h"
+#include "txt2pdbdoc.h"
+
+// standard
+#include <stdbool.h>
+#include <stddef.h>                     /* for size_t */
+#include <stdio.h>
+
+#define SERVE_MAX_SIZE_DEFAULT  (16 * 1024 * 1024)  /* bytes */
+#define SERVE_TIMEOUT_DEFAULT   30      /* seconds */
+
+#define SERVE_OPT_NO_BINARY     0x01u   /* binary = false */
+#define SERVE_OPT_NO_COMPRESS   0x02u   /* compress = false */
+#define SERVE_OPT_NO_CHECK_DOC  0x04u   /* no_check_doc = true */
+#define SERVE_OPT_NO_TIMESTAMP  0x08u   /* no_timestamp = true */
+#define SERVE_OPT_NO_WARNINGS   0x10u   /* no_warnings = true */
+#define SERVE_OPT_VERIFY_ENCODE 0x20u   /* verify_encode = true */
+#define SERVE_OPT_HTML          0x40u   /* html = true */
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Sends a single conversion request to a server and waits for its response.
+ * Prints an error message and exits if the server can not be reached or
+ * doesn't respond properly.
+ *
+ * @param socket_path The path of the server's socket.
+ * @param opts The conversion options.  Diagnostic messages returned by the
+ * server are passed to its \ref t2pd_options::diag_fn "diag_fn", if any.
+ * @param decode If `true`, decode; if `false`, encode.
+ * @param doc_name The document name (encoding only).
+ * @param fin The file to read from.
+ * @param fout The file to write to.
+ * @param errmsg The buffer to receive the server's error message, if any.
+ * @param errmsg_size The size of \a errmsg.
+ * @return Returns the status of the conversion.
+ */
+NODISCARD
+t2pd_status_t serve_client( char const *socket_path,
+                            t2pd_options_t const *opts, bool decode,
+                            char const *doc_name, FILE *fin, FILE *fout,
+                            char *errmsg, size_t errmsg_size );
+
+/**
+ * Runs a conversion server until it receives either `SIGINT` or `SIGTERM`.
+ *
+ * @param socket_path The path of the socket to create and listen on.
+ * @param num_workers The number of worker threads, i.e., the maximum number of
+ * connections served concurrently.
+ * @param timeout_secs The number of seconds a client has to send each complete
+ * request or to accept each response.
+ * @param max_size The maximum size in bytes of a request.
+ * @return Returns `EXIT_SUCCESS` upon a clean shutdown.
+ */
+NODISCARD
+int serve_main( char const *socket_path, unsigned num_workers,
+                unsigned timeout_secs, size_t max_size );
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif /* txt2pdbdoc_serve_H */
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,123 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      stats.c
+**
+**      Copyright (C) 1998-2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+// local
+#include "pjl_config.h"
+#include "common.h"
+#include "txt2pdbdoc.h"
+
+// standard
+#include <assert.h>
+#include <string.h>
+#include <time.h>
+
+////////// local functions ////////////////////////////////////////////////////
+
+/**
+ * Reads a clock.
+ *
+ * @param clock_id The ID of the clock to read.
+ * @return Returns its time in nanoseconds.
+ */
+NODISCARD
+static uint64_t clock_ns( clockid_t clock_id ) {
+  struct timespec ts;
+  if ( clock_gettime( clock_id, &ts ) == -1 )
+    return 0;
+  return STATIC_CAST( uint64_t, ts.tv_sec ) * 1000000000u +
+         STATIC_CAST( uint64_t, ts.tv_nsec );
+}
+
+/**
+ * Reads both the wall and thread CPU clocks.
+ *
+ * @param clock The clock to set.
+ */
+static void clock_now( t2pd_clock_t *clock ) {
+  clock->wall_ns = clock_ns( CLOCK_MONOTONIC );
+  clock->cpu_ns = clock_ns( CLOCK_THREAD_CPUTIME_ID );
+}
+
+////////// extern functions ///////////////////////////////////////////////////
+
+void t2pd_stats_begin( t2pd_t *t, bool decode, t2pd_clock_t *clock ) {
+  assert( t != NULL );
+  assert( clock != NULL );
+  t2pd_stats_t *const stats = t->opts.stats;
+  if ( stats == NULL )
+    return;
+  memset( stats, 0, sizeof *stats );
+  stats->decode = decode;
+  clock_now( clock );
+}
+
+void t2pd_stats_phase( t2pd_t *t, t2pd_phase_t phase, t2pd_clock_t *clock ) {
+  assert( t != NULL );
+  assert( phase < T2PD_PHASE_COUNT );
+  assert( clock != NULL );
+  t2pd_stats_t *const stats = t->opts.stats;
+  if ( stats == NULL )
+    return;
+  t2pd_clock_t const start = *clock;
+  clock_now( clock );
+  t2pd_phase_stats_t *const ps = &stats->phases[ phase ];
+  ps->wall_ns += clock->wall_ns - start.wall_ns;
+  ps->cpu_ns += clock->cpu_ns - start.cpu_ns;
+  ++ps->count;
+}
+
+void t2pd_stats_record( t2pd_t *t, unsigned rec_num, size_t in_len,
+                        size_t out_len, t2pd_clock_t const *start,
+                        t2pd_clock_t const *clock ) {
+  assert( t != NULL );
+  assert( start != NULL );
+  assert( clock != NULL );
+  t2pd_stats_t *const stats = t->opts.stats;
+  if ( stats == NULL )
+    return;
+  ++stats->num_records;
+
+  t2pd_record_stats_t const rs = {
+    .rec_num = rec_num,
+    .in_len = in_len,
+    .out_len = out_len,
+    .wall_ns = clock->wall_ns - start->wall_ns
+  };
+
+  //
+  // Insertion into a tiny sorted array: find where the record goes (if at
+  // all) and shift the faster ones down, dropping the fastest if full.
+  //
+  unsigned i = stats->num_slowest;
+  if ( i == T2PD_STATS_SLOWEST ) {
+    if ( rs.wall_ns <= stats->slowest[ i - 1 ].wall_ns )
+      return;
+    --i;
+  } else {
+    ++stats->num_slowest;
+  }
+  for ( ; i > 0 && stats->slowest[ i - 1 ].wall_ns < rs.wall_ns; --i )
+    stats->slowest[i] = stats->slowest[ i - 1 ];
+  stats->slowest[i] = rs;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* vim:set et sw=2 ts=2: */
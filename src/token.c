@@ -0,0 +1,91 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      token.c
+**
+**      Copyright (C) 1998-2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+// local
+#include "pjl_config.h"
+#include "token.h"
+
+// standard
+#include <assert.h>
+
+////////// extern functions ///////////////////////////////////////////////////
+
+void doc_tokenizer_init( doc_tokenizer_t *dt, uint8_t const *src,
+                         size_t src_len ) {
+  assert( dt != NULL );
+  dt->src = src;
+  dt->src_len = src_len;
+  dt->src_pos = dt->dst_pos = 0;
+}
+
+doc_token_status_t doc_token_next( doc_tokenizer_t *dt, doc_token_t *tok ) {
+  assert( dt != NULL );
+  assert( tok != NULL );
+
+  size_t const i = dt->src_pos;
+  if ( i == dt->src_len )
+    return DOC_TOKEN_END;
+  unsigned const c = dt->src[i];
+
+  tok->src_pos = i;
+  tok->dst_pos = dt->dst_pos;
+  tok->distance = 0;
+  tok->bytes = NULL;
+
+  if ( c >= 1 && c <= 8 ) {
+    if ( i + 1 + c > dt->src_len )
+      return DOC_TOKEN_CORRUPT;
+    tok->kind = DOC_TOKEN_ESCAPE;
+    tok->src_len = 1 + c;
+    tok->dst_len = c;
+    tok->bytes = dt->src + i + 1;
+  }
+  else if ( c <= 0x7F ) {               // 0,09-7F = self
+    tok->kind = DOC_TOKEN_LITERAL;
+    tok->src_len = tok->dst_len = 1;
+    tok->bytes = dt->src + i;
+  }
+  else if ( c >= 0xC0 ) {               // space + ASCII char
+    tok->kind = DOC_TOKEN_SPACE_CHAR;
+    tok->src_len = 1;
+    tok->dst_len = 2;
+  }
+  else {                                // 80-BF = sequences
+    if ( i + 2 > dt->src_len )
+      return DOC_TOKEN_CORRUPT;
+    unsigned const v = (c << 8) + dt->src[ i + 1 ];
+    unsigned const di = (v & 0x3FFF) >> DOC_TOKEN_COUNT_BITS;
+    if ( di == 0 || di > dt->dst_pos )
+      return DOC_TOKEN_CORRUPT;
+    tok->kind = DOC_TOKEN_BACKREF;
+    tok->src_len = 2;
+    tok->dst_len =
+      (v & ((1u << DOC_TOKEN_COUNT_BITS) - 1)) + DOC_TOKEN_LEN_MIN;
+    tok->distance = di;
+  }
+
+  dt->src_pos += tok->src_len;
+  dt->dst_pos += tok->dst_len;
+  return DOC_TOKEN_OK;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* vim:set et sw=2 ts=2: */
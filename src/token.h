@@ -0,0 +1,128 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      token.h
+**
+**      Copyright (C) 1998-2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#ifndef txt2pdbdoc_token_H
+#define txt2pdbdoc_token_H
+
+/**
+ * @file
+ * Declares a tokenizer for PalmDoc-compressed records.
+ *
+ * A compressed record is a sequence of tokens, each introduced by a byte _c_:
+ *
+ *  _c_       | Token
+ *  ----------|-----------------------------------------------------------
+ *  00, 09-7F | A literal byte _c_.
+ *  01-08     | An escape: the next _c_ bytes are copied as-is.
+ *  80-BF     | With the next byte, a back-reference: 11 bits of distance and
+ *            | 3 bits of length - 3.
+ *  C0-FF     | A space followed by the byte _c_ ^ 80.
+ */
+
+// local
+#include "pjl_config.h"
+
+// standard
+#include <stddef.h>                     /* for size_t */
+#include <stdint.h>
+
+#define DOC_TOKEN_COUNT_BITS  3         /* bits of back-reference length */
+#define DOC_TOKEN_DIST_BITS   11        /* bits of back-reference distance */
+#define DOC_TOKEN_LEN_MIN     3         /* shortest back-reference */
+#define DOC_TOKEN_LEN_MAX     ((1 << DOC_TOKEN_COUNT_BITS) + 2)
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Kinds of tokens.
+ */
+enum doc_token_kind {
+  DOC_TOKEN_LITERAL,                    ///< A literal byte.
+  DOC_TOKEN_ESCAPE,                     ///< A run of 1-8 escaped bytes.
+  DOC_TOKEN_SPACE_CHAR,                 ///< A space followed by a byte.
+  DOC_TOKEN_BACKREF                     ///< A back-reference.
+};
+typedef enum doc_token_kind doc_token_kind_t;
+
+/**
+ * A single token.
+ */
+struct doc_token {
+  doc_token_kind_t  kind;               ///< The kind of token.
+  size_t            src_pos;            ///< Offset within compressed record.
+  size_t            src_len;            ///< Number of compressed bytes.
+  size_t            dst_pos;            ///< Offset within expanded record.
+  size_t            dst_len;            ///< Number of bytes it expands to.
+  unsigned          distance;           ///< Back-reference distance, if any.
+  uint8_t const    *bytes;              ///< Literal or escaped bytes, if any.
+};
+typedef struct doc_token doc_token_t;
+
+/**
+ * The state of tokenizing a single record.
+ */
+struct doc_tokenizer {
+  uint8_t const    *src;                ///< The compressed record.
+  size_t            src_len;            ///< The length of \a src.
+  size_t            src_pos;            ///< Offset of the next token.
+  size_t            dst_pos;            ///< Expanded offset of the next token.
+};
+typedef struct doc_tokenizer doc_tokenizer_t;
+
+/**
+ * Statuses returned by doc_token_next().
+ */
+enum doc_token_status {
+  DOC_TOKEN_OK,                         ///< A token was returned.
+  DOC_TOKEN_END,                        ///< No more tokens.
+  DOC_TOKEN_CORRUPT                     ///< The next token is invalid.
+};
+typedef enum doc_token_status doc_token_status_t;
+
+////////// extern functions ///////////////////////////////////////////////////
+
+/**
+ * Initializes a tokenizer.
+ *
+ * @param dt The tokenizer to initialize.
+ * @param src The compressed record.
+ * @param src_len The length of \a src.
+ */
+void doc_tokenizer_init( doc_tokenizer_t *dt, uint8_t const *src,
+                         size_t src_len );
+
+/**
+ * Gets the next token.
+ *
+ * @param dt The tokenizer.
+ * @param tok The token to fill in.
+ * @return Returns #DOC_TOKEN_OK if \a tok was filled in; #DOC_TOKEN_END at the
+ * end of the record; or #DOC_TOKEN_CORRUPT if the next token is truncated or is
+ * a back-reference to before the start of the record.  In the latter case, \a
+ * dt->src_pos is left at the offending token.
+ */
+NODISCARD
+doc_token_status_t doc_token_next( doc_tokenizer_t *dt, doc_token_t *tok );
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif /* txt2pdbdoc_token_H */
+/* vim:set et sw=2 ts=2: */
@@ -21,40 +21,69 @@
 
 // local
 #include "pjl_config.h"
-#include "common.h"
+#include "batch.h"
 #include "options.h"
+#include "pool.h"
+#include "serve.h"
+#include "txt2pdbdoc.h"
 #include "util.h"
 
 // standard
+#include <getopt.h>
+#include <inttypes.h>                   /* for PRIu64 */
 #include <stdio.h>
 #include <stdlib.h>                     /* for atexit(), exit() */
+#include <string.h>
+#include <sys/resource.h>               /* for getrusage() */
 #include <sysexits.h>
-#include <unistd.h>                     /* for getopt() */
 
 ////////// extern declarations ////////////////////////////////////////////////
 
-char const  *doc_name;                  // document name (when encoding)
-FILE        *fin;                       // file to read from
-char const  *fin_path;                  // path name of input file
-FILE        *fout;                      // file to write to
-char const  *fout_path;                 // path name of output file
 char const  *me;                        // executable name
 
-bool         opt_binary = true;         // strip binary characters
-bool         opt_compress = true;       // compress generated Doc files
-bool         opt_decode;                // decode from Doc instead
-bool         opt_no_check_doc;          // don't check Doc file signature
-bool         opt_no_timestamp;          // don't timestamp generated Doc files
-bool         opt_no_warnings;           // don't emit character warnings
-char32_t     opt_unmapped_codepoint;    // codepoint to subsitute for unmapped
-bool         opt_verbose;               // be verbose
+////////// local variables ////////////////////////////////////////////////////
 
-extern void decode( void );
-extern void encode( void );
+static char const  *batch_out_dir;      // output directory (batch mode)
+static char const  *batch_src_path;     // manifest or directory (batch mode)
+static char const  *doc_name;           // document name (when encoding)
+static FILE        *fin;                // file to read from
+static char const  *fin_path;           // path name of input file
+static FILE        *fout;               // file to write to
+static char const  *fout_path;          // path name of output file
+static char const  *socket_path;        // socket to serve or connect to
+static char const  *stats_path;         // file to write statistics to
+static size_t       verify_num_paths;   // number of files to verify
+static char const *const *verify_paths; // files to verify
+
+static bool         opt_batch;          // batch mode
+static bool         opt_connect;        // convert via a server
+static unsigned     opt_debounce = 100; // debounce milliseconds (watch mode)
+static bool         opt_decode;         // decode from Doc instead
+static bool         opt_verify;         // verify Doc files
+static unsigned     opt_jobs;           // number of threads (batch mode)
+static size_t       opt_max_size = SERVE_MAX_SIZE_DEFAULT;
+static uint64_t     opt_record_size;    // text record size (when encoding)
+static uint64_t     opt_volume_records; // text records per volume (encoding)
+static bool         opt_serve;          // run as a server
+static bool         opt_stats_json;     // print statistics as JSON
+static unsigned     opt_timeout = SERVE_TIMEOUT_DEFAULT;
+static bool         opt_watch;          // watch mode
+static t2pd_options_t conv_opts;        // conversion options
+static t2pd_stats_t conv_stats;         // conversion statistics
+
+static char const *const DECODE_PHASE_NAMES[] = {
+  "read", "transcode", "decompress", "write"
+};
+static char const *const ENCODE_PHASE_NAMES[] = {
+  "read", "transcode", "compress", "write"
+};
 
 ////////// local functions ////////////////////////////////////////////////////
 
 static void clean_up( void );
+static FILE* open_volume( void*, unsigned );
+static void print_diag( void*, t2pd_diag_t, char const* );
+static void print_stats( void );
 static void process_options( int, char*[] );
 static void usage( void );
 
@@ -62,13 +91,78 @@ static void usage( void );
 
 int main( int argc, char *argv[] ) {
   atexit( clean_up );
+  t2pd_options_init( &conv_opts );
+  conv_opts.diag_fn = &print_diag;
   process_options( argc, argv );
+  if ( fout_path != NULL )
+    conv_opts.volume_fn = &open_volume;
 
-  if ( opt_decode )
-    decode();
-  else
-    encode();
+  if ( opt_batch ) {
+    exit(
+      batch_main(
+        &conv_opts, opt_decode, opt_jobs, batch_src_path, batch_out_dir
+      )
+    );
+  }
+
+  if ( opt_watch ) {
+    exit(
+      batch_watch(
+        &conv_opts, opt_jobs, batch_src_path, batch_out_dir, opt_debounce
+      )
+    );
+  }
+
+  if ( opt_verify )
+    exit( batch_verify( &conv_opts, opt_jobs, verify_num_paths, verify_paths ) );
+
+  if ( opt_serve )
+    exit( serve_main( socket_path, opt_jobs, opt_timeout, opt_max_size ) );
+
+  t2pd_t *t = NULL;
+  t2pd_status_t status;
+  char const *errmsg;
+  char client_errmsg[ 256 ];
+
+  if ( opt_connect ) {
+    status = serve_client(
+      socket_path, &conv_opts, opt_decode, doc_name, fin, fout,
+      client_errmsg, sizeof client_errmsg
+    );
+    errmsg = client_errmsg;
+  } else {
+    if ( (t = t2pd_new( &conv_opts )) == NULL )
+      PERROR_EXIT( EX_OSERR );
+    status = opt_decode ?
+      t2pd_decode_file( t, fin, fout ) :
+      t2pd_encode_file( t, doc_name, fin, fout );
+    errmsg = t2pd_errmsg( t );
+  }
+
+  switch ( status ) {
+    case T2PD_OK:
+      break;
+    case T2PD_ERR_NOT_DOC:
+      PMESSAGE_EXIT( EX_DATAERR, "%s is not a Doc file\n", fin_path );
+    case T2PD_ERR_COMPRESSION:
+    case T2PD_ERR_CORRUPT:
+      PMESSAGE_EXIT( EX_DATAERR, "error: %s\n", errmsg );
+    case T2PD_ERR_VERIFY:
+      PMESSAGE_EXIT( EX_SOFTWARE, "error: %s\n", errmsg );
+    case T2PD_ERR_READ:
+      PMESSAGE_EXIT( EX_NOINPUT, "%s\n", errmsg );
+    case T2PD_ERR_WRITE:
+      PMESSAGE_EXIT( EX_IOERR, "%s\n", errmsg );
+    case T2PD_ERR_ARG:
+    case T2PD_ERR_NOMEM:
+      PMESSAGE_EXIT( EX_OSERR,
+        "%s\n", errmsg[0] != '\0' ? errmsg : t2pd_strerror( status )
+      );
+  } // switch
 
+  t2pd_free( t );
+  if ( conv_opts.stats != NULL )
+    print_stats();
   exit( EXIT_SUCCESS );
 }
 
@@ -81,49 +175,327 @@ static void clean_up( void ) {
     fclose( fout );
 }
 
+/**
+ * Opens the output file for a volume after the first of a Doc file too large
+ * for one.
+ *
+ * @param data Not used.
+ * @param volume The volume number (&gt; 1).
+ * @return Returns the file opened for writing or NULL upon error.
+ */
+NODISCARD
+static FILE* open_volume( void *data, unsigned volume ) {
+  (void)data;
+  return volume_fopen( fout_path, volume );
+}
+
+/**
+ * Prints a diagnostic message from the library to standard error.
+ *
+ * @param data Not used.
+ * @param kind The kind of message.
+ * @param msg The message.
+ */
+static void print_diag( void *data, t2pd_diag_t kind, char const *msg ) {
+  (void)data;
+  if ( kind == T2PD_DIAG_PROGRESS )
+    PRINT_ERR( "%s", msg );
+  else
+    PMESSAGE( "%s", msg );
+}
+
+/**
+ * Gets the peak resident set size of this process.
+ *
+ * @return Returns said size in kibibytes or 0 if unknown.
+ */
+NODISCARD
+static long peak_rss_kib( void ) {
+  struct rusage ru;
+  if ( getrusage( RUSAGE_SELF, &ru ) == -1 )
+    return 0;
+#ifdef __APPLE__
+  return ru.ru_maxrss / 1024;           // bytes on macOS
+#else
+  return ru.ru_maxrss;
+#endif /* __APPLE__ */
+}
+
+/**
+ * Gets the average length of back-references emitted by the compressor.
+ *
+ * @return Returns said length or 0 if none.
+ */
+NODISCARD
+static double stats_match_avg( void ) {
+  return conv_stats.matches == 0 ? 0.0 :
+    STATIC_CAST( double, conv_stats.match_bytes ) /
+    STATIC_CAST( double, conv_stats.matches );
+}
+
+/**
+ * Converts nanoseconds to milliseconds.
+ *
+ * @param ns The nanoseconds to convert.
+ * @return Returns said milliseconds.
+ */
+NODISCARD
+static double to_ms( uint64_t ns ) {
+  return STATIC_CAST( double, ns ) / 1e6;
+}
+
+/**
+ * Prints the conversion statistics as JSON.
+ *
+ * @param sout The file to print to.
+ * @param phase_name The name of each phase.
+ */
+static void print_stats_json( FILE *sout, char const *const phase_name[] ) {
+  t2pd_stats_t const *const st = &conv_stats;
+  FPRINTF( sout,
+    "{\n  \"operation\": \"%s\",\n  \"phases\": {",
+    st->decode ? "decode" : "encode"
+  );
+  for ( unsigned p = 0; p < T2PD_PHASE_COUNT; ++p ) {
+    t2pd_phase_stats_t const *const ps = &st->phases[p];
+    FPRINTF( sout,
+      "%s\n    \"%s\": "
+      "{ \"wall_ns\": %llu, \"cpu_ns\": %llu, \"count\": %llu }",
+      p > 0 ? "," : "", phase_name[p],
+      STATIC_CAST( unsigned long long, ps->wall_ns ),
+      STATIC_CAST( unsigned long long, ps->cpu_ns ),
+      STATIC_CAST( unsigned long long, ps->count )
+    );
+  } // for
+  FPRINTF( sout,
+    "\n  },\n"
+    "  \"bytes_in\": %llu,\n"
+    "  \"bytes_out\": %llu,\n"
+    "  \"records\": %u,\n"
+    "  \"compressor\": {\n"
+    "    \"match_attempts\": %llu,\n"
+    "    \"matches\": %llu,\n"
+    "    \"average_match_length\": %.2f,\n"
+    "    \"literal_escapes\": %llu\n"
+    "  },\n"
+    "  \"slowest_records\": [",
+    STATIC_CAST( unsigned long long, st->bytes_in ),
+    STATIC_CAST( unsigned long long, st->bytes_out ),
+    st->num_records,
+    STATIC_CAST( unsigned long long, st->match_attempts ),
+    STATIC_CAST( unsigned long long, st->matches ),
+    stats_match_avg(),
+    STATIC_CAST( unsigned long long, st->literal_escapes )
+  );
+  for ( unsigned i = 0; i < st->num_slowest; ++i ) {
+    t2pd_record_stats_t const *const rs = &st->slowest[i];
+    FPRINTF( sout,
+      "%s\n    { \"record\": %u, \"bytes_in\": %zu, "
+      "\"bytes_out\": %zu, \"wall_ns\": %llu }",
+      i > 0 ? "," : "", rs->rec_num, rs->in_len, rs->out_len,
+      STATIC_CAST( unsigned long long, rs->wall_ns )
+    );
+  } // for
+  FPRINTF( sout,
+    "%s],\n  \"peak_rss_kib\": %ld\n}\n",
+    st->num_slowest > 0 ? "\n  " : "", peak_rss_kib()
+  );
+}
+
+/**
+ * Prints the conversion statistics as text.
+ *
+ * @param sout The file to print to.
+ * @param phase_name The name of each phase.
+ */
+static void print_stats_text( FILE *sout, char const *const phase_name[] ) {
+  t2pd_stats_t const *const st = &conv_stats;
+  uint64_t total_wall = 0, total_cpu = 0;
+
+  FPRINTF( sout,
+    "%-12s %12s %12s %8s\n", "phase", "wall ms", "cpu ms", "count"
+  );
+  for ( unsigned p = 0; p < T2PD_PHASE_COUNT; ++p ) {
+    t2pd_phase_stats_t const *const ps = &st->phases[p];
+    if ( ps->count == 0 )
+      continue;
+    FPRINTF( sout, "%-12s %12.3f %12.3f %8llu\n",
+      phase_name[p], to_ms( ps->wall_ns ), to_ms( ps->cpu_ns ),
+      STATIC_CAST( unsigned long long, ps->count )
+    );
+    total_wall += ps->wall_ns;
+    total_cpu += ps->cpu_ns;
+  } // for
+  FPRINTF( sout, "%-12s %12.3f %12.3f\n\n",
+    "total", to_ms( total_wall ), to_ms( total_cpu )
+  );
+
+  FPRINTF( sout,
+    "bytes in:        %llu\n"
+    "bytes out:       %llu\n"
+    "records:         %u\n",
+    STATIC_CAST( unsigned long long, st->bytes_in ),
+    STATIC_CAST( unsigned long long, st->bytes_out ),
+    st->num_records
+  );
+  if ( !st->decode && conv_opts.compress ) {
+    FPRINTF( sout,
+      "match attempts:  %llu\n"
+      "matches:         %llu (average length %.2f)\n"
+      "literal escapes: %llu\n",
+      STATIC_CAST( unsigned long long, st->match_attempts ),
+      STATIC_CAST( unsigned long long, st->matches ),
+      stats_match_avg(),
+      STATIC_CAST( unsigned long long, st->literal_escapes )
+    );
+  }
+  FPRINTF( sout, "peak RSS:        %ld KiB\n", peak_rss_kib() );
+
+  if ( st->num_slowest > 0 ) {
+    FPRINTF( sout, "\nslowest records:\n" );
+    for ( unsigned i = 0; i < st->num_slowest; ++i ) {
+      t2pd_record_stats_t const *const rs = &st->slowest[i];
+      FPRINTF( sout, "  record %5u: %5zu -> %5zu bytes, %9.3f ms\n",
+        rs->rec_num, rs->in_len, rs->out_len, to_ms( rs->wall_ns )
+      );
+    } // for
+  }
+}
+
+/**
+ * Prints the conversion statistics to standard error or the statistics file.
+ */
+static void print_stats( void ) {
+  FILE *const sout =
+    stats_path != NULL ? check_fopen( stats_path, "w" ) : stderr;
+  char const *const *const phase_names =
+    conv_stats.decode ? DECODE_PHASE_NAMES : ENCODE_PHASE_NAMES;
+  if ( opt_stats_json )
+    print_stats_json( sout, phase_names );
+  else
+    print_stats_text( sout, phase_names );
+  if ( sout != stderr && fclose( sout ) == EOF )
+    PMESSAGE_EXIT( EX_IOERR, "\"%s\": %s\n", stats_path, STRERROR );
+}
+
 /**
  * Prints the usage message to standard error and exits.
  */
 static void usage( void ) {
   PRINT_ERR(
-"usage: %s [-bctvw] document_name file.txt file.pdb\n"
-"       %s -d [-Dvw] [-U codepoint] file.pdb [file.txt]\n"
+"usage: %s [-bcHmRstvw] [-C socket] [-F file] [-n records] [-r size] document_name file.txt file.pdb\n"
+"       %s -d [-DHsvw] [-C socket] [-F file] [-U codepoint] {file.pdb|-} [file.txt]\n"
+"       %s -B [-bcHmRtw] [-j threads] [-n records] [-r size] {manifest|dir} [out_dir]\n"
+"       %s -B -d [-DHw] [-U codepoint] [-j threads] {manifest|dir} [out_dir]\n"
+"       %s -W [-bcHmRtw] [-e ms] [-j threads] [-n records] [-r size] dir [out_dir]\n"
+"       %s -k [-D] [-j threads] {file.pdb...|-}\n"
+"       %s -S socket [-j threads] [-M bytes] [-T seconds]\n"
 "       %s -V\n"
 "\n"
 "options:\n"
 "  -b         Don't strip binary characters [default: do].\n"
+"  -B         Convert many files listed in a manifest or directory.\n"
 "  -c         Don't compress generated Doc file [default: do].\n"
+"  -C socket  Convert via the server listening on socket.\n"
 "  -d         Decode Doc file to text [default: encode to Doc].\n"
 "  -D         Don't check the type/creator of Doc files [default: do].\n"
+"  -e number  Set debounce interval in milliseconds for -W [default: 100].\n"
+"  -F file    Write statistics to file [default: stderr].\n"
+"  -H         Encode from or decode to HTML [default: text].\n"
+"  -j number  Set number of threads for -B, -k, -S, or -W [default: CPUs].\n"
+"  -k         Verify integrity of Doc files.\n"
+"  -m[text]   Make bookmarks of lines starting with text [default: none].\n"
+"  -M number  Set maximum request size for -S [default: %d].\n"
+"  -n number  Set most text records per volume [default: as many as fit].\n"
+"  -r number  Set text record size when encoding [default: 4096].\n"
+"  -R         Check each compressed record round-trips [default: don't].\n"
+"  -s[json]   Print timing and compression statistics [default: text].\n"
+"  -S socket  Serve conversion requests on socket.\n"
 "  -t         Don't include timestamps when encoding [default: do].\n"
+"  -T number  Set request timeout in seconds for -S [default: %d].\n"
 "  -U number  Set Unicode unmapped character [default: none].\n"
 "  -v         Be verbose [default: don't].\n"
 "  -V         Print version and exit.\n"
 "  -w         Don't print character conversion warnings [default: do].\n"
-    , me, me, me
+"  -W         Watch a directory and encode text files as they change.\n"
+    , me, me, me, me, me, me, me, me
+    , SERVE_MAX_SIZE_DEFAULT, SERVE_TIMEOUT_DEFAULT
   );
   exit( EX_USAGE );
 }
 
 static void process_options( int argc, char *argv[] ) {
-  char const  opts[] = "bcdDtU:vVw";    // command line options
-  bool        print_version = false;
+  static char const SHORT_OPTS[] = "bBcC:dDe:F:Hj:km::M:n:r:Rs::S:tT:U:vVwW";
+  static struct option const LONG_OPTS[] = {
+    { "batch",        no_argument,        NULL, 'B' },
+    { "bookmarks",    optional_argument,  NULL, 'm' },
+    { "connect",      required_argument,  NULL, 'C' },
+    { "debounce",     required_argument,  NULL, 'e' },
+    { "decode",       no_argument,        NULL, 'd' },
+    { "html",         no_argument,        NULL, 'H' },
+    { "jobs",         required_argument,  NULL, 'j' },
+    { "keep-binary",  no_argument,        NULL, 'b' },
+    { "max-size",     required_argument,  NULL, 'M' },
+    { "no-check",     no_argument,        NULL, 'D' },
+    { "no-compress",  no_argument,        NULL, 'c' },
+    { "no-timestamp", no_argument,        NULL, 't' },
+    { "no-warnings",  no_argument,        NULL, 'w' },
+    { "record-size",  required_argument,  NULL, 'r' },
+    { "round-trip",   no_argument,        NULL, 'R' },
+    { "serve",        required_argument,  NULL, 'S' },
+    { "stats",        optional_argument,  NULL, 's' },
+    { "stats-file",   required_argument,  NULL, 'F' },
+    { "timeout",      required_argument,  NULL, 'T' },
+    { "unmapped",     required_argument,  NULL, 'U' },
+    { "verbose",      no_argument,        NULL, 'v' },
+    { "verify",       no_argument,        NULL, 'k' },
+    { "version",      no_argument,        NULL, 'V' },
+    { "volume-records", required_argument, NULL, 'n' },
+    { "watch",        no_argument,        NULL, 'W' },
+    { NULL,           0,                  NULL, 0   }
+  };
+  bool print_version = false;
 
   me = strrchr( argv[0], '/' );         // determine base name...
   me = me ? me + 1 : argv[0];           // ...of executable
 
   opterr = 1;
-  for ( int opt; (opt = getopt( argc, argv, opts )) != EOF; ) {
+  for ( int opt;
+        (opt = getopt_long( argc, argv, SHORT_OPTS, LONG_OPTS, NULL )) != EOF; ) {
     switch ( opt ) {
-      case 'b': opt_binary = false;                                 break;
-      case 'c': opt_compress = false;                               break;
-      case 'd': opt_decode = true;                                  break;
-      case 'D': opt_no_check_doc = true;                            break;
-      case 't': opt_no_timestamp = true;                            break;
-      case 'U': opt_unmapped_codepoint = parse_codepoint( optarg ); break;
-      case 'v': opt_verbose = true;                                 break;
-      case 'V': print_version = true;                               break;
-      case 'w': opt_no_warnings = true;                             break;
+      case 'b': conv_opts.binary = false;                                 break;
+      case 'B': opt_batch = true;                                         break;
+      case 'c': conv_opts.compress = false;                               break;
+      case 'C': opt_connect = true; socket_path = optarg;                 break;
+      case 'd': opt_decode = true;                                        break;
+      case 'D': conv_opts.no_check_doc = true;                            break;
+      case 'e': opt_debounce = STATIC_CAST( unsigned, parse_ull( optarg ) ); break;
+      case 'F': stats_path = optarg;                                      break;
+      case 'H': conv_opts.html = true;                                    break;
+      case 'j': opt_jobs = STATIC_CAST( unsigned, parse_ull( optarg ) );  break;
+      case 'k': opt_verify = true;                                        break;
+      case 'm': conv_opts.bookmark = optarg != NULL ? optarg : "";       break;
+      case 'M': opt_max_size = STATIC_CAST( size_t, parse_ull( optarg ) ); break;
+      case 'n': opt_volume_records = parse_ull( optarg );                 break;
+      case 'r': opt_record_size = parse_ull( optarg );                    break;
+      case 'R': conv_opts.verify_encode = true;                           break;
+      case 's':
+        if ( optarg == NULL || strcmp( optarg, "text" ) == 0 )
+          opt_stats_json = false;
+        else if ( strcmp( optarg, "json" ) == 0 )
+          opt_stats_json = true;
+        else
+          PMESSAGE_EXIT( EX_USAGE, "\"%s\": invalid format for -s\n", optarg );
+        conv_opts.stats = &conv_stats;
+        break;
+      case 'S': opt_serve = true; socket_path = optarg;                   break;
+      case 't': conv_opts.no_timestamp = true;                            break;
+      case 'T': opt_timeout = STATIC_CAST( unsigned, parse_ull( optarg ) ); break;
+      case 'U': conv_opts.unmapped_codepoint = parse_codepoint( optarg ); break;
+      case 'v': conv_opts.verbose = true;                                 break;
+      case 'V': print_version = true;                                     break;
+      case 'w': conv_opts.no_warnings = true;                             break;
+      case 'W': opt_watch = true;                                         break;
       default : usage();
     } // switch
     opts_given[ opt ] = true;
@@ -132,27 +504,91 @@ static void process_options( int argc, char *argv[] ) {
   argv += optind - 1;
 
   // check for mutually exclusive options
-  check_mutually_exclusive( "bct", "dD" );
-  check_mutually_exclusive( "V", "bcdDtUvw" );
+  check_mutually_exclusive( "bcmnrRt", "dD" );
+  check_mutually_exclusive( "c", "R" );
+  check_mutually_exclusive( "B", "CFsv" );
+  check_mutually_exclusive( "C", "Fmnrsv" );
+  check_mutually_exclusive( "k", "bBcCdFHmnrRsStUvwW" );
+  check_mutually_exclusive( "S", "bBcCdDFHmnrRstUvwW" );
+  check_mutually_exclusive( "W", "BCdDFsv" );
+  check_mutually_exclusive( "V", "bBcCdDeFHjkmMnrRsStTUvwW" );
 
   // check for options that require other options
   check_required( "DU", "d" );
+  check_required( "e", "W" );
+  check_required( "F", "s" );
+  check_required( "j", "BkSW" );
+  check_required( "MT", "S" );
 
   if ( print_version ) {
     PRINT_ERR( "%s\n", PACKAGE_STRING );
     exit( EXIT_SUCCESS );
   }
 
+  if ( opts_given[ 'j' ] && opt_jobs == 0 )
+    PMESSAGE_EXIT( EX_USAGE, "\"%s\": invalid value for -j\n", "0" );
+  if ( opts_given[ 'r' ] ) {
+    if ( opt_record_size < T2PD_RECORD_SIZE_MIN ||
+         opt_record_size > T2PD_RECORD_SIZE_MAX ) {
+      PMESSAGE_EXIT( EX_USAGE,
+        "\"%" PRIu64 "\": invalid value for -r: must be %u-%u\n",
+        opt_record_size, T2PD_RECORD_SIZE_MIN, T2PD_RECORD_SIZE_MAX
+      );
+    }
+    conv_opts.record_size = STATIC_CAST( unsigned, opt_record_size );
+  }
+  if ( opts_given[ 'n' ] ) {
+    if ( opt_volume_records == 0 || opt_volume_records > 0xFFFF ) {
+      PMESSAGE_EXIT( EX_USAGE,
+        "\"%" PRIu64 "\": invalid value for -n: must be 1-65535\n",
+        opt_volume_records
+      );
+    }
+    conv_opts.volume_records = STATIC_CAST( unsigned, opt_volume_records );
+  }
+  if ( opt_jobs == 0 )
+    opt_jobs = pool_default_workers();
+
+  if ( opt_serve ) {
+    if ( argc != 0 )
+      usage();
+    return;
+  }
+
+  if ( opt_verify ) {
+    if ( argc < 1 )
+      usage();
+    verify_num_paths = STATIC_CAST( size_t, argc );
+    verify_paths = (char const *const*)argv + 1;
+    return;
+  }
+
+  if ( opt_batch || opt_watch ) {
+    switch ( argc ) {
+      case 2:
+        batch_out_dir = argv[2];
+        FALLTHROUGH;
+      case 1:
+        batch_src_path = argv[1];
+        break;
+      default:
+        usage();
+    } // switch
+    return;
+  }
+
   if ( opt_decode ) {
     switch ( argc ) {
       case 1:
         fin_path = argv[1];
-        fin  = check_fopen( fin_path , "r" );
+        fin = strcmp( fin_path, "-" ) == 0 ?
+          stdin : check_fopen( fin_path, "r" );
         fout = stdout;
         break;
       case 2:
         fin_path = argv[1];
-        fin = check_fopen( fin_path, "r" );
+        fin = strcmp( fin_path, "-" ) == 0 ?
+          stdin : check_fopen( fin_path, "r" );
         fout_path = argv[2];
         fout = check_fopen( fout_path, "w" );
         break;
@@ -0,0 +1,416 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      txt2pdbdoc.h
+**
+**      Copyright (C) 1998-2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#ifndef txt2pdbdoc_H
+#define txt2pdbdoc_H
+
+/**
+ * @file
+ * Declares the public API of **libtxt2pdbdoc**, a reentrant library for
+ * converting between text and Doc files.
+ *
+ * All conversion state lives in a ::t2pd_t handle.  Different handles may be
+ * used concurrently by different threads; a single handle must not.  No
+ * function in the library ever calls `exit`(3): errors are returned as
+ * ::t2pd_status_t values instead.
+ */
+
+// standard
+#include <stdbool.h>
+#include <stddef.h>                     /* for size_t */
+#include <stdint.h>                     /* for uint8_t, ... */
+#include <stdio.h>                      /* for FILE */
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * The maximum number of bytes t2pd_compress() can produce for \a N bytes of
+ * input.
+ */
+#define T2PD_COMPRESS_BOUND(N)    ((N) * 2)
+
+/**
+ * The minimum and maximum sizes of text records when encoding.  Smaller
+ * records can't make full use of the 2K window of back-references; record 0
+ * holds the size in 16 bits.
+ *
+ * @sa t2pd_options::record_size
+ */
+#define T2PD_RECORD_SIZE_MIN      2048u
+#define T2PD_RECORD_SIZE_MAX      65535u
+
+/**
+ * Status codes returned by library functions.
+ */
+enum t2pd_status {
+  T2PD_OK,                              ///< Success.
+  T2PD_ERR_ARG,                         ///< Invalid argument.
+  T2PD_ERR_NOMEM,                       ///< Memory allocation failed.
+  T2PD_ERR_READ,                        ///< Error reading input.
+  T2PD_ERR_WRITE,                       ///< Error writing output.
+  T2PD_ERR_NOT_DOC,                     ///< Input is not a Doc file.
+  T2PD_ERR_COMPRESSION,                 ///< Unknown Doc compression type.
+  T2PD_ERR_CORRUPT,                     ///< Input is malformed or truncated.
+  T2PD_ERR_VERIFY                       ///< Round-trip check failed.
+};
+typedef enum t2pd_status t2pd_status_t;
+
+/**
+ * Kinds of diagnostic messages passed to a ::t2pd_diag_fn.
+ */
+enum t2pd_diag {
+  T2PD_DIAG_WARNING,                    ///< Character conversion warning.
+  T2PD_DIAG_INFO,                       ///< Informational message.
+  T2PD_DIAG_PROGRESS                    ///< Verbose progress text fragment.
+};
+typedef enum t2pd_diag t2pd_diag_t;
+
+/**
+ * The signature for a function that receives diagnostic messages.
+ *
+ * @param data The \ref t2pd_options::diag_data "diag_data" pointer.
+ * @param kind The kind of message.
+ * @param msg The NULL-terminated message.  Warning and informational messages
+ * end with a newline; progress text fragments may not.
+ */
+typedef void (*t2pd_diag_fn)( void *data, t2pd_diag_t kind, char const *msg );
+
+/**
+ * The signature for a function that opens the file for the next volume when
+ * encoding text too large for one Doc file.  Each volume is a complete Doc
+ * file whose name ends with its volume number.
+ *
+ * @param data The \ref t2pd_options::volume_data "volume_data" pointer.
+ * @param volume The volume number starting at 2: volume 1 is written to the
+ * file given to the encoding function.
+ * @return Returns a seekable file opened for writing that the library closes
+ * when done or NULL upon error with `errno` set.
+ */
+typedef FILE* (*t2pd_volume_fn)( void *data, unsigned volume );
+
+/**
+ * Phases of a conversion whose times are measured in a ::t2pd_stats.
+ */
+enum t2pd_phase {
+  T2PD_PHASE_READ,                      ///< Reading Doc records (decoding).
+  T2PD_PHASE_TRANSCODE,                 ///< Reading and transcoding text.
+  T2PD_PHASE_COMPRESS,                  ///< Compressing or uncompressing.
+  T2PD_PHASE_WRITE,                     ///< Writing output.
+  T2PD_PHASE_COUNT                      ///< Number of phases.
+};
+typedef enum t2pd_phase t2pd_phase_t;
+
+/**
+ * The number of slowest records kept in a ::t2pd_stats.
+ */
+#define T2PD_STATS_SLOWEST        5
+
+/**
+ * Times spent in a conversion phase.
+ */
+struct t2pd_phase_stats {
+  uint64_t      wall_ns;                ///< Elapsed (wall clock) time.
+  uint64_t      cpu_ns;                 ///< CPU time of the calling thread.
+  uint64_t      count;                  ///< Times the phase was entered.
+};
+typedef struct t2pd_phase_stats t2pd_phase_stats_t;
+
+/**
+ * Statistics of one text record.
+ */
+struct t2pd_record_stats {
+  unsigned      rec_num;                ///< Record number (1-based).
+  size_t        in_len;                 ///< Size before conversion.
+  size_t        out_len;                ///< Size after conversion.
+  uint64_t      wall_ns;                ///< Elapsed time for all its phases.
+};
+typedef struct t2pd_record_stats t2pd_record_stats_t;
+
+/**
+ * Statistics of a conversion, filled in if \ref t2pd_options::stats "stats"
+ * is set.  When encoding, text is read and transcoded in a single pass, so
+ * reading it is included in #T2PD_PHASE_TRANSCODE; a wall time much larger
+ * than its CPU time means the conversion is waiting for input.
+ */
+struct t2pd_stats {
+  bool          decode;                 ///< Was it a decode?
+  t2pd_phase_stats_t phases[ T2PD_PHASE_COUNT ]; ///< Per-phase times.
+  uint64_t      bytes_in;               ///< Total bytes read.
+  uint64_t      bytes_out;              ///< Total bytes written.
+  unsigned      num_records;            ///< Number of text records.
+
+  uint64_t      match_attempts;         ///< Back-reference searches.
+  uint64_t      matches;                ///< Back-references emitted.
+  uint64_t      match_bytes;            ///< Bytes replaced by them.
+  uint64_t      literal_escapes;        ///< Bytes needing an escape code.
+
+  /// The slowest records, slowest first.
+  t2pd_record_stats_t slowest[ T2PD_STATS_SLOWEST ];
+  unsigned      num_slowest;            ///< Number of \a slowest used.
+};
+typedef struct t2pd_stats t2pd_stats_t;
+
+/**
+ * Conversion options.
+ *
+ * @sa t2pd_options_init()
+ */
+struct t2pd_options {
+  bool          binary;                 ///< Strip binary characters.
+  /// If not NULL, the text that marks lines to make into bookmarks when
+  /// encoding.  If empty, it is taken from a final `<`_marker_`>` line of the
+  /// text, if any.  It must remain valid while in use.
+  char const   *bookmark;
+  bool          compress;               ///< Compress generated Doc files.
+  bool          html;                   ///< Encode from or decode to HTML.
+  bool          no_check_doc;           ///< Don't check Doc file signature.
+  bool          no_timestamp;           ///< Don't timestamp generated files.
+  bool          no_warnings;            ///< Don't emit character warnings.
+  /// The size of text records when encoding from #T2PD_RECORD_SIZE_MIN to
+  /// #T2PD_RECORD_SIZE_MAX, or 0 for 4096, the most every reader accepts.
+  unsigned      record_size;
+  uint32_t      unmapped_codepoint;     ///< Codepoint to substitute, if any.
+  bool          verbose;                ///< Emit progress diagnostics.
+  bool          verify_encode;          ///< Round-trip check each record.
+  /// The most text records per volume when encoding, or 0 for as many as fit
+  /// in one Doc file.
+  unsigned      volume_records;
+
+  t2pd_diag_fn  diag_fn;                ///< Diagnostic receiver, if any.
+  void         *diag_data;              ///< Passed to \a diag_fn.
+
+  /// Opens the files for volumes after the first.  If NULL, encoding text
+  /// too large for one Doc file fails.
+  t2pd_volume_fn volume_fn;
+  void         *volume_data;            ///< Passed to \a volume_fn.
+
+  /// Receives the statistics of each conversion, if not NULL.  It must not
+  /// be shared by handles used concurrently.
+  t2pd_stats_t *stats;
+};
+typedef struct t2pd_options t2pd_options_t;
+
+/**
+ * An opaque conversion handle.
+ */
+typedef struct t2pd t2pd_t;
+
+////////// handles ////////////////////////////////////////////////////////////
+
+/**
+ * Initializes \a opts to the default options, i.e., those used by the
+ * **txt2pdbdoc** command when no options are given.
+ *
+ * @param opts The options to initialize.
+ */
+void t2pd_options_init( t2pd_options_t *opts );
+
+/**
+ * Creates a new conversion handle.
+ *
+ * @param opts The options to use, or NULL for the defaults.  They are copied.
+ * @return Returns a new handle or NULL if memory allocation failed.
+ *
+ * @sa t2pd_free()
+ */
+t2pd_t* t2pd_new( t2pd_options_t const *opts );
+
+/**
+ * Frees a conversion handle.
+ *
+ * @param t The handle to free.  If NULL, does nothing.
+ *
+ * @sa t2pd_new()
+ */
+void t2pd_free( t2pd_t *t );
+
+/**
+ * Replaces the options of an existing handle so it (and its buffers) can be
+ * reused for conversions needing different options.
+ *
+ * @param t The handle.
+ * @param opts The options to use, or NULL for the defaults.  They are copied.
+ */
+void t2pd_set_options( t2pd_t *t, t2pd_options_t const *opts );
+
+/**
+ * Gets a description of the most recent error that occurred using \a t.
+ *
+ * @param t The handle.
+ * @return Returns said description (without a trailing newline) or the empty
+ * string if no error has occurred.  The string is valid only until the next
+ * call using \a t.
+ */
+char const* t2pd_errmsg( t2pd_t const *t );
+
+/**
+ * Gets a generic description of \a status.
+ *
+ * @param status The status to describe.
+ * @return Returns said description.
+ */
+char const* t2pd_strerror( t2pd_status_t status );
+
+////////// conversion /////////////////////////////////////////////////////////
+
+/**
+ * Encodes text from \a fin into a Doc file written to \a fout.
+ *
+ * @param t The handle.
+ * @param doc_name The name of the document.
+ * @param fin The file to read UTF-8 text from.  It must be a regular file.
+ * @param fout The file to write to.  It must be seekable.  If the text is too
+ * large for one Doc file, it's volume 1 and the rest are opened via
+ * \ref t2pd_options::volume_fn "volume_fn".
+ * @return Returns #T2PD_OK only if successful.
+ */
+t2pd_status_t t2pd_encode_file( t2pd_t *t, char const *doc_name, FILE *fin,
+                                FILE *fout );
+
+/**
+ * Encodes text read from the file descriptor \a in_fd into a Doc file written
+ * to the file descriptor \a out_fd.  Neither descriptor is closed.  Either
+ * may be a pipe.
+ *
+ * @param t The handle.
+ * @param doc_name The name of the document.
+ * @param in_fd The file descriptor to read UTF-8 text from.
+ * @param out_fd The file descriptor to write to.
+ * @return Returns #T2PD_OK only if successful.
+ */
+t2pd_status_t t2pd_encode_fd( t2pd_t *t, char const *doc_name, int in_fd,
+                              int out_fd );
+
+/**
+ * Encodes text in memory into a Doc file in memory.
+ *
+ * @param t The handle.
+ * @param doc_name The name of the document.
+ * @param in The UTF-8 text to encode.
+ * @param in_len The number of bytes of \a in.
+ * @param out A pointer to receive a pointer to the encoded Doc file that the
+ * caller must `free`(3).
+ * @param out_len A pointer to receive the number of bytes of \a *out.
+ * @return Returns #T2PD_OK only if successful.
+ */
+t2pd_status_t t2pd_encode_mem( t2pd_t *t, char const *doc_name,
+                               void const *in, size_t in_len,
+                               void **out, size_t *out_len );
+
+/**
+ * Decodes a Doc file read from \a fin into UTF-8 text written to \a fout.
+ *
+ * If \a fin isn't seekable (e.g., a pipe), its record list is read and then
+ * its text records are read in order as text is written, so their offsets must
+ * be increasing, and the last record of the file extends to its end.  (When
+ * decoding to HTML, it's first copied to a temporary file instead.)
+ *
+ * @param t The handle.
+ * @param fin The Doc file to read, positioned at its start.
+ * @param fout The file to write to.
+ * @return Returns #T2PD_OK only if successful.
+ */
+t2pd_status_t t2pd_decode_file( t2pd_t *t, FILE *fin, FILE *fout );
+
+/**
+ * Decodes a Doc file read from the file descriptor \a in_fd into UTF-8 text
+ * written to the file descriptor \a out_fd.  Neither descriptor is closed.
+ *
+ * @param t The handle.
+ * @param in_fd The file descriptor to read the Doc file from.
+ * @param out_fd The file descriptor to write to.
+ * @return Returns #T2PD_OK only if successful.
+ */
+t2pd_status_t t2pd_decode_fd( t2pd_t *t, int in_fd, int out_fd );
+
+/**
+ * Decodes a Doc file in memory into UTF-8 text in memory.
+ *
+ * @param t The handle.
+ * @param in The Doc file to decode.
+ * @param in_len The number of bytes of \a in.
+ * @param out A pointer to receive a pointer to the decoded text that the
+ * caller must `free`(3).
+ * @param out_len A pointer to receive the number of bytes of \a *out.
+ * @return Returns #T2PD_OK only if successful.
+ */
+t2pd_status_t t2pd_decode_mem( t2pd_t *t, void const *in, size_t in_len,
+                               void **out, size_t *out_len );
+
+////////// verification ///////////////////////////////////////////////////////
+
+/**
+ * Checks the integrity of a Doc file without decoding it to text.  Checked
+ * are: the PDB header; the type/creator (unless
+ * \ref t2pd_options::no_check_doc "no_check_doc"); that record offsets are
+ * within the file and monotonically increasing; that record 0 is consistent
+ * with the PDB header and itself; and that every text record decompresses
+ * without overrunning to exactly the record size given in record 0 (the last
+ * to the remainder of the document size).  Checking stops at the first error.
+ *
+ * @param t The handle.
+ * @param fin The Doc file to check.  It must be seekable.
+ * @return Returns #T2PD_OK only if the file is valid.
+ */
+t2pd_status_t t2pd_verify_file( t2pd_t *t, FILE *fin );
+
+////////// compression ////////////////////////////////////////////////////////
+
+/**
+ * Compresses a buffer using Doc compression.
+ *
+ * @param src The bytes to compress.
+ * @param src_len The number of bytes of \a src.
+ * @param dst The buffer to receive the compressed bytes.  It must be at least
+ * #T2PD_COMPRESS_BOUND(\a src_len) bytes.
+ * @param dst_len A pointer to receive the number of compressed bytes.
+ * @return Returns #T2PD_OK only if successful.
+ */
+t2pd_status_t t2pd_compress( uint8_t const *src, size_t src_len,
+                             uint8_t *dst, size_t *dst_len );
+
+/**
+ * Uncompresses a buffer compressed using Doc compression.
+ *
+ * @param src The bytes to uncompress.
+ * @param src_len The number of bytes of \a src.
+ * @param dst The buffer to receive the uncompressed bytes.
+ * @param dst_size The size of \a dst.
+ * @param dst_len A pointer to receive the number of uncompressed bytes.
+ * @return Returns #T2PD_OK only if successful or #T2PD_ERR_CORRUPT if either
+ * \a src is malformed or its uncompressed bytes would exceed \a dst_size.
+ */
+t2pd_status_t t2pd_uncompress( uint8_t const *src, size_t src_len,
+                               uint8_t *dst, size_t dst_size,
+                               size_t *dst_len );
+
+///////////////////////////////////////////////////////////////////////////////
+
+#ifdef __cplusplus
+} // extern "C"
+#endif /* __cplusplus */
+
+#endif /* txt2pdbdoc_H */
+/* vim:set et sw=2 ts=2: */
@@ -27,8 +27,6 @@
 
 // standard
 #include <assert.h>
-#include <ctype.h>
-#include <sysexits.h>
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -54,31 +52,6 @@ char8_t const UTF8_LEN_TABLE[] = {
 
 ////////// extern functions ///////////////////////////////////////////////////
 
-char32_t parse_codepoint( char const *s ) {
-  assert( s != NULL );
-
-  if ( s[0] != '\0' && s[1] == '\0' )   // assume single-char ASCII
-    return STATIC_CAST( char32_t, s[0] );
-
-  char const *const s0 = s;
-  char *t = NULL;
-
-  if ( (s[0] == 'U' || s[0] == 'u') && s[1] == '+' ) {
-    // convert [uU]+NNNN to 0xNNNN so strtoull() will grok it
-    t = check_strdup( s );
-    s = memcpy( t, "0x", 2 );
-  }
-  uint64_t const cp = parse_ull( s );
-  free( t );
-
-  if ( cp_is_valid( cp ) )
-    return STATIC_CAST( char32_t, cp );
-  PMESSAGE_EXIT( EX_USAGE,
-    "\"%s\": invalid Unicode code-point for -%c\n",
-    s0, 'U'
-  );
-}
-
 char32_t utf8_decode( char8_t const *u ) {
   assert( u != NULL );
 
@@ -77,20 +77,6 @@ bool cp_is_valid( uint64_t cp_candidate ) {
       ||  (cp_candidate >= 0x010000 && cp_candidate <= CP_VALID_MAX);
 }
 
-/**
- * Parses a Unicode code-point value.
- *
- * @param s The NULL-terminated string to parse.  Allows for strings of the
- * form:
- *  + X: a single character.
- *  + NN: two-or-more decimal digits.
- *  + 0xN, u+N, or U+N: one-or-more hexadecimal digits.
- * @return Returns the Unicode code-point value
- * or prints an error message and exits if \a s is invalid.
- */
-NODISCARD
-char32_t parse_codepoint( char const *s );
-
 /**
  * Gets the length of a UTF-8 character.
  *
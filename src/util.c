@@ -21,13 +21,12 @@
 
 // local
 #include "pjl_config.h"
-#include "common.h"
-#include "unicode.h"
 #include "util.h"
 
 // standard
 #include <assert.h>
 #include <ctype.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sysexits.h>
 
@@ -87,16 +86,6 @@ char* check_strdup( char const *s ) {
   return dup;
 }
 
-uint8_t* mem_find( uint8_t *m, size_t m_len, uint8_t *b, size_t b_len ) {
-  assert( m != NULL );
-  assert( b != NULL );
-
-  for ( size_t i = m_len - b_len + 1; i > 0; --i, ++m )
-    if ( *m == *b && memcmp( m, b, b_len ) == 0 )
-      return m;
-  return NULL;
-}
-
 uint64_t parse_ull( char const *s ) {
   assert( s != NULL );
   s = skip_ws( s );
@@ -121,27 +110,33 @@ int peekc( FILE *file ) {
   return c;
 }
 
-char const* printable_char( char c ) {
-  switch( c ) {
-    case '\0': return "\\0";
-    case '\a': return "\\a";
-    case '\b': return "\\b";
-    case '\f': return "\\f";
-    case '\n': return "\\n";
-    case '\r': return "\\r";
-    case '\t': return "\\t";
-    case '\v': return "\\v";
-  } // switch
-
-  static char buf[5];                   // \xHH + NULL
-  if ( isprint( c ) ) {
-    buf[0] = c;
-    buf[1] = '\0';
-  }
-  else {
-    snprintf( buf, sizeof buf, "\\x%02X", STATIC_CAST( unsigned, c ) );
-  }
-  return buf;
+FILE* volume_fopen( char const *path, unsigned volume ) {
+  char *const vpath = volume_path( path, volume );
+  if ( vpath == NULL )
+    return NULL;
+  FILE *const file = fopen( vpath, "w" );
+  free( vpath );
+  return file;
+}
+
+char* volume_path( char const *path, unsigned volume ) {
+  assert( path != NULL );
+  assert( volume > 1 );
+
+  char const *const slash = strrchr( path, '/' );
+  char const *const base = slash != NULL ? slash + 1 : path;
+  char const *ext = strrchr( base, '.' );
+  if ( ext == NULL || ext == base )     // no extension or a "dot file"
+    ext = path + strlen( path );
+
+  size_t const size = strlen( path ) + 1 + 10 /* digits */ + 1;
+  char *const vpath = malloc( size );
+  if ( vpath == NULL )
+    return NULL;
+  snprintf( vpath, size, "%.*s.%u%s",
+    STATIC_CAST( int, ext - path ), path, volume, ext
+  );
+  return vpath;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
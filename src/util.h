@@ -44,6 +44,7 @@
 # define FSEEK_FN fseek
 #endif /* HAVE_FSEEKO */
 
+#define ARRAY_SIZE(A)       (sizeof(A) / sizeof(A)[0])
 #define BLOCK(...)          do { __VA_ARGS__ } while (0)
 #define PERROR_EXIT(STATUS) BLOCK( perror( me ); exit( STATUS ); )
 #define PRINT_ERR(...)      fprintf( stderr, __VA_ARGS__ )
@@ -84,6 +85,8 @@
  */
 #define NO_OP                     ((void)0)
 
+#define PRINTABLE_CHAR_SIZE       5     /* \xHH + NULL */
+
 #define PMESSAGE(FORMAT,...) \
   PRINT_ERR( "%s: " FORMAT, me, __VA_ARGS__ )
 
@@ -152,7 +155,8 @@ void* check_realloc( void *p, size_t size );
  * or NULL if not found.
  */
 NODISCARD
-uint8_t* mem_find( uint8_t *m, size_t m_len, uint8_t *b, size_t b_len );
+uint8_t const* mem_find( uint8_t const *m, size_t m_len, uint8_t const *b,
+                         size_t b_len );
 
 /**
  * Parses a string into a \c uint64_t.
@@ -188,13 +192,38 @@ int peekc( FILE *file );
  *    hexedecimal value of che characters ASCII code.
  *
  * @param c The character to get the printable form of.
+ * @param buf A buffer of at least #PRINTABLE_CHAR_SIZE bytes that may be used
+ * to hold the result.
  * @return Returns a NULL-terminated string that is a printable version of
- * \a c.  Note that the result is a pointer to static storage, hence subsequent
- * calls will overwrite the returned value.  As such, this function is not
- * thread-safe.
+ * \a c.  It is either a string literal or \a buf.
+ */
+NODISCARD
+char const* printable_char( char c, char buf[ PRINTABLE_CHAR_SIZE ] );
+
+/**
+ * Opens the file for a volume of a Doc file whose first volume is \a path.
+ *
+ * @param path The path of the first volume.
+ * @param volume The volume number (&gt; 1).
+ * @return Returns the file opened for writing or NULL upon error.
+ *
+ * @sa volume_path()
+ */
+NODISCARD
+FILE* volume_fopen( char const *path, unsigned volume );
+
+/**
+ * Gets the path of a volume of a Doc file whose first volume is \a path: the
+ * volume number is inserted before the extension, if any, e.g., volume 2 of
+ * `alice.pdb` is `alice.2.pdb`.
+ *
+ * @param path The path of the first volume.
+ * @param volume The volume number (&gt; 1).
+ * @return Returns said path or NULL upon error with `errno` set.  The caller
+ * is responsible for freeing it.
  */
 NODISCARD
-char const* printable_char( char c );
+char* volume_path( char const *path, unsigned volume );
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -0,0 +1,195 @@
+/*
+**      txt2pdbdoc -- Text to Doc converter for Palm Pilots
+**      verify.c
+**
+**      Copyright (C) 1998-2024  Paul J. Lucas
+**
+**      This program is free software; you can redistribute it and/or modify
+**      it under the terms of the GNU General Public License as published by
+**      the Free Software Foundation; either version 2 of the License, or
+**      (at your option) any later version.
+**
+**      This program is distributed in the hope that it will be useful,
+**      but WITHOUT ANY WARRANTY; without even the implied warranty of
+**      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**      GNU General Public License for more details.
+**
+**      You should have received a copy of the GNU General Public License
+**      along with this program; if not, write to the Free Software
+**      Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+// local
+#include "pjl_config.h"
+#include "common.h"
+#include "doc.h"
+#include "palm.h"
+#include "txt2pdbdoc.h"
+#include "util.h"
+
+// standard
+#include <assert.h>
+#include <sys/types.h>                  /* for FreeBSD */
+#include <netinet/in.h>                 /* for ntohl(), ntohs() */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+////////// local functions ////////////////////////////////////////////////////
+
+/**
+ * Reads the offsets of all records into \a t->offsets followed by the file
+ * size as a sentinel so the size of record _i_ is always `offsets[i+1] -
+ * offsets[i]`.
+ *
+ * @param t The handle.
+ * @param fin The file to read from, positioned at the first record entry.
+ * @param num_records The number of records.
+ * @param file_size The size of the file.
+ * @return Returns #T2PD_OK only if successful.
+ */
+NODISCARD
+static t2pd_status_t read_offsets( t2pd_t *t, FILE *fin, unsigned num_records,
+                                   DWord file_size ) {
+  t2pd_status_t const status = t2pd_offsets_reserve( t, num_records + 1 );
+  if ( status != T2PD_OK )
+    return status;
+
+  DWord const list_end = DatabaseHdrSize + RecordEntrySize * num_records;
+  DWord prev = list_end;
+  for ( unsigned i = 0; i < num_records; ++i ) {
+    RecordEntryType rec;
+    T2PD_FREAD( t, &rec, RecordEntrySize, fin );
+    DWord const offset = ntohl( rec.offset );
+    if ( offset < prev || offset > file_size ) {
+      return t2pd_error( t, T2PD_ERR_CORRUPT,
+        "record %u: offset %lu %s\n", i, STATIC_CAST( unsigned long, offset ),
+        offset > file_size ? "beyond end of file" :
+        i == 0 ? "within record list" : "less than previous record's"
+      );
+    }
+    t->offsets[i] = prev = offset;
+  } // for
+  t->offsets[ num_records ] = file_size;
+  return T2PD_OK;
+}
+
+////////// extern functions ///////////////////////////////////////////////////
+
+t2pd_status_t t2pd_verify_file( t2pd_t *t, FILE *fin ) {
+  if ( t == NULL || fin == NULL )
+    return T2PD_ERR_ARG;
+
+  T2PD_FSEEK( t, fin, 0, SEEK_END );
+  long const ftell_size = ftell( fin );
+  if ( ftell_size < 0 || ftell_size > 0xFFFFFFFFL )
+    return t2pd_error( t, T2PD_ERR_CORRUPT, "file too large\n" );
+  DWord const file_size = STATIC_CAST( DWord, ftell_size );
+  T2PD_FSEEK( t, fin, 0, SEEK_SET );
+
+  ////////// check header /////////////////////////////////////////////////////
+
+  DatabaseHdrType header;
+  T2PD_FREAD( t, &header, DatabaseHdrSize, fin );
+  if ( memchr( header.name, '\0', sizeof header.name ) == NULL )
+    return t2pd_error( t, T2PD_ERR_CORRUPT, "name not null-terminated\n" );
+
+  doc_layout_t dl;
+  doc_status_t doc_status =
+    doc_parse_header( &header, !t->opts.no_check_doc, &dl );
+  if ( doc_status != DOC_OK )
+    return t2pd_doc_error( t, doc_status, &dl );
+  unsigned const num_pdb_records = dl.num_pdb_records;
+
+  t2pd_status_t status = read_offsets( t, fin, num_pdb_records, file_size );
+  if ( status != T2PD_OK )
+    return status;
+  DWord const *const offsets = t->offsets;
+
+  ////////// check record 0 ///////////////////////////////////////////////////
+
+  size_t const rec0_size = offsets[1] - offsets[0];
+  doc_record0_t rec0;
+  if ( rec0_size >= sizeof rec0 ) {
+    T2PD_FSEEK( t, fin, offsets[0], SEEK_SET );
+    T2PD_FREAD( t, &rec0, sizeof rec0, fin );
+  }
+  doc_status = doc_parse_record0( &rec0, rec0_size, &dl );
+  if ( doc_status != DOC_OK )
+    return t2pd_doc_error( t, doc_status, &dl );
+
+  unsigned const compression = dl.compression;
+  DWord const doc_size = dl.doc_size;
+  unsigned const num_records = dl.rec0_num_records;
+  unsigned const rec_size = dl.rec_size;
+
+  status = t2pd_buffers_reserve( t, rec_size );
+  if ( status != T2PD_OK )
+    return status;
+  if ( num_records >= num_pdb_records ) {
+    return t2pd_error( t, T2PD_ERR_CORRUPT,
+      "record 0: %u text records, but only %u PDB records\n",
+      num_records, num_pdb_records
+    );
+  }
+  DWord const expected_records =
+    doc_size / rec_size + (doc_size % rec_size != 0);
+  if ( num_records != expected_records ) {
+    return t2pd_error( t, T2PD_ERR_CORRUPT,
+      "record 0: %u text records, but document size %lu needs %lu\n",
+      num_records, STATIC_CAST( unsigned long, doc_size ),
+      STATIC_CAST( unsigned long, expected_records )
+    );
+  }
+
+  ////////// check text records ///////////////////////////////////////////////
+
+  buffer_t *const in_buf = &t->z_buf;
+  buffer_t *const out_buf = &t->rec_buf;
+  size_t const in_buf_size = T2PD_COMPRESS_BOUND( rec_size );
+
+  for ( unsigned rec_num = 1; rec_num <= num_records; ++rec_num ) {
+    size_t const expected_len = rec_num < num_records ?
+      rec_size : doc_size - STATIC_CAST( DWord, num_records - 1 ) * rec_size;
+    size_t const stored_len = offsets[ rec_num + 1 ] - offsets[ rec_num ];
+
+    if ( compression == DOC_UNCOMPRESSED ) {
+      if ( stored_len != expected_len ) {
+        return t2pd_error( t, T2PD_ERR_CORRUPT,
+          "record %u: %zu bytes; expected %zu\n",
+          rec_num, stored_len, expected_len
+        );
+      }
+      continue;                         // nothing else to check
+    }
+
+    if ( stored_len > in_buf_size ) {
+      return t2pd_error( t, T2PD_ERR_CORRUPT,
+        "record %u: compressed size %zu too large\n", rec_num, stored_len
+      );
+    }
+    T2PD_FSEEK( t, fin, offsets[ rec_num ], SEEK_SET );
+    T2PD_FREAD( t, in_buf->data, stored_len, fin );
+    in_buf->len = stored_len;
+
+    status = t2pd_uncompress( in_buf->data, in_buf->len, out_buf->data,
+                              expected_len, &out_buf->len );
+    if ( status != T2PD_OK ) {
+      return t2pd_error( t, T2PD_ERR_CORRUPT,
+        "record %u: invalid compressed data or more than %zu bytes\n",
+        rec_num, expected_len
+      );
+    }
+    if ( out_buf->len != expected_len ) {
+      return t2pd_error( t, T2PD_ERR_CORRUPT,
+        "record %u: decompresses to %zu bytes; expected %zu\n",
+        rec_num, out_buf->len, expected_len
+      );
+    }
+  } // for
+
+  return T2PD_OK;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* vim:set et sw=2 ts=2: */
@@ -50,6 +50,14 @@ fail() {
   } > $TRS_FILE
 }
 
+skip() {
+  print_result SKIP $TEST_NAME
+  {
+    echo ":test-result: SKIP"
+    echo ":copy-in-global-log: no"
+  } > $TRS_FILE
+}
+
 print_result() {
   RESULT=$1; shift
   COLOR=`eval echo \\$COLOR_$RESULT`
@@ -79,6 +87,7 @@ ME=`local_basename "$0"`
   echo "$ME: \$BUILD_SRC not set" >&2
   exit 2
 }
+[ "$BUILD_BENCH" ] || BUILD_BENCH=$BUILD_SRC/../bench
 
 ########## Process command-line ###############################################
 
@@ -227,6 +236,124 @@ run_test_file() {
   fi
 }
 
+##
+# Prints the current time in nanoseconds or nothing if date(1) can't.
+##
+now_ns() {
+  NS=`date +%s%N 2>/dev/null`
+  case $NS in
+  *[!0-9]*|'') ;;
+  *) echo $NS ;;
+  esac
+}
+
+##
+# Prints the median time in nanoseconds of 5 runs of a command or nothing if
+# the time can't be measured.
+##
+median_time_ns() {
+  TIMES=
+  for RUN in 1 2 3 4 5
+  do
+    START=`now_ns`
+    "$@" > /dev/null || return
+    END=`now_ns`
+    [ "$START" -a "$END" ] || return 0
+    TIMES="$TIMES `expr $END - $START`"
+  done
+  echo $TIMES | tr ' ' '\n' | sort -n | sed -n 3p
+}
+
+##
+# A .perf file has the same format as a .test file except that the input is a
+# corpus kind and size given to gencorpus and the expected exit status is
+# replaced by two limits:
+#
+#   COMMAND | OPTIONS | DOC_NAME | KIND SIZE | MAX_RATIO | MAX_SLOWDOWN
+#
+# MAX_RATIO is the baseline compression ratio (output size / input size) that
+# must not be exceeded.  MAX_SLOWDOWN is the maximum time the conversion may
+# take as a multiple of the time gzip(1) takes to compress the same corpus,
+# used as a calibration loop so the limit holds on any machine.  Both times
+# are the median of 5 runs; gzip compresses the corpus repeated until one run
+# takes at least CAL_MIN_NS so its startup doesn't dominate, and its time is
+# divided by the number of repeats.
+#
+# The ratio is deterministic and always checked.  Timings of tests run in
+# parallel with others are meaningless, so the timing is checked only if
+# T2PD_PERF is set, e.g.:
+#
+#     make check -j1 T2PD_PERF=1
+#
+# If the ratio is within the baseline but the timing isn't checked because
+# T2PD_PERF isn't set, gzip is missing, or the time can't be measured, the
+# result is SKIP.
+##
+CAL_MIN_NS=100000000                    # 100 ms
+CAL_REPEAT_MAX=4096
+
+run_perf_file() {
+  IFS='|' read COMMAND OPTIONS DOC_NAME CORPUS MAX_RATIO MAX_SLOWDOWN < $TEST
+  COMMAND=`echo $COMMAND`               # trims whitespace
+  DOC_NAME=`echo $DOC_NAME`             # trims whitespace
+  MAX_RATIO=`echo $MAX_RATIO`           # trims whitespace
+  MAX_SLOWDOWN=`echo $MAX_SLOWDOWN`     # trims whitespace
+  INPUT=${OUTPUT}corpus.txt
+
+  $BUILD_BENCH/gencorpus $CORPUS > $INPUT 2> $LOG_FILE || { fail; return; }
+  $COMMAND $OPTIONS "$DOC_NAME" $INPUT $OUTPUT 2>> $LOG_FILE || { fail; return; }
+
+  IN_SIZE=`wc -c < $INPUT`
+  OUT_SIZE=`wc -c < $OUTPUT`
+  RATIO=`awk "BEGIN { printf \"%.4f\", $OUT_SIZE / $IN_SIZE }"`
+  echo "ratio: $RATIO ($OUT_SIZE / $IN_SIZE); baseline: $MAX_RATIO" >> $LOG_FILE
+  awk "BEGIN { exit !($OUT_SIZE / $IN_SIZE <= $MAX_RATIO) }" || { fail; return; }
+
+  if [ -z "$T2PD_PERF" ]
+  then
+    echo "timing: skipped (T2PD_PERF not set)" >> $LOG_FILE
+    skip; return
+  fi
+  command -v gzip > /dev/null 2>&1 || {
+    echo "timing: skipped (no gzip)" >> $LOG_FILE
+    skip; return
+  }
+
+  CAL_INPUT=${OUTPUT}cal.txt
+  cp $INPUT $CAL_INPUT || { fail; return; }
+  CAL_REPEAT=1
+  while [ $CAL_REPEAT -lt $CAL_REPEAT_MAX ]
+  do
+    START=`now_ns`
+    gzip -c $CAL_INPUT > /dev/null || { fail; return; }
+    END=`now_ns`
+    [ "$START" -a "$END" ] || break
+    [ `expr $END - $START` -lt $CAL_MIN_NS ] || break
+    cat $CAL_INPUT $CAL_INPUT > ${CAL_INPUT}2 && mv ${CAL_INPUT}2 $CAL_INPUT ||
+      { fail; return; }
+    CAL_REPEAT=`expr $CAL_REPEAT \* 2`
+  done
+
+  CONV_NS=`median_time_ns $COMMAND $OPTIONS "$DOC_NAME" $INPUT $OUTPUT` || {
+    fail; return;
+  }
+  CAL_NS=`median_time_ns gzip -c $CAL_INPUT` || { fail; return; }
+  if [ -z "$CONV_NS" -o -z "$CAL_NS" ]
+  then
+    echo "timing: skipped (no nanosecond clock)" >> $LOG_FILE
+    skip; return
+  fi
+  CAL_NS=`expr $CAL_NS / $CAL_REPEAT`
+
+  SLOWDOWN=`awk "BEGIN { printf \"%.2f\", $CONV_NS / ($CAL_NS + 1) }"`
+  echo "slowdown: $SLOWDOWN ($CONV_NS ns / $CAL_NS ns); limit: $MAX_SLOWDOWN" \
+    >> $LOG_FILE
+  if awk "BEGIN { exit !($SLOWDOWN <= $MAX_SLOWDOWN) }"
+  then pass
+  else fail
+  fi
+}
+
 ##
 # Must put BUILD_SRC first in PATH so we get the correct version of txt2pdbdoc.
 ##
@@ -235,6 +362,7 @@ PATH=$BUILD_SRC:$PATH
 trap "x=$?; rm -f /tmp/*_$$_* 2>/dev/null; exit $x" EXIT HUP INT TERM
 
 case $TEST in
+*.perf) run_perf_file ;;
 *.sh)   run_sh_file ;;
 *.test) run_test_file ;;
 esac
@@ -0,0 +1,50 @@
+#! /bin/sh
+##
+#       txt2pdbdoc -- Text to Doc converter for Palm Pilots
+#       test/tests/palm-ascii.sh
+#
+#       Copyright (C) 2024  Paul J. Lucas
+#
+#       This program is free software; you can redistribute it and/or modify
+#       it under the terms of the GNU General Public License as published by
+#       the Free Software Foundation; either version 2 of the Licence, or
+#       (at your option) any later version.
+#
+#       This program is distributed in the hope that it will be useful,
+#       but WITHOUT ANY WARRANTY; without even the implied warranty of
+#       MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#       GNU General Public License for more details.
+#
+#       You should have received a copy of the GNU General Public License
+#       along with this program.  If not, see <http://www.gnu.org/licenses/>.
+##
+
+##
+# Tests that every printable ASCII character maps to itself from PalmOS to
+# Unicode when only lines of matches are transcoded (pdbgrep) and when
+# decoding to HTML (-d -H), neither of which takes the ASCII fast path of
+# decoding to text.  (0x27, 0x37, 0x47, 0x57, 0x67, and 0x77 once mapped to
+# the character before each.)
+##
+
+OUTPUT=$1
+LOG_FILE=$2
+trap "rm -f ${OUTPUT}*" EXIT
+
+# all 95 printable characters: "Z" is close enough to the middle for all of
+# them to be within the context of a match
+awk 'BEGIN { for ( c = 32; c < 127; ++c ) printf "%c", c; print "" }' \
+  > ${OUTPUT}.txt
+txt2pdbdoc -t ASCII ${OUTPUT}.txt ${OUTPUT}.pdb 2>> $LOG_FILE || exit
+
+pdbgrep Z ${OUTPUT}.pdb > ${OUTPUT}out 2>> $LOG_FILE || exit
+cat ${OUTPUT}out >> $LOG_FILE
+[ "`cut -d: -f4- ${OUTPUT}out`" = "`cat ${OUTPUT}.txt`" ] || exit
+
+txt2pdbdoc -d -H ${OUTPUT}.pdb ${OUTPUT}.html 2>> $LOG_FILE || exit
+grep -q "0123456789" ${OUTPUT}.html || exit
+grep -q "ABCDEFGHIJKLMNOPQRSTUVWXYZ" ${OUTPUT}.html || exit
+grep -q "abcdefghijklmnopqrstuvwxyz" ${OUTPUT}.html || exit
+grep -q "&amp;'()" ${OUTPUT}.html
+
+# vim:set et sw=2 ts=2:
@@ -0,0 +1,46 @@
+#! /bin/sh
+##
+#       txt2pdbdoc -- Text to Doc converter for Palm Pilots
+#       test/tests/pdbdump-empty.sh
+#
+#       Copyright (C) 2024  Paul J. Lucas
+#
+#       This program is free software; you can redistribute it and/or modify
+#       it under the terms of the GNU General Public License as published by
+#       the Free Software Foundation; either version 2 of the Licence, or
+#       (at your option) any later version.
+#
+#       This program is distributed in the hope that it will be useful,
+#       but WITHOUT ANY WARRANTY; without even the implied warranty of
+#       MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#       GNU General Public License for more details.
+#
+#       You should have received a copy of the GNU General Public License
+#       along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+##
+##
+# Tests dumping a PDB file having only a header and no records: dumps must
+# succeed with no records, but Doc-specific dumps must fail.
+##
+
+OUTPUT=$1
+LOG_FILE=$2
+DATA_DIR=$srcdir/data
+trap "rm -f ${OUTPUT}*" EXIT
+
+# the header of a real file but with the number of records set to 0
+{ head -c 76 $DATA_DIR/ISO_8859-1.pdb; printf '\000\000'; } > ${OUTPUT}.pdb
+
+for opts in "" -d -l "-j -p"
+do
+  pdbdump $opts ${OUTPUT}.pdb > ${OUTPUT}out 2>> $LOG_FILE || exit
+  cat ${OUTPUT}out >> $LOG_FILE
+  grep -q "0000" ${OUTPUT}out && exit 1   # no record rows
+done
+pdbdump -j ${OUTPUT}.pdb | grep -q '"records": \[\]' || exit
+
+pdbdump -s ${OUTPUT}.pdb > /dev/null 2>> $LOG_FILE && exit 1
+exit 0
+
+# vim:set et sw=2 ts=2:
@@ -0,0 +1,40 @@
+#! /bin/sh
+##
+#       txt2pdbdoc -- Text to Doc converter for Palm Pilots
+#       test/tests/pdbdump-stdin.sh
+#
+#       Copyright (C) 2024  Paul J. Lucas
+#
+#       This program is free software; you can redistribute it and/or modify
+#       it under the terms of the GNU General Public License as published by
+#       the Free Software Foundation; either version 2 of the Licence, or
+#       (at your option) any later version.
+#
+#       This program is distributed in the hope that it will be useful,
+#       but WITHOUT ANY WARRANTY; without even the implied warranty of
+#       MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#       GNU General Public License for more details.
+#
+#       You should have received a copy of the GNU General Public License
+#       along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+##
+# Tests that dumping a PDB file streamed from a pipe produces the same output
+# as dumping it mapped from a regular file, both as text and as JSON.
+##
+
+OUTPUT=$1
+LOG_FILE=$2
+DATA_DIR=$srcdir/data
+trap "rm -f ${OUTPUT}*" EXIT
+
+PDB=$DATA_DIR/ISO_8859-1.pdb
+
+for opts in "" -d -h "-j -p"
+do
+  pdbdump $opts $PDB ${OUTPUT}file 2>> $LOG_FILE || exit
+  cat $PDB | pdbdump $opts /dev/stdin ${OUTPUT}pipe 2>> $LOG_FILE || exit
+  diff ${OUTPUT}file ${OUTPUT}pipe >> $LOG_FILE || exit
+done
+
+# vim:set et sw=2 ts=2:
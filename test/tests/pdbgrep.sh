@@ -0,0 +1,75 @@
+#! /bin/sh
+##
+#       txt2pdbdoc -- Text to Doc converter for Palm Pilots
+#       test/tests/pdbgrep.sh
+#
+#       Copyright (C) 2024  Paul J. Lucas
+#
+#       This program is free software; you can redistribute it and/or modify
+#       it under the terms of the GNU General Public License as published by
+#       the Free Software Foundation; either version 2 of the Licence, or
+#       (at your option) any later version.
+#
+#       This program is distributed in the hope that it will be useful,
+#       but WITHOUT ANY WARRANTY; without even the implied warranty of
+#       MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#       GNU General Public License for more details.
+#
+#       You should have received a copy of the GNU General Public License
+#       along with this program.  If not, see <http://www.gnu.org/licenses/>.
+##
+
+##
+# Tests searching Doc files (pdbgrep): matches must be found across record
+# boundaries and in both compressed and uncompressed files, with or without
+# case, exit statuses must be like grep(1)'s, and output for files having
+# more than can be buffered must still not be interleaved.
+##
+
+OUTPUT=$1
+LOG_FILE=$2
+DATA_DIR=$srcdir/data
+trap "rm -f ${OUTPUT}*" EXIT
+
+for i in 1 2 3 4 5 6 7 8 9 10
+do cat $DATA_DIR/sample.txt
+done > ${OUTPUT}txt
+txt2pdbdoc -r 2048 -t Sample ${OUTPUT}txt ${OUTPUT}c.pdb 2>> $LOG_FILE || exit
+txt2pdbdoc -c -r 2048 -t Sample ${OUTPUT}txt ${OUTPUT}u.pdb 2>> $LOG_FILE ||
+  exit
+
+for pdb in ${OUTPUT}c.pdb ${OUTPUT}u.pdb
+do
+  # the 3rd match spans records 1 and 2
+  pdbgrep -j 1 'General Public License for more details' $pdb \
+    > ${OUTPUT}out 2>> $LOG_FILE || exit
+  cat ${OUTPUT}out >> $LOG_FILE
+  [ "`cut -d: -f3 ${OUTPUT}out | tr '\n' ' '`" = \
+    "524 1274 2024 2774 3524 4274 5024 5774 6524 7274 " ] || exit
+  grep -q "^$pdb:Sample:2024:GNU General Public License for more details\.\$" \
+    ${OUTPUT}out || exit
+
+  N=`grep -o License ${OUTPUT}txt | wc -l | tr -d ' '`
+  [ "`pdbgrep -c License $pdb`" = "$pdb:Sample:$N" ] || exit
+  [ "`pdbgrep -ci 'gnu general' $pdb`" = "$pdb:Sample:30" ] || exit
+done
+
+[ "`pdbgrep -l Foundation ${OUTPUT}c.pdb ${OUTPUT}u.pdb | wc -l`" -eq 2 ] ||
+  exit
+pdbgrep Windows ${OUTPUT}c.pdb >> $LOG_FILE 2>&1
+[ $? -eq 1 ] || exit
+pdbgrep Foundation ${OUTPUT}c.pdb ${OUTPUT}txt >> $LOG_FILE 2>&1
+[ $? -eq 65 ] || exit
+
+# well over 64 KB of output per file
+awk 'BEGIN { for ( i = 1; i <= 20000; ++i ) print "Line", i, "of the text." }' \
+  > ${OUTPUT}txt
+txt2pdbdoc -t Lines ${OUTPUT}txt ${OUTPUT}1.pdb 2>> $LOG_FILE || exit
+cp ${OUTPUT}1.pdb ${OUTPUT}2.pdb || exit
+cp ${OUTPUT}1.pdb ${OUTPUT}3.pdb || exit
+pdbgrep -j 3 Line ${OUTPUT}1.pdb ${OUTPUT}2.pdb ${OUTPUT}3.pdb \
+  > ${OUTPUT}out 2>> $LOG_FILE || exit
+[ `wc -l < ${OUTPUT}out` -eq 60000 ] || exit
+[ `cut -d: -f1 ${OUTPUT}out | uniq | wc -l` -eq 3 ]
+
+# vim:set et sw=2 ts=2:
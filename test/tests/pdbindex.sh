@@ -0,0 +1,77 @@
+#! /bin/sh
+##
+#       txt2pdbdoc -- Text to Doc converter for Palm Pilots
+#       test/tests/pdbindex.sh
+#
+#       Copyright (C) 2024  Paul J. Lucas
+#
+#       This program is free software; you can redistribute it and/or modify
+#       it under the terms of the GNU General Public License as published by
+#       the Free Software Foundation; either version 2 of the Licence, or
+#       (at your option) any later version.
+#
+#       This program is distributed in the hope that it will be useful,
+#       but WITHOUT ANY WARRANTY; without even the implied warranty of
+#       MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#       GNU General Public License for more details.
+#
+#       You should have received a copy of the GNU General Public License
+#       along with this program.  If not, see <http://www.gnu.org/licenses/>.
+##
+
+##
+# Tests indexing Doc files (pdbindex): phrases must be found where pdbgrep(1)
+# finds them, including across record boundaries, and updating the index must
+# pick up changed files, even those changed within the same second.
+##
+
+OUTPUT=$1
+LOG_FILE=$2
+DATA_DIR=$srcdir/data
+trap "rm -f ${OUTPUT}*" EXIT
+
+for i in 1 2 3 4 5 6 7 8 9 10
+do cat $DATA_DIR/sample.txt
+done > ${OUTPUT}txt
+txt2pdbdoc -r 2048 -t Sample ${OUTPUT}txt ${OUTPUT}c.pdb 2>> $LOG_FILE || exit
+txt2pdbdoc -c -r 2048 -t Sample ${OUTPUT}txt ${OUTPUT}u.pdb 2>> $LOG_FILE ||
+  exit
+pdbindex -j 1 ${OUTPUT}idx ${OUTPUT}c.pdb ${OUTPUT}u.pdb 2>> $LOG_FILE || exit
+
+PHRASE='General Public License for more details'
+pdbindex -q ${OUTPUT}idx "$PHRASE" > ${OUTPUT}out 2>> $LOG_FILE || exit
+pdbgrep -j 1 "$PHRASE" ${OUTPUT}c.pdb ${OUTPUT}u.pdb > ${OUTPUT}exp \
+  2>> $LOG_FILE || exit
+cat ${OUTPUT}out >> $LOG_FILE
+cmp -s ${OUTPUT}out ${OUTPUT}exp || exit
+
+# words are case-insensitive and punctuation between them doesn't matter
+[ "`pdbindex -qc ${OUTPUT}idx 'GNU, general' | tr '\n' ' '`" = \
+  "${OUTPUT}c.pdb:Sample:30 ${OUTPUT}u.pdb:Sample:30 " ] || exit
+N=`grep -oiw license ${OUTPUT}txt | wc -l | tr -d ' '`
+[ "`pdbindex -qc ${OUTPUT}idx license | head -1`" = \
+  "${OUTPUT}c.pdb:Sample:$N" ] || exit
+
+# update after a file changes
+txt2pdbdoc -t Sample $DATA_DIR/sample.txt ${OUTPUT}u.pdb 2>> $LOG_FILE || exit
+pdbindex ${OUTPUT}idx 2>> $LOG_FILE || exit
+[ "`pdbindex -qc ${OUTPUT}idx 'GNU, general' | tr '\n' ' '`" = \
+  "${OUTPUT}c.pdb:Sample:30 ${OUTPUT}u.pdb:Sample:3 " ] || exit
+
+pdbindex -q ${OUTPUT}idx 'more license' >> $LOG_FILE 2>&1
+[ $? -eq 1 ] || exit
+
+# update after a file changes within the same second keeping the same size
+txt2pdbdoc -c -r 2048 -t Sample ${OUTPUT}txt ${OUTPUT}s.pdb 2>> $LOG_FILE ||
+  exit
+touch -d @1000000000.25 ${OUTPUT}s.pdb || exit
+pdbindex ${OUTPUT}s.idx ${OUTPUT}s.pdb 2>> $LOG_FILE || exit
+sed 's/General/Generic/g' ${OUTPUT}txt > ${OUTPUT}g.txt
+txt2pdbdoc -c -r 2048 -t Sample ${OUTPUT}g.txt ${OUTPUT}s.pdb 2>> $LOG_FILE ||
+  exit
+touch -d @1000000000.75 ${OUTPUT}s.pdb || exit
+pdbindex ${OUTPUT}s.idx ${OUTPUT}s.pdb 2>> $LOG_FILE || exit
+pdbindex -q ${OUTPUT}s.idx 'GNU, general' >> $LOG_FILE 2>&1
+[ $? -eq 1 ]
+
+# vim:set et sw=2 ts=2:
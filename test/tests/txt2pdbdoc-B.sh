@@ -0,0 +1,66 @@
+#! /bin/sh
+##
+#       txt2pdbdoc -- Text to Doc converter for Palm Pilots
+#       test/tests/txt2pdbdoc-B.sh
+#
+#       Copyright (C) 2024  Paul J. Lucas
+#
+#       This program is free software; you can redistribute it and/or modify
+#       it under the terms of the GNU General Public License as published by
+#       the Free Software Foundation; either version 2 of the Licence, or
+#       (at your option) any later version.
+#
+#       This program is distributed in the hope that it will be useful,
+#       but WITHOUT ANY WARRANTY; without even the implied warranty of
+#       MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#       GNU General Public License for more details.
+#
+#       You should have received a copy of the GNU General Public License
+#       along with this program.  If not, see <http://www.gnu.org/licenses/>.
+##
+
+##
+# Tests batch mode (-B) on both a directory and a manifest: every file must
+# convert identically to converting it alone, and a failed conversion must be
+# reported without stopping the others.
+##
+
+OUTPUT=$1
+LOG_FILE=$2
+DATA_DIR=$srcdir/data
+DIR=${OUTPUT}dir
+
+rm -rf $DIR
+mkdir $DIR || exit
+trap "rm -rf $DIR" EXIT
+
+for name in a b c d e
+do cp $DATA_DIR/sample.txt $DIR/$name.txt || exit
+done
+
+##
+# Directory: encode then decode everything with several threads.
+##
+txt2pdbdoc -B -t -j 3 $DIR > $DIR/status 2>> $LOG_FILE || exit
+[ `grep -c '^ok	' $DIR/status` -eq 5 ] || exit
+txt2pdbdoc -t c $DIR/c.txt $DIR/ref.pdb 2>> $LOG_FILE || exit
+cmp $DIR/c.pdb $DIR/ref.pdb >> $LOG_FILE || exit
+rm $DIR/ref.pdb
+
+mkdir $DIR/out || exit
+txt2pdbdoc -B -d -j 2 $DIR $DIR/out > /dev/null 2>> $LOG_FILE || exit
+for name in a b c d e
+do cmp $DATA_DIR/sample.txt $DIR/out/$name.txt >> $LOG_FILE || exit
+done
+
+##
+# Manifest: one missing input must fail only its own line.
+##
+printf 'A\t%s\t%s\nB\t%s\t%s\n' \
+  $DIR/a.txt $DIR/a2.pdb $DIR/missing.txt $DIR/b2.pdb |
+  txt2pdbdoc -B -t - > $DIR/status 2>> $LOG_FILE
+[ $? -eq 65 ] || exit
+grep -q "^ok	$DIR/a.txt	" $DIR/status || exit
+grep -q "^error	$DIR/missing.txt	" $DIR/status || exit
+
+# vim:set et sw=2 ts=2:
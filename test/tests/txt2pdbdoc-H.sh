@@ -0,0 +1,70 @@
+#! /bin/sh
+##
+#       txt2pdbdoc -- Text to Doc converter for Palm Pilots
+#       test/tests/txt2pdbdoc-H.sh
+#
+#       Copyright (C) 2024  Paul J. Lucas
+#
+#       This program is free software; you can redistribute it and/or modify
+#       it under the terms of the GNU General Public License as published by
+#       the Free Software Foundation; either version 2 of the Licence, or
+#       (at your option) any later version.
+#
+#       This program is distributed in the hope that it will be useful,
+#       but WITHOUT ANY WARRANTY; without even the implied warranty of
+#       MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#       GNU General Public License for more details.
+#
+#       You should have received a copy of the GNU General Public License
+#       along with this program.  If not, see <http://www.gnu.org/licenses/>.
+##
+
+##
+# Tests encoding HTML (-H): the text must be what html2pdbtxt produces, the
+# record 0 document size must be exact, with -m, every <A NAME> must become
+# a bookmark record, and HTML that converts into more text than its own size
+# must be encoded in full, split into correctly named volumes if need be.
+##
+
+OUTPUT=$1
+LOG_FILE=$2
+DATA_DIR=$srcdir/data
+EXPECTED_DIR=$srcdir/expected
+trap "rm -f ${OUTPUT}*" EXIT
+
+txt2pdbdoc -t -H Sample $DATA_DIR/sample.html ${OUTPUT}.pdb 2>> $LOG_FILE ||
+  exit
+txt2pdbdoc -d ${OUTPUT}.pdb ${OUTPUT}.txt 2>> $LOG_FILE || exit
+cmp $EXPECTED_DIR/txt2pdbdoc-H.txt ${OUTPUT}.txt >> $LOG_FILE || exit
+txt2pdbdoc -k ${OUTPUT}.pdb >> $LOG_FILE 2>&1 || exit
+
+txt2pdbdoc -t -H -m Sample $DATA_DIR/sample.html ${OUTPUT}.pdb \
+  2>> $LOG_FILE || exit
+pdbdump -l ${OUTPUT}.pdb > ${OUTPUT}dump || exit
+cat ${OUTPUT}dump >> $LOG_FILE
+grep -q '^Records: 4$' ${OUTPUT}dump || exit
+txt2pdbdoc -d ${OUTPUT}.pdb ${OUTPUT}.txt 2>> $LOG_FILE || exit
+cmp $EXPECTED_DIR/txt2pdbdoc-H.txt ${OUTPUT}.txt >> $LOG_FILE || exit
+
+# 1600 bytes of <HR> tags become 400 rules of 68 characters: 5 records
+awk 'BEGIN { for ( i = 1; i <= 400; ++i ) printf "<hr>" }' > ${OUTPUT}.html
+txt2pdbdoc -t -H -r 2048 Rules ${OUTPUT}.html ${OUTPUT}.pdb 2>> $LOG_FILE ||
+  exit
+txt2pdbdoc -d ${OUTPUT}.pdb ${OUTPUT}.txt 2>> $LOG_FILE || exit
+[ `grep -c . ${OUTPUT}.txt` -eq 400 ] || exit
+txt2pdbdoc -t -H -r 2048 -n 2 Rules ${OUTPUT}.html ${OUTPUT}v.pdb \
+  2>> $LOG_FILE || exit
+rm -f ${OUTPUT}v.txt
+for v in 1 2 3
+do
+  case $v in
+  1) PDB=${OUTPUT}v.pdb ;;
+  *) PDB=${OUTPUT}v.$v.pdb ;;
+  esac
+  pdbdump -l $PDB > ${OUTPUT}dump || exit
+  grep -q "^   Name: Rules $v/3\$" ${OUTPUT}dump || exit
+  txt2pdbdoc -d $PDB >> ${OUTPUT}v.txt 2>> $LOG_FILE || exit
+done
+cmp ${OUTPUT}.txt ${OUTPUT}v.txt >> $LOG_FILE
+
+# vim:set et sw=2 ts=2:
@@ -0,0 +1,65 @@
+#! /bin/sh
+##
+#       txt2pdbdoc -- Text to Doc converter for Palm Pilots
+#       test/tests/txt2pdbdoc-S.sh
+#
+#       Copyright (C) 2024  Paul J. Lucas
+#
+#       This program is free software; you can redistribute it and/or modify
+#       it under the terms of the GNU General Public License as published by
+#       the Free Software Foundation; either version 2 of the Licence, or
+#       (at your option) any later version.
+#
+#       This program is distributed in the hope that it will be useful,
+#       but WITHOUT ANY WARRANTY; without even the implied warranty of
+#       MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#       GNU General Public License for more details.
+#
+#       You should have received a copy of the GNU General Public License
+#       along with this program.  If not, see <http://www.gnu.org/licenses/>.
+##
+
+##
+# Tests the conversion server (-S) via its client (-C): conversions must match
+# local ones, oversized requests must be rejected, and the socket must be
+# removed upon shutdown.
+##
+
+OUTPUT=$1
+LOG_FILE=$2
+DATA_DIR=$srcdir/data
+SOCKET=${OUTPUT}sock
+
+txt2pdbdoc -S $SOCKET -j 2 -M 8192 2>> $LOG_FILE &
+SERVER=$!
+trap "kill $SERVER 2>/dev/null; rm -f ${OUTPUT}*" EXIT
+
+tries=0
+until [ -S $SOCKET ]
+do
+  tries=`expr $tries + 1`
+  [ $tries -le 50 ] || exit
+  sleep 0.1
+done
+
+txt2pdbdoc -t Sample $DATA_DIR/sample.txt ${OUTPUT}local.pdb 2>> $LOG_FILE ||
+  exit
+txt2pdbdoc -C $SOCKET -t Sample $DATA_DIR/sample.txt ${OUTPUT}remote.pdb \
+  2>> $LOG_FILE || exit
+cmp ${OUTPUT}local.pdb ${OUTPUT}remote.pdb >> $LOG_FILE || exit
+
+txt2pdbdoc -C $SOCKET -d ${OUTPUT}remote.pdb ${OUTPUT}remote.txt \
+  2>> $LOG_FILE || exit
+cmp $DATA_DIR/sample.txt ${OUTPUT}remote.txt >> $LOG_FILE || exit
+
+# a request larger than -M must fail but leave the server running
+head -c 10000 /dev/zero > ${OUTPUT}big.txt
+txt2pdbdoc -C $SOCKET Big ${OUTPUT}big.txt ${OUTPUT}big.pdb 2>> $LOG_FILE &&
+  exit 1
+txt2pdbdoc -C $SOCKET -d ${OUTPUT}remote.pdb > /dev/null 2>> $LOG_FILE || exit
+
+kill $SERVER
+wait $SERVER || exit
+[ ! -e $SOCKET ]
+
+# vim:set et sw=2 ts=2:
@@ -0,0 +1,83 @@
+#! /bin/sh
+##
+#       txt2pdbdoc -- Text to Doc converter for Palm Pilots
+#       test/tests/txt2pdbdoc-W.sh
+#
+#       Copyright (C) 2024  Paul J. Lucas
+#
+#       This program is free software; you can redistribute it and/or modify
+#       it under the terms of the GNU General Public License as published by
+#       the Free Software Foundation; either version 2 of the Licence, or
+#       (at your option) any later version.
+#
+#       This program is distributed in the hope that it will be useful,
+#       but WITHOUT ANY WARRANTY; without even the implied warranty of
+#       MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#       GNU General Public License for more details.
+#
+#       You should have received a copy of the GNU General Public License
+#       along with this program.  If not, see <http://www.gnu.org/licenses/>.
+##
+
+##
+# Tests watch mode (-W): a text file written into a subdirectory of the watched
+# directory must be encoded to the mirrored output directory the same as
+# encoding it directly, with its latency logged; if a volume can't be renamed
+# into place, no temporary volumes may be left behind.
+##
+
+OUTPUT=$1
+LOG_FILE=$2
+DATA_DIR=$srcdir/data
+WATCH_DIR=${OUTPUT}watch
+OUT_DIR=${OUTPUT}out
+
+mkdir -p $WATCH_DIR/sub || exit
+txt2pdbdoc -W -t -e 50 -j 2 -n 2 $WATCH_DIR $OUT_DIR > ${OUTPUT}log 2>> $LOG_FILE &
+WATCHER=$!
+trap "kill $WATCHER 2>/dev/null; rm -rf ${OUTPUT}*" EXIT
+
+sleep 0.5
+if ! kill -0 $WATCHER 2>/dev/null
+then
+  wait $WATCHER
+  [ $? -eq 69 ] && exit 0               # EX_UNAVAILABLE: no inotify
+  exit 1
+fi
+
+cp $DATA_DIR/sample.txt $WATCH_DIR/sub/sample.txt || exit
+
+tries=0
+until grep -q "^ok" ${OUTPUT}log
+do
+  tries=`expr $tries + 1`
+  [ $tries -le 100 ] || exit
+  sleep 0.1
+done
+
+txt2pdbdoc -t sample $DATA_DIR/sample.txt ${OUTPUT}direct.pdb 2>> $LOG_FILE ||
+  exit
+cmp ${OUTPUT}direct.pdb $OUT_DIR/sub/sample.pdb >> $LOG_FILE || exit
+[ ! -e $OUT_DIR/sub/sample.pdb.tmp ] || exit
+awk -F'\t' '$1 == "ok" && NF == 6 && $6 >= 0 { found = 1 } END { exit !found }' \
+  ${OUTPUT}log || exit
+
+for i in 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20
+do cat $DATA_DIR/sample.txt
+done > ${OUTPUT}big.txt
+mkdir $OUT_DIR/sub/big.2.pdb || exit   # volume 2 can't be renamed onto it
+cp ${OUTPUT}big.txt $WATCH_DIR/sub/big.txt || exit
+
+tries=0
+until grep -q "^error" ${OUTPUT}log
+do
+  tries=`expr $tries + 1`
+  [ $tries -le 100 ] || exit
+  sleep 0.1
+done
+[ -z "`find $OUT_DIR -name '*.tmp'`" ] || exit
+
+kill $WATCHER
+wait $WATCHER
+
+# vim:set et sw=2 ts=2:
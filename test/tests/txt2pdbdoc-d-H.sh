@@ -0,0 +1,47 @@
+#! /bin/sh
+##
+#       txt2pdbdoc -- Text to Doc converter for Palm Pilots
+#       test/tests/txt2pdbdoc-d-H.sh
+#
+#       Copyright (C) 2024  Paul J. Lucas
+#
+#       This program is free software; you can redistribute it and/or modify
+#       it under the terms of the GNU General Public License as published by
+#       the Free Software Foundation; either version 2 of the Licence, or
+#       (at your option) any later version.
+#
+#       This program is distributed in the hope that it will be useful,
+#       but WITHOUT ANY WARRANTY; without even the implied warranty of
+#       MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#       GNU General Public License for more details.
+#
+#       You should have received a copy of the GNU General Public License
+#       along with this program.  If not, see <http://www.gnu.org/licenses/>.
+##
+
+##
+# Tests decoding to HTML (-d -H): with bookmark records, the table of contents
+# must come from them; without, from the headings found by scanning the text.
+##
+
+OUTPUT=$1
+LOG_FILE=$2
+DATA_DIR=$srcdir/data
+EXPECTED_DIR=$srcdir/expected
+trap "rm -f ${OUTPUT}*" EXIT
+
+txt2pdbdoc -t -m Alice $DATA_DIR/bookmarks.txt ${OUTPUT}.pdb 2>> $LOG_FILE ||
+  exit
+txt2pdbdoc -d -H ${OUTPUT}.pdb ${OUTPUT}.html 2>> $LOG_FILE || exit
+diff $EXPECTED_DIR/txt2pdbdoc-d-H.html ${OUTPUT}.html >> $LOG_FILE || exit
+
+txt2pdbdoc -t Alice $DATA_DIR/bookmarks.txt ${OUTPUT}.pdb 2>> $LOG_FILE ||
+  exit
+txt2pdbdoc -d -H ${OUTPUT}.pdb ${OUTPUT}.html 2>> $LOG_FILE || exit
+cat ${OUTPUT}.html >> $LOG_FILE
+grep -q '^<DD><DL COMPACT>$' ${OUTPUT}.html || exit
+grep -q '^<DT><A HREF="#the_pool_of_tears">The Pool of Tears</A>$' \
+  ${OUTPUT}.html || exit
+grep -q '^<H3>The Pool of Tears</H3>' ${OUTPUT}.html
+
+# vim:set et sw=2 ts=2:
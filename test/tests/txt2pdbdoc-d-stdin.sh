@@ -0,0 +1,58 @@
+#! /bin/sh
+##
+#       txt2pdbdoc -- Text to Doc converter for Palm Pilots
+#       test/tests/txt2pdbdoc-d-stdin.sh
+#
+#       Copyright (C) 2024  Paul J. Lucas
+#
+#       This program is free software; you can redistribute it and/or modify
+#       it under the terms of the GNU General Public License as published by
+#       the Free Software Foundation; either version 2 of the Licence, or
+#       (at your option) any later version.
+#
+#       This program is distributed in the hope that it will be useful,
+#       but WITHOUT ANY WARRANTY; without even the implied warranty of
+#       MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#       GNU General Public License for more details.
+#
+#       You should have received a copy of the GNU General Public License
+#       along with this program.  If not, see <http://www.gnu.org/licenses/>.
+##
+
+##
+# Tests decoding from a pipe (-d -): records must be read as they arrive,
+# including bookmark records after the text, giving the same text and HTML as
+# decoding a file; truncated input must fail.
+##
+
+OUTPUT=$1
+LOG_FILE=$2
+DATA_DIR=$srcdir/data
+trap "rm -f ${OUTPUT}*" EXIT
+
+# several text records followed by bookmark records
+for i in 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20
+do cat $DATA_DIR/bookmarks.txt
+done > ${OUTPUT}.txt
+txt2pdbdoc -t -r 2048 -m Alice ${OUTPUT}.txt ${OUTPUT}.pdb 2>> $LOG_FILE ||
+  exit
+
+txt2pdbdoc -d ${OUTPUT}.pdb ${OUTPUT}file.txt 2>> $LOG_FILE || exit
+cat ${OUTPUT}.pdb | txt2pdbdoc -d - ${OUTPUT}pipe.txt 2>> $LOG_FILE || exit
+cmp ${OUTPUT}file.txt ${OUTPUT}pipe.txt >> $LOG_FILE || exit
+
+txt2pdbdoc -d -H ${OUTPUT}.pdb ${OUTPUT}file.html 2>> $LOG_FILE || exit
+cat ${OUTPUT}.pdb | txt2pdbdoc -d -H - ${OUTPUT}pipe.html 2>> $LOG_FILE ||
+  exit
+cmp ${OUTPUT}file.html ${OUTPUT}pipe.html >> $LOG_FILE || exit
+
+txt2pdbdoc -t -c Sample $DATA_DIR/sample.txt ${OUTPUT}.pdb 2>> $LOG_FILE ||
+  exit
+cat ${OUTPUT}.pdb | txt2pdbdoc -d - ${OUTPUT}pipe.txt 2>> $LOG_FILE || exit
+cmp $DATA_DIR/sample.txt ${OUTPUT}pipe.txt >> $LOG_FILE || exit
+
+head -c 100 ${OUTPUT}.pdb | txt2pdbdoc -d - > /dev/null 2>> $LOG_FILE &&
+  exit 1
+exit 0
+
+# vim:set et sw=2 ts=2:
@@ -0,0 +1,54 @@
+#! /bin/sh
+##
+#       txt2pdbdoc -- Text to Doc converter for Palm Pilots
+#       test/tests/txt2pdbdoc-k.sh
+#
+#       Copyright (C) 2024  Paul J. Lucas
+#
+#       This program is free software; you can redistribute it and/or modify
+#       it under the terms of the GNU General Public License as published by
+#       the Free Software Foundation; either version 2 of the Licence, or
+#       (at your option) any later version.
+#
+#       This program is distributed in the hope that it will be useful,
+#       but WITHOUT ANY WARRANTY; without even the implied warranty of
+#       MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#       GNU General Public License for more details.
+#
+#       You should have received a copy of the GNU General Public License
+#       along with this program.  If not, see <http://www.gnu.org/licenses/>.
+##
+
+##
+# Tests verify mode (-k): valid files must pass and truncated or corrupted
+# ones must fail with the offending record reported.
+##
+
+OUTPUT=$1
+LOG_FILE=$2
+EXPECTED_DIR=$srcdir/expected
+trap "rm -f ${OUTPUT}*" EXIT
+
+GOOD_C=$EXPECTED_DIR/txt2pdbdoc-t_01.pdb
+GOOD_U=$EXPECTED_DIR/txt2pdbdoc-c-t_01.pdb
+# text that shrinks when transcoded
+SHRUNK_C=$EXPECTED_DIR/txt2pdbdoc-t_02.pdb
+SHRUNK_U=$EXPECTED_DIR/txt2pdbdoc-c-t_02.pdb
+
+txt2pdbdoc -k -j 2 $GOOD_C $GOOD_U $SHRUNK_C $SHRUNK_U > ${OUTPUT}status \
+  2>> $LOG_FILE || exit
+[ `grep -c '^ok	' ${OUTPUT}status` -eq 4 ] || exit
+
+head -c 200 $GOOD_C > ${OUTPUT}short.pdb
+cp $GOOD_C ${OUTPUT}bad.pdb
+printf '\377\377' | dd of=${OUTPUT}bad.pdb bs=1 seek=120 conv=notrunc 2> /dev/null
+
+printf '%s\n' $GOOD_C ${OUTPUT}short.pdb ${OUTPUT}bad.pdb |
+  txt2pdbdoc -k - > ${OUTPUT}status 2>> $LOG_FILE
+[ $? -eq 65 ] || exit
+cat ${OUTPUT}status >> $LOG_FILE
+grep -q "^ok	$GOOD_C\$" ${OUTPUT}status || exit
+grep -q "^error	${OUTPUT}short.pdb	record 1: " ${OUTPUT}status || exit
+grep -q "^error	${OUTPUT}bad.pdb	record 1: " ${OUTPUT}status
+
+# vim:set et sw=2 ts=2:
@@ -0,0 +1,57 @@
+#! /bin/sh
+##
+#       txt2pdbdoc -- Text to Doc converter for Palm Pilots
+#       test/tests/txt2pdbdoc-m.sh
+#
+#       Copyright (C) 2024  Paul J. Lucas
+#
+#       This program is free software; you can redistribute it and/or modify
+#       it under the terms of the GNU General Public License as published by
+#       the Free Software Foundation; either version 2 of the Licence, or
+#       (at your option) any later version.
+#
+#       This program is distributed in the hope that it will be useful,
+#       but WITHOUT ANY WARRANTY; without even the implied warranty of
+#       MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#       GNU General Public License for more details.
+#
+#       You should have received a copy of the GNU General Public License
+#       along with this program.  If not, see <http://www.gnu.org/licenses/>.
+##
+
+##
+# Tests bookmarks (-m): a marker taken from the final <marker> line must give
+# the same file as the marker given explicitly, bookmark records must follow
+# the text records with record 0 right after the record list, and decoding
+# must ignore them.
+##
+
+OUTPUT=$1
+LOG_FILE=$2
+DATA_DIR=$srcdir/data
+trap "rm -f ${OUTPUT}*" EXIT
+
+txt2pdbdoc -t -m Alice $DATA_DIR/bookmarks.txt ${OUTPUT}.pdb 2>> $LOG_FILE ||
+  exit
+txt2pdbdoc -t --bookmarks='(*)' Alice $DATA_DIR/bookmarks.txt \
+  ${OUTPUT}2.pdb 2>> $LOG_FILE || exit
+cmp ${OUTPUT}.pdb ${OUTPUT}2.pdb >> $LOG_FILE || exit
+
+pdbdump -r 2- ${OUTPUT}.pdb > ${OUTPUT}dump || exit
+cat ${OUTPUT}dump >> $LOG_FILE
+grep -q '^Records: 5$' ${OUTPUT}dump || exit
+grep -q ': 446F 776E .* Down the Rabbit\.$' ${OUTPUT}dump || exit
+grep -q ': 0000 0015 .*' ${OUTPUT}dump || exit
+grep -q ': 5468 6520 .* The Pool of Tea\.$' ${OUTPUT}dump || exit
+grep -q ': 0000 007D .*' ${OUTPUT}dump || exit
+grep -q ': 4120 4361 .* A Caucus-Race a\.$' ${OUTPUT}dump || exit
+
+# 78-byte header + 5 8-byte record entries = 0x76
+pdbdump -l ${OUTPUT}.pdb > ${OUTPUT}dump || exit
+grep -q '^    0 00000076 ' ${OUTPUT}dump || exit
+
+txt2pdbdoc -d ${OUTPUT}.pdb ${OUTPUT}.txt 2>> $LOG_FILE || exit
+cmp $DATA_DIR/bookmarks.txt ${OUTPUT}.txt >> $LOG_FILE || exit
+txt2pdbdoc -k ${OUTPUT}.pdb >> $LOG_FILE 2>&1
+
+# vim:set et sw=2 ts=2:
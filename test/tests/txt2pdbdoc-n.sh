@@ -0,0 +1,81 @@
+#! /bin/sh
+##
+#       txt2pdbdoc -- Text to Doc converter for Palm Pilots
+#       test/tests/txt2pdbdoc-n.sh
+#
+#       Copyright (C) 2024  Paul J. Lucas
+#
+#       This program is free software; you can redistribute it and/or modify
+#       it under the terms of the GNU General Public License as published by
+#       the Free Software Foundation; either version 2 of the Licence, or
+#       (at your option) any later version.
+#
+#       This program is distributed in the hope that it will be useful,
+#       but WITHOUT ANY WARRANTY; without even the implied warranty of
+#       MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#       GNU General Public License for more details.
+#
+#       You should have received a copy of the GNU General Public License
+#       along with this program.  If not, see <http://www.gnu.org/licenses/>.
+##
+
+##
+# Tests splitting text into volumes (-n): every volume must be a valid Doc
+# file with the right name and counts in both its header and record 0, the
+# volumes must decode back to the text in order, and batch mode must count
+# the bytes of every volume.
+##
+
+OUTPUT=$1
+LOG_FILE=$2
+trap "rm -rf ${OUTPUT}*" EXIT
+
+# 21893 bytes of text is 11 records of 2048 bytes: volumes of 5, 5, and 1
+awk 'BEGIN { for ( i = 1; i <= 1000; ++i ) print "Line", i, "of the text." }' \
+  > ${OUTPUT}.txt
+
+txt2pdbdoc -t -r 2048 -n 5 Test ${OUTPUT}.txt ${OUTPUT}.pdb 2>> $LOG_FILE ||
+  exit
+[ -f ${OUTPUT}.4.pdb ] && exit 1
+
+rm -f ${OUTPUT}.out
+for v in 1:5 2:5 3:1
+do
+  VOLUME=`echo $v | cut -d: -f1`
+  RECORDS=`echo $v | cut -d: -f2`
+  case $VOLUME in
+  1) PDB=${OUTPUT}.pdb ;;
+  *) PDB=${OUTPUT}.$VOLUME.pdb ;;
+  esac
+
+  pdbdump -l $PDB > ${OUTPUT}dump || exit
+  cat ${OUTPUT}dump >> $LOG_FILE
+  grep -q "^   Name: Test $VOLUME/3\$" ${OUTPUT}dump || exit
+  grep -q "^Records: `expr $RECORDS + 1`\$" ${OUTPUT}dump || exit
+
+  # record 0's number of text records
+  REC0=`od -An -tu1 -j78 -N4 $PDB |
+        awk '{ print (($1 * 256 + $2) * 256 + $3) * 256 + $4 }'`
+  N=`od -An -tu1 -j\`expr $REC0 + 8\` -N2 $PDB | awk '{ print $1 * 256 + $2 }'`
+  [ "$N" -eq $RECORDS ] || exit
+
+  txt2pdbdoc -k $PDB >> $LOG_FILE 2>&1 || exit
+  txt2pdbdoc -d $PDB >> ${OUTPUT}.out 2>> $LOG_FILE || exit
+done
+cmp ${OUTPUT}.txt ${OUTPUT}.out >> $LOG_FILE || exit
+
+txt2pdbdoc -n 0 Test ${OUTPUT}.txt ${OUTPUT}.pdb 2>> $LOG_FILE && exit 1
+
+##
+# Batch mode: the output size is that of all the volumes.
+##
+mkdir ${OUTPUT}dir || exit
+cp ${OUTPUT}.txt ${OUTPUT}dir/v.txt || exit
+txt2pdbdoc -B -t -r 2048 -n 5 ${OUTPUT}dir > ${OUTPUT}status 2>> $LOG_FILE ||
+  exit
+cat ${OUTPUT}status >> $LOG_FILE
+SIZE=`cat ${OUTPUT}dir/v.pdb ${OUTPUT}dir/v.2.pdb ${OUTPUT}dir/v.3.pdb | wc -c`
+[ "`cut -f5 ${OUTPUT}status`" -eq $SIZE ] || exit
+exit 0
+
+# vim:set et sw=2 ts=2:
@@ -0,0 +1,54 @@
+#! /bin/sh
+##
+#       txt2pdbdoc -- Text to Doc converter for Palm Pilots
+#       test/tests/txt2pdbdoc-r.sh
+#
+#       Copyright (C) 2024  Paul J. Lucas
+#
+#       This program is free software; you can redistribute it and/or modify
+#       it under the terms of the GNU General Public License as published by
+#       the Free Software Foundation; either version 2 of the Licence, or
+#       (at your option) any later version.
+#
+#       This program is distributed in the hope that it will be useful,
+#       but WITHOUT ANY WARRANTY; without even the implied warranty of
+#       MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#       GNU General Public License for more details.
+#
+#       You should have received a copy of the GNU General Public License
+#       along with this program.  If not, see <http://www.gnu.org/licenses/>.
+##
+
+##
+# Tests the record size (-r): larger records must round-trip in fewer records
+# and decoding must reject records larger than record 0 says they are.
+##
+
+OUTPUT=$1
+LOG_FILE=$2
+trap "rm -f ${OUTPUT}*" EXIT
+
+awk 'BEGIN { for ( i = 1; i <= 1000; ++i ) print "Line", i, "of the text." }' \
+  > ${OUTPUT}.txt
+
+txt2pdbdoc -t -r 16384 Test ${OUTPUT}.txt ${OUTPUT}.pdb 2>> $LOG_FILE || exit
+pdbdump -l ${OUTPUT}.pdb > ${OUTPUT}dump || exit
+cat ${OUTPUT}dump >> $LOG_FILE
+grep -q '^Records: 3$' ${OUTPUT}dump || exit
+txt2pdbdoc -k ${OUTPUT}.pdb >> $LOG_FILE 2>&1 || exit
+txt2pdbdoc -d ${OUTPUT}.pdb ${OUTPUT}.out 2>> $LOG_FILE || exit
+cmp ${OUTPUT}.txt ${OUTPUT}.out >> $LOG_FILE || exit
+
+txt2pdbdoc -r 1024 Test ${OUTPUT}.txt ${OUTPUT}.pdb 2>> $LOG_FILE && exit 1
+
+# patch record 0's record size to 4096
+REC0=`od -An -tu1 -j78 -N4 ${OUTPUT}.pdb |
+      awk '{ print (($1 * 256 + $2) * 256 + $3) * 256 + $4 }'`
+printf '\020\000' |
+  dd of=${OUTPUT}.pdb bs=1 seek=`expr $REC0 + 10` conv=notrunc 2> /dev/null ||
+  exit
+txt2pdbdoc -d ${OUTPUT}.pdb ${OUTPUT}.out 2>> $LOG_FILE && exit 1
+txt2pdbdoc -k ${OUTPUT}.pdb >> $LOG_FILE 2>&1 && exit 1
+exit 0
+
+# vim:set et sw=2 ts=2:
@@ -0,0 +1,74 @@
+#! /bin/sh
+##
+#       txt2pdbdoc -- Text to Doc converter for Palm Pilots
+#       test/tests/txt2pdbdoc-s.sh
+#
+#       Copyright (C) 2024  Paul J. Lucas
+#
+#       This program is free software; you can redistribute it and/or modify
+#       it under the terms of the GNU General Public License as published by
+#       the Free Software Foundation; either version 2 of the Licence, or
+#       (at your option) any later version.
+#
+#       This program is distributed in the hope that it will be useful,
+#       but WITHOUT ANY WARRANTY; without even the implied warranty of
+#       MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#       GNU General Public License for more details.
+#
+#       You should have received a copy of the GNU General Public License
+#       along with this program.  If not, see <http://www.gnu.org/licenses/>.
+##
+
+##
+# Tests statistics (-s): they must not change the output, must be printed to
+# stderr as text by default or to a file (-F) as JSON, and must account for
+# every record and byte.  Encoding must use a bounded amount of memory no
+# matter how large the text is.
+##
+
+OUTPUT=$1
+LOG_FILE=$2
+DATA_DIR=$srcdir/data
+EXPECTED_DIR=$srcdir/expected
+trap "rm -f ${OUTPUT}*" EXIT
+
+##
+# Encode with text statistics.
+##
+txt2pdbdoc -t -s "Copyright Notice" $DATA_DIR/sample.txt ${OUTPUT}.pdb \
+  2> ${OUTPUT}stats || exit
+cat ${OUTPUT}stats >> $LOG_FILE
+cmp $EXPECTED_DIR/txt2pdbdoc-t_01.pdb ${OUTPUT}.pdb >> $LOG_FILE || exit
+grep -q '^compress ' ${OUTPUT}stats || exit
+grep -q '^bytes in: *750$' ${OUTPUT}stats || exit
+grep -q '^records: *1$' ${OUTPUT}stats || exit
+grep -q '^match attempts: *[1-9]' ${OUTPUT}stats || exit
+grep -q '^peak RSS: *[0-9]* KiB$' ${OUTPUT}stats || exit
+grep -q '^  record     1:   750 -> ' ${OUTPUT}stats || exit
+
+##
+# Decode with JSON statistics to a file.
+##
+txt2pdbdoc -d --stats=json --stats-file=${OUTPUT}json ${OUTPUT}.pdb \
+  ${OUTPUT}.txt 2>> $LOG_FILE || exit
+cat ${OUTPUT}json >> $LOG_FILE
+cmp $DATA_DIR/sample.txt ${OUTPUT}.txt >> $LOG_FILE || exit
+grep -q '"operation": "decode",' ${OUTPUT}json || exit
+grep -q '"decompress": { "wall_ns": [0-9]*, "cpu_ns": [0-9]*, "count": 1 }' \
+  ${OUTPUT}json || exit
+grep -q '"bytes_out": 750,' ${OUTPUT}json || exit
+grep -q '{ "record": 1, "bytes_in": [0-9]*, "bytes_out": 750, ' ${OUTPUT}json ||
+  exit
+
+##
+# Encode 16 MB uncompressed: the peak RSS must be well under the text's size.
+##
+yes 'The quick brown fox jumps over the lazy dog.' | head -c 16000000 \
+  > ${OUTPUT}big.txt
+txt2pdbdoc -c -r 2048 -s Big ${OUTPUT}big.txt ${OUTPUT}big.pdb \
+  2> ${OUTPUT}stats || exit
+RSS=`sed -n 's/^peak RSS: *\([0-9]*\) KiB$/\1/p' ${OUTPUT}stats`
+echo "peak RSS: $RSS KiB" >> $LOG_FILE
+[ "$RSS" ] && [ $RSS -lt 8192 ]
+
+# vim:set et sw=2 ts=2: